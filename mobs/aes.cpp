@@ -22,6 +22,7 @@
 #include "objtypes.h"
 #include "aes.h"
 #include "logging.h"
+#include "metrics.h"
 
 #include <openssl/ssl.h>
 #include <openssl/rand.h>
@@ -268,6 +269,7 @@ int mobs::CryptBufAes::underflowWorker(bool nowait) {
     data->inputStart = &data->inputBuf[0];
     if (1 != EVP_DecryptUpdate(data->ctx, (u_char *) &data->buffer[0], &len, start, int(sz)))
       throw openssl_exception(LOGSTR("mobs::CryptBufAes"));
+    Metrics::count("crypt.aes.decrypt", uint64_t(sz));
   }
   if (data->finished) {
     int lenf;
@@ -334,6 +336,7 @@ mobs::CryptBufAes::int_type mobs::CryptBufAes::overflow(mobs::CryptBufAes::int_t
       if (1 != EVP_EncryptUpdate(data->ctx, &buf[ofs], &len, (u_char *) (Base::pbase()),
                                  int(std::distance(Base::pbase(), Base::pptr()))))
         throw openssl_exception(LOGSTR("mobs::CryptBufAes"));
+      Metrics::count("crypt.aes.encrypt", uint64_t(std::distance(Base::pbase(), Base::pptr())));
 //    CSBLOG(LM_DEBUG, "Writing " << len << "  was " << std::distance(Base::pbase(), Base::pptr()));
       len += ofs;
       doWrite((char *) (&buf[0]), len);
@@ -0,0 +1,353 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "auditwriter.h"
+#include "dbifc.h"
+#include "converter.h"
+#include "logging.h"
+#include "condwait.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+
+namespace mobs {
+
+class AuditWriterData {
+public:
+  /// Eintrag in der Warteschlange
+  class Entry {
+  public:
+    Entry(size_t s, AuditQueued e, bool w) : seq(s), entry(std::move(e)), waiting(w) {}
+    size_t seq;
+    AuditQueued entry;
+    bool waiting; // Ergebnis wird im Modus Synchronous abgefragt
+    std::string error;
+  };
+
+  AuditWriterData(AuditWriter::Durability d, std::string file, size_t mq, size_t bs) :
+          durability(d), spoolFile(std::move(file)), maxQueue(mq ? mq : 1), batchSize(bs ? bs : 1) {}
+
+  void run();
+  size_t writeBatch(std::list<Entry> &batch);
+  void spool(const AuditQueued &entry);
+  void rewriteSpool();
+  void loadSpool();
+
+  AuditWriter::Durability durability;
+  std::string spoolFile;
+  size_t maxQueue;
+  size_t batchSize;
+
+  mutable std::mutex mutex;
+  std::condition_variable cond;
+  std::map<std::string, std::string> connections;
+  std::list<Entry> queue;
+  std::list<AuditQueued> failedEntries; // verbleiben in der Spool-Datei
+  std::map<size_t, std::string> errors; // Fehler je Eintrag für wartende Commits
+  std::ofstream spoolOut;
+  size_t inflight = 0;   // gesicherte, aber noch nicht übergebene Einträge
+  bool spoolDirty = false; // Spool-Datei enthält bereits abgearbeitete Einträge
+  size_t queuedSeq = 0;  // Anzahl übergebener Einträge
+  size_t doneSeq = 0;    // Anzahl abgearbeiteter Einträge
+  size_t writtenCnt = 0;
+  bool stop = false;
+  std::thread thread;
+};
+
+void AuditWriterData::spool(const AuditQueued &entry) {
+  if (not spoolOut.is_open())
+    return;
+  spoolOut << entry.to_string() << '\n';
+  spoolOut.flush();
+  if (spoolOut.fail())
+    THROW("error writing audit spool " << spoolFile);
+}
+
+void AuditWriterData::rewriteSpool() {
+  spoolDirty = false;
+  spoolOut.close();
+  spoolOut.open(spoolFile, std::ios::trunc);
+  for (auto &e:failedEntries)
+    spoolOut << e.to_string() << '\n';
+  spoolOut.flush();
+  if (spoolOut.fail())
+    LOG(LM_ERROR, "AuditWriter: error rewriting audit spool " << spoolFile);
+}
+
+void AuditWriterData::loadSpool() {
+  std::ifstream in(spoolFile);
+  if (not in.is_open())
+    return;
+  std::list<AuditQueued> entries;
+  std::set<std::string> cancelled;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty())
+      continue;
+    AuditQueued entry;
+    try {
+      string2Obj(line, entry);
+    } catch (std::exception &e) {
+      LOG(LM_ERROR, "AuditWriter: invalid entry in " << spoolFile << ": " << e.what());
+      continue;
+    }
+    if (entry.cancelled())
+      cancelled.insert(entry.txId());
+    else
+      entries.push_back(entry);
+  }
+  size_t cnt = 0;
+  for (auto &e:entries) {
+    if (not e.txId().empty() and cancelled.find(e.txId()) != cancelled.end())
+      continue;
+    queue.emplace_back(++queuedSeq, e, false);
+    cnt++;
+  }
+  spoolDirty = true;
+  if (cnt)
+    LOG(LM_INFO, "AuditWriter: " << cnt << " entries recovered from " << spoolFile);
+}
+
+size_t AuditWriterData::writeBatch(std::list<Entry> &batch) {
+  size_t cnt = 0;
+  // nach Verbindungen gruppieren, je Verbindung eine Transaktion
+  std::map<std::string, std::vector<Entry *>> groups;
+  for (auto &e:batch)
+    groups[e.entry.connection()].push_back(&e);
+  for (auto &g:groups) {
+    const std::string &con = g.first;
+    auto &entries = g.second;
+    for (int retry = 0;; retry++) {
+      try {
+        DatabaseManager::transaction_callback cb = [&con, &entries](DbTransaction *trans) {
+          DatabaseInterface dbi = trans->getDbIfc(con);
+          for (auto e:entries)
+            dbi.save(e->entry.activity);
+        };
+        DatabaseManager::execute(cb);
+        cnt += entries.size();
+        break;
+      } catch (locked_error &e) {
+        if (retry >= 10) {
+          LOG(LM_ERROR, "AuditWriter: database locked " << e.what());
+        } else {
+          std::this_thread::sleep_for(std::chrono::milliseconds(100 * (retry + 1)));
+          continue;
+        }
+      } catch (std::exception &e) {
+        LOG(LM_ERROR, "AuditWriter: batch failed " << e.what());
+      }
+      // Einzeln schreiben, damit ein fehlerhafter Eintrag nicht den ganzen Block verwirft
+      for (auto e:entries) {
+        try {
+          DatabaseManager::transaction_callback cb = [&con, e](DbTransaction *trans) {
+            DatabaseInterface dbi = trans->getDbIfc(con);
+            dbi.save(e->entry.activity);
+          };
+          DatabaseManager::execute(cb);
+          cnt++;
+        } catch (std::exception &ex) {
+          LOG(LM_ERROR, "AuditWriter: audit entry not written " << e->entry.activity.to_string() << ": " << ex.what());
+          e->error = ex.what();
+          if (e->error.empty())
+            e->error = "unknown error";
+        }
+      }
+      break;
+    }
+  }
+  return cnt;
+}
+
+void AuditWriterData::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    waitFor(cond, lock, [this]() { return stop or not queue.empty() or (spoolDirty and inflight == 0); });
+    if (not queue.empty()) {
+      std::list<Entry> batch;
+      auto end = queue.begin();
+      size_t n = 0;
+      for (; end != queue.end() and n < batchSize; ++end)
+        n++;
+      batch.splice(batch.end(), queue, queue.begin(), end);
+      cond.notify_all(); // Platz in der Warteschlange
+      lock.unlock();
+      size_t cnt = writeBatch(batch);
+      lock.lock();
+      writtenCnt += cnt;
+      for (auto &e:batch) {
+        if (e.error.empty())
+          continue;
+        failedEntries.push_back(e.entry);
+        if (e.waiting)
+          errors[e.seq] = e.error;
+      }
+      doneSeq += n;
+      spoolDirty = spoolOut.is_open();
+      cond.notify_all();
+    }
+    // alles abgearbeitet, in der Spool-Datei verbleiben nur die nicht geschriebenen Einträge
+    if (queue.empty() and inflight == 0 and spoolDirty)
+      rewriteSpool();
+    if (queue.empty() and stop)
+      break;
+  }
+}
+
+
+std::atomic<AuditWriter *> AuditWriter::writer{nullptr};
+
+AuditWriter::AuditWriter(Durability durability, const std::string &spoolFile, size_t maxQueue, size_t batchSize) {
+  if (writer)
+    throw std::runtime_error(u8"AuditWriter already exists");
+  data = std::unique_ptr<AuditWriterData>(new AuditWriterData(durability, spoolFile, maxQueue, batchSize));
+  if (not data->spoolFile.empty()) {
+    data->loadSpool();
+    data->spoolOut.open(data->spoolFile, std::ios::app);
+    if (not data->spoolOut.is_open())
+      THROW("can't open audit spool " << data->spoolFile);
+  }
+  data->thread = std::thread(&AuditWriterData::run, data.get());
+  writer = this;
+}
+
+AuditWriter::~AuditWriter() {
+  AuditWriter *self = this;
+  writer.compare_exchange_strong(self, nullptr);
+  {
+    std::lock_guard<std::mutex> guard(data->mutex);
+    data->stop = true;
+  }
+  data->cond.notify_all();
+  if (data->thread.joinable())
+    data->thread.join();
+}
+
+void AuditWriter::useConnection(const std::string &connectionName, const std::string &auditConnectionName) {
+  std::lock_guard<std::mutex> guard(data->mutex);
+  data->connections[connectionName] = auditConnectionName;
+}
+
+std::string AuditWriter::auditConnection(const std::string &connectionName) const {
+  std::lock_guard<std::mutex> guard(data->mutex);
+  auto i = data->connections.find(connectionName);
+  if (i == data->connections.end())
+    return {};
+  return i->second;
+}
+
+void AuditWriter::put(const std::string &auditConnectionName, const AuditActivity &activity) {
+  std::list<AuditQueued> entries(1);
+  entries.front().connection(auditConnectionName);
+  entries.front().activity(activity);
+  spool(entries);
+  submit(entries);
+}
+
+void AuditWriter::spool(std::list<AuditQueued> &entries) {
+  if (entries.empty())
+    return;
+  std::string txId = gen_uuid_v4_p();
+  std::lock_guard<std::mutex> guard(data->mutex);
+  if (data->stop)
+    THROW("AuditWriter is stopped");
+  // zählt ab hier, damit cancel() auch nach einem Schreibfehler passt
+  data->inflight += entries.size();
+  for (auto &e:entries) {
+    e.txId(txId);
+    data->spool(e);
+  }
+}
+
+void AuditWriter::submit(const std::list<AuditQueued> &entries) {
+  if (entries.empty())
+    return;
+  std::unique_lock<std::mutex> lock(data->mutex);
+  if (data->stop)
+    THROW("AuditWriter is stopped");
+  bool waiting = data->durability == Synchronous;
+  size_t first = data->queuedSeq + 1;
+  for (auto &e:entries) {
+    waitFor(data->cond, lock, [this]() { return data->queue.size() < data->maxQueue; });
+    data->queue.emplace_back(++data->queuedSeq, e, waiting);
+    data->inflight--;
+    data->cond.notify_all();
+  }
+  if (not waiting)
+    return;
+  size_t seq = data->queuedSeq;
+  waitFor(data->cond, lock, [this, seq]() { return data->doneSeq >= seq; });
+  std::string error;
+  for (auto i = data->errors.lower_bound(first); i != data->errors.end() and i->first <= seq;) {
+    error += ' ';
+    error += i->second;
+    i = data->errors.erase(i);
+  }
+  if (not error.empty())
+    THROW("audit trail not written:" << error);
+}
+
+void AuditWriter::cancel(const std::list<AuditQueued> &entries) {
+  if (entries.empty())
+    return;
+  std::lock_guard<std::mutex> guard(data->mutex);
+  data->inflight -= entries.size();
+  data->cond.notify_all();
+  AuditQueued c;
+  c.txId(entries.front().txId());
+  c.cancelled(true);
+  try {
+    data->spool(c);
+  } catch (std::exception &e) {
+    LOG(LM_ERROR, "AuditWriter: " << e.what());
+  }
+}
+
+void AuditWriter::flush() {
+  std::unique_lock<std::mutex> lock(data->mutex);
+  size_t seq = data->queuedSeq;
+  waitFor(data->cond, lock, [this, seq]() { return data->doneSeq >= seq; });
+}
+
+size_t AuditWriter::queued() const {
+  std::lock_guard<std::mutex> guard(data->mutex);
+  return data->queuedSeq - data->doneSeq;
+}
+
+size_t AuditWriter::written() const {
+  std::lock_guard<std::mutex> guard(data->mutex);
+  return data->writtenCnt;
+}
+
+size_t AuditWriter::failed() const {
+  std::lock_guard<std::mutex> guard(data->mutex);
+  return data->failedEntries.size();
+}
+
+
+}
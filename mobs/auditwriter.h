@@ -0,0 +1,144 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file auditwriter.h
+ \brief  Asynchrones Schreiben des Audit-Trails im Hintergrund */
+
+
+#ifndef MOBS_AUDITWRITER_H
+#define MOBS_AUDITWRITER_H
+
+#include "audittrail.h"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+
+
+namespace mobs {
+
+/// \private
+class AuditQueued : public mobs::ObjectBase {
+public:
+  ObjInit(AuditQueued);
+  MemVar(std::string, connection);
+  MemVar(std::string, txId); ///< Kennung der Transaktion in der Spool-Datei
+  MemVar(bool, cancelled); ///< Storno-Satz für txId nach gescheitertem Commit
+  MemObj(AuditActivity, activity);
+};
+
+class AuditWriterData;
+
+/** \brief Schreibt den Audit-Trail von Transaktionen gesammelt in einem Hintergrund-Thread
+ *
+ * Ohne AuditWriter wird jede AuditActivity innerhalb der Transaktion gespeichert. Ist ein AuditWriter instanziiert,
+ * so werden die Einträge der mit useConnection() angemeldeten Verbindungen nach erfolgreichem Commit an den Writer
+ * übergeben. Dieser sammelt die Einträge vieler Transaktionen und speichert sie in einer gemeinsamen Transaktion.
+ *
+ * Da die Datenbank-Verbindungen nicht thread-sicher sind, schreibt der Writer über eine eigene, separat beim
+ * DatabaseManager angemeldete Verbindung auf dieselbe Datenbank.
+ *
+ * Die Warteschlange ist begrenzt; ist sie voll, so blockiert der Commit, bis wieder Platz ist.
+ * Im Modus \c Synchronous kehrt der Commit erst zurück, wenn der Audit-Trail geschrieben wurde; konnte ein Eintrag
+ * nicht geschrieben werden, wirft er eine Exception, obwohl die Daten bereits festgeschrieben sind. Im Modus
+ * \c Asynchronous kehrt der Commit sofort zurück.
+ *
+ * Ist eine Spool-Datei angegeben, so werden die Einträge einer Transaktion vor deren Commit dort angehängt; scheitert
+ * der Commit, so wird ein Storno-Satz angehängt. Sind alle Einträge abgearbeitet, wird die Datei neu geschrieben und
+ * enthält danach nur noch die Einträge, die nicht geschrieben werden konnten. Beim Start werden die verbliebenen
+ * Einträge erneut geschrieben. Bricht das Programm zwischen Spool und Commit ab, so wird dabei auch der Eintrag
+ * einer nicht festgeschriebenen Transaktion geschrieben.
+ *
+ * Das Objekt darf nur einmal instanziiert werden, und zwar nach dem DatabaseManager und dem Anmelden der Verbindungen.
+ * Im Destruktor werden alle anstehenden Einträge noch geschrieben.
+ * \code
+ * mobs::DatabaseManager dbMgr;
+ * dbMgr.addConnection("my_maria", mobs::ConnectionInformation("mariadb://localhost", "mobs"));
+ * dbMgr.addConnection("my_maria_audit", mobs::ConnectionInformation("mariadb://localhost", "mobs"));
+ * mobs::AuditWriter auditWriter(mobs::AuditWriter::Asynchronous, "audit.spool");
+ * auditWriter.useConnection("my_maria", "my_maria_audit");
+ * \endcode
+ */
+class AuditWriter {
+public:
+  /// Modus für das Verhalten beim Commit
+  enum Durability {
+    Synchronous, ///< Commit wartet, bis der Audit-Trail geschrieben ist
+    Asynchronous ///< Commit kehrt sofort zurück
+  };
+
+  /** \brief Konstruktor, startet den Hintergrund-Thread
+   *
+   * @param durability Verhalten beim Commit
+   * @param spoolFile Datei zur Absicherung noch nicht geschriebener Einträge; leer für keine
+   * @param maxQueue maximale Anzahl wartender Einträge
+   * @param batchSize maximale Anzahl Einträge je Schreib-Transaktion
+   * \throw runtime_error wenn bereits ein AuditWriter existiert oder die Spool-Datei nicht geöffnet werden kann
+   */
+  explicit AuditWriter(Durability durability = Asynchronous, const std::string &spoolFile = "", size_t maxQueue = 10000,
+                       size_t batchSize = 100);
+  /// Destruktor, schreibt alle anstehenden Einträge
+  ~AuditWriter();
+
+  AuditWriter(const AuditWriter &) = delete;
+  AuditWriter &operator=(const AuditWriter &) = delete;
+
+  /// globaler Zugriff auf den Writer, sofern initialisiert
+  static AuditWriter *instance() noexcept { return writer.load(); }
+
+  /** \brief Audit-Trail der Verbindung über den Writer schreiben
+   *
+   * @param connectionName Name der Verbindung der Applikation
+   * @param auditConnectionName Name einer eigenen Verbindung zur selben Datenbank, über die der Writer schreibt
+   */
+  void useConnection(const std::string &connectionName, const std::string &auditConnectionName);
+
+  /// liefert den Namen der Verbindung des Writers oder "", wenn die Verbindung nicht über den Writer läuft
+  std::string auditConnection(const std::string &connectionName) const;
+
+  /// Übergabe eines Eintrags; die Verbindung ist bereits die des Writers
+  void put(const std::string &auditConnectionName, const AuditActivity &activity);
+
+  /// \private Einträge einer Transaktion vor dem Commit in der Spool-Datei sichern
+  void spool(std::list<AuditQueued> &entries);
+  /// \private Einträge nach erfolgreichem Commit übergeben; \throw runtime_error bei Fehler im Modus Synchronous
+  void submit(const std::list<AuditQueued> &entries);
+  /// \private bereits gesicherte Einträge nach gescheitertem Commit verwerfen
+  void cancel(const std::list<AuditQueued> &entries);
+
+  /// warte, bis alle anstehenden Einträge geschrieben sind
+  void flush();
+
+  /// Anzahl der wartenden Einträge
+  size_t queued() const;
+  /// Anzahl der bisher geschriebenen Einträge
+  size_t written() const;
+  /// Anzahl der Einträge, die nicht geschrieben werden konnten; sie verbleiben in der Spool-Datei
+  size_t failed() const;
+
+private:
+  static std::atomic<AuditWriter *> writer;
+  std::unique_ptr<AuditWriterData> data;
+};
+
+
+}
+
+#endif //MOBS_AUDITWRITER_H
@@ -0,0 +1,471 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "blobstore.h"
+#include "dbifc.h"
+#include "converter.h"
+#include "logging.h"
+#include "condwait.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+
+namespace {
+using namespace mobs;
+
+// gemeinsame Synchronisation der Threads eines BlobStore-Zugriffs
+class ChunkSync {
+public:
+  void fail(std::exception_ptr e) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (not failed)
+      error = std::move(e);
+    failed = true;
+    cond.notify_all();
+  }
+
+  std::exception_ptr error;
+
+protected:
+
+  bool failed = false;
+  std::mutex mutex;
+  std::condition_variable cond;
+};
+
+// Übergabe der gelesenen Teilstücke an die schreibenden Threads
+class UploadQueue : public ChunkSync {
+public:
+  explicit UploadQueue(size_t mq) : maxQueue(mq ? mq : 1) {}
+
+  // liefert false, wenn abgebrochen wurde
+  bool put(uint64_t n, std::vector<u_char> &&data) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitFor(cond, lock, [this]() { return failed or queue.size() < maxQueue; });
+    if (failed)
+      return false;
+    queue.emplace_back(n, std::move(data));
+    cond.notify_all();
+    return true;
+  }
+  // liefert false, wenn alles abgearbeitet ist oder abgebrochen wurde
+  bool get(uint64_t &n, std::vector<u_char> &data) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitFor(cond, lock, [this]() { return failed or not queue.empty() or closed; });
+    if (failed or queue.empty())
+      return false;
+    n = queue.front().first;
+    data = std::move(queue.front().second);
+    queue.pop_front();
+    cond.notify_all();
+    return true;
+  }
+  void close() {
+    std::lock_guard<std::mutex> guard(mutex);
+    closed = true;
+    cond.notify_all();
+  }
+
+private:
+  size_t maxQueue;
+  bool closed = false;
+  std::deque<std::pair<uint64_t, std::vector<u_char>>> queue;
+};
+
+// Vergabe der zu ladenden Teilstücke und Rückgabe in der richtigen Reihenfolge
+class DownloadWindow : public ChunkSync {
+public:
+  DownloadWindow(uint64_t first, uint64_t end, size_t window) : nextLoad(first), nextWrite(first), end(end),
+                                                               window(window ? window : 1) {}
+
+  // nächstes zu ladendes Teilstück; liefert false, wenn alles vergeben ist oder abgebrochen wurde
+  bool take(uint64_t &n) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitFor(cond, lock, [this]() { return failed or nextLoad >= end or nextLoad < nextWrite + window; });
+    if (failed or nextLoad >= end)
+      return false;
+    n = nextLoad++;
+    cond.notify_all();
+    return true;
+  }
+  void done(uint64_t n, std::vector<u_char> &&data) {
+    std::lock_guard<std::mutex> guard(mutex);
+    ready[n] = std::move(data);
+    cond.notify_all();
+  }
+  // nächstes Teilstück in Reihenfolge; liefert false, wenn abgebrochen wurde
+  bool next(std::vector<u_char> &data) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitFor(cond, lock, [this]() { return failed or ready.find(nextWrite) != ready.end(); });
+    if (failed)
+      return false;
+    auto i = ready.find(nextWrite);
+    data = std::move(i->second);
+    ready.erase(i);
+    nextWrite++;
+    cond.notify_all();
+    return true;
+  }
+
+private:
+  uint64_t nextLoad;
+  uint64_t nextWrite;
+  uint64_t end;
+  size_t window;
+  std::map<uint64_t, std::vector<u_char>> ready;
+};
+
+// zu lesender Bereich eines BLOBs
+class BlobRange {
+public:
+  BlobRange(const BlobInfo &info, uint64_t offset, uint64_t length) : size(info.size()), chunkSize(info.chunkSize()),
+                                                                       begin(offset) {
+    if (offset > size)
+      THROW("blob " << info.id() << " offset " << offset << " beyond size " << size);
+    if (chunkSize == 0 and size > 0)
+      THROW("blob " << info.id() << " invalid chunk size");
+    stop = length > size - offset ? size : offset + length;
+    first = begin < stop ? begin / chunkSize : 0;
+    end = begin < stop ? (stop - 1) / chunkSize + 1 : 0;
+  }
+  // Länge des Teilstücks n
+  uint64_t expected(uint64_t n) const { return std::min(uint64_t(chunkSize), size - n * chunkSize); }
+  // den angeforderten Teil des Teilstücks n ausgeben
+  void write(std::ostream &dest, uint64_t n, const std::vector<u_char> &data) const {
+    uint64_t pos = n * chunkSize;
+    uint64_t from = std::max(begin, pos) - pos;
+    uint64_t to = std::min(stop, pos + data.size()) - pos;
+    dest.write(reinterpret_cast<const char *>(&data[from]), std::streamsize(to - from));
+    if (dest.bad())
+      THROW("blob write to stream failed");
+  }
+
+  uint64_t size;
+  uint64_t chunkSize;
+  uint64_t begin;
+  uint64_t stop;
+  uint64_t first; // erstes Teilstück
+  uint64_t end; // Ende der Teilstücke (exklusiv)
+};
+
+// Id, unter der die Teilstücke abgelegt sind
+std::string chunkId(const BlobInfo &info) {
+  return info.chunkId().empty() ? info.id() : info.chunkId();
+}
+
+void loadChunk(DatabaseInterface &dbi, const std::string &id, uint64_t n, const BlobRange &range,
+               std::vector<u_char> &data) {
+  BlobChunk c;
+  c.id(id);
+  c.chunk(n);
+  if (not dbi.load(c))
+    THROW("blob " << id << " chunk " << n << " missing");
+  data = c.data();
+  if (data.size() != range.expected(n))
+    THROW("blob " << id << " chunk " << n << " has invalid size " << data.size());
+}
+
+BlobInfo loadInfo(DatabaseInterface &dbi, const std::string &id) {
+  BlobInfo info;
+  info.id(id);
+  if (not dbi.load(info))
+    THROW("blob " << id << " not found");
+  return info;
+}
+
+void eraseChunks(DatabaseInterface &dbi, const std::string &cid) {
+  BlobChunk c;
+  c.id(cid);
+  std::vector<uint64_t> chunks;
+  DatabaseInterface dbk = dbi.withKeysOnly();
+  for (auto cursor = dbk.qbe(c); not cursor->eof(); cursor->next()) {
+    BlobChunk k;
+    dbk.retrieve(k, cursor);
+    chunks.push_back(k.chunk());
+  }
+  for (auto n:chunks) {
+    c.chunk(n);
+    dbi.destroy(c);
+  }
+}
+
+// Teilstücke eines gescheiterten Schreibvorgangs entfernen
+void discardChunks(DatabaseInterface &dbi, const std::string &cid) {
+  try {
+    eraseChunks(dbi, cid);
+  } catch (std::exception &e) {
+    LOG(LM_ERROR, "BlobStore: cleanup of " << cid << " failed: " << e.what());
+  }
+}
+
+// Eigenschaften vor dem Schreiben lesen; ist der BLOB neu, bleibt die Version 0
+void startInfo(DatabaseInterface &dbi, const std::string &id, BlobInfo &info) {
+  info.id(id);
+  dbi.load(info);
+}
+
+// neue Eigenschaften speichern und damit auf die neuen Teilstücke umschalten, danach die alten löschen;
+// über das Versionsfeld scheitert das Speichern, wenn der BLOB seit startInfo() ersetzt wurde
+void saveInfo(DatabaseInterface &dbi, BlobInfo &info, const std::string &cid, uint64_t size, size_t chunkSize,
+              uint64_t chunks) {
+  std::string old = chunkId(info);
+  info.size(size);
+  info.chunkSize(uint32_t(chunkSize));
+  info.chunks(chunks);
+  info.created(MTimeNow());
+  info.chunkId(cid);
+  try {
+    dbi.save(info);
+  } catch (...) {
+    discardChunks(dbi, cid);
+    throw;
+  }
+  discardChunks(dbi, old);
+}
+
+// bei konkurrierenden Schreibzugriffen (z.B. SQLite) mit Pause wiederholen
+void saveChunk(DatabaseInterface &dbi, const BlobChunk &c) {
+  for (int retry = 0;; retry++) {
+    try {
+      dbi.save(c);
+      return;
+    } catch (locked_error &e) {
+      if (retry >= 20)
+        throw;
+      std::this_thread::sleep_for(std::chrono::milliseconds(5 * (retry + 1)));
+    }
+  }
+}
+
+size_t readChunk(std::istream &source, std::vector<u_char> &buf) {
+  source.read(reinterpret_cast<char *>(&buf[0]), std::streamsize(buf.size()));
+  if (source.bad())
+    THROW("blob read from stream failed");
+  return size_t(source.gcount());
+}
+
+}
+
+namespace mobs {
+
+const uint64_t BlobStore::npos;
+const size_t BlobStore::defaultChunkSize;
+
+BlobStore::BlobStore(std::vector<std::string> connectionNames, size_t chunkSize) :
+        connections(std::move(connectionNames)), chunkSize(chunkSize) {
+  if (connections.empty())
+    THROW("BlobStore needs at least one connection");
+  if (chunkSize == 0 or chunkSize > std::numeric_limits<uint32_t>::max())
+    THROW("BlobStore invalid chunk size " << chunkSize);
+}
+
+std::vector<DatabaseInterface> BlobStore::interfaces() const {
+  DatabaseManager *dbm = DatabaseManager::instance();
+  if (not dbm)
+    throw std::runtime_error("DatabaseManager invalid");
+  std::vector<DatabaseInterface> result;
+  for (auto &c:connections)
+    result.push_back(dbm->getDbIfc(c));
+  return result;
+}
+
+void BlobStore::structure() {
+  DatabaseManager *dbm = DatabaseManager::instance();
+  if (not dbm)
+    throw std::runtime_error("DatabaseManager invalid");
+  DatabaseInterface dbi = dbm->getDbIfc(connections.front());
+  structure(dbi);
+}
+
+std::string BlobStore::upload(std::istream &source) {
+  std::string id = gen_uuid_v4_p();
+  upload(id, source);
+  return id;
+}
+
+void BlobStore::upload(const std::string &id, std::istream &source) {
+  std::vector<DatabaseInterface> dbis = interfaces();
+  if (dbis.size() == 1) {
+    write(dbis.front(), id, source, chunkSize);
+    return;
+  }
+  BlobInfo info;
+  startInfo(dbis.front(), id, info);
+  std::string cid = gen_uuid_v4_p();
+  UploadQueue queue(2 * dbis.size());
+  std::vector<std::thread> pool;
+  for (auto &d:dbis) {
+    pool.emplace_back([&queue, &d, &cid]() {
+      try {
+        uint64_t n;
+        std::vector<u_char> data;
+        while (queue.get(n, data)) {
+          BlobChunk c;
+          c.id(cid);
+          c.chunk(n);
+          c.data(data);
+          saveChunk(d, c);
+        }
+      } catch (...) {
+        queue.fail(std::current_exception());
+      }
+    });
+  }
+  uint64_t n = 0;
+  uint64_t total = 0;
+  try {
+    for (;;) {
+      std::vector<u_char> buf(chunkSize);
+      size_t sz = readChunk(source, buf);
+      if (sz == 0)
+        break;
+      buf.resize(sz);
+      total += sz;
+      if (not queue.put(n++, std::move(buf)) or sz < chunkSize)
+        break;
+    }
+  } catch (...) {
+    queue.fail(std::current_exception());
+  }
+  queue.close();
+  for (auto &t:pool)
+    t.join();
+  if (queue.error) {
+    discardChunks(dbis.front(), cid);
+    std::rethrow_exception(queue.error);
+  }
+  saveInfo(dbis.front(), info, cid, total, chunkSize, n);
+}
+
+void BlobStore::download(const std::string &id, std::ostream &dest, uint64_t offset, uint64_t length) {
+  std::vector<DatabaseInterface> dbis = interfaces();
+  BlobInfo info = loadInfo(dbis.front(), id);
+  BlobRange range(info, offset, length);
+  if (dbis.size() == 1 or range.end - range.first <= 1) {
+    read(dbis.front(), id, dest, offset, length);
+    return;
+  }
+  DownloadWindow window(range.first, range.end, 2 * dbis.size());
+  std::vector<std::thread> pool;
+  std::string cid = chunkId(info);
+  for (auto &d:dbis) {
+    pool.emplace_back([&window, &d, &cid, &range]() {
+      try {
+        uint64_t n;
+        while (window.take(n)) {
+          std::vector<u_char> data;
+          loadChunk(d, cid, n, range, data);
+          window.done(n, std::move(data));
+        }
+      } catch (...) {
+        window.fail(std::current_exception());
+      }
+    });
+  }
+  try {
+    std::vector<u_char> data;
+    for (uint64_t n = range.first; n < range.end and window.next(data); n++)
+      range.write(dest, n, data);
+  } catch (...) {
+    window.fail(std::current_exception());
+  }
+  // Threads beenden, falls die Ausgabe abgebrochen wurde
+  window.fail(nullptr);
+  for (auto &t:pool)
+    t.join();
+  if (window.error)
+    std::rethrow_exception(window.error);
+}
+
+uint64_t BlobStore::size(const std::string &id) {
+  std::vector<DatabaseInterface> dbis = interfaces();
+  return loadInfo(dbis.front(), id).size();
+}
+
+bool BlobStore::remove(const std::string &id) {
+  std::vector<DatabaseInterface> dbis = interfaces();
+  return erase(dbis.front(), id);
+}
+
+void BlobStore::structure(DatabaseInterface &dbi) {
+  dbi.structure(BlobInfo());
+  dbi.structure(BlobChunk());
+}
+
+void BlobStore::write(DatabaseInterface &dbi, const std::string &id, std::istream &source, size_t chunkSize) {
+  if (chunkSize == 0 or chunkSize > std::numeric_limits<uint32_t>::max())
+    THROW("BlobStore invalid chunk size " << chunkSize);
+  BlobInfo info;
+  startInfo(dbi, id, info);
+  std::string cid = gen_uuid_v4_p();
+  std::vector<u_char> buf(chunkSize);
+  uint64_t n = 0;
+  uint64_t total = 0;
+  try {
+    for (;;) {
+      size_t sz = readChunk(source, buf);
+      if (sz == 0)
+        break;
+      BlobChunk c;
+      c.id(cid);
+      c.chunk(n++);
+      c.data(std::vector<u_char>(buf.begin(), buf.begin() + sz));
+      dbi.save(c);
+      total += sz;
+      if (sz < chunkSize)
+        break;
+    }
+  } catch (...) {
+    discardChunks(dbi, cid);
+    throw;
+  }
+  saveInfo(dbi, info, cid, total, chunkSize, n);
+}
+
+void BlobStore::read(DatabaseInterface &dbi, const std::string &id, std::ostream &dest, uint64_t offset,
+                     uint64_t length) {
+  BlobInfo info = loadInfo(dbi, id);
+  BlobRange range(info, offset, length);
+  std::string cid = chunkId(info);
+  std::vector<u_char> data;
+  for (uint64_t n = range.first; n < range.end; n++) {
+    loadChunk(dbi, cid, n, range, data);
+    range.write(dest, n, data);
+  }
+}
+
+bool BlobStore::erase(DatabaseInterface &dbi, const std::string &id) {
+  BlobInfo info;
+  info.id(id);
+  bool found = dbi.load(info);
+  // zuerst die Eigenschaften, damit ein unvollständiger BLOB nicht mehr sichtbar ist
+  if (found)
+    dbi.destroy(info);
+  eraseChunks(dbi, found ? chunkId(info) : id);
+  return found;
+}
+
+
+}
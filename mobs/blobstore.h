@@ -0,0 +1,148 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file blobstore.h
+ \brief  Ablage großer BLOBs in Teilstücken über beliebige Datenbank-Verbindungen */
+
+
+#ifndef MOBS_BLOBSTORE_H
+#define MOBS_BLOBSTORE_H
+
+#include "objgen.h"
+#include "mchrono.h"
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+
+namespace mobs {
+
+class DatabaseInterface;
+
+/// Datenbank-Objekt mit den Eigenschaften eines BLOBs
+class BlobInfo : public mobs::ObjectBase {
+public:
+  ObjInit(BlobInfo, COLNAME(blobInfo));
+  MemVar(std::string, id, KEYELEMENT1, LENGTH(80));
+  MemVar(int64_t, version, VERSIONFIELD); ///< optimistisches Locking beim Ersetzen
+  MemVar(uint64_t, size);
+  MemVar(uint32_t, chunkSize);
+  MemVar(uint64_t, chunks);
+  MemVar(MTime, created, DBCOMPACT);
+  MemVar(std::string, chunkId, LENGTH(80)); ///< Id der Teilstücke; leer, wenn sie unter id abgelegt sind
+};
+
+/// Datenbank-Objekt für ein Teilstück eines BLOBs
+class BlobChunk : public mobs::ObjectBase {
+public:
+  ObjInit(BlobChunk, COLNAME(blobChunks));
+  MemVar(std::string, id, KEYELEMENT1, LENGTH(80));
+  MemVar(uint64_t, chunk, KEYELEMENT2);
+  MemVar(std::vector<u_char>, data);
+};
+
+/** \brief Speichert große BLOBs in Teilstücken fester Größe
+ *
+ * Die Teilstücke werden als mobs::BlobChunk, die Eigenschaften als mobs::BlobInfo über die normale
+ * Objekt-Schnittstelle gespeichert; damit steht die Ablage auf jeder Datenbank zur Verfügung. Die Tabellen
+ * werden mit structure() angelegt.
+ *
+ * Da Datenbank-Verbindungen nicht thread-sicher sind, werden für den parallelen Zugriff mehrere beim
+ * DatabaseManager angemeldete Verbindungen auf dieselbe Datenbank übergeben; jede wird von genau einem Thread benutzt.
+ * Beim Schreiben wird der Stream sequenziell gelesen und die Teilstücke parallel gespeichert, beim Lesen werden die
+ * Teilstücke parallel geladen und in der richtigen Reihenfolge ausgegeben. Die Eigenschaften werden erst nach allen
+ * Teilstücken gespeichert, ein BLOB ist also erst nach vollständigem Schreiben sichtbar.
+ *
+ * Die Teilstücke werden bei jedem Schreiben unter einer neuen Id (BlobInfo::chunkId) abgelegt. Beim Ersetzen eines
+ * BLOBs bleibt der alte Inhalt bis zum Speichern der neuen Eigenschaften vollständig lesbar; erst danach werden die
+ * alten Teilstücke gelöscht. Scheitert das Schreiben, bleibt der alte BLOB unverändert erhalten. Ein Lesevorgang,
+ * der während des Ersetzens läuft, kann mit einem Fehler für ein fehlendes Teilstück abbrechen.
+ * Wird derselbe BLOB gleichzeitig mehrfach ersetzt, gewinnt der erste; die anderen scheitern über das Versionsfeld
+ * von BlobInfo mit einem mobs::optLock_error und entfernen ihre Teilstücke wieder.
+ * \code
+ * mobs::BlobStore store({"blob1", "blob2", "blob3", "blob4"});
+ * store.structure();
+ * std::ifstream in("archive.tar", std::ios::binary);
+ * std::string id = store.upload(in);
+ * store.download(id, std::cout, 1024, 4096);
+ * \endcode
+ */
+class BlobStore {
+public:
+  /// Länge für "bis zum Ende"
+  static const uint64_t npos = std::numeric_limits<uint64_t>::max();
+  /// Standard-Größe eines Teilstücks
+  static const size_t defaultChunkSize = 255 * 1024;
+
+  /** \brief Konstruktor
+   *
+   * @param connectionNames Namen der beim DatabaseManager angemeldeten Verbindungen, je Verbindung ein Thread
+   * @param chunkSize Größe der Teilstücke in Bytes beim Schreiben
+   * \throw runtime_error wenn keine Verbindung angegeben ist
+   */
+  explicit BlobStore(std::vector<std::string> connectionNames, size_t chunkSize = defaultChunkSize);
+
+  /// Tabellen bzw. Collections anlegen
+  void structure();
+  /** \brief BLOB unter einer neuen Id speichern
+   *
+   * @param source Stream, aus dem die Daten gelesen werden
+   * @return Id (UUID) des BLOBs
+   */
+  std::string upload(std::istream &source);
+  /// BLOB unter der angegebenen Id speichern; ein vorhandener BLOB wird ersetzt
+  void upload(const std::string &id, std::istream &source);
+  /** \brief BLOB ganz oder teilweise lesen
+   *
+   * @param id Id des BLOBs
+   * @param dest Ausgabe-Stream
+   * @param offset Position des ersten Bytes
+   * @param length maximale Anzahl Bytes oder npos für bis zum Ende
+   * \throw runtime_error wenn der BLOB nicht existiert oder offset hinter dem Ende liegt
+   */
+  void download(const std::string &id, std::ostream &dest, uint64_t offset = 0, uint64_t length = npos);
+  /// Größe des BLOBs; \throw runtime_error wenn der BLOB nicht existiert
+  uint64_t size(const std::string &id);
+  /// BLOB löschen; liefert false, wenn er nicht existiert
+  bool remove(const std::string &id);
+
+  /// Tabellen über ein DatabaseInterface anlegen
+  static void structure(DatabaseInterface &dbi);
+  /// BLOB sequenziell über ein DatabaseInterface speichern
+  static void write(DatabaseInterface &dbi, const std::string &id, std::istream &source,
+                    size_t chunkSize = defaultChunkSize);
+  /// BLOB sequenziell über ein DatabaseInterface lesen
+  static void read(DatabaseInterface &dbi, const std::string &id, std::ostream &dest, uint64_t offset = 0,
+                   uint64_t length = npos);
+  /// BLOB über ein DatabaseInterface löschen; liefert false, wenn er nicht existiert
+  static bool erase(DatabaseInterface &dbi, const std::string &id);
+
+private:
+  std::vector<DatabaseInterface> interfaces() const;
+  std::vector<std::string> connections;
+  size_t chunkSize;
+};
+
+
+}
+
+#endif //MOBS_BLOBSTORE_H
@@ -0,0 +1,273 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "compress.h"
+#include "logging.h"
+
+#include <zlib.h>
+#include <algorithm>
+#include <array>
+
+
+#define INPUT_BUFFER_LEN 8192
+
+class mobs::CryptBufDeflateData { // NOLINT(cppcoreguidelines-pro-type-member-init)
+public:
+  CryptBufDeflateData(CryptBufBase *n, int l) : next(n), level(l) { }
+  ~CryptBufDeflateData() {
+    if (deflating)
+      deflateEnd(&zs);
+    if (inflating)
+      inflateEnd(&zs);
+  }
+
+  std::unique_ptr<CryptBufBase> next; // nachgeschaltetes Plugin
+  std::unique_ptr<std::ostream> nextOut;
+  std::unique_ptr<std::istream> nextIn;
+  std::array<mobs::CryptBufDeflate::char_type, INPUT_BUFFER_LEN> buffer; // unkomprimierte Daten
+  std::array<mobs::CryptBufDeflate::char_type, INPUT_BUFFER_LEN> zbuf; // komprimierte Daten
+  z_stream zs{};
+  int level;
+  size_t maxInflated = mobs::CryptBufDeflate::defaultMaxInflated();
+  bool deflating = false;
+  bool inflating = false;
+  bool pending = false; // Daten seit letztem Flush
+  bool finished = false;
+};
+
+
+mobs::CryptBufDeflate::CryptBufDeflate(CryptBufBase *next, int level) : CryptBufBase() {
+  TRACE("");
+  data = std::unique_ptr<mobs::CryptBufDeflateData>(new mobs::CryptBufDeflateData(next, level));
+}
+
+mobs::CryptBufDeflate::~CryptBufDeflate() {
+  TRACE("");
+}
+
+std::string mobs::CryptBufDeflate::name() const {
+  if (data->next)
+    return prefix() + data->next->name();
+  return u8"deflate";
+}
+
+size_t mobs::CryptBufDeflate::recipients() const {
+  return data->next ? data->next->recipients() : 0;
+}
+
+std::string mobs::CryptBufDeflate::getRecipientId(size_t pos) const {
+  return data->next ? data->next->getRecipientId(pos) : std::string();
+}
+
+std::string mobs::CryptBufDeflate::getRecipientKeyBase64(size_t pos) const {
+  return data->next ? data->next->getRecipientKeyBase64(pos) : std::string();
+}
+
+void mobs::CryptBufDeflate::setOstr(std::ostream &ostr) {
+  if (data->next) {
+    data->next->setOstr(ostr);
+    data->nextOut = std::unique_ptr<std::ostream>(new std::ostream(data->next.get()));
+    CryptBufBase::setOstr(*data->nextOut);
+  } else
+    CryptBufBase::setOstr(ostr);
+  Base::setp(data->buffer.begin(), data->buffer.end());
+}
+
+void mobs::CryptBufDeflate::setIstr(std::istream &istr) {
+  if (data->next) {
+    data->next->setIstr(istr);
+    data->nextIn = std::unique_ptr<std::istream>(new std::istream(data->next.get()));
+    CryptBufBase::setIstr(*data->nextIn);
+  } else
+    CryptBufBase::setIstr(istr);
+  Base::setg(data->buffer.begin(), data->buffer.begin(), data->buffer.begin());
+}
+
+void mobs::CryptBufDeflate::setBase64(bool on) {
+  if (data->next)
+    data->next->setBase64(on);
+  else
+    CryptBufBase::setBase64(on);
+}
+
+void mobs::CryptBufDeflate::setMaxInflated(size_t max) {
+  data->maxInflated = max;
+}
+
+size_t mobs::CryptBufDeflate::totalIn() const {
+  return data->inflating ? data->zs.total_out : data->zs.total_in;
+}
+
+size_t mobs::CryptBufDeflate::totalOut() const {
+  return data->inflating ? data->zs.total_in : data->zs.total_out;
+}
+
+void mobs::CryptBufDeflate::deflateBuf(const char_type *s, size_t n, int flush) {
+  if (not data->deflating) {
+    if (deflateInit(&data->zs, data->level) != Z_OK)
+      THROW("deflateInit failed");
+    data->deflating = true;
+  }
+  data->zs.next_in = reinterpret_cast<Bytef *>(const_cast<char_type *>(s));
+  data->zs.avail_in = uInt(n);
+  int ret;
+  do {
+    data->zs.next_out = reinterpret_cast<Bytef *>(&data->zbuf[0]);
+    data->zs.avail_out = uInt(data->zbuf.size());
+    ret = deflate(&data->zs, flush);
+    if (ret == Z_STREAM_ERROR)
+      THROW("deflate failed");
+    doWrite(&data->zbuf[0], std::streamsize(data->zbuf.size() - data->zs.avail_out));
+  } while (data->zs.avail_out == 0 or (flush == Z_FINISH and ret != Z_STREAM_END));
+  data->pending = flush == Z_NO_FLUSH;
+}
+
+mobs::CryptBufDeflate::int_type mobs::CryptBufDeflate::overflow(mobs::CryptBufDeflate::int_type ch) {
+  TRACE("");
+  if (data->finished or not isGood())
+    return Traits::eof();
+  try {
+    if (Base::pbase() != Base::pptr()) {
+      deflateBuf(Base::pbase(), std::distance(Base::pbase(), Base::pptr()), Z_NO_FLUSH);
+      Base::setp(data->buffer.begin(), data->buffer.end()); // buffer zurücksetzen
+    }
+    if (not Traits::eq_int_type(ch, Traits::eof()))
+      Base::sputc(Traits::to_char_type(ch));
+    if (isGood())
+      return ch;
+  } catch (std::exception &e) {
+    LOG(LM_ERROR, "Exception " << e.what());
+    setBad();
+    throw std::ios_base::failure(e.what(), std::io_errc::stream);
+  }
+  return Traits::eof();
+}
+
+int mobs::CryptBufDeflate::sync() {
+  TRACE("");
+  if (data->inflating or data->finished)
+    return isGood() ? 0 : -1;
+  if (Base::pbase() != Base::pptr() or data->pending) {
+    try {
+      // Flush, damit der Empfänger alle bisherigen Daten entpacken kann
+      deflateBuf(Base::pbase(), std::distance(Base::pbase(), Base::pptr()), Z_SYNC_FLUSH);
+    } catch (std::exception &e) {
+      LOG(LM_ERROR, "Exception " << e.what());
+      setBad();
+      return -1;
+    }
+    Base::setp(data->buffer.begin(), data->buffer.end());
+  }
+  if (data->nextOut)
+    data->nextOut->flush();
+  return isGood() ? 0 : -1;
+}
+
+void mobs::CryptBufDeflate::finalize() {
+  TRACE("");
+  if (data->inflating or data->finished)
+    return;
+  if (isGood()) {
+    try {
+      deflateBuf(Base::pbase(), std::distance(Base::pbase(), Base::pptr()), Z_FINISH);
+    } catch (std::exception &e) {
+      LOG(LM_ERROR, "Exception " << e.what());
+      setBad();
+    }
+    Base::setp(data->buffer.begin(), data->buffer.end());
+  }
+  data->finished = true;
+  CryptBufBase::finalize();
+  if (data->next) {
+    data->nextOut->flush();
+    data->next->finalize();
+  }
+}
+
+std::streamsize mobs::CryptBufDeflate::inflateStep(bool wait) {
+  if (data->finished)
+    return -1;
+  if (not data->inflating) {
+    if (inflateInit(&data->zs) != Z_OK)
+      THROW("inflateInit failed");
+    data->inflating = true;
+  }
+  for (;;) {
+    if (data->zs.avail_in == 0) {
+      if (not wait and canRead() <= 0)
+        return 0;
+      auto sz = doRead(&data->zbuf[0], std::streamsize(data->zbuf.size()));
+      if (sz <= 0)
+        THROW("compressed stream truncated");
+      data->zs.next_in = reinterpret_cast<Bytef *>(&data->zbuf[0]);
+      data->zs.avail_in = uInt(sz);
+    }
+    // höchstens ein Byte über die Grenze entpacken, um die Überschreitung zu erkennen
+    size_t avail = data->buffer.size();
+    if (data->maxInflated)
+      avail = std::min(avail, data->maxInflated + 1 - std::min(size_t(data->zs.total_out), data->maxInflated));
+    data->zs.next_out = reinterpret_cast<Bytef *>(&data->buffer[0]);
+    data->zs.avail_out = uInt(avail);
+    int ret = inflate(&data->zs, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END)
+      data->finished = true;
+    else if (ret != Z_OK and ret != Z_BUF_ERROR)
+      THROW("inflate failed " << ret);
+    if (data->maxInflated and data->zs.total_out > data->maxInflated)
+      THROW("inflated data exceeds limit of " << data->maxInflated << " bytes");
+    auto sz = std::streamsize(avail - data->zs.avail_out);
+    Base::setg(&data->buffer[0], &data->buffer[0], &data->buffer[sz]);
+    if (sz > 0)
+      return sz;
+    if (data->finished)
+      return -1;
+    if (not wait)
+      return 0;
+  }
+}
+
+mobs::CryptBufDeflate::int_type mobs::CryptBufDeflate::underflow() {
+  TRACE("");
+  if (not isGood())
+    return Traits::eof();
+  try {
+    if (inflateStep(true) > 0)
+      return Traits::to_int_type(*Base::gptr());
+  } catch (std::exception &e) {
+    LOG(LM_ERROR, "Exception " << e.what());
+    Base::setg(&data->buffer[0], &data->buffer[0], &data->buffer[0]);
+    setBad();
+    throw std::ios_base::failure(e.what(), std::io_errc::stream);
+  }
+  return Traits::eof();
+}
+
+std::streamsize mobs::CryptBufDeflate::showmanyc() {
+  TRACE("");
+  if (not isGood())
+    return -1;
+  try {
+    return inflateStep(false);
+  } catch (std::exception &e) {
+    LOG(LM_ERROR, "Exception " << e.what());
+    setBad();
+  }
+  return -1;
+}
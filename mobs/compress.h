@@ -0,0 +1,129 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file compress.h
+ *
+ *  \brief Plugin zur Kompression von Streams (zlib)
+ */
+
+#ifndef MOBS_COMPRESS_H
+#define MOBS_COMPRESS_H
+
+#include "csb.h"
+#include<memory>
+#include<string>
+
+namespace mobs {
+
+class CryptBufDeflateData;
+
+/** \brief Stream-Buffer als Filter für CryptBufBase mit Kompression nach zlib (deflate)
+ *
+ * Dient als Plugin für mobs::CryptIstrBuf oder mobs::CryptOstrBuf. Beim Schreiben wird komprimiert, beim Lesen entpackt.
+ *
+ * Optional kann ein weiteres Plugin (z.B. mobs::CryptBufAes) nachgeschaltet werden, durch das die komprimierten Daten
+ * geleitet werden. So lässt sich die Kompression vor der Verschlüsselung einsetzen:
+ * \code
+ * writer.startEncrypt(new mobs::CryptBufDeflate(new mobs::CryptBufAes(key, iv, "", true)));
+ * \endcode
+ * Als Name des Algorithmus wird dann "deflate+aes-256-cbc" geliefert, daran erkennt der Empfänger die Kompression.
+ * Base64 wird ebenfalls an das nachgeschaltete Plugin weitergereicht.
+ *
+ * Bei sync() wird ein zlib-Flush durchgeführt, damit der Empfänger die bisherigen Daten vollständig lesen kann.
+ *
+ * Beim Entpacken ist die Menge der unkomprimierten Daten begrenzt (siehe setMaxInflated()), damit ein kleiner
+ * präparierter Datenstrom keine beliebig großen Datenmengen erzeugen kann.
+ *
+ * \warning Kompression vor Verschlüsselung verrät über die Länge der Chiffrate, wie gut sich der Klartext
+ * komprimieren lässt. Enthält ein Datenstrom sowohl Geheimnisse als auch vom Angreifer beeinflussbare Daten,
+ * lassen sich die Geheimnisse dadurch schrittweise erraten (vgl. CRIME/BREACH). In solchen Fällen darf die
+ * Kompression nicht verwendet werden.
+ */
+class CryptBufDeflate : public CryptBufBase {
+public:
+  using Base = std::basic_streambuf<char>; ///< Basis-Typ
+  using char_type = typename Base::char_type;  ///< Element-Typ
+  using Traits = std::char_traits<char_type>; ///< Traits-Typ
+  using int_type = typename Base::int_type; ///< zugehöriger int-Typ
+
+  /** \brief Konstruktor
+   *
+   * @param next nachgeschaltetes Plugin oder nullptr; geht in den Besitz des Objektes über
+   * @param level Kompressionsstufe 1 (schnell) bis 9 (klein) oder -1 für den Standardwert
+   */
+  explicit CryptBufDeflate(CryptBufBase *next = nullptr, int level = -1);
+  ~CryptBufDeflate() override;
+
+  /// Präfix im Namen des Algorithmus bei nachgeschaltetem Plugin
+  static std::string prefix() { return u8"deflate+"; }
+
+  /// Bezeichnung des Algorithmus, bei nachgeschaltetem Plugin mit dessen Namen
+  std::string name() const override;
+  /// \private
+  size_t recipients() const override;
+  /// \private
+  std::string getRecipientId(size_t pos) const override;
+  /// \private
+  std::string getRecipientKeyBase64(size_t pos) const override;
+
+  /// \private
+  void setOstr(std::ostream &ostr) override;
+  /// \private
+  void setIstr(std::istream &istr) override;
+  /// (de-)aktiviert den Base64-Modus, bei nachgeschaltetem Plugin in diesem
+  void setBase64(bool on) override;
+
+  /** \brief Obergrenze der entpackten Daten festlegen
+   *
+   * Wird sie überschritten, so schlägt das Lesen mit einer Exception fehl.
+   * @param max Anzahl Bytes, 0 = unbegrenzt; Vorgabe ist defaultMaxInflated()
+   */
+  void setMaxInflated(size_t max);
+  /// Vorgabe für die Obergrenze der entpackten Daten (64 MiB)
+  static size_t defaultMaxInflated() { return size_t(64) * 1024 * 1024; }
+
+  /// Anzahl der unkomprimierten Bytes
+  size_t totalIn() const;
+  /// Anzahl der komprimierten Bytes
+  size_t totalOut() const;
+
+  /// \private
+  int_type overflow(int_type ch) override;
+  /// \private
+  int_type underflow() override;
+  /// \private
+  void finalize() override;
+
+protected:
+  /// \private
+  std::streamsize showmanyc() override;
+  /// \private
+  int sync() override;
+
+private:
+  void deflateBuf(const char_type *s, size_t n, int flush);
+  std::streamsize inflateStep(bool wait);
+  std::unique_ptr<CryptBufDeflateData> data;
+};
+
+
+}
+
+#endif //MOBS_COMPRESS_H
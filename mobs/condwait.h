@@ -0,0 +1,52 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file condwait.h
+ \brief  Warten auf eine Condition-Variable für die Hintergrund-Threads der Bibliothek */
+
+
+#ifndef MOBS_CONDWAIT_H
+#define MOBS_CONDWAIT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace mobs {
+
+/** \brief blockierend warten, bis \c pred erfüllt ist
+ *
+ * Jede Zustandsänderung, die \c pred beeinflusst, muss unter dem Mutex erfolgen und über \c cond signalisiert werden;
+ * ein periodisches Aufwachen findet nicht statt.
+ *
+ * Es wird wait_for mit einem Intervall von 24 Stunden statt wait verwendet: Neuere GCC-Versionen binden
+ * std::condition_variable::wait an ein Symbol aus GLIBCXX_3.4.30, das ältere Laufzeitbibliotheken nicht enthalten.
+ * @param cond Condition-Variable
+ * @param lock gesperrter Mutex
+ * @param pred Bedingung
+ */
+template<typename P>
+void waitFor(std::condition_variable &cond, std::unique_lock<std::mutex> &lock, P pred) {
+  while (not cond.wait_for(lock, std::chrono::hours(24), pred)) {}
+}
+
+}
+
+#endif //MOBS_CONDWAIT_H
@@ -32,14 +32,21 @@
 #include <unistd.h>
 #endif
 
+#include <atomic>
 #include <sstream>
 #include <utility>
 #include <vector>
 #include <random>
 #include <iomanip>
 #include <regex>
+#include <cstring>
 #include <cwchar>
 
+#if (defined(__x86_64__) or defined(__i386__)) and (defined(__GNUC__) or defined(__clang__))
+#define MOBS_SIMD_X86
+#include <immintrin.h>
+#endif
+
 
 using namespace std;
 
@@ -231,6 +238,522 @@ wchar_t to_7up(wchar_t c) {
   return static_cast<size_t>(tab_7up[size_t(c)]);
 }
 
+namespace {
+
+// CPU-Eigenschaften, einmalig zur Laufzeit ermittelt
+class CpuSupport {
+public:
+  CpuSupport() {
+#ifdef MOBS_SIMD_X86
+    __builtin_cpu_init();
+    sse2 = __builtin_cpu_supports("sse2");
+    ssse3 = __builtin_cpu_supports("ssse3");
+    avx2 = __builtin_cpu_supports("avx2");
+#endif
+  }
+  bool sse2 = false;
+  bool ssse3 = false;
+  bool avx2 = false;
+};
+
+const CpuSupport &cpu() {
+  static CpuSupport support;
+  return support;
+}
+
+size_t asciiPrefixScalar(const char *s, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t v;
+    memcpy(&v, s + i, sizeof(v));
+    if (v & 0x8080808080808080ULL)
+      break;
+  }
+  for (; i < n; i++)
+    if (s[i] & 0x80)
+      break;
+  return i;
+}
+
+template<typename C>
+void widenScalar(const u_char *s, size_t n, C *d) {
+  for (size_t i = 0; i < n; i++)
+    d[i] = C(s[i]);
+}
+
+// kopiert, solange die Zeichen kleiner als limit sind
+template<typename C>
+size_t narrowScalar(const C *s, size_t n, char *d, uint32_t limit) {
+  size_t i = 0;
+  for (; i < n; i++) {
+    if (s[i] < 0 or uint32_t(s[i]) >= limit)
+      break;
+    d[i] = char(s[i]);
+  }
+  return i;
+}
+
+#ifdef MOBS_SIMD_X86
+__attribute__((target("sse2")))
+size_t asciiPrefixSse2(const char *s, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    int m = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)));
+    if (m)
+      return i + size_t(__builtin_ctz(unsigned(m)));
+  }
+  return i + asciiPrefixScalar(s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+size_t asciiPrefixAvx2(const char *s, size_t n) {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    int m = _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i)));
+    if (m)
+      return i + size_t(__builtin_ctz(unsigned(m)));
+  }
+  return i + asciiPrefixSse2(s + i, n - i);
+}
+
+// 8-Bit nach 32-Bit Zeichen
+__attribute__((target("sse2")))
+void widen32Sse2(const u_char *s, size_t n, void *dest) {
+  auto d = reinterpret_cast<__m128i *>(dest);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16, d += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+    _mm_storeu_si128(d, _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128(d + 1, _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128(d + 2, _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128(d + 3, _mm_unpackhi_epi16(hi, zero));
+  }
+  widenScalar(s + i, n - i, reinterpret_cast<uint32_t *>(dest) + i);
+}
+
+// 32-Bit nach 8-Bit Zeichen, solange kleiner als limit (0x80 oder 0x100)
+__attribute__((target("sse2")))
+size_t narrow32Sse2(const int32_t *s, size_t n, char *d, uint32_t limit) {
+  const __m128i mask = _mm_set1_epi32(int(~(limit - 1)));
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    auto p = reinterpret_cast<const __m128i *>(s + i);
+    __m128i a = _mm_loadu_si128(p);
+    __m128i b = _mm_loadu_si128(p + 1);
+    __m128i c = _mm_loadu_si128(p + 2);
+    __m128i e = _mm_loadu_si128(p + 3);
+    __m128i o = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, e)), mask);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(o, zero)) != 0xffff)
+      break;
+    __m128i r = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, e));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i), r);
+  }
+  return i + narrowScalar(s + i, n - i, d + i, limit);
+}
+
+// UTF-8-Validierung nach J. Keiser, D. Lemire: Validating UTF-8 In Less Than One Instruction Per Byte
+const uint8_t tooShort = 1 << 0;
+const uint8_t tooLong = 1 << 1;
+const uint8_t overlong3 = 1 << 2;
+const uint8_t tooLarge = 1 << 3;
+const uint8_t surrogate = 1 << 4;
+const uint8_t overlong2 = 1 << 5;
+const uint8_t tooLarge1000 = 1 << 6;
+const uint8_t overlong4 = 1 << 6;
+const uint8_t twoConts = 1 << 7;
+const uint8_t carry = tooShort | tooLong | twoConts;
+
+__attribute__((target("ssse3")))
+inline __m128i utf8Errors(__m128i input, __m128i prev) {
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  const __m128i byte1High = _mm_setr_epi8(
+          tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong,
+          twoConts, twoConts, twoConts, twoConts,
+          tooShort | overlong2, tooShort, tooShort | overlong3 | surrogate,
+          char(tooShort | tooLarge | tooLarge1000 | overlong4));
+  const __m128i byte1Low = _mm_setr_epi8(
+          char(carry | overlong3 | overlong2 | overlong4), char(carry | overlong2), char(carry), char(carry),
+          char(carry | tooLarge), char(carry | tooLarge | tooLarge1000), char(carry | tooLarge | tooLarge1000),
+          char(carry | tooLarge | tooLarge1000), char(carry | tooLarge | tooLarge1000),
+          char(carry | tooLarge | tooLarge1000), char(carry | tooLarge | tooLarge1000),
+          char(carry | tooLarge | tooLarge1000), char(carry | tooLarge | tooLarge1000),
+          char(carry | tooLarge | tooLarge1000 | surrogate), char(carry | tooLarge | tooLarge1000),
+          char(carry | tooLarge | tooLarge1000));
+  const __m128i byte2High = _mm_setr_epi8(
+          tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort,
+          char(tooLong | overlong2 | twoConts | overlong3 | tooLarge1000 | overlong4),
+          char(tooLong | overlong2 | twoConts | overlong3 | tooLarge),
+          char(tooLong | overlong2 | twoConts | surrogate | tooLarge),
+          char(tooLong | overlong2 | twoConts | surrogate | tooLarge),
+          tooShort, tooShort, tooShort, tooShort);
+  __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+  __m128i sc = _mm_and_si128(_mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                             _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, nibble)));
+  sc = _mm_and_si128(sc, _mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+  // 3. und 4. Byte einer Folge müssen Folgebytes sein
+  __m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, prev, 14), _mm_set1_epi8(char(0xe0 - 1)));
+  __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, prev, 13), _mm_set1_epi8(char(0xf0 - 1)));
+  __m128i must23 = _mm_and_si128(_mm_cmpgt_epi8(_mm_or_si128(third, fourth), _mm_setzero_si128()),
+                                 _mm_set1_epi8(char(0x80)));
+  return _mm_xor_si128(must23, sc);
+}
+
+__attribute__((target("ssse3")))
+bool utf8ValidSsse3(const char *s, size_t n) {
+  // am Blockende unvollständige Folgen
+  const __m128i maxValue = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         char(0xf0 - 1), char(0xe0 - 1), char(0xc0 - 1));
+  __m128i error = _mm_setzero_si128();
+  __m128i prev = _mm_setzero_si128();
+  __m128i incomplete = _mm_setzero_si128();
+  char tail[16];
+  for (size_t i = 0; i < n; i += 16) {
+    __m128i input;
+    if (n - i >= 16)
+      input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+    else {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, s + i, n - i);
+      input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tail));
+    }
+    if (_mm_movemask_epi8(input) == 0)
+      error = _mm_or_si128(error, incomplete);
+    else {
+      error = _mm_or_si128(error, utf8Errors(input, prev));
+      incomplete = _mm_subs_epu8(input, maxValue);
+    }
+    prev = input;
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xffff)
+      return false;
+  }
+  error = _mm_or_si128(error, incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff;
+}
+#endif
+
+size_t asciiPrefix(const char *s, size_t n) {
+#ifdef MOBS_SIMD_X86
+  if (cpu().avx2)
+    return asciiPrefixAvx2(s, n);
+  if (cpu().sse2)
+    return asciiPrefixSse2(s, n);
+#endif
+  return asciiPrefixScalar(s, n);
+}
+
+template<typename C>
+void widen(const char *s, size_t n, C *d) {
+#ifdef MOBS_SIMD_X86
+  if (sizeof(C) == 4 and cpu().sse2)
+    return widen32Sse2(reinterpret_cast<const u_char *>(s), n, d);
+#endif
+  widenScalar(reinterpret_cast<const u_char *>(s), n, d);
+}
+
+template<typename C>
+size_t narrow(const C *s, size_t n, char *d, uint32_t limit) {
+#ifdef MOBS_SIMD_X86
+  if (sizeof(C) == 4 and cpu().sse2)
+    return narrow32Sse2(reinterpret_cast<const int32_t *>(s), n, d, limit);
+#endif
+  return narrowScalar(s, n, d, limit);
+}
+
+/* eine UTF-8-Sequenz dekodieren, liefert die Länge, 0 bei ungültiger und -1 bei unvollständiger Sequenz
+ * Surrogates werden wie von std::codecvt_utf8 akzeptiert */
+int utf8Sequence(const u_char *s, size_t n, uint32_t &cp) {
+  u_char c = s[0];
+  int len;
+  uint32_t min;
+  if (c < 0x80) {
+    cp = c;
+    return 1;
+  } else if (c < 0xc2)
+    return 0;
+  else if (c < 0xe0) {
+    len = 2;
+    cp = c & 0x1fu;
+    min = 0x80;
+  } else if (c < 0xf0) {
+    len = 3;
+    cp = c & 0x0fu;
+    min = 0x800;
+  } else if (c < 0xf5) {
+    len = 4;
+    cp = c & 0x07u;
+    min = 0x10000;
+  } else
+    return 0;
+  if (n < size_t(len))
+    return -1;
+  for (int i = 1; i < len; i++) {
+    if ((s[i] & 0xc0) != 0x80)
+      return 0;
+    cp = (cp << 6) | (s[i] & 0x3fu);
+  }
+  if (cp < min or cp > 0x10ffff)
+    return 0;
+  return len;
+}
+
+size_t utf8Encode(uint32_t cp, char *d) {
+  if (cp < 0x80) {
+    d[0] = char(cp);
+    return 1;
+  } else if (cp < 0x800) {
+    d[0] = char(0xc0 | (cp >> 6));
+    d[1] = char(0x80 | (cp & 0x3f));
+    return 2;
+  } else if (cp < 0x10000) {
+    d[0] = char(0xe0 | (cp >> 12));
+    d[1] = char(0x80 | ((cp >> 6) & 0x3f));
+    d[2] = char(0x80 | (cp & 0x3f));
+    return 3;
+  }
+  d[0] = char(0xf0 | (cp >> 18));
+  d[1] = char(0x80 | ((cp >> 12) & 0x3f));
+  d[2] = char(0x80 | ((cp >> 6) & 0x3f));
+  d[3] = char(0x80 | (cp & 0x3f));
+  return 4;
+}
+
+// bei utf16 werden Zeichen ab U+10000 als Surrogate-Paar abgelegt
+template<typename C>
+size_t utf8DecodeStr(const char *s, size_t n, std::basic_string<C> &dest, bool utf16) {
+  size_t pos = dest.size();
+  dest.resize(pos + n);
+  C *d = &dest[pos];
+  size_t i = 0;
+  while (i < n) {
+    size_t a = asciiPrefix(s + i, n - i);
+    widen(s + i, a, d);
+    d += a;
+    i += a;
+    while (i < n and (s[i] & 0x80)) {
+      uint32_t cp;
+      int l = utf8Sequence(reinterpret_cast<const u_char *>(s + i), n - i, cp);
+      if (l <= 0) {
+        n = i;
+        break;
+      }
+      if (utf16 and cp > 0xffff) {
+        cp -= 0x10000;
+        *d++ = C(0xd800 + (cp >> 10));
+        *d++ = C(0xdc00 + (cp & 0x3ff));
+      } else
+        *d++ = C(cp);
+      i += size_t(l);
+    }
+  }
+  dest.resize(size_t(d - &dest[0]));
+  return i;
+}
+
+// bei utf16 werden Surrogate-Paare zusammengefasst, einzelne Surrogates sind ungültig
+template<typename C>
+size_t utf8EncodeStr(const C *s, size_t n, std::string &dest, bool utf16) {
+  size_t pos = dest.size();
+  dest.resize(pos + n + 3);
+  size_t d = pos;
+  size_t i = 0;
+  while (i < n) {
+    size_t a = narrow(s + i, n - i, &dest[d], 0x80);
+    d += a;
+    i += a;
+    if (i >= n)
+      break;
+    // Platz für den Rest, falls alles ASCII ist, plus ein Zeichen mit 4 Bytes
+    if (dest.size() - d < n - i + 3)
+      dest.resize(dest.size() + std::max(n - i, size_t(64)) + 3);
+    auto c = s[i];
+    if (c < 0 or uint32_t(c) > 0x10ffff)
+      break;
+    uint32_t cp = uint32_t(c);
+    size_t l = 1;
+    if (cp >= 0xd800 and cp < 0xe000) {
+      if (not utf16 or cp >= 0xdc00 or i + 1 >= n or s[i + 1] < 0xdc00 or s[i + 1] >= 0xe000)
+        break;
+      cp = 0x10000 + ((cp - 0xd800) << 10) + (uint32_t(s[i + 1]) - 0xdc00);
+      l = 2;
+    }
+    d += utf8Encode(cp, &dest[d]);
+    i += l;
+  }
+  dest.resize(d);
+  return i;
+}
+
+// ASCII-Abschnitte am Stück, sonst zeichenweise über conv
+template<typename F>
+void codecIn(const char *&from, const char *from_end, wchar_t *&to, wchar_t *to_end, F conv) {
+  while (from != from_end and to != to_end) {
+    size_t a = asciiPrefix(from, std::min(size_t(from_end - from), size_t(to_end - to)));
+    widen(from, a, to);
+    from += a;
+    to += a;
+    if (from != from_end and to != to_end)
+      *to++ = conv(*reinterpret_cast<const u_char *>(from++));
+  }
+}
+
+template<typename F>
+void codecOut(const wchar_t *&from, const wchar_t *from_end, char *&to, char *to_end, F conv) {
+  while (from != from_end and to != to_end) {
+    size_t a = narrow(from, std::min(size_t(from_end - from), size_t(to_end - to)), to, 0x80);
+    from += a;
+    to += a;
+    if (from != from_end and to != to_end)
+      *to++ = char(u_char(conv(*from++)));
+  }
+}
+
+}
+
+size_t ascii_prefix(const char *s, size_t n) {
+  return asciiPrefix(s, n);
+}
+
+bool utf8_valid(const char *s, size_t n) {
+  size_t i = asciiPrefix(s, n);
+#ifdef MOBS_SIMD_X86
+  if (cpu().ssse3)
+    return utf8ValidSsse3(s + i, n - i);
+#endif
+  while (i < n) {
+    uint32_t cp;
+    int l = utf8Sequence(reinterpret_cast<const u_char *>(s + i), n - i, cp);
+    if (l <= 0 or (cp >= 0xd800 and cp < 0xe000))
+      return false;
+    i += size_t(l);
+  }
+  return true;
+}
+
+void widen_latin1(const char *s, size_t n, wchar_t *dest) {
+  widen(s, n, dest);
+}
+
+size_t narrow_latin1(const wchar_t *s, size_t n, char *dest) {
+  return narrow(s, n, dest, 0x100);
+}
+
+size_t narrow_ascii(const wchar_t *s, size_t n, char *dest) {
+  return narrow(s, n, dest, 0x80);
+}
+
+size_t utf8_decode(const char *s, size_t n, std::wstring &dest) {
+  return utf8DecodeStr(s, n, dest, true);
+}
+
+size_t utf8_decode(const char *s, size_t n, std::u32string &dest) {
+  return utf8DecodeStr(s, n, dest, false);
+}
+
+size_t utf8_encode(const wchar_t *s, size_t n, std::string &dest) {
+  return utf8EncodeStr(s, n, dest, true);
+}
+
+size_t utf8_encode(const char32_t *s, size_t n, std::string &dest) {
+  return utf8EncodeStr(s, n, dest, false);
+}
+
+
+codec_utf8::result codec_utf8::do_out(mbstate_t &state, const wchar_t *from, const wchar_t *from_end,
+                                      const wchar_t *&from_next, char *to, char *to_end, char *&to_next) const {
+  result res = ok;
+  while (from != from_end) {
+    size_t a = narrow(from, std::min(size_t(from_end - from), size_t(to_end - to)), to, 0x80);
+    from += a;
+    to += a;
+    if (from == from_end)
+      break;
+    if (*from < 0 or uint32_t(*from) > 0x10ffff) {
+      res = error;
+      break;
+    }
+    char buf[4];
+    size_t l = utf8Encode(uint32_t(*from), buf);
+    if (size_t(to_end - to) < l) {
+      res = partial;
+      break;
+    }
+    to = std::copy(&buf[0], &buf[l], to);
+    from++;
+  }
+  from_next = from;
+  to_next = to;
+  return res;
+}
+
+codec_utf8::result codec_utf8::do_in(state_type &state, const char *from, const char *from_end,
+                                     const char *&from_next, wchar_t *to, wchar_t *to_end,
+                                     wchar_t *&to_next) const {
+  result res = ok;
+  while (from != from_end) {
+    size_t a = asciiPrefix(from, std::min(size_t(from_end - from), size_t(to_end - to)));
+    widen(from, a, to);
+    from += a;
+    to += a;
+    if (from == from_end)
+      break;
+    if (to == to_end) {
+      res = partial;
+      break;
+    }
+    uint32_t cp;
+    int l = utf8Sequence(reinterpret_cast<const u_char *>(from), size_t(from_end - from), cp);
+    if (l <= 0) {
+      res = l ? partial : error;
+      break;
+    }
+    *to++ = wchar_t(cp);
+    from += l;
+  }
+  from_next = from;
+  to_next = to;
+  return res;
+}
+
+codec_utf8::result codec_utf8::do_unshift(state_type &state, char *to, char *to_end, char *&to_next) const {
+  to_next = to;
+  return noconv;
+}
+
+int codec_utf8::do_encoding() const noexcept {
+  return 0;
+}
+
+int codec_utf8::do_length(state_type &state, const char *from, const char *from_end, size_t max) const {
+  const char *start = from;
+  while (from != from_end and max > 0) {
+    size_t a = asciiPrefix(from, std::min(size_t(from_end - from), max));
+    from += a;
+    max -= a;
+    if (from == from_end or max == 0)
+      break;
+    uint32_t cp;
+    int l = utf8Sequence(reinterpret_cast<const u_char *>(from), size_t(from_end - from), cp);
+    if (l <= 0)
+      break;
+    from += l;
+    max--;
+  }
+  return int(from - start);
+}
+
+int codec_utf8::do_max_length() const noexcept {
+  return 4;
+}
+
+bool codec_utf8::do_always_noconv() const noexcept {
+  return false;
+}
+
+
 codec_iso8859_1::result codec_iso8859_1::do_out(mbstate_t& state,
                                                 const wchar_t* from,
                                                 const wchar_t* from_end,
@@ -239,10 +762,12 @@ codec_iso8859_1::result codec_iso8859_1::do_out(mbstate_t& state,
                                                 char* to_end,
                                                 char*& to_next) const
 {
-  for (; from != from_end and to != to_end; from++, to++)
-  {
-    *to = u_char(to_iso_8859_1(*from));
-//    cerr << to_string(*from);
+  while (from != from_end and to != to_end) {
+    size_t a = narrow_latin1(from, std::min(size_t(from_end - from), size_t(to_end - to)), to);
+    from += a;
+    to += a;
+    if (from != from_end and to != to_end)
+      *to++ = char(u_char(to_iso_8859_1(*from++)));
   }
   to_next = to;
   from_next = from;
@@ -257,11 +782,10 @@ codec_iso8859_1::result codec_iso8859_1::do_in (state_type& state,
                                                 wchar_t* to_end,
                                                 wchar_t*& to_next) const
 {
-  for (; from != from_end and to != to_end; from++, to++)
-  {
-    *to = from_iso_8859_1(*(unsigned char*)from);
-//    cerr << to_string(*to);
-  }
+  size_t n = std::min(size_t(from_end - from), size_t(to_end - to));
+  widen_latin1(from, n, to);
+  from += n;
+  to += n;
   to_next = to;
   from_next = from;
   return ok;
@@ -279,10 +803,7 @@ codec_iso8859_9::result codec_iso8859_9::do_out(mbstate_t& state,
                                                 char* to_end,
                                                 char*& to_next) const
 {
-  for (; from != from_end and to != to_end; from++, to++)
-  {
-    *to = u_char(to_iso_8859_9(*from));
-  }
+  codecOut(from, from_end, to, to_end, to_iso_8859_9);
   to_next = to;
   from_next = from;
   return ok;
@@ -296,10 +817,7 @@ codec_iso8859_9::result codec_iso8859_9::do_in (state_type& state,
                                                 wchar_t* to_end,
                                                 wchar_t*& to_next) const
 {
-  for (; from != from_end and to != to_end; from++, to++)
-  {
-    *to = from_iso_8859_9(*(unsigned char*)from);
-  }
+  codecIn(from, from_end, to, to_end, from_iso_8859_9);
   to_next = to;
   from_next = from;
   return ok;
@@ -317,10 +835,7 @@ codec_iso8859_15::result codec_iso8859_15::do_out(mbstate_t& state,
                                                   char* to_end,
                                                   char*& to_next) const
 {
-  for (; from != from_end and to != to_end; from++, to++)
-  {
-    *to = u_char(to_iso_8859_15(*from));
-  }
+  codecOut(from, from_end, to, to_end, to_iso_8859_15);
   to_next = to;
   from_next = from;
   return ok;
@@ -334,10 +849,7 @@ codec_iso8859_15::result codec_iso8859_15::do_in (state_type& state,
                                                   wchar_t* to_end,
                                                   wchar_t*& to_next) const
 {
-  for (; from != from_end and to != to_end; from++, to++)
-  {
-    *to = from_iso_8859_15(*(unsigned char*)from);
-  }
+  codecIn(from, from_end, to, to_end, from_iso_8859_15);
   to_next = to;
   from_next = from;
   return ok;
@@ -356,10 +868,7 @@ codec_windows_1252::result codec_windows_1252::do_out(mbstate_t& state,
                                                   char* to_end,
                                                   char*& to_next) const
 {
-  for (; from != from_end and to != to_end; from++, to++)
-  {
-    *to = u_char(to_windows_1252(*from));
-  }
+  codecOut(from, from_end, to, to_end, to_windows_1252);
   to_next = to;
   from_next = from;
   return ok;
@@ -373,10 +882,7 @@ codec_windows_1252::result codec_windows_1252::do_in (state_type& state,
                                                   wchar_t* to_end,
                                                   wchar_t*& to_next) const
 {
-  for (; from != from_end and to != to_end; from++, to++)
-  {
-    *to = from_windows_1252(*(unsigned char*)from);
-  }
+  codecIn(from, from_end, to, to_end, from_windows_1252);
   to_next = to;
   from_next = from;
   return ok;
@@ -387,10 +893,269 @@ bool codec_windows_1252::do_always_noconv() const noexcept {
 }
 
 
+namespace {
+
+const char b64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Dekodier-Tabelle: 0..63 gültig, sonst -1
+class Base64Table {
+public:
+  Base64Table() {
+    for (auto &v:values)
+      v = -1;
+    for (int i = 0; i < 64; i++)
+      values[u_char(b64Alphabet[i])] = int8_t(i);
+  }
+  int8_t values[256];
+};
+
+const Base64Table b64Table;
+
+// kodiert vollständige 3er-Gruppen, liefert die Anzahl der verarbeiteten Bytes
+size_t encodeScalar(const u_char *src, size_t n, char *dst) {
+  size_t i = 0;
+  for (; i + 3 <= n; i += 3) {
+    uint32_t v = uint32_t(src[i]) << 16 | uint32_t(src[i + 1]) << 8 | src[i + 2];
+    *dst++ = b64Alphabet[v >> 18];
+    *dst++ = b64Alphabet[(v >> 12) & 0x3f];
+    *dst++ = b64Alphabet[(v >> 6) & 0x3f];
+    *dst++ = b64Alphabet[v & 0x3f];
+  }
+  return i;
+}
+
+// dekodiert vollständige 4er-Gruppen bis zum ersten Zeichen außerhalb des Alphabets, liefert die Anzahl der Zeichen
+size_t decodeScalar(const char *src, size_t n, u_char *dst) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    int a = b64Table.values[u_char(src[i])];
+    int b = b64Table.values[u_char(src[i + 1])];
+    int c = b64Table.values[u_char(src[i + 2])];
+    int d = b64Table.values[u_char(src[i + 3])];
+    if ((a | b | c | d) < 0)
+      break;
+    uint32_t v = uint32_t(a) << 18 | uint32_t(b) << 12 | uint32_t(c) << 6 | uint32_t(d);
+    *dst++ = u_char(v >> 16);
+    *dst++ = u_char(v >> 8);
+    *dst++ = u_char(v);
+  }
+  return i;
+}
+
+#ifdef MOBS_SIMD_X86
+// Verfahren nach W. Muła, D. Lemire: Faster Base64 Encoding and Decoding using AVX2 Instructions
+
+__attribute__((target("ssse3")))
+size_t encodeSsse3(const u_char *src, size_t n, char *dst) {
+  const __m128i shuffle = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m128i shiftLUT = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                         '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  size_t i = 0;
+  // es werden 16 Bytes gelesen, aber nur 12 verarbeitet
+  for (; n - i >= 16; i += 12, dst += 16) {
+    __m128i in = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), shuffle);
+    __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    __m128i idx = _mm_or_si128(t0, t1);
+    __m128i r = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    r = _mm_or_si128(r, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+    r = _mm_add_epi8(_mm_shuffle_epi8(shiftLUT, r), idx);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), r);
+  }
+  return i + encodeScalar(src + i, n - i, dst);
+}
+
+__attribute__((target("ssse3")))
+size_t decodeSsse3(const char *src, size_t n, u_char *dst) {
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  size_t i = 0;
+  // es werden 16 Bytes geschrieben, aber nur 12 gültig; daher Abstand zum Ende von dst halten
+  for (; n - i >= 24; i += 16, dst += 12) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), in));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), in));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), in));
+    __m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+    __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+    if (_mm_movemask_epi8(valid) != 0xffff)
+      break;
+    __m128i shift = _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    shift = _mm_or_si128(shift, _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62 - '+')),
+                                             _mm_and_si128(slash, _mm_set1_epi8(63 - '/'))));
+    __m128i v = _mm_add_epi8(in, shift);
+    v = _mm_madd_epi16(_mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_shuffle_epi8(v, pack));
+  }
+  return i + decodeScalar(src + i, n - i, dst);
+}
+
+__attribute__((target("avx2")))
+size_t encodeAvx2(const u_char *src, size_t n, char *dst) {
+  const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                           1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i shiftLUT = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  size_t i = 0;
+  // je Hälfte werden 16 Bytes gelesen, aber nur 12 verarbeitet
+  for (; n - i >= 28; i += 24, dst += 32) {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 12));
+    __m256i in = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), shuffle);
+    __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+                                    _mm256_set1_epi32(0x04000040));
+    __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+                                    _mm256_set1_epi32(0x01000010));
+    __m256i idx = _mm256_or_si256(t0, t1);
+    __m256i r = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+    r = _mm256_or_si256(r, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx), _mm256_set1_epi8(13)));
+    r = _mm256_add_epi8(_mm256_shuffle_epi8(shiftLUT, r), idx);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), r);
+  }
+  return i + encodeSsse3(src + i, n - i, dst);
+}
+
+__attribute__((target("avx2")))
+size_t decodeAvx2(const char *src, size_t n, u_char *dst) {
+  const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  size_t i = 0;
+  // es werden 28 Bytes geschrieben, aber nur 24 gültig
+  for (; n - i >= 40; i += 32, dst += 24) {
+    __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), in));
+    __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), in));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), in));
+    __m256i plus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+    __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+    __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                    _mm256_or_si256(_mm256_or_si256(digit, plus), slash));
+    if (_mm256_movemask_epi8(valid) != -1)
+      break;
+    __m256i shift = _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+                                    _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+    shift = _mm256_or_si256(shift, _mm256_or_si256(_mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')),
+                                                   _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/'))));
+    __m256i v = _mm256_add_epi8(in, shift);
+    v = _mm256_madd_epi16(_mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+    v = _mm256_shuffle_epi8(v, pack);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm256_castsi256_si128(v));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 12), _mm256_extracti128_si256(v, 1));
+  }
+  return i + decodeSsse3(src + i, n - i, dst);
+}
+#endif
+
+// Auswahl der Implementierung zur Laufzeit
+class Base64Codec {
+public:
+  const char *name;
+  size_t (*encode)(const u_char *, size_t, char *);
+  size_t (*decode)(const char *, size_t, u_char *);
+};
+
+const Base64Codec scalarCodec{"scalar", encodeScalar, decodeScalar};
+#ifdef MOBS_SIMD_X86
+const Base64Codec ssse3Codec{"ssse3", encodeSsse3, decodeSsse3};
+const Base64Codec avx2Codec{"avx2", encodeAvx2, decodeAvx2};
+#endif
+
+// Implementierung nach Namen, nullptr wenn auf dieser CPU nicht verfügbar; "" liefert die beste
+const Base64Codec *findCodec(const std::string &name) {
+#ifdef MOBS_SIMD_X86
+  if (cpu().avx2 and (name.empty() or name == avx2Codec.name))
+    return &avx2Codec;
+  if (cpu().ssse3 and (name.empty() or name == ssse3Codec.name))
+    return &ssse3Codec;
+#endif
+  if (name.empty() or name == scalarCodec.name)
+    return &scalarCodec;
+  return nullptr;
+}
+
+std::atomic<const Base64Codec *> &activeCodec() {
+  static std::atomic<const Base64Codec *> codec(findCodec(""));
+  return codec;
+}
+
+const Base64Codec &base64Codec() {
+  return *activeCodec().load(std::memory_order_relaxed);
+}
+
+}
+
+size_t encode_base64(const u_char *src, size_t n, char *dest) {
+  size_t done = base64Codec().encode(src, n, dest);
+  char *d = dest + done / 3 * 4;
+  if (n - done == 2) {
+    uint32_t v = uint32_t(src[done]) << 8 | src[done + 1];
+    *d++ = b64Alphabet[v >> 10];
+    *d++ = b64Alphabet[(v >> 4) & 0x3f];
+    *d++ = b64Alphabet[(v & 0x0f) << 2];
+    *d++ = '=';
+  } else if (n - done == 1) {
+    *d++ = b64Alphabet[src[done] >> 2];
+    *d++ = b64Alphabet[(src[done] & 0x03) << 4];
+    *d++ = '=';
+    *d++ = '=';
+  }
+  return size_t(d - dest);
+}
+
+size_t decode_base64(const char *src, size_t n, u_char *dest) {
+  return base64Codec().decode(src, n, dest);
+}
+
+const char *base64_implementation() {
+  return base64Codec().name;
+}
+
+bool base64_implementation(const std::string &name) {
+  const Base64Codec *codec = findCodec(name);
+  if (not codec)
+    return false;
+  activeCodec().store(codec, std::memory_order_relaxed);
+  return true;
+}
+
+void append_base64(std::string &dest, const u_char *src, size_t n, const std::string &linebreak) {
+  if (linebreak.empty()) {
+    size_t pos = dest.length();
+    dest.resize(pos + base64_encoded_size(n));
+    dest.resize(pos + encode_base64(src, n, &dest[pos]));
+    return;
+  }
+  // Zeilenumbruch nach je 17 Blöcken wie bei copy_base64
+  const size_t line = 17 * 3;
+  dest.reserve(dest.length() + base64_encoded_size(n) + (n / line) * linebreak.length());
+  for (size_t i = 0; i < n; i += line) {
+    size_t sz = std::min(line, n - i);
+    size_t pos = dest.length();
+    dest.resize(pos + base64_encoded_size(sz));
+    dest.resize(pos + encode_base64(src + i, sz, &dest[pos]));
+    if (sz == line)
+      dest += linebreak;
+  }
+}
+
+std::string to_string_base64(const std::vector<u_char> &t, const std::string &linebreak) {
+  std::string u;
+  if (not t.empty())
+    append_base64(u, &t[0], t.size(), linebreak);
+  return u;
+}
+
 int from_base64(wchar_t c) {
   if (c < 0 or c > 127)
     return -1;
-  static const vector<int> b64Chars = {
+  static const int b64Chars[] = {
           -1, -1, -1, -1, -1, -1, -1, -1, -1, 99, 99, -1, 99, 99, -1, -1,
           -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
           99, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
@@ -403,10 +1168,9 @@ int from_base64(wchar_t c) {
 }
 
 wchar_t to_base64(int i) {
-  const wstring base64 = L"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
   if (i < 0 or i > 63)
     return winval;
-  return base64[size_t(i)];
+  return wchar_t(b64Alphabet[i]);
 }
 
 
@@ -438,19 +1202,23 @@ wchar_t from_html_tag(const std::wstring &tok)
   return c;
 }
 
-std::wstring::const_iterator to7Up(std::wstring::const_iterator begin, std::wstring::const_iterator end, std::string &result) {
-  char last = ' ';
-  for (; begin != end; begin++) {
+namespace {
+
+// Reduktion auf Suchtoken für to7Up
+class SevenUp {
+public:
+  explicit SevenUp(std::string &r) : result(r) { }
+  // liefert true, wenn ein Delimiter erreicht ist
+  bool put(wchar_t c) {
     char n = ' ';
-//    wchar_t x = *begin;
-    if (*begin >= 0 and size_t(*begin) < sizeof(tab_7up) -1)
-      n = tab_7up[size_t(*begin)];
+    if (c >= 0 and size_t(c) < sizeof(tab_7up) -1)
+      n = tab_7up[size_t(c)];
     switch (n) {
       case '\0' ... 0x1f:
-        LOG(LM_ERROR, " EEEE " << to_string(*begin));
+        LOG(LM_ERROR, " EEEE " << to_string(c));
+        __attribute__ ((fallthrough));
       case ',':
-        begin++;
-        return begin;
+        return true;
       case ' ':
         last = ' ';
         break;
@@ -460,66 +1228,279 @@ std::wstring::const_iterator to7Up(std::wstring::const_iterator begin, std::wstr
         __attribute__ ((fallthrough));
       default:
         if (n == last)
-          continue;
+          break;
         result += n;
         last = n;
     }
+    return false;
   }
-  return begin;
+
+private:
+  std::string &result;
+  char last = ' ';
+};
+
+// dekodiert ein UTF-8-Zeichen; liefert die Länge in Bytes oder 0 bei ungültiger Sequenz
+size_t decodeUtf8(const char *p, const char *end, wchar_t &w) {
+  auto c = u_char(*p);
+  size_t len;
+  if (c < 0x80) {
+    w = c;
+    return 1;
+  } else if (c < 0xC2)
+    return 0;
+  else if (c < 0xE0) {
+    len = 2;
+    w = c & 0x1F;
+  } else if (c < 0xF0) {
+    len = 3;
+    w = c & 0x0F;
+  } else if (c < 0xF5) {
+    len = 4;
+    w = c & 0x07;
+  } else
+    return 0;
+  if (end - p < std::ptrdiff_t(len))
+    return 0;
+  for (size_t i = 1; i < len; i++) {
+    auto x = u_char(p[i]);
+    if ((x & 0xC0) != 0x80)
+      return 0;
+    w = (w << 6) | (x & 0x3F);
+  }
+  return len;
 }
 
-std::wstring toLower(const std::wstring &tx) {
-  std::locale loc;
-#ifndef __WIN32__
-  try {
-    const char *cp = getenv("LANG");
-    if (cp)
-      loc = std::locale(cp);
-    else
-      loc = std::locale("de_DE.UTF-8");
-  } catch (...) {
-    loc = std::locale();
+void appendUtf8(std::string &s, wchar_t w) {
+  auto c = uint32_t(w);
+  if (c < 0x80)
+    s += char(c);
+  else if (c < 0x800) {
+    s += char(0xC0 | (c >> 6));
+    s += char(0x80 | (c & 0x3F));
+  } else if (c < 0x10000) {
+    s += char(0xE0 | (c >> 12));
+    s += char(0x80 | ((c >> 6) & 0x3F));
+    s += char(0x80 | (c & 0x3F));
+  } else {
+    s += char(0xF0 | (c >> 18));
+    s += char(0x80 | ((c >> 12) & 0x3F));
+    s += char(0x80 | ((c >> 6) & 0x3F));
+    s += char(0x80 | (c & 0x3F));
   }
-  // LOG(LM_DEBUG, "LOCALE = " << loc.name());
-#endif
-  wstring lo;
-  lo.reserve(tx.length());
-  std::transform(tx.begin(), tx.end(), std::back_inserter(lo), [loc](const wchar_t c) { return std::tolower(c, loc);} );
-  return lo;
 }
 
-std::wstring toUpper(const std::wstring &tx) {
-  std::locale loc;
-#ifndef __WIN32__
-  try {
-    const char *cp = getenv("LANG");
-    if (cp)
-      loc = std::locale(cp);
-    else
-      loc = std::locale("de_DE.UTF-8");
-  } catch (...) {
-    loc = std::locale();
+/* Umsetztabellen für Groß- und Kleinschreibung
+ *
+ * ASCII, Latin-1 und Latin Extended-A sind fest hinterlegt, ebenso die regelmäßigen Paare aus Latin Extended-B.
+ * Alle anderen Zeichen werden über die Locale umgesetzt, die nur einmal pro Prozess ermittelt wird.
+ */
+class CaseTable {
+public:
+  static const CaseTable &instance() {
+    static CaseTable t;
+    return t;
   }
-  //LOG(LM_DEBUG, "LOCALE = " << loc.name());
+
+  wchar_t lower(wchar_t c) const {
+    if (c >= 0 and c < tabSize)
+      return lo[size_t(c)];
+    return ct->tolower(c);
+  }
+
+  wchar_t upper(wchar_t c) const {
+    if (c >= 0 and c < tabSize)
+      return up[size_t(c)];
+    return ct->toupper(c);
+  }
+
+private:
+  static const wchar_t tabSize = 0x250;
+
+  CaseTable() {
+#ifndef __WIN32__
+    try {
+      const char *cp = getenv("LANG");
+      if (cp)
+        loc = std::locale(cp);
+      else
+        loc = std::locale("de_DE.UTF-8");
+    } catch (...) {
+      loc = std::locale();
+    }
 #endif
+    ct = &std::use_facet<std::ctype<wchar_t>>(loc);
+    for (wchar_t c = 0; c < tabSize; c++) {
+      if (c < 0x180) {
+        lo[size_t(c)] = c;
+        up[size_t(c)] = c;
+      } else {
+        lo[size_t(c)] = ct->tolower(c);
+        up[size_t(c)] = ct->toupper(c);
+      }
+    }
+    pairs('A', 'Z', 0x20);
+    pairs(0xC0, 0xD6, 0x20);
+    pairs(0xD8, 0xDE, 0x20);
+    set(0x178, 0xFF);
+    up[0xB5] = 0x39C;
+    alternating(0x100, 0x12F);
+    lo[0x130] = 'i';
+    up[0x131] = 'I';
+    alternating(0x132, 0x137);
+    alternating(0x139, 0x148);
+    alternating(0x14A, 0x177);
+    alternating(0x179, 0x17E);
+    up[0x17F] = 'S';
+    alternating(0x1CD, 0x1DC);
+    alternating(0x1DE, 0x1EF);
+    alternating(0x1F4, 0x1F5);
+    alternating(0x1F8, 0x21F);
+    alternating(0x222, 0x233);
+    alternating(0x246, 0x24F);
+  }
+
+  void set(wchar_t u, wchar_t l) {
+    lo[size_t(u)] = l;
+    up[size_t(l)] = u;
+  }
+  // Großbuchstaben von first bis last, Kleinbuchstaben um delta versetzt
+  void pairs(wchar_t first, wchar_t last, wchar_t delta) {
+    for (wchar_t c = first; c <= last; c++)
+      set(c, c + delta);
+  }
+  // abwechselnd Groß- und Kleinbuchstabe, beginnend mit Großbuchstabe
+  void alternating(wchar_t first, wchar_t last) {
+    for (wchar_t c = first; c < last; c += 2)
+      set(c, c + 1);
+  }
+
+  std::locale loc;
+  const std::ctype<wchar_t> *ct = nullptr;
+  wchar_t lo[tabSize]{};
+  wchar_t up[tabSize]{};
+};
+
+template<bool Upper>
+bool caseUtf8(std::string &tx) {
+  const CaseTable &tab = CaseTable::instance();
+  const char *begin = tx.c_str();
+  const char *end = begin + tx.length();
+  const char *p = begin;
+  // erste Änderung suchen, bis dahin wird nichts kopiert
+  for (; p != end;) {
+    auto c = u_char(*p);
+    if (c < 0x80) {
+      if (Upper ? (c >= 'a' and c <= 'z') : (c >= 'A' and c <= 'Z'))
+        break;
+      p++;
+      continue;
+    }
+    wchar_t w;
+    size_t len = decodeUtf8(p, end, w);
+    if (len and (Upper ? tab.upper(w) : tab.lower(w)) != w)
+      break;
+    p += len ? len : 1;
+  }
+  if (p == end)
+    return false;
+  std::string result;
+  result.reserve(tx.length() + 4);
+  result.append(begin, p);
+  while (p != end) {
+    auto c = u_char(*p);
+    if (c < 0x80) {
+      if (Upper)
+        result += (c >= 'a' and c <= 'z') ? char(c - 0x20) : char(c);
+      else
+        result += (c >= 'A' and c <= 'Z') ? char(c + 0x20) : char(c);
+      p++;
+      continue;
+    }
+    wchar_t w;
+    size_t len = decodeUtf8(p, end, w);
+    if (len)
+      appendUtf8(result, Upper ? tab.upper(w) : tab.lower(w));
+    else {
+      // ungültige Sequenz unverändert übernehmen
+      result += char(c);
+      len = 1;
+    }
+    p += len;
+  }
+  tx.swap(result);
+  return true;
+}
+
+}
+
+std::wstring::const_iterator to7Up(std::wstring::const_iterator begin, std::wstring::const_iterator end, std::string &result) {
+  SevenUp sevenUp(result);
+  for (; begin != end; begin++) {
+    if (sevenUp.put(*begin))
+      return ++begin;
+  }
+  return begin;
+}
+
+std::string::const_iterator to7Up(std::string::const_iterator begin, std::string::const_iterator end, std::string &result) {
+  if (begin == end)
+    return begin;
+  SevenUp sevenUp(result);
+  const char *e = &*begin + (end - begin);
+  while (begin != end) {
+    wchar_t w;
+    size_t len = decodeUtf8(&*begin, e, w);
+    if (not len) {
+      w = u_char(*begin);
+      len = 1;
+    }
+    begin += len;
+    if (sevenUp.put(w))
+      return begin;
+  }
+  return begin;
+}
+
+std::wstring toLower(const std::wstring &tx) {
+  const CaseTable &tab = CaseTable::instance();
   wstring lo;
   lo.reserve(tx.length());
-  std::transform(tx.begin(), tx.end(), std::back_inserter(lo), [loc](const wchar_t c) { return std::toupper(c, loc);} );
+  std::transform(tx.begin(), tx.end(), std::back_inserter(lo), [&tab](const wchar_t c) { return tab.lower(c);} );
   return lo;
 }
 
+std::wstring toUpper(const std::wstring &tx) {
+  const CaseTable &tab = CaseTable::instance();
+  wstring up;
+  up.reserve(tx.length());
+  std::transform(tx.begin(), tx.end(), std::back_inserter(up), [&tab](const wchar_t c) { return tab.upper(c);} );
+  return up;
+}
+
 std::string toLower(const string &tx) {
-  return mobs::to_string(mobs::toLower(mobs::to_wstring(tx)));
+  std::string lo(tx);
+  caseUtf8<false>(lo);
+  return lo;
 }
 
 std::string toUpper(const string &tx) {
-  return mobs::to_string(mobs::toUpper(mobs::to_wstring(tx)));
+  std::string up(tx);
+  caseUtf8<true>(up);
+  return up;
+}
+
+bool toLowerInplace(std::string &tx) {
+  return caseUtf8<false>(tx);
+}
+
+bool toUpperInplace(std::string &tx) {
+  return caseUtf8<true>(tx);
 }
 
 void from_string_base64(const string &base64, vector<u_char> &v) {
   Base64Reader bd(v);
-  for (auto c:base64)
-    bd.put(u_char(c));
+  bd.put(base64.c_str(), base64.length());
   bd.done();
 }
 
@@ -535,6 +1516,24 @@ void Base64Reader::done() {
     put('=');
 }
 
+void Base64Reader::put(const char *s, size_t n) {
+  const char *end = s + n;
+  while (s != end) {
+    if (b64Cnt == 0) {
+      // vollständige 4er-Gruppen am Stück dekodieren
+      size_t pos = base64.size();
+      size_t len = size_t(end - s);
+      base64.resize(pos + len / 4 * 3);
+      size_t done = decode_base64(s, len, base64.data() + pos);
+      base64.resize(pos + done / 4 * 3);
+      s += done;
+      if (s == end)
+        break;
+    }
+    put(wchar_t(u_char(*s++)));
+  }
+}
+
 #pragma clang diagnostic push
 #pragma ide diagnostic ignored "hicpp-signed-bitwise"
 void Base64Reader::put(wchar_t c) {
@@ -580,8 +1579,7 @@ void Base64Reader::put(wchar_t c) {
 bool StrConv<std::vector<u_char>>::c_string2x(const std::string &str, std::vector<u_char> &t, const ConvFromStrHint &) {
   try {
     Base64Reader r(t);
-    for (auto c:str)
-      r.put(c);
+    r.put(str.c_str(), str.length());
     r.done();
   }
   catch (exception &e) {
@@ -606,14 +1604,11 @@ bool StrConv<std::vector<u_char>>::c_wstring2x(const std::wstring &wstr, std::ve
 
 
 std::string StrConv<std::vector<u_char>>::c_to_string(const std::vector<u_char> &t, const ConvToStrHint &cts) {
-  std::string u;
-  copy_base64(t.cbegin(), t.cend(), std::back_inserter(u), cts.hasFeatureWithIndentation() ? "\n  ":"");
-  return u;
+  return to_string_base64(t, cts.hasFeatureWithIndentation() ? "\n  ":"");
 }
 std::wstring StrConv<std::vector<u_char>>::c_to_wstring(const std::vector<u_char> &t, const ConvToStrHint &cts) {
-  std::wstring u;
-  copy_base64(t.cbegin(), t.cend(), std::back_inserter(u), cts.hasFeatureWithIndentation() ? "\n  ":"");
-  return u;
+  std::string u = to_string_base64(t, cts.hasFeatureWithIndentation() ? "\n  ":"");
+  return std::wstring(u.cbegin(), u.cend());
 }
 
 bool StrConv<std::vector<u_char>>::c_from_blob(const void *p, uint64_t sz, vector<u_char> &t) {
@@ -58,11 +58,23 @@ std::string timeOffsetToStr(long gmtoff);
  */
 std::wstring::const_iterator to7Up(std::wstring::const_iterator begin, std::wstring::const_iterator end, std::string &result);
 
+/** \brief Reduziert einen Text in UTF-8 auf Suchtoken vo Großbuchstaben und Ziffern
+ *
+ * wie to7Up für std::wstring, jedoch ohne vorherige Umwandlung nach std::wstring
+ * @param begin Start-Iterator
+ * @param end Ende-Iterator
+ * @param result Rückgabe Token
+ * @return iterator Iterator nach einem Delimiter oder end
+ */
+std::string::const_iterator to7Up(std::string::const_iterator begin, std::string::const_iterator end, std::string &result);
+
 /// Zugriff auf Umsetztabelle von to7Up
 wchar_t to_7up(wchar_t c);
 
 /** \brief wandelt einen Text in Kleinbuchstaben anhand der Locale der Rechners
  *
+ * ASCII, Latin-1 und Latin Extended werden über feste Tabellen umgesetzt, die übrigen Zeichen über die Locale,
+ * die einmalig beim ersten Aufruf ermittelt wird.
  * Unter Windows der LC_CTYPE gesetzt sein, damit Sonderzeichen korrekt behandelt werden
  * @return Ergebnisstring
  */
@@ -79,12 +91,26 @@ std::wstring toUpper(const std::wstring &);
  * @return Ergebnisstring
  */
 std::string toLower(const std::string &);
+/** \brief wandelt einen Text in UTF-8 direkt in Kleinbuchstaben um
+ *
+ * Ist nichts umzuwandeln, so bleibt der Text unverändert und es wird kein Speicher angefordert.
+ * @param tx Text in UTF-8; ungültige Sequenzen bleiben erhalten
+ * @return true, wenn der Text verändert wurde
+ */
+bool toLowerInplace(std::string &tx);
 /** \brief wandelt einen Text in Großbuchstaben anhand der Locale der Rechners
  *
  * Unter Windows der LC_CTYPE gesetzt sein, damit Sonderzeichen korrekt behandelt werden
  * @return Ergebnisstring
  */
 std::string toUpper(const std::string &);
+/** \brief wandelt einen Text in UTF-8 direkt in Großbuchstaben um
+ *
+ * Ist nichts umzuwandeln, so bleibt der Text unverändert und es wird kein Speicher angefordert.
+ * @param tx Text in UTF-8; ungültige Sequenzen bleiben erhalten
+ * @return true, wenn der Text verändert wurde
+ */
+bool toUpperInplace(std::string &tx);
 
 /// wandelt einen Unicode-zeichen in ein ISO8859-1 Zeichen um; im Fehlerfall wird U+00bf INVERTED QUESTION MARK geliefert
 wchar_t to_iso_8859_1(wchar_t c);
@@ -102,6 +128,81 @@ wchar_t from_iso_8859_15(wchar_t c);
 /// wandelt ein Windows-1252 Zeichen in Unicode um
 wchar_t from_windows_1252(wchar_t c);
 
+/** \brief Länge des ASCII-Anteils am Anfang eines Textes
+ *
+ * Verwendet, sofern die CPU es unterstützt, SSE2- bzw. AVX2-Befehle.
+ * @param s Text
+ * @param n Länge in Bytes
+ * @return Anzahl der Zeichen bis zum ersten Byte >= 0x80
+ */
+size_t ascii_prefix(const char *s, size_t n);
+
+/** \brief prüft einen Text auf gültiges UTF-8 nach RFC 3629
+ *
+ * Überlange Sequenzen, Surrogates und Werte über U+10FFFF sind ungültig. Die Prüfung erfolgt, sofern die CPU es
+ * unterstützt, mit SSSE3-Befehlen blockweise.
+ * @param s Text
+ * @param n Länge in Bytes
+ * @return true, wenn der Text gültig ist
+ */
+bool utf8_valid(const char *s, size_t n);
+
+/// wandelt \c n Zeichen ISO8859-1 in Unicode um
+void widen_latin1(const char *s, size_t n, wchar_t *dest);
+/// wandelt Unicode-Zeichen nach ISO8859-1 um, bis zum ersten nicht darstellbaren Zeichen; liefert deren Anzahl
+size_t narrow_latin1(const wchar_t *s, size_t n, char *dest);
+/// wandelt Unicode-Zeichen nach ASCII um, bis zum ersten nicht darstellbaren Zeichen; liefert deren Anzahl
+size_t narrow_ascii(const wchar_t *s, size_t n, char *dest);
+
+/** \brief Umwandlung von UTF-8 nach UTF-16 in einem std::wstring wie bei \c std::codecvt_utf8_utf16
+ *
+ * ASCII-Abschnitte werden blockweise umgesetzt, Zeichen ab U+10000 als Surrogate-Paar abgelegt.
+ * @param s Text in UTF-8
+ * @param n Länge in Bytes
+ * @param dest Ziel, an das angehängt wird
+ * @return Anzahl der verarbeiteten Bytes; ist sie kleiner \c n, so folgt eine ungültige oder unvollständige Sequenz
+ */
+size_t utf8_decode(const char *s, size_t n, std::wstring &dest);
+/// Umwandlung von UTF-8 nach UTF-32, siehe utf8_decode(const char *, size_t, std::wstring &)
+size_t utf8_decode(const char *s, size_t n, std::u32string &dest);
+/** \brief Umwandlung nach UTF-8 wie bei \c std::codecvt_utf8_utf16
+ *
+ * Surrogate-Paare werden zusammengefasst.
+ * @param s Text
+ * @param n Anzahl Zeichen
+ * @param dest Ziel, an das angehängt wird
+ * @return Anzahl der verarbeiteten Zeichen; ist sie kleiner \c n, so folgt ein ungültiges Zeichen
+ */
+size_t utf8_encode(const wchar_t *s, size_t n, std::string &dest);
+/// Umwandlung von UTF-32 nach UTF-8, siehe utf8_encode(const wchar_t *, size_t, std::string &); Surrogates sind ungültig
+size_t utf8_encode(const char32_t *s, size_t n, std::string &dest);
+
+/** \brief codec für UTF-8, verhält sich wie \c std::codecvt_utf8<wchar_t>
+ *
+ * ASCII-Abschnitte werden blockweise umgesetzt.
+ */
+class codec_utf8 : virtual public std::codecvt<wchar_t, char, std::mbstate_t> {
+public:
+  /// \private
+  result do_out(mbstate_t& state, const wchar_t* from, const wchar_t* from_end, const wchar_t*& from_next,
+                char* to, char* to_end, char*& to_next) const override;
+  /// \private
+  result do_in (state_type& state, const char* from, const char* from_end, const char*& from_next,
+                wchar_t* to, wchar_t* to_limit, wchar_t*& to_next) const override;
+
+protected:
+  /// \private
+  result do_unshift(state_type& state, char* to, char* to_end, char*& to_next) const override;
+  /// \private
+  int do_encoding() const noexcept override;
+  /// \private
+  int do_length(state_type& state, const char* from, const char* from_end, size_t max) const override;
+  /// \private
+  int do_max_length() const noexcept override;
+  /// \private
+  bool do_always_noconv() const noexcept override;
+};
+
 /// codec für wfstream
 class codec_iso8859_1 : virtual public std::codecvt<wchar_t, char, std::mbstate_t> {
 public:
@@ -209,6 +310,53 @@ OutputIt copy_base64(InputIt first, InputIt last, OutputIt d_first, const std::s
 }
 #pragma clang diagnostic pop
 
+/// Länge der Base64-Kodierung von \c n Bytes inkl. Padding ohne Zeilenumbrüche
+inline size_t base64_encoded_size(size_t n) { return (n + 2) / 3 * 4; }
+
+/** \brief Block-weise Base64-Kodierung
+ *
+ * Verwendet, sofern die CPU es unterstützt, SSSE3- bzw. AVX2-Befehle; die Auswahl erfolgt zur Laufzeit.
+ * @param src Quelldaten
+ * @param n Anzahl Bytes
+ * @param dest Zielpuffer mit mindestens base64_encoded_size(n) Zeichen
+ * @return Anzahl der geschriebenen Zeichen inkl. Padding
+ */
+size_t encode_base64(const u_char *src, size_t n, char *dest);
+
+/** \brief Block-weise Base64-Dekodierung vollständiger 4er-Gruppen
+ *
+ * Die Dekodierung stoppt vor der ersten Gruppe, die ein Zeichen außerhalb des Base64-Alphabets enthält
+ * (Whitespace, Padding); der Rest muss vom Aufrufer z.B. mit Base64Reader verarbeitet werden.
+ * @param src Base64-Text
+ * @param n Anzahl Zeichen
+ * @param dest Zielpuffer mit mindestens n / 4 * 3 Bytes
+ * @return Anzahl der verarbeiteten Zeichen, ein Vielfaches von 4; es wurden davon 3/4 Bytes geschrieben
+ */
+size_t decode_base64(const char *src, size_t n, u_char *dest);
+
+/// Name der zur Laufzeit gewählten Base64-Implementierung ("avx2", "ssse3" oder "scalar")
+const char *base64_implementation();
+
+/** \brief Base64-Implementierung erzwingen
+ *
+ * Für Tests und Vergleichsmessungen der einzelnen Pfade; gilt prozessweit.
+ * @param name "avx2", "ssse3", "scalar" oder "" für die beste verfügbare Implementierung
+ * @return false, wenn die Implementierung auf dieser CPU bzw. in diesem Build nicht verfügbar ist
+ */
+bool base64_implementation(const std::string &name);
+
+/** \brief Base64-Kodierung an einen String anhängen
+ *
+ * @param dest Ziel
+ * @param src Quelldaten
+ * @param n Anzahl Bytes
+ * @param linebreak String, der wie bei copy_base64 nach je 17 Blöcken ausgegeben wird
+ */
+void append_base64(std::string &dest, const u_char *src, size_t n, const std::string &linebreak = "");
+
+/// Umwandlung eines Vektors nach Base64 in einen \c std::string, optional mit Zeilenumbrüchen
+std::string to_string_base64(const std::vector<u_char> &t, const std::string &linebreak = "");
+
 /// Umwandlung eines Containers mit base64-Inhalt nach \c std::string
 template<typename T>
 std::string to_string_base64(const T &t) { std::string u; copy_base64(t.cbegin(), t.cend(), std::back_inserter(u)); return u; }
@@ -242,6 +390,14 @@ public:
    * \throws runtime_error im Fehlerfall
    */
   void put(wchar_t c);
+  /** \brief Block von Zeichen parsen
+   *
+   * vollständige Gruppen werden am Stück dekodiert
+   * @param s Base-64 Text; whitespace wird ignoriert
+   * @param n Anzahl Zeichen
+   * \throws runtime_error im Fehlerfall
+   */
+  void put(const char *s, size_t n);
   /// Ende des zu parsenden Textes
   void done();
   /// Neustart
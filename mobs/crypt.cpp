@@ -43,6 +43,10 @@
 #include <iomanip>
 
 #include "encdata.h"
+#include "lrucache.h"
+
+#include <fstream>
+#include <mutex>
 
 
 #define KEYBUFLEN 32
@@ -159,60 +163,174 @@ std::string mobs_internal::openSslGetError() {
 }
 
 
+namespace {
+
+// Cache der geparsten Schlüssel; der Schlüssel ist ein SHA-256 über Typ, PEM-Inhalt und Passphrase
+class KeyCache {
+public:
+  static KeyCache &instance() { static KeyCache cache; return cache; }
+
+  bool enabled() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return maxSize > 0;
+  }
+  std::shared_ptr<EVP_PKEY> lookup(const std::string &fingerprint) {
+    std::lock_guard<std::mutex> guard(mutex);
+    return cache.lookup(fingerprint);
+  }
+  void insert(const std::string &fingerprint, std::shared_ptr<EVP_PKEY> key) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (not maxSize)
+      return;
+    cache.insert(fingerprint, std::move(key));
+    cache.reduceCount(maxSize);
+  }
+  void size(size_t n) {
+    std::lock_guard<std::mutex> guard(mutex);
+    maxSize = n;
+    cache.reduceCount(n);
+  }
+  void clear() {
+    std::lock_guard<std::mutex> guard(mutex);
+    cache.reduceCount(0);
+  }
+
+  static std::string fingerprint(char type, const std::string &pem, const std::string &passphrase) {
+    std::unique_ptr<EVP_MD_CTX, SSL_Delete> ctx(EVP_MD_CTX_new(), SSL_Delete{});
+    u_char md[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    if (not ctx or 1 != EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr) or
+        1 != EVP_DigestUpdate(ctx.get(), &type, 1) or
+        1 != EVP_DigestUpdate(ctx.get(), pem.c_str(), pem.length() + 1) or
+        1 != EVP_DigestUpdate(ctx.get(), passphrase.c_str(), passphrase.length()) or
+        1 != EVP_DigestFinal_ex(ctx.get(), md, &len))
+      throw openssl_exception(LOGSTR("mobs::KeyCache"));
+    return std::string(reinterpret_cast<char *>(md), len);
+  }
+
+private:
+  // OpenSSL vor dem Cache initialisieren, damit der Cache vor dem Cleanup von OpenSSL aufgeräumt wird
+  KeyCache() { OPENSSL_init_crypto(0, nullptr); }
+  std::mutex mutex;
+  size_t maxSize = 32;
+  mobs::LRUCache<EVP_PKEY> cache;
+};
+
+// liefert den Inhalt im PEM-Format; ist file kein PEM-String, wird die Datei in buf gelesen
+const std::string *pemContent(const std::string &file, std::string &buf) {
+  if (file.length() > 10 and file.compare(0, 10, "-----BEGIN") == 0)
+    return &file;
+  std::ifstream in(file, std::ios::binary);
+  if (not in.is_open())
+    return nullptr;
+  buf.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  if (in.bad())
+    return nullptr;
+  return &buf;
+}
+
+std::unique_ptr<EVP_PKEY, SSL_Delete> newReference(const std::shared_ptr<EVP_PKEY> &key) {
+  if (not key or 1 != EVP_PKEY_up_ref(key.get()))
+    return {nullptr, SSL_Delete{}};
+  return {key.get(), SSL_Delete{}};
+}
+
+}
+
 std::unique_ptr<EVP_PKEY, SSL_Delete> mobs_internal::readPrivateKey(const std::string &file, const std::string &passphrase) {
   if (file.empty())
     return {nullptr, SSL_Delete{}};
-  std::unique_ptr<BIO, SSL_Delete> bp{nullptr, SSL_Delete{}};
-  if (file.length() > 10 and file.compare(0, 10, "-----BEGIN") == 0) {
-    bp.reset(BIO_new_mem_buf(file.c_str(), static_cast<int>(file.length())));
-    if (not bp)
-      THROW("alloc mem");
-  }
-  else {
-    bp.reset(BIO_new(BIO_s_file()));
-    if (not bp)
-      return {nullptr, SSL_Delete{}};
-    if (1 != BIO_read_filename(bp.get(), file.c_str()))
-      return {nullptr, SSL_Delete{}};
+  std::string buf;
+  const std::string *pem = pemContent(file, buf);
+  if (not pem)
+    return {nullptr, SSL_Delete{}};
+  auto &cache = KeyCache::instance();
+  std::string fingerprint;
+  if (cache.enabled()) {
+    fingerprint = KeyCache::fingerprint('S', *pem, passphrase);
+    if (auto key = cache.lookup(fingerprint))
+      return newReference(key);
   }
+  std::unique_ptr<BIO, SSL_Delete> bp(BIO_new_mem_buf(pem->c_str(), static_cast<int>(pem->length())), SSL_Delete{});
+  if (not bp)
+    THROW("alloc mem");
 
 // Load the RSA key from the BIO
   EVP_PKEY* rsaPrivKey = nullptr;
 // wenn nullptr statt passphrase, wird auf der Konsole nachgefragt
   if (not PEM_read_bio_PrivateKey( bp.get(), &rsaPrivKey, nullptr, (void *)passphrase.c_str() ))
     throw openssl_exception(LOGSTR("mobs::readPrivateKey"));
-  std::unique_ptr<EVP_PKEY, SSL_Delete> key(rsaPrivKey, SSL_Delete{});
+  std::shared_ptr<EVP_PKEY> key(rsaPrivKey, SSL_Delete{});
   //if (not EVP_PKEY_is_a(key.get(), "RSA") and not EVP_PKEY_is_a(key.get(), "EC"))
   //THROW("IS NO RSA KEY: "); // << EVP_PKEY_get0_type_name(rsaPrivKey));
-  return key;
+  if (not fingerprint.empty())
+    cache.insert(fingerprint, key);
+  return newReference(key);
 }
 
 std::unique_ptr<EVP_PKEY, SSL_Delete> mobs_internal::readPublicKey(const std::string &file) {
   if (file.empty())
     return {nullptr, SSL_Delete{}};
-  std::unique_ptr<BIO, SSL_Delete> bp{nullptr, SSL_Delete{}};
-  if (file.length() > 10 and file.compare(0, 10, "-----BEGIN") == 0) {
-    bp.reset(BIO_new_mem_buf(file.c_str(), static_cast<int>(file.length())));
-    if (not bp)
-      THROW("alloc mem");
-  }
-  else {
-    bp.reset(BIO_new(BIO_s_file()));
-    if (not bp)
-      return {nullptr, SSL_Delete{}};
-    if (1 != BIO_read_filename(bp.get(), file.c_str()))
-      return {nullptr, SSL_Delete{}};
+  std::string buf;
+  const std::string *pem = pemContent(file, buf);
+  if (not pem)
+    return {nullptr, SSL_Delete{}};
+  auto &cache = KeyCache::instance();
+  std::string fingerprint;
+  if (cache.enabled()) {
+    fingerprint = KeyCache::fingerprint('P', *pem, "");
+    if (auto key = cache.lookup(fingerprint))
+      return newReference(key);
   }
+  std::unique_ptr<BIO, SSL_Delete> bp(BIO_new_mem_buf(pem->c_str(), static_cast<int>(pem->length())), SSL_Delete{});
+  if (not bp)
+    THROW("alloc mem");
 
   // Load the RSA key from the BIO
   EVP_PKEY* rsaPubKey = nullptr;
   if (not PEM_read_bio_PUBKEY(bp.get(), &rsaPubKey, nullptr, nullptr ))
     throw openssl_exception(LOGSTR("mobs::readPublicKey"));
-  std::unique_ptr<EVP_PKEY, SSL_Delete> key(rsaPubKey, SSL_Delete{});
+  std::shared_ptr<EVP_PKEY> key(rsaPubKey, SSL_Delete{});
 
   //if (not EVP_PKEY_is_a(key.get(), "RSA") and not EVP_PKEY_is_a(key.get(), "EC"))
   //  THROW("IS NO RSA KEY"); // << EVP_PKEY_get0_type_name(rsaPubKey));
-  return key;
+  if (not fingerprint.empty())
+    cache.insert(fingerprint, key);
+  return newReference(key);
+}
+
+namespace mobs {
+class CryptKeyData {
+public:
+  explicit CryptKeyData(std::unique_ptr<EVP_PKEY, SSL_Delete> k) : key(std::move(k)) {}
+  std::unique_ptr<EVP_PKEY, SSL_Delete> key;
+};
+}
+
+mobs::CryptKey mobs::CryptKey::privateKey(const std::string &filePriv, const std::string &passphrase) {
+  auto key = mobs_internal::readPrivateKey(filePriv, passphrase);
+  if (not key)
+    THROW(u8"can't load priv key");
+  return CryptKey(std::make_shared<CryptKeyData>(std::move(key)));
+}
+
+mobs::CryptKey mobs::CryptKey::publicKey(const std::string &filePub) {
+  auto key = mobs_internal::readPublicKey(filePub);
+  if (not key)
+    THROW(u8"can't load pub key");
+  return CryptKey(std::make_shared<CryptKeyData>(std::move(key)));
+}
+
+void mobs::keyCacheSize(size_t n) {
+  KeyCache::instance().size(n);
+}
+
+void mobs::keyCacheClear() {
+  KeyCache::instance().clear();
+}
+
+static EVP_PKEY *keyOf(const mobs::CryptKey &key) {
+  return key.get() ? key.get()->key.get() : nullptr;
 }
 
 
@@ -511,14 +629,19 @@ mobs::encryptPrivate(const std::vector<u_char> &sessionKey, std::vector<u_char>
 void
 mobs::decryptPrivate(const std::vector<u_char> &cipher, std::vector<u_char> &sessionKey, const std::string &filePriv,
                         const std::string &passphrase) {
-  auto rsaPrivKey = mobs_internal::readPrivateKey(filePriv, passphrase);
+  decryptPrivate(cipher, sessionKey, CryptKey::privateKey(filePriv, passphrase));
+}
+
+void
+mobs::decryptPrivate(const std::vector<u_char> &cipher, std::vector<u_char> &sessionKey, const CryptKey &privKey) {
+  EVP_PKEY *rsaPrivKey = keyOf(privKey);
   if (not rsaPrivKey)
     THROW(u8"can't load priv key");
-  if (cipher.size() != EVP_PKEY_size(rsaPrivKey.get()))
-    THROW(u8"cipher must have size of " << EVP_PKEY_size(rsaPrivKey.get()));
-  sessionKey.resize(EVP_PKEY_size(rsaPrivKey.get()), 0);
+  if (cipher.size() != EVP_PKEY_size(rsaPrivKey))
+    THROW(u8"cipher must have size of " << EVP_PKEY_size(rsaPrivKey));
+  sessionKey.resize(EVP_PKEY_size(rsaPrivKey), 0);
 
-  std::unique_ptr<EVP_PKEY_CTX, SSL_Delete>ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, rsaPrivKey.get(), nullptr), SSL_Delete{});
+  std::unique_ptr<EVP_PKEY_CTX, SSL_Delete>ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, rsaPrivKey, nullptr), SSL_Delete{});
   if (!ctx)
     throw openssl_exception(LOGSTR("mobs::decryptPrivateRsa"));
   if (1 != EVP_PKEY_private_check(ctx.get()))
@@ -536,14 +659,19 @@ mobs::decryptPrivate(const std::vector<u_char> &cipher, std::vector<u_char> &ses
 
 void
 mobs::encryptPublic(const std::vector<u_char> &sessionKey, std::vector<u_char> &cipher, const std::string &filePub) {
-  auto rsaPubKey = mobs_internal::readPublicKey(filePub);
+  encryptPublic(sessionKey, cipher, CryptKey::publicKey(filePub));
+}
+
+void
+mobs::encryptPublic(const std::vector<u_char> &sessionKey, std::vector<u_char> &cipher, const CryptKey &pubKey) {
+  EVP_PKEY *rsaPubKey = keyOf(pubKey);
   if (not rsaPubKey)
     THROW(u8"can't load pub key");
-  if (sessionKey.size() >= EVP_PKEY_size(rsaPubKey.get()) - 41)
+  if (sessionKey.size() >= EVP_PKEY_size(rsaPubKey) - 41)
     THROW(u8"array to big");
-  LOG(LM_INFO, "MAX= " << EVP_PKEY_size(rsaPubKey.get()) - 41 << " res " << EVP_PKEY_size(rsaPubKey.get()));
-  cipher.resize(EVP_PKEY_size(rsaPubKey.get()), 0);
-  std::unique_ptr<EVP_PKEY_CTX, SSL_Delete>ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, rsaPubKey.get(), nullptr), SSL_Delete{});
+  LOG(LM_INFO, "MAX= " << EVP_PKEY_size(rsaPubKey) - 41 << " res " << EVP_PKEY_size(rsaPubKey));
+  cipher.resize(EVP_PKEY_size(rsaPubKey), 0);
+  std::unique_ptr<EVP_PKEY_CTX, SSL_Delete>ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, rsaPubKey, nullptr), SSL_Delete{});
   if (!ctx)
     throw openssl_exception(LOGSTR("mobs::encryptPublicRsa"));
   if (1 != EVP_PKEY_public_check(ctx.get()))
@@ -572,14 +700,19 @@ OSSL_PARAM params[] = {
 void
 mobs::digestSign(const std::vector<u_char> &buffer, std::vector<u_char> &cipher, const std::string &filePriv,
                  const std::string &passphrase) {
-  auto eckey = mobs_internal::readPrivateKey(filePriv, passphrase);
+  digestSign(buffer, cipher, CryptKey::privateKey(filePriv, passphrase));
+}
+
+void
+mobs::digestSign(const std::vector<u_char> &buffer, std::vector<u_char> &cipher, const CryptKey &privKey) {
+  EVP_PKEY *eckey = keyOf(privKey);
   if (not eckey)
     THROW(u8"can't load priv key");
   std::unique_ptr<EVP_MD_CTX, SSL_Delete>mdCtx(EVP_MD_CTX_new(), SSL_Delete{});
   auto md = EVP_get_digestbyname("sha256");
   if (not md)
     throw openssl_exception(LOGSTR("mobs::digestSign"));
-  if (1 != EVP_DigestSignInit(mdCtx.get(), nullptr, md, nullptr,  eckey.get()))
+  if (1 != EVP_DigestSignInit(mdCtx.get(), nullptr, md, nullptr,  eckey))
     throw openssl_exception(LOGSTR("mobs::digestSign"));
   cipher.resize(1024);
   size_t sz = cipher.size();
@@ -590,14 +723,19 @@ mobs::digestSign(const std::vector<u_char> &buffer, std::vector<u_char> &cipher,
 
 bool
 mobs::digestVerify(const std::vector<u_char> &buffer, const std::vector<u_char> &cipher, const std::string &filePub) {
-  auto eckey = mobs_internal::readPublicKey(filePub);
+  return digestVerify(buffer, cipher, CryptKey::publicKey(filePub));
+}
+
+bool
+mobs::digestVerify(const std::vector<u_char> &buffer, const std::vector<u_char> &cipher, const CryptKey &pubKey) {
+  EVP_PKEY *eckey = keyOf(pubKey);
   if (not eckey)
     THROW(u8"can't load pub key");
   std::unique_ptr<EVP_MD_CTX, SSL_Delete>mdCtx(EVP_MD_CTX_new(), SSL_Delete{});
   auto md = EVP_get_digestbyname("sha256");
   if (not md)
     throw openssl_exception(LOGSTR("mobs::digestVerify"));
-  if (1 != EVP_DigestVerifyInit(mdCtx.get(), nullptr, md, nullptr,  eckey.get()))
+  if (1 != EVP_DigestVerifyInit(mdCtx.get(), nullptr, md, nullptr,  eckey))
     throw openssl_exception(LOGSTR("mobs::digestVerify"));
   int ret = EVP_DigestVerify(mdCtx.get(), &cipher[0], cipher.size(), &buffer[0], buffer.size());
   if (ret == 1)
@@ -658,27 +796,32 @@ mobs::encapsulatePublic(std::vector<u_char> &cipher, std::vector<u_char> &key, c
 void
 mobs::decapsulatePublic(const std::vector<u_char> &cipher, std::vector<u_char> &key, const std::string &filePriv,
                            const std::string &passphrase, const std::string &filePub) {
-  auto rsaPrivKey = mobs_internal::readPrivateKey(filePriv, passphrase);
+  decapsulatePublic(cipher, key, CryptKey::privateKey(filePriv, passphrase),
+                    filePub.empty() ? CryptKey() : CryptKey::publicKey(filePub));
+}
+
+void
+mobs::decapsulatePublic(const std::vector<u_char> &cipher, std::vector<u_char> &key, const CryptKey &privKey,
+                        const CryptKey &pubKey) {
+  EVP_PKEY *rsaPrivKey = keyOf(privKey);
   if (not rsaPrivKey)
     THROW(u8"can't load priv key");
-  auto rsaPubKey = mobs_internal::readPublicKey(filePub);
-  std::unique_ptr<EVP_PKEY_CTX, SSL_Delete>ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, rsaPrivKey.get(), nullptr), SSL_Delete{});
+  EVP_PKEY *rsaPubKey = keyOf(pubKey);
+  std::unique_ptr<EVP_PKEY_CTX, SSL_Delete>ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, rsaPrivKey, nullptr), SSL_Delete{});
   if (!ctx)
     throw openssl_exception(LOGSTR("mobs::decapsulatePublic"));
   if (1 != EVP_PKEY_private_check(ctx.get()))
     THROW("IS NO PRIVATE KEY");
-  if (filePub.empty()) {
+  if (not rsaPubKey) {
     if (EVP_PKEY_decapsulate_init(ctx.get(), nullptr) <= 0)
       throw openssl_exception(LOGSTR("mobs::decapsulatePublic"));
   } else {
 #if OPENSSL_VERSION_MAJOR == 3 && OPENSSL_VERSION_MINOR >= 2
-    if (not rsaPubKey)
-      THROW(u8"can't load pub key");
-    if (EVP_PKEY_is_a(rsaPrivKey.get(), "RSA")) {
+    if (EVP_PKEY_is_a(rsaPrivKey, "RSA")) {
       if (EVP_PKEY_CTX_set_kem_op(ctx.get(), "RSASVE") <= 0) // DHKEM
         throw openssl_exception(LOGSTR("mobs::decapsulatePublic"));
     }
-    if (EVP_PKEY_auth_decapsulate_init(ctx.get(), rsaPubKey.get(), nullptr) <= 0)
+    if (EVP_PKEY_auth_decapsulate_init(ctx.get(), rsaPubKey, nullptr) <= 0)
       throw openssl_exception(LOGSTR("mobs::decapsulatePublic"));
 #else
     throw std::runtime_error(LOGSTR("mobs::decapsulatePublic function not supported"));
@@ -799,13 +942,19 @@ std::string mobs::getKeyFingerprint(const std::string &filePub) {
 
 void mobs::deriveSharedSecret(std::vector<u_char> &cipher, const std::string &filePubPeer, const std::string &filePriv,
                               const std::string &passphrase) {
-  auto rsaPubKey = mobs_internal::readPublicKey(filePubPeer);
+  deriveSharedSecret(cipher, CryptKey::publicKey(filePubPeer), CryptKey::privateKey(filePriv, passphrase));
+}
+
+void mobs::deriveSharedSecret(std::vector<u_char> &cipher, const CryptKey &pubPeer, const CryptKey &privKey) {
+  EVP_PKEY *rsaPubKey = keyOf(pubPeer);
   if (not rsaPubKey)
     THROW(u8"can't load pub key");
-  auto rsaPrivKey = mobs_internal::readPrivateKey(filePriv, passphrase);
+  EVP_PKEY *rsaPrivKey = keyOf(privKey);
+  if (not rsaPrivKey)
+    THROW(u8"can't load priv key");
 
   /* Create the context for the shared secret derivation */
-  std::unique_ptr<EVP_PKEY_CTX, SSL_Delete>ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, rsaPrivKey.get(), nullptr), SSL_Delete{});
+  std::unique_ptr<EVP_PKEY_CTX, SSL_Delete>ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, rsaPrivKey, nullptr), SSL_Delete{});
   if (!ctx)
     throw openssl_exception(LOGSTR("mobs::deriveSharedSecret"));
   /* Initialise */
@@ -816,7 +965,7 @@ void mobs::deriveSharedSecret(std::vector<u_char> &cipher, const std::string &fi
     throw openssl_exception(LOGSTR("mobs::deriveSharedSecret"));
   }
   /* Provide the peer public key */
-  if (EVP_PKEY_derive_set_peer(ctx.get(), rsaPubKey.get()) <= 0)
+  if (EVP_PKEY_derive_set_peer(ctx.get(), rsaPubKey) <= 0)
     throw openssl_exception(LOGSTR("mobs::deriveSharedSecret"));
   /* Determine buffer length for shared secret */
   size_t outlen = 0;
@@ -27,11 +27,57 @@
 #define MOBS_CRYPT_H
 
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace mobs {
 class ObjectBase;
+class CryptKeyData;
+
+/** \brief Handle auf einen geladenen Schlüssel
+ *
+ * Der Schlüssel wird einmalig gelesen und ggf. mit der Passphrase entschlüsselt. Danach kann das Handle beliebig oft,
+ * auch aus mehreren Threads gleichzeitig, verwendet werden, ohne dass der Schlüssel erneut geparst werden muss.
+ * Kopien des Handles verweisen auf denselben Schlüssel.
+ */
+class CryptKey {
+public:
+  CryptKey() = default;
+  /** \brief privaten Schlüssel laden
+   *
+   * @param filePriv Dateipfad eines private Keys oder der Schlüssel selbst im PEM-Format
+   * @param passphrase Kennwort zum private Key
+   * \throw std::runtime_error im Fehlerfall
+   */
+  static CryptKey privateKey(const std::string &filePriv, const std::string &passphrase);
+  /** \brief öffentlichen Schlüssel laden
+   *
+   * @param filePub Dateipfad eines public Keys oder der Schlüssel selbst im PEM-Format
+   * \throw std::runtime_error im Fehlerfall
+   */
+  static CryptKey publicKey(const std::string &filePub);
+  /// ist kein Schlüssel geladen
+  bool empty() const { return not data; }
+  /// interne Daten
+  const CryptKeyData *get() const { return data.get(); }
+
+private:
+  explicit CryptKey(std::shared_ptr<CryptKeyData> d) : data(std::move(d)) {}
+  std::shared_ptr<CryptKeyData> data;
+};
+
+/** \brief Größe des Schlüssel-Caches festlegen
+ *
+ * Geparste Schlüssel werden anhand eines Fingerprints aus Inhalt der PEM-Datei bzw. des PEM-Strings und der Passphrase
+ * gecacht, so dass wiederholte Aufrufe mit demselben Schlüssel diesen nicht erneut parsen und entschlüsseln müssen.
+ * Eine Änderung des Dateiinhaltes führt automatisch zu einem neuen Eintrag. Default sind 32 Einträge.
+ * @param n maximale Anzahl Schlüssel im Cache, 0 deaktiviert den Cache
+ */
+void keyCacheSize(size_t n);
+
+/// Schlüssel-Cache leeren
+void keyCacheClear();
 
 /// Klasse für public-Key Informationen
 class RecipientKey {
@@ -120,6 +166,15 @@ std::string getPublicKey(const std::vector<u_char> &data);
  */
 void encryptPublic(const std::vector<u_char> &sessionKey, std::vector<u_char> &cipher, const std::string &filePub);
 
+/** \brief Verschlüsselung eine Keys mit einem public Key
+ *
+ * @param sessionKey zu verschlüsselnde Zeichenkette
+ * @param cipher verschlüsseltes Ergebnis
+ * @param pubKey Handle des public Keys
+ * \throw std::runtime_error im Fehlerfall
+ */
+void encryptPublic(const std::vector<u_char> &sessionKey, std::vector<u_char> &cipher, const CryptKey &pubKey);
+
 /** \brief Entschlüsselung mit einem private Key
  *
  * @param cipher verschlüsselte Eingabe
@@ -130,6 +185,15 @@ void encryptPublic(const std::vector<u_char> &sessionKey, std::vector<u_char> &c
 */
 void decryptPrivate(const std::vector<u_char> &cipher, std::vector<u_char> &sessionKey, const std::string &filePriv, const std::string &passphrase);
 
+/** \brief Entschlüsselung mit einem private Key
+ *
+ * @param cipher verschlüsselte Eingabe
+ * @param sessionKey entschlüsselte Zeichenkette
+ * @param privKey Handle des private Keys
+ * \throw std::runtime_error im Fehlerfall
+*/
+void decryptPrivate(const std::vector<u_char> &cipher, std::vector<u_char> &sessionKey, const CryptKey &privKey);
+
 /** \brief Verschlüsselung eine Keys mit einem private Key
  *
  * Der zu verschlüsselnde Buffer darf maximal 214 Zeichen lang sein
@@ -161,6 +225,15 @@ void decryptPublic(const std::vector<u_char> &cipher, std::vector<u_char> &sessi
 void digestSign(const std::vector<u_char> &buffer, std::vector<u_char> &cipher, const std::string &filePriv,
                 const std::string &passphrase);
 
+/** \brief Erzeuge eine Signatur aus einem Buffer
+ *
+ * @param buffer zu signierende Eingabe, zB, Hash-Wert
+ * @param cipher erzeugte Signatur
+ * @param privKey Handle des private Keys
+ * \throw std::runtime_error im Fehlerfall
+ */
+void digestSign(const std::vector<u_char> &buffer, std::vector<u_char> &cipher, const CryptKey &privKey);
+
 /** \brief Prüfe eine Signatur zu einem Buffer
  *
  * @param buffer zu überprüfende Eingabe, zB, Hash-Wert
@@ -171,6 +244,16 @@ void digestSign(const std::vector<u_char> &buffer, std::vector<u_char> &cipher,
  */
 bool digestVerify(const std::vector<u_char> &buffer, const std::vector<u_char> &cipher, const std::string &filePup);
 
+/** \brief Prüfe eine Signatur zu einem Buffer
+ *
+ * @param buffer zu überprüfende Eingabe, zB, Hash-Wert
+ * @param cipher Signatur die überprüft werden soll
+ * @param pubKey Handle des öffentlichen Keys
+ * @return true, wenn die Signatur übereinstimmt
+ * \throw runtime_error im Fehlerfall
+ */
+bool digestVerify(const std::vector<u_char> &buffer, const std::vector<u_char> &cipher, const CryptKey &pubKey);
+
 /** \brief Test ob Passwort und Schlüssel OK
  *
  * @param filePriv Dateipfad eines private Keys oder der Schlüssel selbst im PEM-Format
@@ -264,6 +347,17 @@ void encapsulatePublic(std::vector<u_char> &cipher, std::vector<u_char> &session
 void decapsulatePublic(const std::vector<u_char> &cipher, std::vector<u_char> &sessionKey, const std::string &filePriv,
                        const std::string &passphrase, const std::string &filePup = "");
 
+/** \brief Authentifizierungsschlüssel für Session-Key entschlüsseln
+ *
+ * @param cipher Cipher die vom Client erhalten wurde
+ * @param sessionKey generierter Session-Key der symmetrischen Verschlüsselung
+ * @param privKey Handle des privaten Schlüssels des Servers
+ * @param pubKey Handle des öffentlichen Schlüssels des Clients zur Authentisierung oder leer (ab openSSL 3.2)
+ * \throw std::runtime_error im Fehlerfall
+ */
+void decapsulatePublic(const std::vector<u_char> &cipher, std::vector<u_char> &sessionKey, const CryptKey &privKey,
+                       const CryptKey &pubKey = CryptKey());
+
 /** \brief Ermittel das gemeinsame shared secret zwischen zwei Schlusselpaaren.
  *
  * Beide Seiten erhalten mit dem jeweiligen eigenen privaten und dem anderen öffentlichen Schlüssel dasselbe shared secret
@@ -276,6 +370,15 @@ void decapsulatePublic(const std::vector<u_char> &cipher, std::vector<u_char> &s
 void deriveSharedSecret(std::vector<u_char> &secret, const std::string &filePubPeer, const std::string &filePriv,
                         const std::string &passphrase);
 
+/** \brief Ermittel das gemeinsame shared secret zwischen zwei Schlusselpaaren.
+ *
+ * @param secret generiertes shared secret
+ * @param pubPeer Handle des öffentlichen Schlüssels der Gegenstelle
+ * @param privKey Handle des privaten eigenen Schlüssels
+ * \throw std::runtime_error im Fehlerfall
+ */
+void deriveSharedSecret(std::vector<u_char> &secret, const CryptKey &pubPeer, const CryptKey &privKey);
+
 /** \brief erzeuge einen public ephemeral key und bereite einen Schlüsselaustausch vor (KEM).
  *
  * Das Verfahren ist für EC oder DH Schlüssel möglich und als 'Ephemeral Diffie-Hellman' bekannt.
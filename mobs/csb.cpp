@@ -583,6 +583,21 @@ public:
     }
   }
 
+  // Block dekodieren; vollständige Gruppen am Stück, Rest (Whitespace, Padding) zeichenweise
+  void b64getBlock(const char *cp, size_t n, CryptBufBase::char_type *&it) {
+    const char *end = cp + n;
+    while (cp != end) {
+      if (b64Cnt == 0) {
+        size_t done = decode_base64(cp, size_t(end - cp), reinterpret_cast<u_char *>(it));
+        it += done / 4 * 3;
+        cp += done;
+        if (cp == end)
+          break;
+      }
+      b64get(u_char(*cp++), it);
+    }
+  }
+
   std::streamsize canRead() const {
     CSBLOG(LM_DEBUG, "canRead");
     if (readLimit == 0)
@@ -656,10 +671,8 @@ public:
       for (std::streamsize i = 0; i < lookaheadCnt; i++)
         b64get(u_char(*cp++), it);
       lookaheadCnt = 0;
-      cp = &buf[0];
       if (sr)
-        for (std::streamsize i = 0; i < sr; i++)
-          b64get(u_char(*cp++), it);
+        b64getBlock(&buf[0], size_t(sr), it);
       else {
         if (b64Cnt > 0)
           for (; b64Cnt < 4; b64Cnt++)
@@ -704,22 +717,41 @@ public:
   void b64put(const u_char *buf, size_t sz) {
     auto first = buf;
     auto last = first + sz;
-    while (first != last) {
-      b64.a = (b64.a << 8) + (*first & 0xff);
-      if (++b64.i == 3) {
-        *outStb << char(to_base64(b64.a >> 18));
-        *outStb << char(to_base64((b64.a >> 12) & 0x3f));
-        *outStb << char(to_base64((b64.a >> 6) & 0x3f));
-        *outStb << char(to_base64(b64.a & 0x3f));
-        b64.i = 0;
-        b64.a = 0;
-        if (b64.l++ > 15) {
-          for (auto c: b64.linebreak)
-            *outStb << c;
-          b64.l = 0;
-        }
+    // angefangene Gruppe zeichenweise auffüllen
+    while (first != last and b64.i != 0)
+      b64putChar(*first++);
+    // vollständige Gruppen zeilenweise am Stück kodieren
+    std::array<char, 17 * 4> line; // NOLINT(cppcoreguidelines-pro-type-member-init)
+    while (last - first >= 3) {
+      size_t groups = std::min(size_t(last - first) / 3, size_t(17 - b64.l));
+      size_t n = encode_base64(first, groups * 3, &line[0]);
+      outStb->write(&line[0], std::streamsize(n));
+      first += groups * 3;
+      b64.l += int(groups);
+      if (b64.l >= 17) {
+        for (auto c: b64.linebreak)
+          *outStb << c;
+        b64.l = 0;
+      }
+    }
+    while (first != last)
+      b64putChar(*first++);
+  }
+
+  void b64putChar(u_char c) {
+    b64.a = (b64.a << 8) + c;
+    if (++b64.i == 3) {
+      *outStb << char(to_base64(b64.a >> 18));
+      *outStb << char(to_base64((b64.a >> 12) & 0x3f));
+      *outStb << char(to_base64((b64.a >> 6) & 0x3f));
+      *outStb << char(to_base64(b64.a & 0x3f));
+      b64.i = 0;
+      b64.a = 0;
+      if (b64.l++ > 15) {
+        for (auto ch: b64.linebreak)
+          *outStb << ch;
+        b64.l = 0;
       }
-      first++;
     }
   }
 
@@ -89,16 +89,16 @@ public:
    *
    * @param on Base64 einschalten
    */
-  void setBase64(bool on);
+  virtual void setBase64(bool on);
 
   /// Abfrage des Status
   bool bad() const;
 
   /// Übergeordneten Ausgabe-stream setzen
-  void setOstr(std::ostream &ostr);
+  virtual void setOstr(std::ostream &ostr);
 
   /// Übergeordneten Eingabe-stream setzen
-  void setIstr(std::istream &istr);
+  virtual void setIstr(std::istream &istr);
 
   /** \brief Anzahl der zu lesenden Bytes begrenzen
    *
@@ -37,10 +37,21 @@
 #endif
 
 #include "helper.h"
+#include "queryorder.h"
+#include "queryprojection.h"
+#include "querygenerator.h"
 #include "mchrono.h"
 #include "audittrail.h"
+#include "auditwriter.h"
 #include "converter.h"
+#include "metrics.h"
+#include "condwait.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iomanip>
+#include <mutex>
+#include <thread>
 #include <sstream>
 #ifndef __MINGW32__
 #include <unistd.h>
@@ -55,6 +66,68 @@ public:
   std::shared_ptr<DatabaseConnection> connection;
   std::string database;
 };
+
+// Übergabe der gelesenen Objekte an die Call-Back-Threads von parallelScan
+class ScanQueue {
+public:
+  ScanQueue(size_t mq, size_t r) : maxQueue(mq ? mq : 1), readers(r) {}
+
+  // liefert false, wenn abgebrochen wurde
+  bool put(std::unique_ptr<ObjectBase> obj) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitFor(cond, lock, [this]() { return failed or queue.size() < maxQueue; });
+    if (failed)
+      return false;
+    queue.push_back(std::move(obj));
+    cond.notify_all();
+    return true;
+  }
+  // liefert nullptr, wenn alles abgearbeitet ist oder abgebrochen wurde
+  std::unique_ptr<ObjectBase> get() {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitFor(cond, lock, [this]() { return failed or not queue.empty() or readers == 0; });
+    if (failed or queue.empty())
+      return nullptr;
+    std::unique_ptr<ObjectBase> obj = std::move(queue.front());
+    queue.pop_front();
+    cond.notify_all();
+    return obj;
+  }
+  void readerDone() {
+    std::lock_guard<std::mutex> guard(mutex);
+    readers--;
+    cond.notify_all();
+  }
+  void fail(std::exception_ptr e) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (not failed)
+      error = std::move(e);
+    failed = true;
+    cond.notify_all();
+  }
+
+  std::exception_ptr error;
+
+private:
+
+  size_t maxQueue;
+  size_t readers;
+  bool failed = false;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<std::unique_ptr<ObjectBase>> queue;
+};
+
+// ermittelt das erste Key-Element
+class FirstKey : virtual public ObjTravConst {
+public:
+  bool doObjBeg(const ObjectBase &) override { return true; }
+  void doObjEnd(const ObjectBase &) override { }
+  bool doArrayBeg(const MemBaseVector &) override { return false; }
+  void doArrayEnd(const MemBaseVector &) override { }
+  void doMem(const MemberBase &mem) override { if (not key) key = &mem; }
+  const MemberBase *key = nullptr;
+};
 }
 
 
@@ -194,6 +267,8 @@ void DatabaseManager::execute(DatabaseManager::transaction_callback &cb) {
   try {
     cb(&transaction);
     transaction.writeAuditTrail();
+    transaction.prepare();
+    transaction.spoolAuditTrail();
   } catch (mobs::locked_error &e) {
     LOG(LM_DEBUG, "TRANSACTION FAILED locked_error " << e.what());
     transaction.finish(false);
@@ -220,6 +295,7 @@ void DatabaseManager::execute(DatabaseManager::transaction_callback &cb) {
     throw std::runtime_error(u8"DbTransaction error: unknown exception");
   }
   transaction.finish(true);
+  transaction.submitAuditTrail();
   DbTransaction::MTime end = std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::system_clock::now());
   auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - transaction.startTime()).count();
   LOG(LM_DEBUG, "TRANSACTION FINISHED " << duration << " µs");
@@ -236,6 +312,9 @@ public:
     // je Database eigenen AuditTrail-Buffer
     std::map<std::string, AuditActivity> audit;
   };
+  // Audit-Trail für den AuditWriter, wird erst nach dem Commit übergeben
+  std::list<AuditQueued> deferredAudit;
+  bool auditSpooled = false; // deferredAudit ist bereits in der Spool-Datei gesichert
   std::map<const DatabaseConnection *, DTI> connections;
   DbTransaction::IsolationLevel isolationLevel = DbTransaction::RepeatableRead;
   DbTransaction::MTime start = std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::system_clock::now());
@@ -307,12 +386,54 @@ void DbTransaction::writeAuditTrail() {
       if (not data->comment.empty())
         a.second.comment(data->comment);
       DatabaseInterface dbi_t(dti.dbCon, a.first);
+      AuditWriter *writer = AuditWriter::instance();
+      if (writer) {
+        std::string con = writer->auditConnection(dbi_t.connectionName());
+        if (not con.empty()) {
+          data->deferredAudit.emplace_back();
+          data->deferredAudit.back().connection(con);
+          data->deferredAudit.back().activity(a.second);
+          continue;
+        }
+      }
       dbi_t.transaction = this;
       dti.dbCon->save(dbi_t, a.second);
     }
   }
 }
 
+void DbTransaction::spoolAuditTrail() {
+  if (data->deferredAudit.empty())
+    return;
+  AuditWriter *writer = AuditWriter::instance();
+  if (not writer)
+    THROW("AuditWriter not available");
+  data->auditSpooled = true;
+  writer->spool(data->deferredAudit);
+}
+
+void DbTransaction::submitAuditTrail() {
+  if (data->deferredAudit.empty())
+    return;
+  std::list<AuditQueued> entries;
+  std::swap(entries, data->deferredAudit);
+  data->auditSpooled = false;
+  AuditWriter *writer = AuditWriter::instance();
+  if (not writer)
+    THROW("AuditWriter not available, audit trail remains in spool");
+  writer->submit(entries);
+}
+
+void DbTransaction::cancelAuditTrail() {
+  if (not data->auditSpooled)
+    return;
+  data->auditSpooled = false;
+  AuditWriter *writer = AuditWriter::instance();
+  if (writer)
+    writer->cancel(data->deferredAudit);
+  data->deferredAudit.clear();
+}
+
 DbTransaction::DbTransaction() : data(new DbTransactionData) { }
 
 DbTransaction::~DbTransaction() = default;
@@ -343,7 +464,13 @@ DatabaseInterface DbTransaction::getDbIfc(const std::string &connectionName) {
   return dbi;
 }
 
+void DbTransaction::prepare() {
+  for (auto &i:data->connections)
+    i.second.dbCon->prepareTransaction(this, i.second.tdb);
+}
+
 void DbTransaction::finish(bool good) {
+  MetricsTimer timer(good ? "db.commit" : "db.rollback");
   bool error = false;
   std::string msg;
   for (auto &i:data->connections) {
@@ -381,6 +508,8 @@ void DbTransaction::finish(bool good) {
         LOG(LM_DEBUG, "Transaction rollback unknown exception");
     }
   }
+  if (error or not good)
+    cancelAuditTrail();
   if (error and good)
     throw std::runtime_error(std::string(u8"DbTransaction Commit error: ") + msg);
 }
@@ -453,6 +582,7 @@ DatabaseInterface::DatabaseInterface(std::shared_ptr<DatabaseConnection> dbi, st
         : dbCon(std::move(dbi)), databaseName(std::move(dbName)), timeout(0) {  }
 
 bool DatabaseInterface::load(ObjectBase &obj) {
+  MetricsTimer timer("db.load");
   if (not dbCon->load(*this, obj))
     return false;
   obj.loaded(); // Callback
@@ -462,6 +592,7 @@ bool DatabaseInterface::load(ObjectBase &obj) {
 }
 
 void DatabaseInterface::save(const ObjectBase &obj) {
+  MetricsTimer timer("db.save");
   if (transaction) {
     if (obj.hasFeature(DbAuditTrail))
       transaction->doAuditSave(obj, *this);
@@ -488,6 +619,7 @@ void DatabaseInterface::save(ObjectBase &obj) {
 }
 
 bool DatabaseInterface::destroy(const ObjectBase &obj) {
+  MetricsTimer timer("db.destroy");
   if (transaction) {
     if (obj.hasFeature(DbAuditTrail))
       transaction->doAuditDestroy(obj, *this);
@@ -507,27 +639,177 @@ bool DatabaseInterface::destroy(const ObjectBase &obj) {
 }
 
 
+DatabaseInterface DatabaseInterface::withProjection(const QueryProjection &proj) {
+  DatabaseInterface d(*this);
+  d.projection = std::make_shared<const QueryProjection>(proj);
+  return d;
+}
+
+std::shared_ptr<DbCursor> DatabaseInterface::doQuery(ObjectBase &obj, bool qbe, const QueryGenerator *query,
+                                                     const QueryOrder *sort) {
+  MetricsTimer timer("db.query");
+  auto cursor = dbCon->query(*this, obj, qbe, query, sort);
+  if (cursor and not keysOnly and not countCursor)
+    cursor->m_projection = projection;
+  return cursor;
+}
+
 std::shared_ptr<DbCursor> DatabaseInterface::query(ObjectBase &obj, const QueryGenerator &query) {
-  return dbCon->query(*this, obj, false, &query, nullptr);
+  return doQuery(obj, false, &query, nullptr);
 }
 
 std::shared_ptr<DbCursor> DatabaseInterface::query(ObjectBase &obj, const QueryGenerator &query, const QueryOrder &sort) {
-  return dbCon->query(*this, obj, false, &query, &sort);
+  return doQuery(obj, false, &query, &sort);
+}
+
+std::shared_ptr<DbCursor> DatabaseInterface::queryAfter(ObjectBase &obj, const QueryGenerator &query,
+                                                        const QueryOrder &sort) {
+  class KeyCheck : virtual public ObjTravConst {
+  public:
+    explicit KeyCheck(const QueryOrder &s) : sort(s) {}
+    bool doObjBeg(const ObjectBase &obj) override { return true; }
+    void doObjEnd(const ObjectBase &obj) override { }
+    bool doArrayBeg(const MemBaseVector &vec) override { return false; }
+    void doArrayEnd(const MemBaseVector &vec) override { }
+    void doMem(const MemberBase &mem) override {
+      u_int pos;
+      int dir;
+      if (not sort.sortInfo(mem, pos, dir))
+        THROW("keyset pagination: sort order must contain key element " << mem.getElementName());
+    }
+    const QueryOrder &sort;
+  };
+  KeyCheck kc(sort);
+  obj.traverseKey(kc);
+
+  QueryGenerator q;
+  q.query = query.query;
+  q.addKeysetAfter(sort);
+  return doQuery(obj, false, &q, &sort);
+}
+
+size_t DatabaseInterface::parallelScan(ObjectBase &obj, const QueryGenerator &query,
+                                       const std::vector<std::string> &connectionNames, size_t threads,
+                                       const scan_callback &cb, size_t maxQueue) {
+  DatabaseManager *dbm = DatabaseManager::instance();
+  if (not dbm)
+    throw std::runtime_error("DatabaseManager invalid");
+  if (connectionNames.empty())
+    THROW("parallelScan needs at least one connection");
+  FirstKey fk;
+  obj.traverseKey(fk);
+  if (not fk.key)
+    THROW("parallelScan needs a key element");
+
+  DatabaseInterface dbi(*this);
+  dbi.countCursor = false;
+  dbi.skip = 0;
+  dbi.limit = 0;
+  dbi.transaction = nullptr;
+
+  // Bereichsgrenzen sind die Keys an den Positionen i * total / n, ermittelt in einem einzigen Durchlauf
+  // über die Keys (statt je Grenze einer Abfrage mit Skip, die jeweils alle vorigen Sätze überliest)
+  std::vector<std::unique_ptr<ObjectBase>> bounds;
+  std::vector<const MemberBase *> boundMem;
+  const size_t n = connectionNames.size();
+  if (n > 1) {
+    size_t total = dbi.withCountCursor().query(obj, query)->pos();
+    QueryOrder sort;
+    sort.add(*fk.key);
+    std::string last;
+    size_t next = 1;
+    auto cursor = dbi.withKeysOnly().query(obj, query, sort);
+    for (size_t pos = 0; next < n and not cursor->eof(); cursor->next(), pos++) {
+      if (pos == 0 or pos < next * total / n)
+        continue;
+      while (next < n and next * total / n <= pos)
+        next++;
+      std::unique_ptr<ObjectBase> b(obj.createNew());
+      if (not b)
+        THROW("parallelScan: can't create object");
+      dbi.retrieve(*b, cursor);
+      FirstKey bk;
+      b->traverseKey(bk);
+      std::string v = bk.key->toStr(ConvToStrHint(false));
+      if (not boundMem.empty() and v == last)
+        continue;
+      last = v;
+      boundMem.push_back(bk.key);
+      bounds.push_back(std::move(b));
+    }
+  }
+
+  // je Bereich ein Cursor auf einer eigenen Verbindung
+  std::vector<std::pair<DatabaseInterface, std::shared_ptr<DbCursor>>> cursors;
+  for (size_t i = 0; i <= boundMem.size(); i++) {
+    DatabaseInterface other = dbm->getDbIfc(connectionNames[i]);
+    DatabaseInterface pdbi(dbi);
+    pdbi.dbCon = other.dbCon;
+    pdbi.databaseName = other.databaseName;
+    QueryGenerator q;
+    q.query = query.query;
+    q.addRange(*fk.key, i > 0 ? boundMem[i - 1] : nullptr, i < boundMem.size() ? boundMem[i] : nullptr);
+    auto cursor = pdbi.query(obj, q);
+    cursors.emplace_back(pdbi, cursor);
+  }
+
+  ScanQueue sq(maxQueue, cursors.size());
+  std::atomic<size_t> done(0);
+  std::vector<std::thread> pool;
+  for (auto &c:cursors) {
+    pool.emplace_back([&sq, &obj, &c]() {
+      try {
+        for (auto &cursor = c.second; not cursor->eof(); cursor->next()) {
+          std::unique_ptr<ObjectBase> o(obj.createNew());
+          if (not o)
+            THROW("parallelScan: can't create object");
+          c.first.retrieve(*o, cursor);
+          if (not sq.put(std::move(o)))
+            break;
+        }
+        c.second = nullptr; // Cursor noch in diesem Thread freigeben
+      } catch (...) {
+        sq.fail(std::current_exception());
+      }
+      sq.readerDone();
+    });
+  }
+  for (size_t i = 0; i < (threads ? threads : 1); i++) {
+    pool.emplace_back([&sq, &cb, &done]() {
+      try {
+        for (;;) {
+          std::unique_ptr<ObjectBase> o = sq.get();
+          if (not o)
+            break;
+          cb(*o);
+          done++;
+        }
+      } catch (...) {
+        sq.fail(std::current_exception());
+      }
+    });
+  }
+  for (auto &t:pool)
+    t.join();
+  if (sq.error)
+    std::rethrow_exception(sq.error);
+  return done;
 }
 
 std::shared_ptr<DbCursor> DatabaseInterface::qbe(ObjectBase &obj) {
-  return dbCon->query(*this, obj, true, nullptr, nullptr);
+  return doQuery(obj, true, nullptr, nullptr);
 }
 
 std::shared_ptr<DbCursor> DatabaseInterface::qbe(ObjectBase &obj, const QueryOrder &sort) {
-  return dbCon->query(*this, obj, true, nullptr, &sort);
+  return doQuery(obj, true, nullptr, &sort);
 }
 
 void DatabaseInterface::retrieve(ObjectBase &obj, std::shared_ptr<mobs::DbCursor> cursor) {
+  MetricsTimer timer("db.retrieve");
   if (not cursor->valid())
     throw std::runtime_error("DatabaseInterface: cursor is not valid");
   dbCon->retrieve(*this, obj, cursor);
-  if (not cursor->keysOnly()) {
+  if (not cursor->keysOnly() and not cursor->projection()) {
     obj.loaded(); // Callback
     if (obj.hasFeature(DbAuditTrail))
       obj.startAudit();
@@ -565,6 +847,9 @@ size_t DatabaseInterface::maxAuditChangesValueSize() const {
 }
 
 
+void DatabaseConnection::prepareTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) {
+}
+
 void DatabaseConnection::uploadFile(DatabaseInterface &dbi, const std::string &id, std::istream &source) {
   THROW("not implemented");
 }
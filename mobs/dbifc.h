@@ -32,6 +32,7 @@
 #include <utility>
 #include <functional>
 #include <memory>
+#include <vector>
 #include <iostream>
 
 
@@ -42,6 +43,8 @@ class DbTransaction;
 class DatabaseManager;
 class QueryOrder;
 class QueryGenerator;
+class QueryProjection;
+class QueryProfiler;
 
 /** \brief Exception falls Datenbank temporär geblockt oder nicht verfügbar
  *
@@ -102,9 +105,16 @@ public:
   /// ist Cursor im KeysOnly-Modus
   virtual bool keysOnly() const { return false; }
 
+  /// Projektion der Abfrage oder nullptr, wenn alle Elemente gelesen werden
+  const QueryProjection *projection() const { return m_projection.get(); }
+
 protected:
   /// \private
   size_t cnt = 0;
+
+private:
+  friend class DatabaseInterface;
+  std::shared_ptr<const QueryProjection> m_projection;
 };
 
 
@@ -142,6 +152,12 @@ public:
 
   /// \private
   virtual void startTransaction(DatabaseInterface &dbi, DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) = 0;
+  /** \brief Vorbereitung des Commits, zurückgehaltene Schreibzugriffe ausführen
+   *
+   * Wird nach dem Transaktions-Callback und vor endTransaction für jede beteiligte Verbindung aufgerufen. Eine
+   * Exception führt zum Rollback der gesamten Transaktion und wird unverändert an den Aufrufer gemeldet.
+   */
+  virtual void prepareTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb);
   /// \private
   virtual void endTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) = 0;
   /// \private
@@ -152,7 +168,7 @@ public:
 
   /** \brief BLOB mittels vorhandener Id in Datenbank ablegen
    *
-   * Diese Funktion ist derzeit nur bei mongoDb implementiert
+   * Bei mongoDb über GridFS, sonst in den Tabellen von mobs::BlobStore, die mit BlobStore::structure anzulegen sind
    * @param dbi DatabaseInterface
    * @param id Id des neuen Blobs (datenbankspezifisch)
    * @param source Stream aus dem die Datei gelesen wird
@@ -162,7 +178,7 @@ public:
 
   /** \brief BLOB in Datenbank ablegen
    *
-   * Diese Funktion ist derzeit nur bei mongoDb implementiert
+   * Bei mongoDb über GridFS, sonst in den Tabellen von mobs::BlobStore, die mit BlobStore::structure anzulegen sind
    * @param dbi DatabaseInterface
    * @param source Stream aus dem die Datei gelesen wird
    * @return id, unter der die Datei abgelegt wurde
@@ -172,7 +188,7 @@ public:
 
   /** \brief BLOB aus Datenbank zurücklesen
    *
-   * Diese Funktion ist derzeit nur bei mongoDb implementiert
+   * Bei mongoDb über GridFS, sonst in den Tabellen von mobs::BlobStore, die mit BlobStore::structure anzulegen sind
    * @param dbi DatabaseInterface
    * @param id Id des BLOBs
    * @param dest
@@ -182,12 +198,24 @@ public:
 
   /** \brief BLOB aus Datenbank löschen
    *
-   * Diese Funktion ist derzeit nur bei mongoDb implementiert
+   * Bei mongoDb über GridFS, sonst in den Tabellen von mobs::BlobStore, die mit BlobStore::structure anzulegen sind
    * @param dbi DatabaseInterface
    * @param id Id des BLOBs
    * \throws exception im Fehlerfall
    */
   virtual void deleteFile(DatabaseInterface &dbi, const std::string &id);
+
+  /** \brief Profiler für die Anweisungen dieser Verbindung setzen
+   *
+   * @param profiler Profiler, der auch von mehreren Verbindungen benutzt werden kann; nullptr schaltet ab
+   * \see mobs::QueryProfiler
+   */
+  void setQueryProfiler(std::shared_ptr<QueryProfiler> profiler) { m_profiler = std::move(profiler); }
+  /// liefert den Profiler der Verbindung oder nullptr
+  const std::shared_ptr<QueryProfiler> &queryProfiler() const { return m_profiler; }
+
+private:
+  std::shared_ptr<QueryProfiler> m_profiler;
 };
 
 /// Container für die Information zu einer Datenbankverbindung
@@ -225,6 +253,17 @@ class DatabaseInterface {
 public:
   friend class DbTransaction;
 
+  /// Call-Back für parallelScan
+  using scan_callback = std::function<void(ObjectBase &)>;
+
+  /// Konstanten für das Lesen der Ergebnismenge einer Query
+  enum FetchPolicy {
+    FetchDefault,  ///< Datenbankabhängige Voreinstellung
+    FetchBuffered, ///< gesamte Ergebnismenge wird beim Client gepuffert
+    FetchStreaming, ///< Datensätze werden einzeln vom Server geholt; die Verbindung ist bis zum Ende des Cursors belegt
+    FetchServerCursor ///< serverseitiger Cursor, es werden jeweils fetchSize Datensätze geholt
+  };
+
   /// \private
   DatabaseInterface(std::shared_ptr<DatabaseConnection> dbi, std::string dbName);
 
@@ -302,6 +341,57 @@ public:
   */
   std::shared_ptr<DbCursor> query(ObjectBase &obj, const QueryGenerator &query, const QueryOrder &sort);
 
+  /** \brief Datenbankabfrage der Folgeseite mittels Keyset-Pagination
+  *
+  * Statt mit withQuerySkip() die vorherigen Seiten zu überspringen, wird die Abfrage hinter dem letzten Objekt der
+  * vorherigen Seite fortgesetzt. Dessen Werte werden aus den Sortier-Elementen von \c obj entnommen. Nach dem
+  * Abarbeiten einer Seite mit retrieve() enthält \c obj bereits das letzte Objekt.
+  *
+  * Die Sortierung muss alle Key-Elemente von \c obj enthalten, damit die Reihenfolge eindeutig ist.
+  * \code
+  * auto cursor = dbi.withQueryLimit(100).query(obj, filter, sort);
+  * ...
+  * cursor = dbi.withQueryLimit(100).queryAfter(obj, filter, sort);
+  * \endcode
+  * @param obj Objekt zur Generierung der Abfrage, mit den Werten des letzten Objektes
+  * @param query Bedingung/Filter der Abfrage. \see QueryGenerator
+  * @param sort Sortier-Objekt zum Aufbau der Query
+  * @return Shared-Pointer auf einen Ergebnis-Cursor
+  * \throw runtime_error wenn ein Fehler auftrat oder die Sortierung nicht alle Key-Elemente enthält
+  */
+  std::shared_ptr<DbCursor> queryAfter(ObjectBase &obj, const QueryGenerator &query, const QueryOrder &sort);
+
+  /** \brief Parallele Datenbankabfrage, aufgeteilt in Bereiche des ersten Key-Elementes
+   *
+   * Die Abfrage wird anhand des ersten Key-Elementes in so viele Bereiche aufgeteilt, wie Verbindungen angegeben sind.
+   * Die Grenzen werden über die Anzahl der Treffer und einen einzigen Durchlauf über die Keys ermittelt. Jeder Bereich wird über eine
+   * eigene Verbindung in einem eigenen Thread gelesen; die gefüllten Objekte werden an einen Pool von \c threads
+   * Threads übergeben, die jeweils \c cb aufrufen. Ist die Warteschlange voll, so wird das Lesen angehalten.
+   *
+   * Die Verbindungen müssen beim DatabaseManager angemeldet sein und auf dieselbe Datenbank zeigen. Da
+   * Datenbank-Verbindungen nicht thread-sicher sind, darf keine davon währenddessen anderweitig benutzt werden.
+   * Die Optionen dieses Interfaces (z.B. withProjection, withFetchPolicy) werden übernommen, Skip und Limit nicht.
+   * Die Reihenfolge der Aufrufe von \c cb ist undefiniert.
+   * \code
+   * std::atomic<size_t> n(0);
+   * dbi.parallelScan(obj, filter, {"scan1", "scan2", "scan3", "scan4"}, 8, [&n](mobs::ObjectBase &o) {
+   *   auto &f = dynamic_cast<Fahrzeug &>(o);
+   *   ...
+   *   n++;
+   * });
+   * \endcode
+   * @param obj Objekt zur Generierung der Abfrage; von diesem Typ werden die Objekte für den Call-Back erzeugt
+   * @param query Bedingung/Filter der Abfrage. \see QueryGenerator
+   * @param connectionNames Namen der Verbindungen, je Bereich eine
+   * @param threads Anzahl der Threads für den Call-Back
+   * @param cb Call-Back, wird parallel aus mehreren Threads aufgerufen
+   * @param maxQueue maximale Anzahl gelesener, noch nicht verarbeiteter Objekte
+   * @return Anzahl der verarbeiteten Objekte
+   * \throw runtime_error wenn ein Fehler auftrat; eine Exception aus dem Call-Back bricht die Abfrage ab und wird weitergereicht
+   */
+  size_t parallelScan(ObjectBase &obj, const QueryGenerator &query, const std::vector<std::string> &connectionNames,
+                      size_t threads, const scan_callback &cb, size_t maxQueue = 1000);
+
   /** \brief Datenbankabfrage Query By Example
    *
    * Es wird eine Datenbankabfrage aus dem übergebenen Objekt generiert, die auf alle,
@@ -325,6 +415,8 @@ public:
 
   /** lade das Objekt, auf das der Cursor zeigt
    *
+   * Bei einer Query mit Projektion werden nur die ausgewählten Elemente geladen; loaded() und der Audit-Trail werden
+   * dann nicht gestartet.
    * @param obj Objekt das mit dem Inhalt der Datenbank überschrieben wird
    * @param cursor Cursor, der auf ein Objekt zeigt, valid() und nicht eof()
    * \throw runtime_error wenn ein Fehler auftrat
@@ -365,6 +457,29 @@ public:
     return d;
   }
 
+  /** \brief Erzeuge ein Duplikat mit einer Projektion, mit der bei einer Query nur die ausgewählten Elemente gelesen werden
+   *
+   * Es werden nur die Spalten der ausgewählten Elemente und der Key-Elemente abgefragt; Detail-Tabellen nicht
+   * ausgewählter Vektoren werden übersprungen. Die Projektion wird kopiert und an den Cursor weitergegeben.
+   * \see QueryProjection
+   */
+  DatabaseInterface withProjection(const QueryProjection &proj);
+
+  /** \brief Erzeuge ein Duplikat mit einer Vorgabe, wie die Ergebnismenge einer Query gelesen wird
+   *
+   * Bei großen Ergebnismengen vermeidet FetchServerCursor sowohl das vollständige Puffern im Speicher als auch einen
+   * Server-Zugriff pro Datensatz. Wird die Vorgabe von einer Datenbank nicht unterstützt, so wird sie ignoriert.
+   * \see MariaDatabaseConnection
+   * @param policy Art des Lesens
+   * @param fetchSize Anzahl der Datensätze je Server-Zugriff bei FetchServerCursor
+   */
+  DatabaseInterface withFetchPolicy(FetchPolicy policy, size_t fetchSize = 100) {
+    DatabaseInterface d(*this);
+    d.fetchPolicy = policy;
+    d.fetchSize = fetchSize ? fetchSize : 1;
+    return d;
+  }
+
   /// Erzeuge ein Duplikat mit der Option, die ersten skip Objekte einer Query zu überspringen
   DatabaseInterface withQuerySkip(size_t skipCnt) {
     DatabaseInterface d(*this);
@@ -404,6 +519,15 @@ public:
   /// Abfrage keys only
   bool getKeysOnly() const { return keysOnly; }
 
+  /// Abfrage FetchPolicy
+  FetchPolicy getFetchPolicy() const { return fetchPolicy; }
+
+  /// Abfrage Anzahl der Datensätze je Server-Zugriff bei FetchServerCursor
+  size_t getFetchSize() const { return fetchSize; }
+
+  /// Abfrage Projektion, nullptr wenn alle Elemente gelesen werden
+  const QueryProjection *getProjection() const { return projection.get(); }
+
   /// Abfrage Transaktion
   DbTransaction *getTransaction() const { return transaction; }
 
@@ -414,13 +538,18 @@ public:
   size_t maxAuditChangesValueSize() const;
 
 private:
+  std::shared_ptr<DbCursor> doQuery(ObjectBase &obj, bool qbe, const QueryGenerator *query, const QueryOrder *sort);
+
   std::shared_ptr<DatabaseConnection> dbCon;
   std::string databaseName;
   bool countCursor = false;
   bool keysOnly = false;
   bool dirtyRead = false;
+  std::shared_ptr<const QueryProjection> projection;
   size_t skip = 0;
   size_t limit = 0;
+  FetchPolicy fetchPolicy = FetchDefault;
+  size_t fetchSize = 100;
   std::chrono::milliseconds timeout;
   DbTransaction *transaction = nullptr;
 };
@@ -559,10 +688,14 @@ private:
   DbTransaction();
   ~DbTransaction();
   DatabaseInterface getDbIfc(DatabaseInterface &dbi);
+  void prepare();
   void finish(bool good);
   void doAuditSave(const ObjectBase &obj, const DatabaseInterface &dbi);
   void doAuditDestroy(const ObjectBase &obj, const DatabaseInterface &dbi);
   void writeAuditTrail();
+  void spoolAuditTrail();
+  void submitAuditTrail();
+  void cancelAuditTrail();
 
   std::unique_ptr<DbTransactionData> data;
 
@@ -22,6 +22,7 @@
 #include "objtypes.h"
 #include "digest.h"
 #include "logging.h"
+#include "condwait.h"
 
 #include <openssl/ssl.h>
 #include <openssl/rand.h>
@@ -29,6 +30,11 @@
 #include <array>
 #include <vector>
 #include <iomanip>
+#include <condition_variable>
+#include <istream>
+#include <list>
+#include <mutex>
+#include <thread>
 //#include <openssl/err.h>
 
 
@@ -52,6 +58,211 @@ public:
   }
 };
 
+std::string hexStr(const u_char *p, size_t n) {
+  static const char hex[] = "0123456789abcdef";
+  std::string r(n * 2, ' ');
+  for (size_t i = 0; i < n; i++) {
+    r[2 * i] = hex[p[i] >> 4];
+    r[2 * i + 1] = hex[p[i] & 0x0f];
+  }
+  return r;
+}
+
+const EVP_MD *getDigest(const std::string &algo) {
+  auto md = EVP_get_digestbyname(algo.c_str());
+  if (not md)
+    throw std::runtime_error(LOGSTR("mobs::CryptBufDigest '" << algo << "' doesn't exist"));
+  return md;
+}
+
+size_t numThreads(size_t threads) {
+  if (threads)
+    return threads;
+  size_t n = std::thread::hardware_concurrency();
+  return n ? n : 1;
+}
+
+}
+
+class mobs::TreeDigestData {
+public:
+  TreeDigestData(const std::string &a, size_t cs, size_t t) : algo(a), chunkSize(cs ? cs : 1), threads(numThreads(t)),
+                                                             md(getDigest(a)) {}
+  ~TreeDigestData() {
+    try {
+      stopPool();
+    } catch (...) {}
+  }
+
+
+  std::string descriptor() const { return "tree:" + algo + ":" + std::to_string(chunkSize); }
+
+  void leaf(EVP_MD_CTX *ctx, const u_char *p, size_t n, std::vector<u_char> &out) const {
+    const u_char prefix = 0;
+    u_int len;
+    out.resize(EVP_MAX_MD_SIZE);
+    if (not EVP_DigestInit_ex(ctx, md, nullptr) or not EVP_DigestUpdate(ctx, &prefix, 1) or
+        not EVP_DigestUpdate(ctx, p, n) or not EVP_DigestFinal_ex(ctx, &out[0], &len))
+      throw openssl_exception(LOGSTR("mobs::TreeDigest"));
+    out.resize(len);
+  }
+
+  void run() {
+    std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX *)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      waitFor(cond, lock, [this]() { return closing or not queue.empty(); });
+      if (queue.empty() or error)
+        break;
+      auto item = std::move(queue.front());
+      queue.pop_front();
+      cond.notify_all(); // Platz in der Warteschlange
+      lock.unlock();
+      std::vector<u_char> result;
+      std::exception_ptr ex;
+      try {
+        leaf(ctx.get(), item.second.data(), item.second.size(), result);
+      } catch (...) {
+        ex = std::current_exception();
+      }
+      lock.lock();
+      if (ex and not error)
+        error = ex;
+      leaves[item.first] = std::move(result);
+      cond.notify_all();
+    }
+  }
+
+  // Block im aufrufenden Thread verarbeiten
+  void putInline(const std::vector<u_char> &chunk) {
+    if (not ctx)
+      ctx = std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX *)>(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    leaves.emplace_back();
+    leaf(ctx.get(), chunk.data(), chunk.size(), leaves.back());
+  }
+
+  // vollständigen Block übergeben
+  void put(std::vector<u_char> &&chunk) {
+    size_t n = leaves.size();
+    if (threads <= 1)
+      return putInline(chunk);
+    std::unique_lock<std::mutex> lock(mutex);
+    if (pool.empty())
+      for (size_t i = 0; i < threads; i++)
+        pool.emplace_back(&TreeDigestData::run, this);
+    waitFor(cond, lock, [this]() { return error or queue.size() < 2 * threads; });
+    if (error)
+      std::rethrow_exception(error);
+    leaves.emplace_back();
+    queue.emplace_back(n, std::move(chunk));
+    cond.notify_all();
+  }
+
+  void stopPool() {
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      closing = true;
+    }
+    cond.notify_all();
+    for (auto &t:pool)
+      t.join();
+    pool.clear();
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  void finish() {
+    if (finished)
+      return;
+    finished = true;
+    if (pool.empty()) {
+      if (not pending.empty() or leaves.empty())
+        putInline(pending);
+    } else if (not pending.empty())
+      put(std::move(pending));
+    stopPool();
+    const u_char prefix = 1;
+    std::string desc = descriptor();
+    std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX *)> root(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    if (not EVP_DigestInit_ex(root.get(), md, nullptr) or not EVP_DigestUpdate(root.get(), &prefix, 1) or
+        not EVP_DigestUpdate(root.get(), desc.c_str(), desc.length()))
+      throw openssl_exception(LOGSTR("mobs::TreeDigest"));
+    for (auto &l:leaves)
+      if (not EVP_DigestUpdate(root.get(), l.data(), l.size()))
+        throw openssl_exception(LOGSTR("mobs::TreeDigest"));
+    u_int len;
+    md_value.resize(EVP_MAX_MD_SIZE);
+    if (not EVP_DigestFinal_ex(root.get(), &md_value[0], &len))
+      throw openssl_exception(LOGSTR("mobs::TreeDigest"));
+    md_value.resize(len);
+  }
+
+  std::string algo;
+  size_t chunkSize;
+  size_t threads;
+  const EVP_MD *md;
+  std::vector<u_char> pending; // angefangener Block
+  std::vector<std::vector<u_char>> leaves; // Hash-Werte der Blöcke
+  std::vector<u_char> md_value{};
+  bool finished = false;
+  std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX *)> ctx{nullptr, EVP_MD_CTX_free}; // ohne Thread-Pool
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::list<std::pair<size_t, std::vector<u_char>>> queue;
+  std::vector<std::thread> pool;
+  std::exception_ptr error;
+  bool closing = false;
+};
+
+mobs::TreeDigest::TreeDigest(const std::string &algo, size_t chunkSize, size_t threads) {
+  data = std::unique_ptr<TreeDigestData>(new TreeDigestData(algo, chunkSize, threads));
+}
+
+mobs::TreeDigest::~TreeDigest() = default;
+
+void mobs::TreeDigest::update(const void *buf, size_t len) {
+  if (data->finished)
+    THROW("TreeDigest already finished");
+  auto p = static_cast<const u_char *>(buf);
+  while (len) {
+    if (data->pending.empty())
+      data->pending.reserve(data->chunkSize);
+    size_t sz = std::min(len, data->chunkSize - data->pending.size());
+    data->pending.insert(data->pending.end(), p, p + sz);
+    p += sz;
+    len -= sz;
+    if (data->pending.size() == data->chunkSize) {
+      data->put(std::move(data->pending));
+      data->pending = std::vector<u_char>();
+    }
+  }
+}
+
+void mobs::TreeDigest::update(std::istream &source) {
+  std::vector<char> buf(std::min(data->chunkSize, size_t(1024 * 1024)));
+  while (source.read(&buf[0], std::streamsize(buf.size())) or source.gcount() > 0)
+    update(&buf[0], size_t(source.gcount()));
+  if (source.bad())
+    THROW("read error");
+}
+
+const std::vector<u_char> &mobs::TreeDigest::hash() {
+  data->finish();
+  return data->md_value;
+}
+
+std::string mobs::TreeDigest::hashStr() {
+  hash();
+  return hexStr(data->md_value.data(), data->md_value.size());
+}
+
+std::string mobs::TreeDigest::descriptor() const {
+  return data->descriptor();
+}
+
+size_t mobs::TreeDigest::chunks() const {
+  return data->leaves.size();
 }
 
 class mobs::CryptBufDigestData { // NOLINT(cppcoreguidelines-pro-type-member-init)
@@ -63,7 +274,9 @@ public:
   }
 
   void md_init() {
-    if (not md_algo.empty()) {
+    if (treeChunk and not md_algo.empty())
+      tree = std::unique_ptr<mobs::TreeDigest>(new mobs::TreeDigest(md_algo, treeChunk, treeThreads));
+    else if (not md_algo.empty()) {
       md = EVP_get_digestbyname(md_algo.c_str());
       if (not md)
         THROW("hash algorithm '" << md_algo << "' not available");
@@ -73,27 +286,52 @@ public:
     }
   }
 
+  bool started() const { return mdctx or tree; }
+
+  void update(const void *p, size_t sz) {
+    if (tree)
+      tree->update(p, sz);
+    else if (mdctx)
+      EVP_DigestUpdate(mdctx, p, sz);
+  }
+
+  void final() {
+    if (tree)
+      md_value = tree->hash();
+    else if (mdctx) {
+      md_value.resize(EVP_MAX_MD_SIZE);
+      u_int md_len;
+      EVP_DigestFinal_ex(mdctx, &md_value[0], &md_len);
+      md_value.resize(md_len);
+    }
+  }
+
   std::array<mobs::CryptBufDigest::char_type, INPUT_BUFFER_LEN> buffer;
   std::vector<u_char> md_value{}; // hash-wert
   EVP_MD_CTX *mdctx = nullptr; // hash context
   const EVP_MD *md = nullptr; // hash algo
   std::string md_algo;
+  size_t treeChunk = 0;
+  size_t treeThreads = 0;
+  std::unique_ptr<mobs::TreeDigest> tree; // Baum-Hash statt mdctx
   bool finished = false;
 };
 
 
 
 std::string mobs::CryptBufDigest::hashStr() const {
-  std::stringstream x;
-  for (auto c:data->md_value)
-    x << std::hex << std::setfill('0') << std::setw(2) << u_int(c);
-  return x.str();
+  return hexStr(data->md_value.data(), data->md_value.size());
 }
 
 void mobs::CryptBufDigest::hashAlgorithm(const std::string &algo) {
   data->md_algo = algo;
 }
 
+void mobs::CryptBufDigest::treeHash(size_t chunkSize, size_t threads) {
+  data->treeChunk = chunkSize;
+  data->treeThreads = threads;
+}
+
 
 mobs::CryptBufDigest::CryptBufDigest(const std::string &algo) : CryptBufBase() {
   TRACE("");
@@ -129,17 +367,13 @@ mobs::CryptBufDigest::int_type mobs::CryptBufDigest::underflow() {
     }
     else
       data->finished = true;
-    if (not data->mdctx)
+    if (not data->started())
       data->md_init();
     if (sz)
-      EVP_DigestUpdate(data->mdctx, &data->buffer[0], sz);
+      data->update(&data->buffer[0], sz);
     Base::setg(&data->buffer[0], &data->buffer[0], &data->buffer[sz]);
-    if (data->finished) {
-      data->md_value.resize(EVP_MAX_MD_SIZE);
-      u_int md_len;
-      EVP_DigestFinal_ex(data->mdctx, &data->md_value[0], &md_len);
-      data->md_value.resize(md_len);
-    }
+    if (data->finished)
+      data->final();
 //    std::cout << "GC2 = " << len << " ";
     if (sz)
       return Traits::to_int_type(*Base::gptr());
@@ -157,12 +391,11 @@ mobs::CryptBufDigest::int_type mobs::CryptBufDigest::overflow(mobs::CryptBufDige
   TRACE("");
   if (isGood())
     try {
-      if (not data->mdctx)
+      if (not data->started())
         data->md_init();
 
       if (Base::pbase() != Base::pptr()) {
-        if (data->mdctx)
-          EVP_DigestUpdate(data->mdctx, (u_char *) Base::pbase(), std::distance(Base::pbase(), Base::pptr()));
+        data->update(Base::pbase(), size_t(std::distance(Base::pbase(), Base::pptr())));
         doWrite(Base::pbase(), std::distance(Base::pbase(), Base::pptr()));
 
         CryptBufBase::setp(data->buffer.begin(), data->buffer.end()); // buffer zurücksetzen
@@ -184,11 +417,11 @@ void mobs::CryptBufDigest::finalize() {
   //LOG(LM_DEBUG, "CryptBufDigest::finalize");
   TRACE("");
   pubsync();
-  if (data->mdctx) {
-    data->md_value.resize(EVP_MAX_MD_SIZE);
-    u_int md_len;
-    EVP_DigestFinal_ex(data->mdctx, &data->md_value[0], &md_len);
-    data->md_value.resize(md_len);
+  try {
+    data->final();
+  } catch (std::exception &e) {
+    LOG(LM_ERROR, "Exception " << e.what());
+    setBad();
   }
   CryptBufBase::finalize();
 }
@@ -221,6 +454,16 @@ public:
     setp(buffer.begin(), buffer.end());
   }
 
+  Digest(const std::string &algo, size_t chunkSize, size_t threads) : algorithm(algo), treeMode(true) {
+    TRACE("");
+    try {
+      tree = std::unique_ptr<mobs::TreeDigest>(new mobs::TreeDigest(algo, chunkSize, threads));
+    } catch (std::exception &e) {
+      LOG(LM_ERROR, "mobs::CryptBufDigest " << e.what());
+    }
+    setp(buffer.begin(), buffer.end());
+  }
+
   ~Digest() override  {
     TRACE("");
     if (mdctx)
@@ -230,12 +473,16 @@ public:
   int sync() override {
     TRACE("");
     overflow(Traits::eof());
-    return mdctx ? 0: -1;
+    return mdctx or tree ? 0: -1;
   }
 
   const std::vector<u_char> &hash() {
     TRACE("");
-    if (mdctx) {
+    if (tree) {
+      pubsync();
+      md_value = tree->hash();
+      tree = nullptr;
+    } else if (mdctx) {
       pubsync();
       md_value.resize(EVP_MAX_MD_SIZE);
       u_int md_len;
@@ -250,18 +497,18 @@ public:
   std::string hashStr() {
     TRACE("");
     hash();
-    std::stringstream x;
-    for (auto c:md_value)
-      x << std::hex << std::setfill('0') << std::setw(2) << u_int(c);
-    return x.str();
+    return hexStr(md_value.data(), md_value.size());
   }
 
   int_type overflow(int_type ch) override {
     TRACE("");
-    if (not mdctx)
+    if (not mdctx and not tree)
       return Traits::eof();
     if (Base::pbase() != Base::pptr()) {
-      EVP_DigestUpdate(mdctx, (u_char *)Base::pbase(), std::distance(Base::pbase(), Base::pptr()));
+      if (tree)
+        tree->update(Base::pbase(), size_t(std::distance(Base::pbase(), Base::pptr())));
+      else
+        EVP_DigestUpdate(mdctx, (u_char *)Base::pbase(), std::distance(Base::pbase(), Base::pptr()));
 
       setp(buffer.begin(), buffer.end()); // buffer zurücksetzen
     }
@@ -273,11 +520,14 @@ public:
     return Traits::eof();
   }
 
-  bool good() const { return mdctx or not md_value.empty(); }
+  bool good() const { return mdctx or tree or not md_value.empty(); }
+  bool isTree() const { return treeMode; }
 
   const std::string algorithm;
 
 private:
+  const bool treeMode = false; // bleibt auch nach hash() erhalten
+  std::unique_ptr<mobs::TreeDigest> tree;
   std::array<mobs::CryptBufDigest::char_type, 2048> buffer;
   std::vector<u_char> md_value{}; // hash-wert
   EVP_MD_CTX *mdctx = nullptr; // hash context
@@ -293,6 +543,14 @@ mobs::digestStream::digestStream(const std::string &algo) : std::ostream(new Dig
     clear(std::ios::badbit);
 }
 
+mobs::digestStream::digestStream(const std::string &algo, size_t chunkSize, size_t threads) :
+        std::ostream(new Digest(algo, chunkSize, threads)) {
+  TRACE("");
+  auto *tp = dynamic_cast<Digest *>(rdbuf());
+  if (not tp or not tp->good())
+    clear(std::ios::badbit);
+}
+
 mobs::digestStream::~digestStream() {
   delete rdbuf();
 }
@@ -320,6 +578,8 @@ std::string mobs::digestStream::uuid() {
   clear(tp->good() ? std::ios::eofbit : std::ios::badbit);
   if (not tp->good())
     THROW("can't create hash");
+  if (tp->isTree())
+    THROW("uuid: tree hash not allowed");
   auto it = tp->hash().begin();
   std::stringstream ss;
   int i;
@@ -353,44 +613,87 @@ std::string mobs::digestStream::uuid() {
 
 
 std::string mobs::hash_value(const std::string &s, const std::string &algo) {
-  mobs::digestStream ds(algo);
-  ds.exceptions(std::ostream::failbit | std::ostream::badbit);
-  ds << s;
-  return ds.hashStr();
+  u_char md_value[EVP_MAX_MD_SIZE];
+  u_int md_len;
+  if (not EVP_Digest(s.data(), s.size(), md_value, &md_len, getDigest(algo), nullptr))
+    throw openssl_exception(LOGSTR("mobs::CryptBufDigest"));
+  return hexStr(md_value, md_len);
 }
 
 std::string mobs::hash_value(const std::vector<u_char> &s, const std::string &algo) {
-  auto md = EVP_get_digestbyname(algo.c_str());
-  if (not md)
-    throw std::runtime_error(LOGSTR("mobs::CryptBufDigest '" << algo << "' doesn't exist"));
-  auto mdctx = EVP_MD_CTX_new();
-  if (not EVP_DigestInit_ex(mdctx, md, nullptr))
-    throw openssl_exception(LOGSTR("mobs::CryptBufDigest"));
-  EVP_DigestUpdate(mdctx, &s[0], s.size());
-
-  std::vector<u_char> md_value;
-  md_value.resize(EVP_MAX_MD_SIZE);
+  u_char md_value[EVP_MAX_MD_SIZE];
   u_int md_len;
-  EVP_DigestFinal_ex(mdctx, &md_value[0], &md_len);
-  md_value.resize(md_len);
-  std::stringstream x;
-  for (auto c:md_value)
-    x << std::hex << std::setfill('0') << std::setw(2) << u_int(c);
-  return x.str();
+  if (not EVP_Digest(s.data(), s.size(), md_value, &md_len, getDigest(algo), nullptr))
+    throw openssl_exception(LOGSTR("mobs::CryptBufDigest"));
+  return hexStr(md_value, md_len);
 }
 
 void mobs::hash_value(const std::vector<u_char> &s, std::vector<u_char> &hash, const std::string &algo) {
-  auto md = EVP_get_digestbyname(algo.c_str());
-  if (not md)
-    throw std::runtime_error(LOGSTR("mobs::CryptBufDigest '" << algo << "' doesn't exist"));
-  auto mdctx = EVP_MD_CTX_new();
-  if (not EVP_DigestInit_ex(mdctx, md, nullptr))
-    throw openssl_exception(LOGSTR("mobs::CryptBufDigest"));
-  EVP_DigestUpdate(mdctx, &s[0], s.size());
-
   hash.resize(EVP_MAX_MD_SIZE);
   u_int md_len;
-  EVP_DigestFinal_ex(mdctx, &hash[0], &md_len);
+  if (not EVP_Digest(s.data(), s.size(), &hash[0], &md_len, getDigest(algo), nullptr))
+    throw openssl_exception(LOGSTR("mobs::CryptBufDigest"));
   hash.resize(md_len);
 }
 
+namespace {
+
+// Hash-Werte vieler Eingaben, je Thread ein wiederverwendeter Kontext
+template<typename T>
+std::vector<std::string> hashValues(const std::vector<T> &s, const std::string &algo, size_t threads) {
+  const EVP_MD *md = getDigest(algo);
+  std::vector<std::string> result(s.size());
+  auto work = [&s, &result, md](size_t first, size_t last) {
+    std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX *)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    u_char md_value[EVP_MAX_MD_SIZE];
+    u_int md_len;
+    for (size_t i = first; i < last; i++) {
+      if (not EVP_DigestInit_ex(ctx.get(), md, nullptr) or not EVP_DigestUpdate(ctx.get(), s[i].data(), s[i].size())
+          or not EVP_DigestFinal_ex(ctx.get(), md_value, &md_len))
+        throw openssl_exception(LOGSTR("mobs::hash_values"));
+      result[i] = hexStr(md_value, md_len);
+    }
+  };
+  // erst ab einigen tausend Einträgen lohnt ein Thread
+  const size_t minPerThread = 4096;
+  threads = std::min(numThreads(threads), (s.size() + minPerThread - 1) / minPerThread);
+  if (threads <= 1) {
+    work(0, s.size());
+    return result;
+  }
+  std::vector<std::thread> pool;
+  std::vector<std::exception_ptr> errors(threads);
+  size_t step = (s.size() + threads - 1) / threads;
+  for (size_t t = 0; t < threads; t++) {
+    pool.emplace_back([&work, &errors, &s, t, step]() {
+      try {
+        work(t * step, std::min(s.size(), (t + 1) * step));
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  for (auto &t:pool)
+    t.join();
+  for (auto &e:errors)
+    if (e)
+      std::rethrow_exception(e);
+  return result;
+}
+
+}
+
+std::vector<std::string> mobs::hash_values(const std::vector<std::string> &s, const std::string &algo, size_t threads) {
+  return hashValues(s, algo, threads);
+}
+
+std::vector<std::string> mobs::hash_values(const std::vector<std::vector<u_char>> &s, const std::string &algo,
+                                           size_t threads) {
+  return hashValues(s, algo, threads);
+}
+
+std::string mobs::tree_hash_value(std::istream &source, const std::string &algo, size_t chunkSize) {
+  TreeDigest td(algo, chunkSize);
+  td.update(source);
+  return td.hashStr();
+}
@@ -64,6 +64,14 @@ public:
    */
   void hashAlgorithm(const std::string &algo);
 
+  /** \brief aktiviert den Baum-Hash, siehe TreeDigest
+   *
+   * Muss vor dem ersten Datenzugriff aufgerufen werden.
+   * @param chunkSize Blockgröße in Bytes
+   * @param threads Anzahl der Threads, 0 für die Anzahl der Prozessorkerne
+   */
+  void treeHash(size_t chunkSize, size_t threads = 0);
+
   /** \brief Ausgabe des ermittelten Hash-Wertes
    *
    * @return Hash-Wert als Byte-Array
@@ -99,6 +107,13 @@ public:
    * @param algo Hash-Methode
    */
   explicit digestStream(const std::string &algo = "sha1");
+  /** \brief Konstruktor für einen Baum-Hash, siehe TreeDigest
+   *
+   * @param algo Hash-Methode
+   * @param chunkSize Blockgröße in Bytes
+   * @param threads Anzahl der Threads, 0 für die Anzahl der Prozessorkerne
+   */
+  digestStream(const std::string &algo, size_t chunkSize, size_t threads = 0);
   ~digestStream() override;
 
   /** \brief Ausgabe des ermittelten Hash-Wertes
@@ -123,6 +138,82 @@ public:
   std::string uuid();
 };
 
+class TreeDigestData;
+
+/** \brief Baum-Hash für große Datenmengen
+ *
+ * Die Daten werden in Blöcke der Größe chunkSize zerlegt, deren Hash-Werte parallel in einem Thread-Pool ermittelt
+ * werden. Der Gesamt-Hash wird über die Kennung (Algorithmus und Blockgröße) und die Block-Hashes gebildet:
+ * \code
+ * leaf = H(0x00 || Block)
+ * root = H(0x01 || "tree:<algo>:<chunkSize>" || leaf_0 || leaf_1 ...)
+ * \endcode
+ * Der Wert ist somit nur zusammen mit descriptor() vergleichbar. Solange die Daten kleiner als ein Block sind,
+ * wird kein Thread gestartet.
+ */
+class TreeDigest {
+public:
+  /** \brief Konstruktor
+   *
+   * @param algo Hash-Methode, siehe openssl list-message-digest-commands
+   * @param chunkSize Blockgröße in Bytes
+   * @param threads Anzahl der Threads, 0 für die Anzahl der Prozessorkerne
+   * \throws runtime_error wenn der Algorithmus nicht existiert
+   */
+  explicit TreeDigest(const std::string &algo = "sha256", size_t chunkSize = 1024 * 1024, size_t threads = 0);
+  ~TreeDigest();
+
+  TreeDigest(const TreeDigest &) = delete;
+  TreeDigest &operator=(const TreeDigest &) = delete;
+
+  /// Daten hinzufügen
+  void update(const void *data, size_t len);
+  /// Daten aus einem Stream bis EOF hinzufügen
+  void update(std::istream &source);
+
+  /** \brief Ausgabe des ermittelten Hash-Wertes; schließt die Berechnung ab
+   *
+   * \throws runtime_error im Fehlerfall
+   */
+  const std::vector<u_char> &hash();
+  /// Ausgabe des ermittelten Hash-Wertes als String
+  std::string hashStr();
+
+  /// Kennung des Verfahrens "tree:<algo>:<chunkSize>"
+  std::string descriptor() const;
+  /// Anzahl der bisher vollständigen Blöcke
+  size_t chunks() const;
+
+private:
+  std::unique_ptr<TreeDigestData> data;
+};
+
+/** \brief Baum-Hash eines Streams ermitteln, siehe TreeDigest
+ *
+ * @param source Eingabe, wird bis EOF gelesen
+ * @param algo Algorithmus
+ * @param chunkSize Blockgröße in Bytes
+ * @return hashwert
+ * \throws runtime_error im Fehlerfall
+ */
+std::string tree_hash_value(std::istream &source, const std::string &algo = "sha256", size_t chunkSize = 1024 * 1024);
+
+/** \brief Hash-Werte vieler kleiner Strings ermitteln
+ *
+ * Der Hash-Kontext wird wiederverwendet; bei vielen Einträgen wird auf mehrere Threads verteilt.
+ * @param s Eingaben
+ * @param algo Algorithmus
+ * @param threads Anzahl der Threads, 0 für die Anzahl der Prozessorkerne
+ * @return hashwerte in der Reihenfolge der Eingabe
+ * \throws runtime_error im Fehlerfall
+ */
+std::vector<std::string> hash_values(const std::vector<std::string> &s, const std::string &algo = "sha1",
+                                     size_t threads = 0);
+
+/// Hash-Werte vieler Char-Buffer ermitteln, siehe hash_values(const std::vector<std::string> &, const std::string &, size_t)
+std::vector<std::string> hash_values(const std::vector<std::vector<u_char>> &s, const std::string &algo = "sha1",
+                                     size_t threads = 0);
+
 /** \brief hash wert eines Strings ermitteln
  *
  * @param s String
@@ -22,9 +22,15 @@
 #include "audittrail.h"
 #include "queryorder.h"
 #include "querygenerator.h"
+#include "queryprojection.h"
 #include "converter.h"
 #include "xmlwriter.h"
 //#include <strstream>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <typeindex>
 
 using namespace mobs;
 using namespace std;
@@ -45,8 +51,9 @@ string vecTableName(const mobs::MemBaseVector *v, const string &name) {
 class GenerateSqlJoin : virtual public ObjTravConst {
 public:
 
-  explicit GenerateSqlJoin(const ConvObjToString& c, SQLDBdescription &sqlDbDescription) :
-          cth(c.exportDbPrefix().exportAltNames()), sqldb(sqlDbDescription)  {}
+  explicit GenerateSqlJoin(const ConvObjToString& c, SQLDBdescription &sqlDbDescription,
+                           const QueryProjection *projection = nullptr) :
+          cth(c.exportDbPrefix().exportAltNames()), scope(projection), sqldb(sqlDbDescription)  {}
 
 
 
@@ -109,12 +116,14 @@ public:
         return false;
       }
     }
+    scope.enter(obj);
     level++;
     return true;
   };
   /// \private
   void doObjEnd(const ObjectBase &obj) final
   {
+    scope.leave();
     level--;
   };
   /// \private
@@ -159,12 +168,14 @@ public:
     useName.push_back(sqldb.tableName(name));
     keys.push_back(vec.getName(cth));
     arrayLevelJoin.push(false);
+    scope.enter(vec);
     level++;
     return true;
   };
   /// \private
   void doArrayEnd(const MemBaseVector &vec) final
   {
+    scope.leave();
     level--;
     keys.pop_back();
     if (not arrayLevelJoin.empty()) {
@@ -220,7 +231,7 @@ public:
       if (not arrayLevelJoin.empty())
         arrayLevelJoin.top() = true;
     }
-    if (arrayLevelJoin.empty()) {
+    if (arrayLevelJoin.empty() and scope.selected(mem)) {
       if (not selectField.empty())
         selectField += ",";
       selectField += "mt.";
@@ -320,6 +331,7 @@ public:
 
 private:
   ConvObjToString cth;
+  ProjectionScope scope;
   int level = 0;
   vector<string> tableName;
   vector<string> useName;
@@ -331,19 +343,21 @@ private:
 
 class ExtractSql : virtual public ObjTrav {
 public:
-  explicit ExtractSql(SQLDBdescription &s, const ConvObjToString& c) : current(nullptr, "", {}),
-                                                                       cth(std::move(c.exportDbPrefix().exportAltNames())),
-                                                                       sqldb(s) { }
+  explicit ExtractSql(SQLDBdescription &s, const ConvObjToString& c, const QueryProjection *projection = nullptr) :
+          current(nullptr, "", {}), cth(std::move(c.exportDbPrefix().exportAltNames())), scope(projection), sqldb(s) { }
 
   bool doObjBeg(ObjectBase &obj) final
   {
     if (level == 0) {
+      scope.enter(obj);
       level++;
       return true;
     }
     if (obj.hasFeature(mobs::DbDetail))
       return false;
     if (obj.hasFeature(mobs::DbJson)) {
+      if (not scope.selected(obj))
+        return false;
       bool null;
       std::string tx;
       sqldb.readValueText(obj.getName(cth), tx, null);
@@ -353,12 +367,14 @@ public:
         string2Obj(tx, obj, ConvObjFromStr().useExceptUnknown());
       return false;
     }
-      level++;
+    scope.enter(obj);
+    level++;
     return true;
   };
 
   void doObjEnd(ObjectBase &obj) final
   {
+    scope.leave();
     level--;
   };
 
@@ -366,11 +382,14 @@ public:
   {
     if (level == 0) {
 //      LOG(LM_DEBUG, "START VEC " << vec.getName(cth));
+      scope.enter(vec);
       level++;
       return true;
     }
     if (vec.hasFeature(mobs::DbDetail))
       return false;
+    if (not scope.selected(vec)) // Detail-Tabelle nicht angefordert
+      return false;
     if (vec.hasFeature(mobs::DbJson)) {
       bool null;
       std::string tx;
@@ -403,11 +422,14 @@ public:
 
   void doArrayEnd(MemBaseVector &vec) final
   {
+    scope.leave();
     level--;
   };
 
   void doMem(MemberBase &mem) final
   {
+    if (not scope.selected(mem))
+      return;
     bool compact = cth.hasFeatureCompact();
     if (mem.is_chartype(cth) and mem.hasFeature(mobs::DbCompact))
       compact = true;
@@ -422,6 +444,7 @@ public:
   SqlGenerator::DetailInfo current;
 private:
   ConvObjToString cth;
+  ProjectionScope scope;
   SQLDBdescription &sqldb;
   int level = 0;
 };
@@ -779,6 +802,53 @@ private:
 };
 
 
+/// Cache für typabhängige, aber wertunabhängige Teile der SQL-Statements
+class StatementCache {
+public:
+  /// Objekt-Typ, Typ der DB-Beschreibung und Text-Schlüssel (Statement-Art, Einstellungen, Tabelle)
+  using Key = std::tuple<std::type_index, std::type_index, std::string>;
+
+  static StatementCache &instance() {
+    static StatementCache cache;
+    return cache;
+  }
+
+  bool get(const Key &key, std::vector<std::string> &val) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end())
+      return false;
+    val = it->second;
+    return true;
+  }
+
+  void put(const Key &key, std::vector<std::string> val) {
+    std::lock_guard<std::mutex> guard(mutex);
+    // Begrenzung bei dynamisch erzeugten Tabellennamen
+    if (entries.size() >= maxEntries)
+      entries.clear();
+    entries[key] = std::move(val);
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> guard(mutex);
+    entries.clear();
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return entries.size();
+  }
+
+  std::atomic<bool> enabled{true};
+
+private:
+  static const size_t maxEntries = 4096;
+  std::mutex mutex;
+  std::map<Key, std::vector<std::string>> entries;
+};
+
+
 }
 
 namespace mobs {
@@ -801,6 +871,73 @@ string SqlGenerator::tableName() const {
     return obj.getObjectName();
 }
 
+bool SqlGenerator::cacheKey(const std::string &kind, std::string &key) const {
+  if (not StatementCache::instance().enabled or obj.getObjectName().empty())
+    return false;
+  key = kind;
+  key += ':';
+  key += sqldb.changeTo_is_IfNull ? '1' : '0';
+  key += sqldb.createWith_IfNotExists ? '1' : '0';
+  key += sqldb.dropWith_IfExists ? '1' : '0';
+  key += sqldb.replaceWithInto ? '1' : '0';
+  key += sqldb.withInsertOnConflict ? '1' : '0';
+  key += sqldb.orderInSelect ? '1' : '0';
+  key += ':';
+  key += obj.getObjectName();
+  key += ':';
+  key += sqldb.tableName(tableName());
+  return true;
+}
+
+bool SqlGenerator::cacheGet(const std::string &key, std::vector<std::string> &val) const {
+  return StatementCache::instance().get(StatementCache::Key(typeid(obj), typeid(sqldb), key), val);
+}
+
+void SqlGenerator::cachePut(const std::string &key, std::vector<std::string> val) const {
+  StatementCache::instance().put(StatementCache::Key(typeid(obj), typeid(sqldb), key), std::move(val));
+}
+
+void SqlGenerator::statementCache(bool on) {
+  StatementCache::instance().enabled = on;
+}
+
+void SqlGenerator::clearStatementCache() {
+  StatementCache::instance().clear();
+}
+
+size_t SqlGenerator::statementCacheSize() {
+  return StatementCache::instance().size();
+}
+
+string SqlGenerator::cachedSequence(const std::string &kind, std::string (SqlGenerator::*gen)(DetailInfo &)) {
+  detailVec.clear();
+  pending.clear();
+  string key;
+  bool useCache = cacheKey(kind, key);
+  vector<string> seq;
+  if (not useCache or not cacheGet(key, seq)) {
+    // komplette Sequenz inkl. Detail-Tabellen erzeugen, diese ist nur vom Typ abhängig
+    DetailInfo di(nullptr, tableName(), {});
+    seq.emplace_back((this->*gen)(di));
+    while (not detailVec.empty()) {
+      seq.emplace_back((this->*gen)(detailVec.front()));
+      detailVec.erase(detailVec.begin());
+    }
+    if (useCache)
+      cachePut(key, seq);
+  }
+  pending.assign(seq.begin() + 1, seq.end());
+  return seq.front();
+}
+
+string SqlGenerator::nextPending() {
+  if (pending.empty())
+    return "";
+  string s = std::move(pending.front());
+  pending.pop_front();
+  return s;
+}
+
 string SqlGenerator::doDelete(SqlGenerator::DetailInfo &di) {
   GenerateSql gs(GenerateSql::Where, sqldb, mobs::ConvObjToString());
   gs.current = di;
@@ -969,31 +1106,51 @@ string SqlGenerator::doInsert(SqlGenerator::DetailInfo &di, bool replace) {
 
   GenerateSql gs(GenerateSql::Fields, sqldb, mobs::ConvObjToString());
   gs.current = di;
-  if (replace) {
-    gs.addText("replace ");
-    if (sqldb.replaceWithInto)
-      gs.addText("into ");
-  } else {
+  if (not replace)
     gs.withCleaner = false;
-
-    gs.addText("insert into ");
+  // Der Teil bis "VALUES (" hängt nur vom Typ ab; bei leerem Vektor fehlen die Felder, daher nicht cachen
+  string key;
+  vector<string> head;
+  bool useCache = (not di.vec or di.vec->size() > 0) and cacheKey(replace ? "replace" : "insert", key);
+  if (useCache) {
+    if (di.vec) {
+      key += ':';
+      key += vecTableName(di.vec, di.tableName);
+      for (auto &k:di.arrayKeys) {
+        key += ',';
+        key += k.first;
+      }
+    }
+    useCache = not cacheGet(key, head);
   }
-  if (di.vec) {
-    gs.addText(sqldb.tableName(vecTableName(di.vec, di.tableName)));
+  if (not head.empty())
+    gs.addText(head.front());
+  else {
+    if (replace) {
+      gs.addText("replace ");
+      if (sqldb.replaceWithInto)
+        gs.addText("into ");
+    } else
+      gs.addText("insert into ");
+    if (di.vec) {
+      gs.addText(sqldb.tableName(vecTableName(di.vec, di.tableName)));
 //    vecSz = di.vec->size();
 
-  }
-  else
-    gs.addText(sqldb.tableName(di.tableName));
+    }
+    else
+      gs.addText(sqldb.tableName(di.tableName));
 
-  gs.addText("(");
-  if (di.vec) {
-    obj.traverseKey(gs);
-    di.vec->traverse(gs);
+    gs.addText("(");
+    if (di.vec) {
+      obj.traverseKey(gs);
+      di.vec->traverse(gs);
+    }
+    else
+      obj.traverse(gs);
+    gs.addText(") VALUES (");
+    if (useCache)
+      cachePut(key, {gs.result()});
   }
-  else
-    obj.traverse(gs);
-  gs.addText(") VALUES (");
 
   gs.setMode(GenerateSql::Values);
   if (di.vec) {
@@ -1020,6 +1177,7 @@ string SqlGenerator::insertStatement(bool first) {
   string s;
   if (first) {
     detailVec.clear();
+    pending.clear();
     DetailInfo di(nullptr, tableName(), {});
     s = doInsert(di, false);
   } else if (eof())
@@ -1036,6 +1194,7 @@ string SqlGenerator::replaceStatement(bool first) {
   string upd;
   if (first) {
     detailVec.clear();
+    pending.clear();
     DetailInfo di(nullptr, tableName(), {});
     if (sqldb.withInsertOnConflict)
       s = doInsertUpd(di, upd);
@@ -1057,6 +1216,7 @@ string SqlGenerator::updateStatement(bool first) {
   string s;
   if (first) {
     detailVec.clear();
+    pending.clear();
     DetailInfo di(nullptr, tableName(), {});
     s = doUpdate(di);
   } else if (eof())
@@ -1073,6 +1233,7 @@ string SqlGenerator::deleteStatement(bool first) {
   string s;
   if (first) {
     detailVec.clear();
+    pending.clear();
     DetailInfo di(nullptr, tableName(), {}, false);
     s = doDelete(di);
   } else if (eof())
@@ -1113,11 +1274,11 @@ string SqlGenerator::doDrop(SqlGenerator::DetailInfo &di) {
 
 string SqlGenerator::dropStatement(bool first) {
   string s;
-  if (first) {
-    detailVec.clear();
-    DetailInfo di(nullptr, tableName(), {});
-    s = doDrop(di);
-  } else if (eof())
+  if (first)
+    return cachedSequence("drop", &SqlGenerator::doDrop);
+  else if (not pending.empty())
+    return nextPending();
+  else if (eof())
     return "";
   else {
     s = doDrop(detailVec.front());
@@ -1166,11 +1327,11 @@ string SqlGenerator::doCreate(SqlGenerator::DetailInfo &di) {
 
 string SqlGenerator::createStatement(bool first) {
   string s;
-  if (first) {
-    detailVec.clear();
-    DetailInfo di(nullptr, tableName(), {});
-    s = doCreate(di);
-  } else if (eof())
+  if (first)
+    return cachedSequence("create", &SqlGenerator::doCreate);
+  else if (not pending.empty())
+    return nextPending();
+  else if (eof())
     return "";
   else {
     s = doCreate(detailVec.front());
@@ -1182,20 +1343,30 @@ string SqlGenerator::createStatement(bool first) {
 string SqlGenerator::selectStatementFirst(bool keys) {
   GenerateSql gs(GenerateSql::Fields, sqldb, mobs::ConvObjToString());
   gs.withCleaner = false;
-  gs.addText("select ");
-  if (keys)
-    obj.traverseKey(gs);
-  else
-    obj.traverse(gs);
-  gs.addText(" from ");
-  gs.addText(sqldb.tableName(tableName()));
-  gs.addText(" where ");
+  string key;
+  vector<string> head;
+  bool useCache = cacheKey(keys ? "selectKeys" : "select", key) and not cacheGet(key, head);
+  if (not head.empty())
+    gs.addText(head.front());
+  else {
+    gs.addText("select ");
+    if (keys)
+      obj.traverseKey(gs);
+    else
+      obj.traverse(gs);
+    gs.addText(" from ");
+    gs.addText(sqldb.tableName(tableName()));
+    gs.addText(" where ");
+    if (useCache)
+      cachePut(key, {gs.result()});
+  }
   gs.setMode(GenerateSql::Where);
   gs.withVersionField = false;
   obj.traverseKey(gs);
   gs.detailVec.clear();
   gs.addText(";");
   detailVec.clear();
+  pending.clear();
   return gs.result();
 }
 
@@ -1260,7 +1431,7 @@ void SqlGenerator::readObject(const DetailInfo &di) {
 }
 
 void SqlGenerator::readObject(mobs::ObjectBase &o) {
-  ExtractSql es(sqldb, mobs::ConvObjToString());
+  ExtractSql es(sqldb, mobs::ConvObjToString(), projection);
   DetailInfo di(nullptr, tableName(), {});
   es.current = di;
   sqldb.startReading();
@@ -1319,7 +1490,7 @@ uint64_t SqlGenerator::getVersion() const {
 std::string
 SqlGenerator::query(QueryMode querMode, const QueryOrder *sort, const QueryGenerator *where, const std::string &join,
                     const std::string &atEnd) {
-  GenerateSqlJoin gsjoin((mobs::ConvObjToString()), sqldb);
+  GenerateSqlJoin gsjoin((mobs::ConvObjToString()), sqldb, projection);
   gsjoin.injectEnd = atEnd;
   gsjoin.noJoin = not join.empty();
   gsjoin.sort = sort;
@@ -1338,7 +1509,7 @@ SqlGenerator::query(QueryMode querMode, const QueryOrder *sort, const QueryGener
 
 std::string
 SqlGenerator::queryBE(QueryMode querMode, const QueryOrder *sort, const QueryGenerator *where, const std::string &atEnd) {
-  GenerateSqlJoin gsjoin((mobs::ConvObjToString().exportModified()), sqldb);
+  GenerateSqlJoin gsjoin((mobs::ConvObjToString().exportModified()), sqldb, projection);
   gsjoin.injectEnd = atEnd;
   gsjoin.sort = sort;
   gsjoin.queryGen = where;
@@ -1357,6 +1528,7 @@ std::string SqlGenerator::insertUpdStatement(bool first, string &upd) {
   string s;
   if (first) {
     detailVec.clear();
+    pending.clear();
     DetailInfo di(nullptr, tableName(), {});
     s = doInsertUpd(di, upd);
   } else if (eof())
@@ -34,6 +34,7 @@ namespace mobs {
 
 class QueryOrder;
 class QueryGenerator;
+class QueryProjection;
 
 /// Klasse die Datenbank-Typ abhängige Definitionen enthält
 class SQLDBdescription {
@@ -150,11 +151,27 @@ public:
   uint64_t getVersion() const;
 
   /// es liegen keine Sub-Statements mehr an
-  bool eof() { return detailVec.empty(); }
+  bool eof() { return detailVec.empty() and pending.empty(); }
   /// hatte letztes Query-Statement einenJoin ?
   bool queryWithJoin() const { return querywJoin; }
   /// löscht temporäre Objekte im Destruktor
   void deleteLater(ObjectBase *o) { m_deleteLater.push_back(o); }
+  /// Projektion für query, queryBE und readObject setzen; nullptr für alle Elemente
+  void setProjection(const QueryProjection *p) { projection = p; }
+
+  /** \brief Cache für SQL-Statements ein- oder ausschalten (Default: an)
+   *
+   * Gecacht werden pro Objekt-Typ und DB-Beschreibung nur die wertunabhängigen Teile: die vollständigen Sequenzen
+   * von createStatement und dropStatement inkl. Detail-Tabellen, sowie bei insertStatement, replaceStatement und
+   * selectStatementFirst der Teil mit Tabellen- und Spaltennamen. Statements, die Werte enthalten, werden immer neu erzeugt.
+   *
+   * Alle Einstellungen aus SQLDBdescription sowie der Tabellenname (inkl. DB-Präfix) gehen in den Schlüssel ein.
+   */
+  static void statementCache(bool on);
+  /// leert den Cache für SQL-Statements
+  static void clearStatementCache();
+  /// Anzahl der Einträge im Cache für SQL-Statements
+  static size_t statementCacheSize();
 
 private:
   std::string doCreate(DetailInfo &);
@@ -165,11 +182,18 @@ private:
 
   std::string doInsert(DetailInfo &, bool replace);
   std::string doSelect(DetailInfo &);
+  bool cacheKey(const std::string &kind, std::string &key) const;
+  bool cacheGet(const std::string &key, std::vector<std::string> &val) const;
+  void cachePut(const std::string &key, std::vector<std::string> val) const;
+  std::string cachedSequence(const std::string &kind, std::string (SqlGenerator::*gen)(DetailInfo &));
+  std::string nextPending();
 
   const mobs::ObjectBase &obj;
   SQLDBdescription &sqldb;
   std::list<DetailInfo> detailVec{};
+  std::list<std::string> pending{}; // Statements aus dem Cache
   bool querywJoin = false;
+  const QueryProjection *projection = nullptr;
   std::list<ObjectBase *> m_deleteLater;
 
 };
@@ -23,6 +23,7 @@
 #include "objgen.h"
 #include "mchrono.h"
 #include "helper.h"
+#include "metrics.h"
 #include "infxtools.h"
 
 #include <esql/sqlca.h>
@@ -655,6 +656,15 @@ private:
 
 
 
+// Ausführung einer Anweisung mit Messung für den QueryProfiler
+int execute(const std::shared_ptr<QueryProfiler> &profiler, const string &stmt, struct sqlda *descriptor = nullptr) {
+  QueryTimer qt(profiler, stmt);
+  int e = descriptor ? infx_exec_desc(stmt.c_str(), descriptor) : infx_execute(stmt.c_str());
+  if (qt.active() and not e)
+    qt.rows(uint64_t(infx_processed_rows()));
+  return e;
+}
+
 class CountCursor : public virtual mobs::DbCursor {
   friend class mobs::InformixDatabaseConnection;
 public:
@@ -692,7 +702,11 @@ public:
     string c = "curs";
     c += std::to_string(m_cursNr);
     LOG(LM_DEBUG, "SQL fetch " << c);
+    if (timer)
+      timer->start();
     int e = infx_fetch(c.c_str(), descPtr);
+    if (timer)
+      timer->stop();
     if (e) {
       close();
       if (e == NOMOREROWS)
@@ -702,8 +716,10 @@ public:
     cnt++;
   }
 private:
-  void open(const string &stmt) {
+  void open(const string &stmt, const std::shared_ptr<QueryProfiler> &profiler) {
     const int NOMOREROWS=100;
+    if (profiler)
+      timer = std::unique_ptr<QueryTimer>(new QueryTimer(profiler, stmt));
     string c = "curs";
     c += std::to_string(m_cursNr);
     string p = "prep";
@@ -747,7 +763,13 @@ private:
       throw informix_exception(u8"cursor: open cursor failed", e);
     LOG(LM_DEBUG, "SQL fetch " << c);
     e = infx_fetch(c.c_str(), descPtr);
+    if (timer)
+      timer->stop();
     if (e) {
+      if (timer) {
+        timer->finish();
+        timer = nullptr;
+      }
       close();
       if (e != NOMOREROWS)
         throw informix_exception(u8"cursor: query row failed", e);
@@ -762,6 +784,11 @@ private:
     infx_remove_curs(c.c_str(), p.c_str());
     free(descPtr);
     descPtr = nullptr;
+    if (timer) {
+      timer->rows(cnt + 1);
+      timer->finish();
+      timer = nullptr;
+    }
   }
   std::shared_ptr<DatabaseConnection> dbCon;  // verhindert das Zerstören der Connection
   std::string databaseName;  // unused
@@ -770,6 +797,7 @@ private:
   int m_cursNr = 0;
   int fldCnt = 0;
   struct sqlda *descPtr = nullptr;
+  std::unique_ptr<QueryTimer> timer; // Messung für den QueryProfiler bis zum Ende des Cursors
   char buf[32768];
 };
 
@@ -831,7 +859,7 @@ bool InformixDatabaseConnection::load(DatabaseInterface &dbi, ObjectBase &obj) {
   string s = gsql.selectStatementFirst();
   LOG(LM_DEBUG, "SQL: " << s);
   auto cursor = std::make_shared<InformixCursor>(conNr, dbi.getConnection(), dbi.database(), false);
-  cursor->open(s);
+  cursor->open(s, queryProfiler());
   if (cursor->eof()) {
     LOG(LM_DEBUG, "NOW ROWS FOUND");
     return false;
@@ -856,7 +884,7 @@ void InformixDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &
   if (currentTransaction == nullptr) {
     string s = "BEGIN WORK;";
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_exec_desc(s.c_str(), &descriptor);
+    int e = execute(queryProfiler(), s, &descriptor);
     if (e)
       throw informix_exception(u8"Transaction failed", e);
     // Wenn DBI mit Transaktion, dann in Transaktion bleiben
@@ -866,7 +894,7 @@ void InformixDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &
   else {
     string s = "SAVEPOINT MOBS;";
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_exec_desc(s.c_str(), &descriptor);
+    int e = execute(queryProfiler(), s, &descriptor);
     if (e)
       throw informix_exception(u8"Transaction failed", e);
   }
@@ -887,11 +915,11 @@ void InformixDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &
       if (not upd.empty()) s.swap(upd); // failed update is faster then insert
     }
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_exec_desc(s.c_str(), &descriptor);
+    int e = execute(queryProfiler(), s, &descriptor);
     int rows = infx_processed_rows();
     if (not e and not insertOnly and not updateOnly and rows == 0 and not upd.empty()) {  // try insert
       LOG(LM_DEBUG, "SQL " << upd);
-      e = infx_exec_desc(upd.c_str(), &descriptor);
+      e = execute(queryProfiler(), upd, &descriptor);
       insertOnly = true;
     }
     if (e)
@@ -907,11 +935,11 @@ void InformixDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &
         if (not upd.empty()) s.swap(upd);
       }
       LOG(LM_DEBUG, "SQL " << s);
-      e = infx_exec_desc(s.c_str(), &descriptor);
+      e = execute(queryProfiler(), s, &descriptor);
       int rows = infx_processed_rows();
       if (not insertOnly and not e and rows == 0 and not upd.empty()) {  // try insert
         LOG(LM_DEBUG, "SQL " << upd);
-        e = infx_exec_desc(upd.c_str(), &descriptor);
+        e = execute(queryProfiler(), upd, &descriptor);
       }
       if (e)
         throw informix_exception(u8"save failed", e);
@@ -923,7 +951,7 @@ void InformixDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &
       s += " TO SAVEPOINT MOBS";
     s += ";";
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_execute(s.c_str());
+    int e = execute(queryProfiler(), s);
     if (e)
       throw informix_exception(u8"Transaction failed", e);
     throw exc;
@@ -933,7 +961,7 @@ void InformixDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &
       s += " TO SAVEPOINT MOBS";
     s += ";";
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_execute(s.c_str());
+    int e = execute(queryProfiler(), s);
     if (e)
       throw informix_exception(u8"Transaction failed", e);
     throw exc;
@@ -945,7 +973,7 @@ void InformixDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &
   else
     s = "COMMIT WORK;";
   LOG(LM_DEBUG, "SQL " << s);
-  int e = infx_execute(s.c_str());
+  int e = execute(queryProfiler(), s);
   if (e)
     throw informix_exception(u8"Transaction failed", e);
 }
@@ -965,7 +993,7 @@ bool InformixDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBas
   if (currentTransaction == nullptr) {
     string s = "BEGIN WORK;";
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_execute(s.c_str());
+    int e = execute(queryProfiler(), s);
     if (e)
       throw informix_exception(u8"Transaction failed", e);
     // Wenn DBI mit Transaktion, dann in Transaktion bleiben
@@ -975,7 +1003,7 @@ bool InformixDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBas
   else {
     string s = "SAVEPOINT MOBS;";
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_execute(s.c_str());
+    int e = execute(queryProfiler(), s);
     if (e)
       throw informix_exception(u8"Transaction failed", e);
   }
@@ -987,7 +1015,7 @@ bool InformixDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBas
     for (bool first = true; first or not gsql.eof(); first = false) {
       string s = gsql.deleteStatement(first);
       LOG(LM_DEBUG, "SQL " << s);
-      int e = infx_exec_desc(s.c_str(), &descriptor);
+      int e = execute(queryProfiler(), s, &descriptor);
       if (e)
         throw informix_exception(u8"destroy failed", e);
       if (first) {
@@ -1002,7 +1030,7 @@ bool InformixDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBas
       s += " TO SAVEPOINT MOBS";
     s += ";";
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_execute(s.c_str());
+    int e = execute(queryProfiler(), s);
     if (e)
       throw informix_exception(u8"Transaction failed", e);
     throw exc;
@@ -1012,7 +1040,7 @@ bool InformixDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBas
       s += " TO SAVEPOINT MOBS";
     s += ";";
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_execute(s.c_str());
+    int e = execute(queryProfiler(), s);
     if (e)
       throw informix_exception(u8"Transaction failed", e);
     throw exc;
@@ -1024,7 +1052,7 @@ bool InformixDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBas
   else
     s = "COMMIT WORK;";
   LOG(LM_DEBUG, "SQL " << s);
-  int e = infx_execute(s.c_str());
+  int e = execute(queryProfiler(), s);
   if (e)
     throw informix_exception(u8"Transaction failed", e);
 
@@ -1040,7 +1068,7 @@ void InformixDatabaseConnection::dropAll(DatabaseInterface &dbi, const ObjectBas
   for (bool first = true; first or not gsql.eof(); first = false) {
     string s = gsql.dropStatement(first);
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_execute(s.c_str());
+    int e = execute(queryProfiler(), s);
     if (e and e != EXISTSNOT)
       throw informix_exception(u8"dropAll failed", e);
   }
@@ -1054,7 +1082,7 @@ void InformixDatabaseConnection::structure(DatabaseInterface &dbi, const ObjectB
   for (bool first = true; first or not gsql.eof(); first = false) {
     string s = gsql.createStatement(first);
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_execute(s.c_str());
+    int e = execute(queryProfiler(), s);
     if (e)
       throw informix_exception(u8"create failed", e);
   }
@@ -1066,6 +1094,7 @@ InformixDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool
   open();
   SQLInformixdescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
+  gsql.setProjection(dbi.getProjection());
   string sqlLimit;
   if (not dbi.getCountCursor() and dbi.getQuerySkip() > 0)
     sqlLimit += STRSTR(" SKIP " << dbi.getQuerySkip());
@@ -1084,14 +1113,16 @@ InformixDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool
   LOG(LM_INFO, "SQL: " << s);
   if (dbi.getCountCursor()) {
     long cnt = 0;
+    QueryTimer qt(queryProfiler(), s);
     int e = infx_count(s.c_str(), &cnt);
+    qt.rows(1);
     if (e)
       throw informix_exception(u8"dropAll failed", e);
     return std::make_shared<CountCursor>(cnt);
   }
 
   auto cursor = std::make_shared<InformixCursor>(conNr, dbi.getConnection(), dbi.database(), dbi.getKeysOnly());
-  cursor->open(s);
+  cursor->open(s, queryProfiler());
   if (cursor->eof()) {
     LOG(LM_DEBUG, "NOW ROWS FOUND");
   }
@@ -1110,6 +1141,7 @@ InformixDatabaseConnection::retrieve(DatabaseInterface &dbi, ObjectBase &obj, st
   open();
   SQLInformixdescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
+  gsql.setProjection(cursor->projection());
 
   obj.clear();
   sd.descriptor = curs->descPtr;
@@ -1124,7 +1156,7 @@ InformixDatabaseConnection::retrieve(DatabaseInterface &dbi, ObjectBase &obj, st
     string s = gsql.selectStatementArray(di);
     LOG(LM_DEBUG, "SQL " << s);
     auto curs2 = std::make_shared<InformixCursor>(conNr, dbi.getConnection(), dbi.database(), false);
-    curs2->open(s);
+    curs2->open(s, queryProfiler());
     sd.descriptor = curs2->descPtr;
     sd.fldCnt = curs2->fldCnt;
     // Vektor auf leer setzten (wurde wegen Struktur zuvor erweitert)
@@ -1144,7 +1176,7 @@ void InformixDatabaseConnection::startTransaction(DatabaseInterface &dbi, DbTran
   if (currentTransaction == nullptr) {
     string s = "BEGIN WORK;";
     LOG(LM_DEBUG, "SQL " << s);
-    int e = infx_execute(s.c_str());
+    int e = execute(queryProfiler(), s);
     if (e)
       throw informix_exception(u8"Transaction failed", e);
     currentTransaction = transaction;
@@ -1160,7 +1192,7 @@ void InformixDatabaseConnection::endTransaction(DbTransaction *transaction, shar
     throw std::runtime_error("transaction mismatch");
   string s = "COMMIT WORK;";
   LOG(LM_DEBUG, "SQL " << s);
-  int e = infx_execute(s.c_str());
+  int e = execute(queryProfiler(), s);
   if (e)
     throw informix_exception(u8"Transaction failed", e);
   currentTransaction = nullptr;
@@ -1171,7 +1203,7 @@ void InformixDatabaseConnection::rollbackTransaction(DbTransaction *transaction,
     return;
   string s = "ROLLBACK WORK;";
   LOG(LM_DEBUG, "SQL " << s);
-  int e = infx_execute(s.c_str());
+  int e = execute(queryProfiler(), s);
   if (e)
     throw informix_exception(u8"Transaction failed", e);
   currentTransaction = nullptr;
@@ -1180,7 +1212,7 @@ void InformixDatabaseConnection::rollbackTransaction(DbTransaction *transaction,
 size_t InformixDatabaseConnection::doSql(const string &sql) {
   LOG(LM_DEBUG, "SQL " << sql);
   open();
-  int e = infx_execute(sql.c_str());
+  int e = execute(queryProfiler(), sql);
   if (e)
     throw informix_exception(u8"doSql " + sql + ": ", e);
   return infx_processed_rows();
@@ -22,7 +22,16 @@
 #include <iostream>
 #include <iomanip>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "logging.h"
+#include "condwait.h"
 
 #ifdef __MINGW32__
 typedef unsigned char u_char;
@@ -48,6 +57,266 @@ namespace logging {
 loglevel currentLevel = lm_trace;
 
 
+namespace {
+
+// Ringpuffer eines Threads, ein Schreiber (der Thread) und ein Leser (der Hintergrund-Thread)
+class LogRing {
+public:
+  struct Entry {
+    int64_t time = 0;
+    std::string text;
+  };
+
+  LogRing(size_t size, unsigned n) : slots(size ? size : 1), id(n) {}
+
+  bool push(int64_t t, std::string &&text) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= slots.size())
+      return false;
+    Entry &e = slots[h % slots.size()];
+    e.time = t;
+    e.text = std::move(text);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(Entry &e) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire))
+      return false;
+    e = std::move(slots[t % slots.size()]);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::vector<Entry> slots;
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+  std::atomic<bool> finished{false};
+  const unsigned id;
+};
+
+// Anbindung des Threads an den aktuellen AsyncLog
+struct ThreadLog {
+  ~ThreadLog() {
+    if (ring)
+      ring->finished = true;
+  }
+  std::shared_ptr<LogRing> ring;
+  unsigned generation = 0;
+};
+
+thread_local ThreadLog threadLog;
+
+std::atomic<logging::AsyncLogData *> activeLog{nullptr};
+std::atomic<int> activeUsers{0};
+std::atomic<unsigned> logGeneration{0};
+
+char levelChar(logging::loglevel l) {
+  switch(l)
+  {
+    case logging::lm_debug: return 'D';
+    case logging::lm_trace: return 'T';
+    case logging::lm_info: return 'I';
+    case logging::lm_error: return 'E';
+    case logging::lm_warn: return 'W';
+  }
+  return ' ';
+}
+
+// Steuerzeichen maskieren, unkritische Abschnitte werden am Stück übernommen
+void appendEscaped(std::string &out, const std::string &msg) {
+  static const char hex[] = "0123456789abcdef";
+  auto start = msg.begin();
+  for (auto i = msg.begin(); i != msg.end(); ++i) {
+    if (u_char(*i) >= 0x20)
+      continue;
+    out.append(start, i);
+    start = i + 1;
+    switch(*i) {
+      case '\n': out += "<NL>"; break;
+      case '\r': out += "<CR>"; break;
+      case 0x0c: out += *i; break;
+      default:
+        out += '<';
+        out += hex[u_char(*i) >> 4];
+        out += hex[u_char(*i) & 0x0f];
+        out += '>';
+    }
+  }
+  out.append(start, msg.end());
+}
+
+}
+
+class AsyncLogData {
+public:
+  AsyncLogData(const std::string &file, size_t size, AsyncLog::Overflow o) : bufferSize(size), overflow(o),
+                                                                             start(std::chrono::steady_clock::now()) {
+    if (not file.empty())
+      fileLog = std::unique_ptr<FileMultiLog>(new FileMultiLog(file));
+  }
+
+  void run();
+  void put(loglevel l, std::string &&text);
+  LogRing &ring();
+
+  size_t bufferSize;
+  AsyncLog::Overflow overflow;
+  std::chrono::steady_clock::time_point start;
+  std::unique_ptr<FileMultiLog> fileLog;
+  unsigned generation = 0;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<std::shared_ptr<LogRing>> rings;
+  unsigned threadCnt = 0;
+  std::atomic<size_t> queuedCnt{0};
+  std::atomic<size_t> droppedCnt{0};
+  size_t doneCnt = 0;
+  size_t writtenCnt = 0;
+  std::atomic<bool> pending{false};
+  bool stop = false;
+  std::thread thread;
+};
+
+LogRing &AsyncLogData::ring() {
+  if (not threadLog.ring or threadLog.generation != generation) {
+    if (threadLog.ring)
+      threadLog.ring->finished = true;
+    std::lock_guard<std::mutex> guard(mutex);
+    threadLog.ring = std::make_shared<LogRing>(bufferSize, ++threadCnt);
+    threadLog.generation = generation;
+    rings.push_back(threadLog.ring);
+  }
+  return *threadLog.ring;
+}
+
+void AsyncLogData::put(loglevel l, std::string &&text) {
+  LogRing &r = ring();
+  int64_t t = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  char buf[48];
+  int n = snprintf(buf, sizeof(buf), "%c %lld.%06lld [%u] ", levelChar(l), (long long)(t / 1000000),
+                   (long long)(t % 1000000), r.id);
+  std::string line;
+  line.reserve(size_t(n) + text.length() + 8);
+  line.append(buf, size_t(n));
+  appendEscaped(line, text);
+  line += '\n';
+  for (;;) {
+    if (r.push(t, std::move(line))) {
+      queuedCnt++;
+      break;
+    }
+    if (overflow == AsyncLog::Drop) {
+      droppedCnt++;
+      return;
+    }
+    pending = true;
+    cond.notify_all();
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  if (not pending.exchange(true))
+    cond.notify_all();
+}
+
+void AsyncLogData::run() {
+  std::vector<LogRing::Entry> batch;
+  std::vector<std::shared_ptr<LogRing>> current;
+  std::string out;
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    // put() signalisiert ohne Mutex, daher kann ein notify verloren gehen; das Intervall begrenzt die Verzögerung
+    cond.wait_for(lock, std::chrono::milliseconds(20), [this]() { return stop or pending; });
+    pending = false;
+    bool stopping = stop;
+    current = rings;
+    lock.unlock();
+    batch.clear();
+    LogRing::Entry e;
+    for (auto &r:current)
+      while (r->pop(e))
+        batch.push_back(std::move(e));
+    if (not batch.empty()) {
+      std::stable_sort(batch.begin(), batch.end(),
+                       [](const LogRing::Entry &a, const LogRing::Entry &b) { return a.time < b.time; });
+      out.clear();
+      for (auto &b:batch)
+        out += b.text;
+      try {
+        if (fileLog)
+          fileLog->logString(out);
+        else
+          std::cerr.write(out.c_str(), std::streamsize(out.length())).flush();
+      } catch (std::exception &ex) {
+        std::cerr << "E AsyncLog " << ex.what() << std::endl;
+      }
+    }
+    lock.lock();
+    doneCnt += batch.size();
+    writtenCnt += batch.size();
+    // Puffer beendeter Threads entfernen
+    rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<LogRing> &r) {
+      return r->finished and r->head == r->tail; }), rings.end());
+    cond.notify_all();
+    if (stopping and batch.empty())
+      break;
+  }
+}
+
+
+AsyncLog::AsyncLog(const std::string &filenamePart, size_t bufferSize, Overflow overflow) {
+  data = std::unique_ptr<AsyncLogData>(new AsyncLogData(filenamePart, bufferSize, overflow));
+  data->generation = ++logGeneration;
+  AsyncLogData *expected = nullptr;
+  if (not activeLog.compare_exchange_strong(expected, data.get()))
+    throw std::runtime_error(u8"AsyncLog already exists");
+  data->thread = std::thread(&AsyncLogData::run, data.get());
+}
+
+AsyncLog::~AsyncLog() {
+  activeLog = nullptr;
+  // laufende Aufrufe von put abwarten
+  while (activeUsers)
+    std::this_thread::yield();
+  {
+    std::lock_guard<std::mutex> guard(data->mutex);
+    data->stop = true;
+  }
+  data->cond.notify_all();
+  if (data->thread.joinable())
+    data->thread.join();
+}
+
+void AsyncLog::flush() {
+  std::unique_lock<std::mutex> lock(data->mutex);
+  size_t seq = data->queuedCnt;
+  data->pending = true;
+  data->cond.notify_all();
+  mobs::waitFor(data->cond, lock, [this, seq]() { return data->doneCnt >= seq; });
+}
+
+size_t AsyncLog::written() const {
+  std::lock_guard<std::mutex> guard(data->mutex);
+  return data->writtenCnt;
+}
+
+size_t AsyncLog::dropped() const {
+  return data->droppedCnt;
+}
+
+
+// Zeile über AsyncLog ausgeben, falls aktiv
+bool writeAsync(loglevel l, std::string &&text) {
+  activeUsers++;
+  AsyncLogData *a = activeLog;
+  if (a)
+    a->put(l, std::move(text));
+  activeUsers--;
+  return a != nullptr;
+}
+
+
 /// \brief Logmeldung ausgeben, interne Funktion, bitte Makro LOG() verwenden
 /// \see LOG(l, x)
 /// @param l Log-Level
@@ -56,45 +325,75 @@ void logMessage(loglevel l, const std::function<std::string()>& message)
 {
   if (l < currentLevel)
     return;
+  logText(l, message());
+}
 
-  char c = ' ';
-  switch(l)
-  {
-    case lm_debug: c = 'D'; break;
-    case lm_trace: c = 'T'; break;
-    case lm_info: c = 'I'; break;
-    case lm_error: c = 'E'; break;
-    case lm_warn: c = 'W'; break;
-  }
-  std::stringstream out;
-  out << c << ' ';
-  for (auto i:message()) {
-    switch(i) {
-      case '\n': out << "<NL>"; break;
-      case '\r': out << "<CR>"; break;
-      case '\0' ... 0x09:
-      case 0x0b:
-      case 0x0e ... 0x1f: out << '<' << std::hex << std::setfill('0') << std::setw(2) << int(u_char(c)) << '>'; break;
-      default: out << i;
-    }
-  }
-  std::cerr << out.str() << std::endl;
+void logText(loglevel l, const std::string &text)
+{
+  if (writeAsync(l, std::string(text)))
+    return;
+  std::string out;
+  out.reserve(text.length() + 8);
+  out += levelChar(l);
+  out += ' ';
+  appendEscaped(out, text);
+  out += '\n';
+  std::cerr.write(out.c_str(), std::streamsize(out.length())).flush();
+}
+
+
+
+namespace {
+std::mutex moduleMutex;
+
+// wird nie freigegeben, da LOG auch noch aus Destruktoren statischer Objekte aufgerufen werden kann
+std::map<std::string, std::atomic<int>> &moduleLevels() {
+  static auto *levels = new std::map<std::string, std::atomic<int>>;
+  return *levels;
+}
+
+std::atomic<int> &moduleLevel(std::string module) {
+  // nur Dateiname ohne Pfad, falls __FILE_NAME__ nicht unterstützt wird
+  auto pos = module.find_last_of("/\\");
+  if (pos != std::string::npos)
+    module.erase(0, pos + 1);
+  std::lock_guard<std::mutex> guard(moduleMutex);
+  auto &levels = moduleLevels();
+  auto it = levels.find(module);
+  if (it == levels.end())
+    it = levels.emplace(std::piecewise_construct, std::forward_as_tuple(module), std::forward_as_tuple(0)).first;
+  return it->second;
+}
+}
+
+std::atomic<int> *moduleLevelRef(const char *module) {
+  return &moduleLevel(module);
 }
 
+void setModuleLevel(const std::string &module, loglevel level) {
+  moduleLevel(module) = level;
+}
 
+void resetModuleLevel(const std::string &module) {
+  moduleLevel(module) = 0;
+}
 
-Trace::Trace (const char *f, const std::function<std::string()>& str) : fun(f)
+
+void Trace::begin(const std::string &str)
 {
-  if (traceOn)
-    std::cerr << "T B(" << ++lev << ") " << fun
-              << " with " << str() << std::endl;
+  std::string text = STRSTR("B(" << ++lev << ") " << fun << " with " << str);
+  if (not writeAsync(lm_trace, std::move(text)))
+    std::cerr << "T " << text << std::endl;
 }
 
 /// Destruktor
 Trace::~Trace ()
 {
-  if (traceOn)
-    std::cerr << "T E(" << lev-- << ") " << fun << std::endl;
+  if (traceOn) {
+    std::string text = STRSTR("E(" << lev-- << ") " << fun);
+    if (not writeAsync(lm_trace, std::move(text)))
+      std::cerr << "T " << text << std::endl;
+  }
 }
 
 
@@ -192,7 +491,7 @@ LogMultiStream::~LogMultiStream() {
 }
 
 
-int Trace::lev = 0;
+thread_local int Trace::lev = 0;
 bool Trace::traceOn = false;
 
 }
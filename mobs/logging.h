@@ -25,7 +25,9 @@
 #include <sstream>
 #include <string>
 #include <array>
+#include <atomic>
 #include <functional>
+#include <memory>
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -41,10 +43,17 @@
  THROW(streamOp)
  
  sowie die Log_level-Makros existieren.
- 
- 
+
+ Die Prüfung des Log-Levels erfolgt vor dem Aufbau der Meldung. Meldungen unterhalb von MOBS_LOG_MIN_LEVEL werden
+ bereits vom Compiler entfernt; zur Laufzeit gilt currentLevel oder ein über setModuleLevel() gesetzter Level der
+ Quelldatei.
  */
 
+#ifndef MOBS_LOG_MIN_LEVEL
+/// \brief minimaler Log-Level, der übersetzt wird (1 = Trace ... 5 = Error)
+#define MOBS_LOG_MIN_LEVEL 1
+#endif
+
 namespace logging {
 
 /// Log-Lebel, bitte Makros verwenden
@@ -58,15 +67,46 @@ typedef enum {
 
 extern loglevel currentLevel;
 
+/** \brief Log-Level für ein Modul setzen
+ *
+ * @param module Name der Quelldatei ohne Pfad, z.B. "sqlite.cpp"
+ * @param level Log-Level, der für dieses Modul anstelle von currentLevel gilt
+ */
+void setModuleLevel(const std::string &module, loglevel level);
+/// Log-Level des Moduls wieder auf currentLevel zurücksetzen
+void resetModuleLevel(const std::string &module);
+
+/// \private
+std::atomic<int> *moduleLevelRef(const char *module);
+
+/// Interne Klasse für den Log-Level einer Quelldatei, bitte Makro LOG verwenden
+class ModuleLevel {
+public:
+  /// \private
+  explicit ModuleLevel(const char *module) : level(moduleLevelRef(module)) {}
+  /// prüft, ob eine Meldung mit Level l ausgegeben wird
+  bool enabled(loglevel l) const {
+    int m = level->load(std::memory_order_relaxed);
+    return l >= (m ? m : currentLevel);
+  }
+private:
+  std::atomic<int> *level;
+};
+
 /// Interne Klasse für Tracing, bitte Makro TRACE verwenden
 class Trace {
 public:
   /// \private
-  Trace (const char *f, const std::function<std::string()> &str);
+  template<typename F>
+  Trace (const char *f, F &&str) : fun(f) {
+    if (traceOn)
+      begin(str());
+  }
   ~Trace ();
   static bool traceOn; ///< schaltet Tracing zur Laufzeit ein und aus
 private:
-  static int lev;
+  void begin(const std::string &str);
+  static thread_local int lev;
   const char *fun;
 };
 
@@ -129,8 +169,63 @@ public:
 };
 
 
+class AsyncLogData;
+
+/** \brief Asynchrone Ausgabe von LOG und TRACE in einem Hintergrund-Thread
+ *
+ * Solange ein Objekt dieser Klasse existiert, werden die Log-Meldungen nicht mehr direkt auf stderr geschrieben. Jeder
+ * Thread legt seine Meldungen ohne Sperre in einem eigenen Ringpuffer ab. Ein Hintergrund-Thread sammelt die Puffer
+ * aller Threads ein, sortiert die Meldungen nach Zeit und schreibt sie blockweise nach stderr oder in ein FileMultiLog.
+ *
+ * Jede Zeile enthält zusätzlich einen monotonen Zeitstempel in Sekunden seit dem Start und eine laufende Thread-Nummer:
+ * \verbatim
+I 12.345678 [2] dbifc.cpp:123 Meldung
+\endverbatim
+ *
+ * Ist der Ringpuffer eines Threads voll, so wird die Meldung je nach Modus verworfen oder gewartet, bis wieder Platz ist.
+ *
+ * Das Objekt darf nur einmal instanziiert werden. Im Destruktor werden alle anstehenden Meldungen noch geschrieben.
+ * \code
+ * logging::AsyncLog asyncLog("server.log");
+ * \endcode
+ */
+class AsyncLog {
+public:
+  /// Verhalten bei vollem Puffer
+  enum Overflow {
+    Drop, ///< Meldung verwerfen
+    Block ///< warten, bis wieder Platz ist
+  };
+
+  /** \brief Konstruktor, startet den Hintergrund-Thread
+   *
+   * @param filenamePart Basis-Name für ein FileMultiLog; leer für stderr
+   * @param bufferSize Anzahl Meldungen je Thread-Puffer
+   * @param overflow Verhalten bei vollem Puffer
+   * \throw runtime_error wenn bereits ein AsyncLog existiert
+   */
+  explicit AsyncLog(const std::string &filenamePart = "", size_t bufferSize = 1024, Overflow overflow = Drop);
+  /// Destruktor, schreibt alle anstehenden Meldungen
+  ~AsyncLog();
+
+  AsyncLog(const AsyncLog &) = delete;
+  AsyncLog &operator=(const AsyncLog &) = delete;
+
+  /// warte, bis alle bisherigen Meldungen geschrieben sind
+  void flush();
+  /// Anzahl der bisher geschriebenen Meldungen
+  size_t written() const;
+  /// Anzahl der wegen vollem Puffer verworfenen Meldungen
+  size_t dropped() const;
+
+private:
+  std::unique_ptr<AsyncLogData> data;
+};
+
 
 void logMessage(loglevel l, const std::function<std::string()>& message);
+/// \private Ausgabe einer Log-Meldung ohne Prüfung des Levels, bitte Makro LOG() verwenden
+void logText(loglevel l, const std::string &text);
 
 }
 
@@ -148,7 +243,10 @@ void logMessage(loglevel l, const std::function<std::string()>& message);
 #define THROW(x) do { std::stringstream ___s___; ___s___ << __FILE_NAME__ << ':' << __LINE__ << " " << std::boolalpha << x; throw std::runtime_error(___s___.str()); } while(false)
 
 /// \brief Erzeugt eine Log-Meldung auf stderr.
-#define LOG(l,x) logging::logMessage(l, [&]()->std::string { std::stringstream ___s___; ___s___ << __FILE_NAME__ << ':' << __LINE__ << " " << std::boolalpha << x; return ___s___.str(); })
+#define LOG(l,x) (((l) >= MOBS_LOG_MIN_LEVEL and [](logging::loglevel ___l___) { \
+  static const logging::ModuleLevel ___m___(__FILE_NAME__); return ___m___.enabled(___l___); }(l)) ? \
+  logging::logText(l, [&]()->std::string { std::stringstream ___s___; \
+  ___s___ << __FILE_NAME__ << ':' << __LINE__ << " " << std::boolalpha << x; return ___s___.str(); }()) : void())
 
 /// \brief Hilfs-Makro das einen Stream als std::string ausgibt
 #define STRSTR(x) ([&]()->std::string { std::stringstream ___s___; ___s___ << x; return ___s___.str(); })()
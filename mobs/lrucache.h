@@ -92,6 +92,13 @@ public:
    * @return tatsächliche Größe des Caches in Bytes
   */
   size_t reduceBytes(size_t n);
+  /** \brief Aufruf einer Funktion für alle Objekte im Cache
+   *
+   * Die Aufrufe werden nicht als Zugriff gezählt
+   * @param f Funktion mit Parameter \c std::shared_ptr<T>
+   */
+  template<class F>
+  void forEach(F f) const { for (auto &i:cache) f(i.second.ptr); }
 
 
 protected:
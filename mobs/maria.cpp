@@ -27,12 +27,16 @@
 #include "objgen.h"
 #include "unixtime.h"
 #include "helper.h"
+#include "metrics.h"
 #include "mchrono.h"
+#include "blobstore.h"
+#include "converter.h"
 
 #include <cstdint>
 #include <iostream>
 #include <utility>
 #include <vector>
+#include <type_traits>
 #include <chrono>
 
 
@@ -44,6 +48,8 @@ class mysql_exception : public std::runtime_error {
 public:
   mysql_exception(const std::string &e, MYSQL *con) : std::runtime_error(string("mysql ") + e + ": " + mysql_error(con)) {
     LOG(LM_DEBUG, "mysql: Error " << mysql_error(con)); }
+  mysql_exception(const std::string &e, MYSQL_STMT *stmt) : std::runtime_error(string("mysql ") + e + ": " + mysql_stmt_error(stmt)) {
+    LOG(LM_DEBUG, "mysql: Error " << mysql_stmt_error(stmt)); }
 //  const char* what() const noexcept override { return error.c_str(); }
 //private:
 //  std::string error;
@@ -93,6 +99,8 @@ public:
       res << "TINYINT";
     else if (mi.isFloat)
       res << "FLOAT";
+    else if (mi.isBlob and dynamic_cast<const BlobChunk *>(mem.getParentObject()))
+      res << "LONGBLOB"; // nur die Teilstücke des BlobStore, werden base64-kodiert übertragen
     else if (mem.is_chartype(mobs::ConvToStrHint(compact))) {
       if (mi.is_specialized and mi.size == 1)
         res << "CHAR(1)";
@@ -256,7 +264,7 @@ public:
   void startReading() override {
     pos = 0;
     fields = mysql_fetch_fields(result);
-    lengths = mysql_fetch_lengths(result);
+    lengths = rowLengths ? rowLengths : mysql_fetch_lengths(result);
     if (not fields or not lengths)
       throw runtime_error("Cursor read error");
   }
@@ -264,6 +272,7 @@ public:
 
   MYSQL_RES *result = nullptr;
   MYSQL_ROW *row = nullptr;
+  unsigned long *rowLengths = nullptr; // Längen bei Prepared-Statements
 
 private:
   std::string dbPrefix;
@@ -295,15 +304,60 @@ public:
                        std::string dbName, bool keysOnly) :
           result(result), fldCnt(fldCnt), dbCon(std::move(dbi)), databaseName(std::move(dbName)), isKeysOnly(keysOnly)
   {  row = mysql_fetch_row(result); }
-  ~MariaCursor() override { if (result) mysql_free_result(result); result = nullptr; }
+  /// Cursor über ein ausgeführtes Prepared-Statement mit serverseitigem Cursor
+  explicit MariaCursor(MYSQL_STMT *stmt, MYSQL_RES *meta, unsigned int fldCnt, std::shared_ptr<DatabaseConnection> dbi,
+                       std::string dbName, bool keysOnly) :
+          result(meta), stmt(stmt), fldCnt(fldCnt), dbCon(std::move(dbi)), databaseName(std::move(dbName)),
+          isKeysOnly(keysOnly), bind(fldCnt), buffers(fldCnt), lengths(fldCnt), nulls(fldCnt), rowData(fldCnt)
+  {
+    for (unsigned int i = 0; i < fldCnt; i++) {
+      buffers[i].resize(256);
+      bind[i] = MYSQL_BIND{};
+      bind[i].buffer_type = MYSQL_TYPE_STRING;
+      bind[i].buffer = &buffers[i][0];
+      bind[i].buffer_length = buffers[i].size();
+      bind[i].length = &lengths[i];
+      bind[i].is_null = &nulls[i];
+    }
+    try {
+      if (mysql_stmt_bind_result(stmt, &bind[0]))
+        throw mysql_exception(u8"cursor: bind failed", stmt);
+      row = fetchStmt();
+    } catch (...) {
+      close();
+      throw;
+    }
+    if (not row)
+      close();
+  }
+  ~MariaCursor() override {
+    if (timer and row)
+      timer->rows(cnt + 1);
+    close();
+  }
   bool eof() override  { return not row; }
   bool valid() override { return not eof(); }
   bool keysOnly() const override { return isKeysOnly; }
   void operator++() override {
     if (eof()) return;
-    row = mysql_fetch_row(result);
     cnt++;
+    if (timer)
+      timer->start();
+    if (stmt) {
+      row = fetchStmt();
+      if (timer)
+        timer->stop();
+      if (not row) {
+        close();
+        finishTimer();
+      }
+      return;
+    }
+    row = mysql_fetch_row(result);
+    if (timer)
+      timer->stop();
     if (not row) {
+      finishTimer();
       auto mdb = dynamic_pointer_cast<MariaDatabaseConnection>(dbCon);
       if (mdb and mysql_errno(mdb->getConnection()))
         throw mysql_exception(u8"cursor: query row failed", mdb->getConnection());
@@ -312,12 +366,64 @@ public:
     }
   }
 private:
+  using NullFlag = std::remove_pointer<decltype(MYSQL_BIND::is_null)>::type;
+
+  void finishTimer() {
+    if (timer) {
+      timer->rows(cnt);
+      timer->finish();
+    }
+  }
+
+  // nächste Zeile des Prepared-Statements holen; zu lange Spalten werden nachgeladen
+  MYSQL_ROW fetchStmt() {
+    int rc = mysql_stmt_fetch(stmt);
+    if (rc == MYSQL_NO_DATA)
+      return nullptr;
+    if (rc == 1)
+      throw mysql_exception(u8"cursor: fetch failed", stmt);
+    bool rebind = false;
+    for (unsigned int i = 0; i < fldCnt; i++) {
+      if (nulls[i]) {
+        rowData[i] = nullptr;
+        continue;
+      }
+      if (lengths[i] > buffers[i].size()) {
+        buffers[i].resize(lengths[i]);
+        bind[i].buffer = &buffers[i][0];
+        bind[i].buffer_length = buffers[i].size();
+        if (mysql_stmt_fetch_column(stmt, &bind[i], i, 0))
+          throw mysql_exception(u8"cursor: fetch column failed", stmt);
+        rebind = true;
+      }
+      rowData[i] = &buffers[i][0];
+    }
+    if (rebind and mysql_stmt_bind_result(stmt, &bind[0]))
+      throw mysql_exception(u8"cursor: bind failed", stmt);
+    return &rowData[0];
+  }
+  void close() {
+    if (result)
+      mysql_free_result(result);
+    result = nullptr;
+    if (stmt)
+      mysql_stmt_close(stmt);
+    stmt = nullptr;
+  }
+
   MYSQL_RES *result;
+  MYSQL_STMT *stmt = nullptr;
   unsigned int fldCnt;
   std::shared_ptr<DatabaseConnection> dbCon;  // verhindert das Zerstören der Connection
   std::string databaseName;  // unused
   MYSQL_ROW row = nullptr;
   bool isKeysOnly;
+  std::vector<MYSQL_BIND> bind;
+  std::vector<std::vector<char>> buffers;
+  std::vector<unsigned long> lengths;
+  std::vector<NullFlag> nulls;
+  std::vector<char *> rowData;
+  std::unique_ptr<QueryTimer> timer; // Messung für den QueryProfiler bis zum Ende des Cursors
 };
 
 }
@@ -384,16 +490,21 @@ MariaDatabaseConnection::~MariaDatabaseConnection() {
 }
 
 bool MariaDatabaseConnection::load(DatabaseInterface &dbi, ObjectBase &obj) {
+  MetricsTimer timer("maria.load");
   open();
   SQLMariaDBdescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
   string s = gsql.selectStatementFirst();
   LOG(LM_DEBUG, "SQL: " << s);
+  checkIdle();
+  QueryTimer qt(queryProfiler(), s);
   if (mysql_real_query(connection, s.c_str(), s.length()))
     throw mysql_exception(u8"load failed", connection);
   MYSQL_RES *result = mysql_store_result(connection);
   if (result == nullptr)
     throw mysql_exception(u8"load store failed", connection);
+  qt.rows(mysql_num_rows(result));
+  qt.finish();
   unsigned int sz = mysql_field_count(connection);
   auto cursor = std::make_shared<MariaCursor>(result, sz, dbi.getConnection(), dbi.database(), false);
   if (cursor->row == nullptr and mysql_errno(connection))
@@ -408,6 +519,7 @@ bool MariaDatabaseConnection::load(DatabaseInterface &dbi, ObjectBase &obj) {
 }
 
 void MariaDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj) {
+  MetricsTimer timer("maria.save");
   open();
   SQLMariaDBdescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
@@ -416,7 +528,7 @@ void MariaDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj
   if (currentTransaction == nullptr) {
     string s = "BEGIN WORK;";
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"Transaction failed", connection);
     // Wenn DBI mit Transaktion, dann in Transaktion bleiben
   }
@@ -425,7 +537,7 @@ void MariaDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj
   else {
     string s = "SAVEPOINT MOBS;";
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"Transaction failed", connection);
   }
   int64_t version = gsql.getVersion();
@@ -441,7 +553,7 @@ void MariaDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj
     else
       s = gsql.replaceStatement(true);
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"save failed", connection);
     auto rows = mysql_affected_rows(connection);
     LOG(LM_DEBUG, "ROWS " << rows);
@@ -457,7 +569,7 @@ void MariaDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj
       else
         s = gsql.replaceStatement(false);
       LOG(LM_DEBUG, "SQL " << s);
-      if (mysql_real_query(connection, s.c_str(), s.length()))
+      if (realQuery(s))
         throw mysql_exception(u8"save failed", connection);
     }
   } catch (runtime_error &e) {
@@ -466,7 +578,7 @@ void MariaDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj
       s += " TO SAVEPOINT MOBS";
     s += ";";
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"Transaction failed", connection);
     throw e;
   } catch (exception &e) {
@@ -475,7 +587,7 @@ void MariaDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj
       s += " TO SAVEPOINT MOBS";
     s += ";";
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"Transaction failed", connection);
     throw e;
   }
@@ -486,13 +598,14 @@ void MariaDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj
   else
     s = "COMMIT WORK;";
   LOG(LM_DEBUG, "SQL " << s);
-  if (mysql_real_query(connection, s.c_str(), s.length()))
+  if (realQuery(s))
     throw mysql_exception(u8"Transaction failed", connection);
 }
 
 
 
 bool MariaDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &obj) {
+  MetricsTimer timer("maria.destroy");
   open();
   SQLMariaDBdescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
@@ -501,7 +614,7 @@ bool MariaDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
   if (currentTransaction == nullptr) {
     string s = "BEGIN WORK;";
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"Transaction failed", connection);
     // Wenn DBI mit Transaktion, dann in Transaktion bleiben
   }
@@ -510,7 +623,7 @@ bool MariaDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
   else {
     string s = "SAVEPOINT MOBS;";
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"Transaction failed", connection);
   }
 
@@ -524,7 +637,7 @@ bool MariaDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
     for (bool first = true; first or not gsql.eof(); first = false) {
       string s = gsql.deleteStatement(first);
       LOG(LM_DEBUG, "SQL " << s);
-      if (mysql_real_query(connection, s.c_str(), s.length()))
+      if (realQuery(s))
         throw mysql_exception(u8"destroy failed", connection);
       if (first) {
         found = (mysql_affected_rows(connection) > 0);
@@ -538,7 +651,7 @@ bool MariaDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
       s += " TO SAVEPOINT MOBS";
     s += ";";
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"Transaction failed", connection);
     THROW(u8"MariaDB destroy: " << e.what());
   } catch (exception &e) {
@@ -547,7 +660,7 @@ bool MariaDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
       s += " TO SAVEPOINT MOBS";
     s += ";";
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"Transaction failed", connection);
     THROW(u8"MariaDB destroy: " << e.what());
   }
@@ -558,7 +671,7 @@ bool MariaDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
   else
     s = "COMMIT WORK;";
   LOG(LM_DEBUG, "SQL " << s);
-  if (mysql_real_query(connection, s.c_str(), s.length()))
+  if (realQuery(s))
     throw mysql_exception(u8"Transaction failed", connection);
 
   return found;
@@ -567,9 +680,11 @@ bool MariaDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
 std::shared_ptr<DbCursor>
 MariaDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qbe, const QueryGenerator *query,
                                const QueryOrder *sort) {
+  MetricsTimer timer("maria.query");
   open();
   SQLMariaDBdescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
+  gsql.setProjection(dbi.getProjection());
 
   string sqlLimit;
   if (not dbi.getCountCursor() and (dbi.getQueryLimit() > 0 or dbi.getQuerySkip() > 0))
@@ -586,12 +701,50 @@ MariaDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qbe
   // TODO  s += " LOCK IN SHARE MODE WAIT 10 "; / NOWAIT
 
   LOG(LM_INFO, "SQL: " << s);
+  checkIdle();
+  std::unique_ptr<QueryTimer> qt;
+  if (queryProfiler())
+    qt = std::unique_ptr<QueryTimer>(new QueryTimer(queryProfiler(), s));
+  if (not dbi.getCountCursor() and dbi.getFetchPolicy() == DatabaseInterface::FetchServerCursor) {
+    MYSQL_STMT *stmt = mysql_stmt_init(connection);
+    if (stmt == nullptr)
+      throw mysql_exception(u8"query init failed", connection);
+    unsigned long cursorType = CURSOR_TYPE_READ_ONLY;
+    unsigned long prefetch = dbi.getFetchSize();
+    MYSQL_RES *meta = nullptr;
+    try {
+      if (mysql_stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &cursorType) or
+          mysql_stmt_attr_set(stmt, STMT_ATTR_PREFETCH_ROWS, &prefetch))
+        throw mysql_exception(u8"query cursor failed", stmt);
+      if (mysql_stmt_prepare(stmt, s.c_str(), s.length()) or mysql_stmt_execute(stmt))
+        throw mysql_exception(u8"query failed", stmt);
+      meta = mysql_stmt_result_metadata(stmt);
+      if (meta == nullptr)
+        throw mysql_exception(u8"load failed", stmt);
+    } catch (...) {
+      mysql_stmt_close(stmt);
+      throw;
+    }
+    // Cursor übernimmt stmt und meta
+    auto cursor = std::make_shared<MariaCursor>(stmt, meta, mysql_num_fields(meta), dbi.getConnection(),
+                                                dbi.database(), dbi.getKeysOnly());
+    if (qt)
+      qt->stop();
+    if (not cursor->row)
+      LOG(LM_DEBUG, "NOW ROWS FOUND");
+    else
+      cursor->timer = std::move(qt);
+    return cursor;
+  }
+
   if (mysql_real_query(connection, s.c_str(), s.length()))
     throw mysql_exception(u8"query failed", connection);
   unsigned int sz = mysql_field_count(connection);
 
   MYSQL_RES *result;
-  if (dbi.getCountCursor() or gsql.queryWithJoin())
+  bool buffered = dbi.getCountCursor() or dbi.getFetchPolicy() == DatabaseInterface::FetchBuffered or
+                  (dbi.getFetchPolicy() == DatabaseInterface::FetchDefault and gsql.queryWithJoin());
+  if (buffered)
     result = mysql_store_result(connection);
   else
     result = mysql_use_result(connection);
@@ -606,16 +759,25 @@ MariaDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qbe
     string value(row[0], lengths[0]);
     size_t cnt = stoull(value, nullptr);
     mysql_free_result(result);
+    if (qt)
+      qt->rows(1);
     return std::make_shared<CountCursor>(cnt);
   }
 
   auto cursor = std::make_shared<MariaCursor>(result, sz, dbi.getConnection(), dbi.database(), dbi.getKeysOnly());
+  if (qt)
+    qt->stop();
   if (cursor->row == nullptr and mysql_errno(connection))
     throw mysql_exception(u8"query row failed", connection);
   if (not cursor->row) {
     LOG(LM_DEBUG, "NOW ROWS FOUND");
     mysql_free_result(cursor->result);
     cursor->result = nullptr;
+  } else {
+    cursor->timer = std::move(qt);
+    // bis zum Ende des Cursors sind keine weiteren Kommandos auf der Verbindung möglich
+    if (not buffered)
+      streamCursor = cursor;
   }
   return cursor;
 }
@@ -634,10 +796,12 @@ MariaDatabaseConnection::retrieve(DatabaseInterface &dbi, ObjectBase &obj, std::
   open();
   SQLMariaDBdescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
+  gsql.setProjection(cursor->projection());
 
   obj.clear();
   sd.result = curs->result;
   sd.row = &curs->row;
+  sd.rowLengths = curs->stmt ? &curs->lengths[0] : nullptr;
   if (curs->isKeysOnly)
     gsql.readObjectKeys(obj);
   else
@@ -647,11 +811,17 @@ MariaDatabaseConnection::retrieve(DatabaseInterface &dbi, ObjectBase &obj, std::
     SqlGenerator::DetailInfo di;
     string s = gsql.selectStatementArray(di);
     LOG(LM_DEBUG, "SQL " << s);
+    checkIdle();
+    QueryTimer qt(queryProfiler(), s);
     if (mysql_real_query(connection, s.c_str(), s.length()))
       throw mysql_exception(u8"query detail failed", connection);
 
 //    unsigned int sz = mysql_field_count(connection);
+    sd.rowLengths = nullptr;
     sd.result = mysql_store_result(connection);
+    if (sd.result)
+      qt.rows(mysql_num_rows(sd.result));
+    qt.finish();
     try {
       if (sd.result == nullptr)
         throw mysql_exception(u8"load detail failed", connection);
@@ -685,7 +855,7 @@ void MariaDatabaseConnection::dropAll(DatabaseInterface &dbi, const ObjectBase &
   for (bool first = true; first or not gsql.eof(); first = false) {
     string s = gsql.dropStatement(first);
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"dropAll failed", connection);
   }
 }
@@ -698,7 +868,7 @@ void MariaDatabaseConnection::structure(DatabaseInterface &dbi, const ObjectBase
   for (bool first = true; first or not gsql.eof(); first = false) {
     string s = gsql.createStatement(first);
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"create failed", connection);
   }
 }
@@ -708,9 +878,25 @@ MYSQL *MariaDatabaseConnection::getConnection() {
   return connection;
 }
 
+void MariaDatabaseConnection::checkIdle() {
+  auto c = streamCursor.lock();
+  if (c and not c->eof())
+    throw runtime_error(u8"MariaDB: connection is busy with a streaming cursor, "
+                        u8"use FetchBuffered or FetchServerCursor or a separate connection");
+}
+
+int MariaDatabaseConnection::realQuery(const string &sql) {
+  checkIdle();
+  QueryTimer qt(queryProfiler(), sql);
+  int rc = mysql_real_query(connection, sql.c_str(), sql.length());
+  if (qt.active() and rc == 0 and mysql_field_count(connection) == 0)
+    qt.rows(mysql_affected_rows(connection));
+  return rc;
+}
+
 size_t MariaDatabaseConnection::doSql(const string &sql)
 {
-  if (mysql_real_query(connection, sql.c_str(), sql.length()))
+  if (realQuery(sql))
     throw mysql_exception(u8"SQL failed", connection);
   return mysql_affected_rows(connection);
 }
@@ -722,7 +908,7 @@ void MariaDatabaseConnection::startTransaction(DatabaseInterface &dbi, DbTransac
     // SET SESSION idle_transaction_timeout=2, SESSION idle_readonly_transaction_timeout=10;
     string s = "BEGIN WORK;";
     LOG(LM_DEBUG, "SQL " << s);
-    if (mysql_real_query(connection, s.c_str(), s.length()))
+    if (realQuery(s))
       throw mysql_exception(u8"Transaction failed", connection);
     currentTransaction = transaction;
   }
@@ -737,7 +923,7 @@ void MariaDatabaseConnection::endTransaction(DbTransaction *transaction, std::sh
     throw std::runtime_error("transaction mismatch");
   string s = "COMMIT WORK;";
   LOG(LM_DEBUG, "SQL " << s);
-  if (mysql_real_query(connection, s.c_str(), s.length()))
+  if (realQuery(s))
     throw mysql_exception(u8"Transaction failed", connection);
   currentTransaction = nullptr;
 }
@@ -747,7 +933,7 @@ void MariaDatabaseConnection::rollbackTransaction(DbTransaction *transaction, st
     return;
   string s = "ROLLBACK WORK;";
   LOG(LM_DEBUG, "SQL " << s);
-  if (mysql_real_query(connection, s.c_str(), s.length()))
+  if (realQuery(s))
     throw mysql_exception(u8"Transaction failed", connection);
   currentTransaction = nullptr;
 }
@@ -756,5 +942,24 @@ size_t MariaDatabaseConnection::maxAuditChangesValueSize(const DatabaseInterface
   return 200;
 }
 
+void MariaDatabaseConnection::uploadFile(DatabaseInterface &dbi, const std::string &id, std::istream &source) {
+  BlobStore::write(dbi, id, source);
+}
+
+std::string MariaDatabaseConnection::uploadFile(DatabaseInterface &dbi, std::istream &source) {
+  std::string id = gen_uuid_v4_p();
+  BlobStore::write(dbi, id, source);
+  return id;
+}
+
+void MariaDatabaseConnection::downloadFile(DatabaseInterface &dbi, const std::string &id, std::ostream &dest) {
+  BlobStore::read(dbi, id, dest);
+}
+
+void MariaDatabaseConnection::deleteFile(DatabaseInterface &dbi, const std::string &id) {
+  if (not BlobStore::erase(dbi, id))
+    THROW("blob " << id << " not found");
+}
+
 
 }
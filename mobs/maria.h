@@ -37,6 +37,17 @@
 namespace mobs {
 
   /** \brief Datenbank-Verbindung zu einer MariaDB.
+   *
+   * Lesen der Ergebnismenge einer Query abhängig von DatabaseInterface::withFetchPolicy:
+   * - FetchDefault: bei Joins und Count gepuffert, sonst zeilenweise
+   * - FetchBuffered: mysql_store_result
+   * - FetchStreaming: mysql_use_result
+   * - FetchServerCursor: Prepared-Statement mit Read-Only-Cursor, es werden jeweils fetchSize Zeilen geholt
+   *
+   * Solange ein zeilenweise gelesener Cursor (FetchStreaming bzw. FetchDefault ohne Join) nicht bis zum Ende gelesen
+   * oder freigegeben ist, kann die Verbindung keine weiteren Kommandos ausführen. Das betrifft auch das Nachladen von
+   * Arrays in retrieve(). Solche Zugriffe werden mit einer Exception abgewiesen; dafür FetchBuffered,
+   * FetchServerCursor oder eine eigene Verbindung verwenden.
    *
    * MariaDB is a registered trademarks of MariaDB.
    * \see www.mariadb.com
@@ -79,6 +90,15 @@ namespace mobs {
     void rollbackTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) override;
     /// \private
     size_t maxAuditChangesValueSize(const DatabaseInterface &dbi) const override;
+
+    /// \private
+    void uploadFile(DatabaseInterface &dbi, const std::string &id, std::istream &source) override;
+    /// \private
+    std::string uploadFile(DatabaseInterface &dbi, std::istream &source) override;
+    /// \private
+    void downloadFile(DatabaseInterface &dbi, const std::string &id, std::ostream &dest) override;
+    /// \private
+    void deleteFile(DatabaseInterface &dbi, const std::string &id) override;
     // ------------------------------
 
 
@@ -94,7 +114,10 @@ namespace mobs {
     MYSQL *getConnection();
 
   private:
+    int realQuery(const std::string &sql);
+    void checkIdle();
     MYSQL *connection = nullptr;
+    std::weak_ptr<DbCursor> streamCursor; // offener Cursor über mysql_use_result
     DbTransaction * currentTransaction = nullptr;
   };
 };
@@ -24,11 +24,240 @@
 #include "converter.h"
 #include "logging.h"
 
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include <vector>
 
 namespace {
+
+// Tage seit 1970-01-01 im proleptischen gregorianischen Kalender (days_from_civil nach H. Hinnant)
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const auto yoe = unsigned(y - era * 400);
+  const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + int64_t(doe) - 719468;
+}
+
+// Umkehrung von daysFromCivil
+void civilFromDays(int64_t z, int64_t &y, unsigned &m, unsigned &d) {
+  z += 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const auto doe = unsigned(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = int64_t(yoe) + era * 400 + (m <= 2);
+}
+
+int64_t floorDiv(int64_t a, int64_t b) {
+  return a / b - (a % b != 0 and (a < 0) != (b < 0));
+}
+
+/* Tabelle der Offsets der lokalen Zeitzone zu UTC
+ *
+ * Wird beim ersten Gebrauch für 1970 bis 2100 einmalig über localtime_r erstellt und danach nur noch gelesen.
+ * Außerhalb des Bereichs sowie bei lokalen Zeiten nahe einer Umstellung wird weiterhin die libc verwendet.
+ * Eine spätere Änderung der Zeitzone (TZ) wird nicht berücksichtigt.
+ */
+class LocalZone {
+public:
+  static const LocalZone &instance() {
+    static LocalZone zone;
+    return zone;
+  }
+
+  // Offset in Sekunden zum UTC-Zeitpunkt s
+  bool utcOffset(int64_t s, long &off) const {
+    if (start.empty() or s < start.front() or s >= end)
+      return false;
+    auto it = std::upper_bound(start.begin(), start.end(), s);
+    off = offsets[size_t(it - start.begin()) - 1];
+    return true;
+  }
+
+  // Offset in Sekunden zur lokalen Zeit l (Sekunden seit Epoche, als wäre l UTC)
+  bool localOffset(int64_t l, long &off) const {
+    long o1, o2;
+    if (not utcOffset(l, o1) or not utcOffset(l - o1, o2))
+      return false;
+    if (o1 != o2 and (not utcOffset(l - o2, o1) or o1 != o2))
+      return false;
+    // Lücke oder Doppeldeutigkeit bei der Umstellung wie bisher über die libc auflösen
+    int64_t s = l - o2;
+    auto it = std::upper_bound(start.begin(), start.end(), s);
+    if (it != start.end() and *it - s < 86400)
+      return false;
+    if (it - start.begin() > 1 and s - *(it - 1) < 86400)
+      return false;
+    off = o2;
+    return true;
+  }
+
+private:
+  LocalZone() {
+#ifndef __MINGW32__
+    const int64_t step = 7 * 86400; // Umstellungen liegen weiter auseinander
+    int64_t from = 0;
+    int64_t to = daysFromCivil(2100, 1, 1) * 86400;
+    long last;
+    if (not probe(from, last))
+      return;
+    start.push_back(from);
+    offsets.push_back(last);
+    for (int64_t s = from + step; s < to; s += step) {
+      long o;
+      if (not probe(s, o)) {
+        start.clear();
+        offsets.clear();
+        return;
+      }
+      if (o == last)
+        continue;
+      // genauen Zeitpunkt der Umstellung suchen
+      int64_t lo = s - step;
+      int64_t hi = s;
+      while (hi - lo > 1) {
+        int64_t mid = lo + (hi - lo) / 2;
+        long om;
+        if (not probe(mid, om))
+          om = o;
+        if (om == last)
+          lo = mid;
+        else
+          hi = mid;
+      }
+      start.push_back(hi);
+      offsets.push_back(o);
+      last = o;
+    }
+    end = to;
+#endif
+  }
+
+  static bool probe(int64_t s, long &off) {
+#ifdef __MINGW32__
+    return false;
+#else
+    time_t t = time_t(s);
+    struct tm ts{};
+    if (not localtime_r(&t, &ts))
+      return false;
+    off = ts.tm_gmtoff;
+    return true;
+#endif
+  }
+
+  std::vector<int64_t> start; // UTC-Sekunden, ab denen offsets[i] gilt
+  std::vector<long> offsets;
+  int64_t end = 0;
+};
+
+// Offset der lokalen Zeitzone zu UTC in Sekunden
+long localOffset(time_t time) {
+  long gmtoff = 0;
+  if (LocalZone::instance().utcOffset(time, gmtoff))
+    return gmtoff;
+  struct tm ts{};
+#ifdef __MINGW32__
+  localtime_s(&ts, &time);
+  time_t gm = _mkgmtime(&ts);
+  gmtoff = gm - time;
+  if (ts.tm_isdst > 0)
+    gmtoff -= 60 * 60;
+#else
+  localtime_r(&time, &ts);
+  gmtoff = ts.tm_gmtoff;
+#endif
+  return gmtoff;
+}
+
+char *put2(char *p, unsigned v) {
+  *p++ = char('0' + v / 10 % 10);
+  *p++ = char('0' + v % 10);
+  return p;
+}
+
+/* Ausgabe im Format ISO8601 ohne Allokation
+ *
+ * @param buf Puffer mit mindestens 40 Zeichen
+ * @param s Sekunden seit Epoche der auszugebenden (lokalen) Zeit
+ * @param us Mikrosekunden
+ * @param f Fraktion, bis zu der ausgegeben werden soll
+ * @param sep Trenner zwischen Datum und Zeit
+ * @param zone Offset ausgeben
+ * @param gmtoff Offset zu UTC in Sekunden
+ * @return Länge
+ */
+size_t formatTime(char *buf, int64_t s, int us, mobs::MTimeFract f, char sep, bool zone, long gmtoff) {
+  int64_t days = floorDiv(s, 86400);
+  auto sec = unsigned(s - days * 86400);
+  int64_t y;
+  unsigned m, d;
+  civilFromDays(days, y, m, d);
+  char *p = buf;
+  if (y < 0) {
+    *p++ = '-';
+    y = -y;
+  }
+  if (y >= 10000) {
+    char tmp[24];
+    char *t = tmp;
+    for (; y; y /= 10)
+      *t++ = char('0' + y % 10);
+    while (t != tmp)
+      *p++ = *--t;
+  } else {
+    p = put2(p, unsigned(y / 100));
+    p = put2(p, unsigned(y % 100));
+  }
+  if (f >= mobs::MMonth) {
+    *p++ = '-';
+    p = put2(p, m);
+  }
+  if (f >= mobs::MDay) {
+    *p++ = '-';
+    p = put2(p, d);
+  }
+  if (f >= mobs::MHour) {
+    *p++ = sep;
+    p = put2(p, sec / 3600);
+  }
+  if (f >= mobs::MMinute) {
+    *p++ = ':';
+    p = put2(p, sec / 60 % 60);
+  }
+  if (f >= mobs::MSecond) {
+    *p++ = ':';
+    p = put2(p, sec % 60);
+  }
+  if (f >= mobs::MF1) {
+    *p++ = '.';
+    int div = 100000;
+    for (int i = mobs::MF1; i <= f; i++) {
+      *p++ = char('0' + us / div % 10);
+      div /= 10;
+    }
+  }
+  if (zone and f >= mobs::MHour) {
+    if (gmtoff) {
+      *p++ = gmtoff > 0 ? '+' : '-';
+      if (gmtoff < 0)
+        gmtoff = -gmtoff;
+      p = put2(p, unsigned(gmtoff / 3600));
+      *p++ = ':';
+      p = put2(p, unsigned(gmtoff % 3600 / 60));
+    } else
+      *p++ = 'Z';
+  }
+  return size_t(p - buf);
+}
+
 class TimeHelper {
 public:
   struct tm ts{};
@@ -39,8 +268,6 @@ public:
 
   size_t read(const std::string &s, mobs::MTime &t);
 
-
-    private:
   static void parseChar(char c, const char *&cp);
 
   static int parseDigit(const char *&cp);
@@ -49,6 +276,7 @@ public:
 
   static void parseYear(int &y, const char *&cp);
 
+private:
   static int parseOff(const char *&cp);
 
   static int parseMicro(const char *&cp);
@@ -87,31 +315,31 @@ size_t TimeHelper::read(const std::string &s, mobs::MTime &t) {
     }
   }
   ts.tm_isdst = -1;
-  std::time_t ti;
+  if (ts.tm_mon < 0 or ts.tm_mon > 11)
+    return 0;
+  // Sekunden seit Epoche, als wäre die Zeit UTC
+  int64_t l = daysFromCivil(int64_t(ts.tm_year) + 1900, unsigned(ts.tm_mon + 1), unsigned(ts.tm_mday)) * 86400 +
+              ts.tm_hour * 3600 + ts.tm_min * 60 + ts.tm_sec;
+  int64_t ti;
   if (*cp == '-' or *cp == '+' or *cp == 'Z') {
     long off = parseOff(cp);
-#ifdef __MINGW32__
-    ti = _mkgmtime(&ts);
-#else
-    ts.tm_gmtoff = 0;
-    ti = timegm(&ts);
-#endif
-    if (ti == -1)
-      return 0;
-    ti -= off;
+    ti = l - off;
   } else {
+    long off;
+    if (LocalZone::instance().localOffset(l, off))
+      ti = l - off;
+    else {
 #ifdef __MINGW32__
-    ti = mktime(&ts);
+      ti = mktime(&ts);
 #else
-    ti = timelocal(&ts);
+      ti = timelocal(&ts);
 #endif
-    if (ti == -1)
-      return 0;
+      if (ti == -1)
+        return 0;
+    }
   }
 
-  std::chrono::system_clock::time_point tp = std::chrono::system_clock::from_time_t(ti);
-  t = std::chrono::time_point_cast<std::chrono::microseconds>(tp);
-  t += std::chrono::microseconds(micros);
+  t = mobs::MTime(std::chrono::microseconds(ti * 1000000 + micros));
   return cp - s.c_str();
 
 }
@@ -199,34 +427,31 @@ namespace mobs {
 // .time_since_epoch().count() liefert anzahl Ticks (MDays)
 template<>
 bool string2x(const std::string &str, MDate &t) {
-  std::istringstream s(str);
-  std::tm ts = {};
-  s >> std::get_time(&ts, "%Y-%m-%d");
-  if (s.fail())
+  const char *cp = str.c_str();
+  int y, m, d;
+  try {
+    bool neg = *cp == '-';
+    if (neg)
+      cp++;
+    TimeHelper::parseYear(y, cp);
+    if (neg)
+      y = -y;
+    TimeHelper::parseChar('-', cp);
+    TimeHelper::parseInt2(m, cp);
+    TimeHelper::parseChar('-', cp);
+    TimeHelper::parseInt2(d, cp);
+  } catch (std::exception &) {
     return false;
-  ts.tm_isdst = -1;
-#ifdef __MINGW32__
-  std::time_t ti = _mkgmtime(&ts);
-#else
-  std::time_t ti = timegm(&ts);
-#endif
-  std::chrono::system_clock::time_point tp = std::chrono::system_clock::from_time_t(ti);
-  t = std::chrono::time_point_cast<MDays>(tp);
-//  i64 = std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+  }
+  if (m < 1 or m > 12 or d < 1 or d > 31)
+    return false;
+  t = MDate(MDays(daysFromCivil(y, unsigned(m), unsigned(d))));
   return true;
 }
 
 std::string to_string(MDate t) {
-  std::stringstream s;
-  struct tm ts{};
-  time_t time = std::chrono::system_clock::to_time_t(t);
-#ifdef __MINGW32__
-  gmtime_s(&ts, &time);
-#else
-  gmtime_r(&time, &ts);
-#endif
-  s << std::put_time(&ts, "%Y-%m-%d");
-  return s.str();
+  char buf[40];
+  return std::string(buf, formatTime(buf, int64_t(t.time_since_epoch().count()) * 86400, 0, MDay, 'T', false, 0));
 }
 
 std::wstring StrConv<MDate>::c_to_wstring(const MDate &t, const ConvToStrHint &cth) {
@@ -311,94 +536,29 @@ bool to_int64(MDate t, int64_t &i) {
 
 
 std::string to_string_iso8601(MTime t, MTimeFract f) {
-#ifdef __MINGW32__
-  static const char *fmt[] = {"%Y", "%Y-%m", "%Y-%m-%d", "%Y-%m-%dT%H", "%Y-%m-%dT%H:%M", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S",
-                              "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S"};
-#else
-  static const char *fmt[] = {"%Y", "%Y-%m", "%F", "%FT%H", "%FT%H:%M", "%FT%T", "%FT%T", "%FT%T", "%FT%T", "%FT%T",
-                              "%FT%T", "%FT%T"};
-#endif
-  std::stringstream s;
-  struct tm ts{};
   time_t time;
-  long gmtoff = 0;
   int us;
   TimeHelper::split(t, time, us);
-#ifdef __MINGW32__
-  localtime_s(&ts, &time);
-  time_t gm = _mkgmtime(&ts);
-  gmtoff = gm - time;
-  if (ts.tm_isdst > 0)
-    gmtoff -= 60 * 60;
-#else
-  localtime_r(&time, &ts);
-  gmtoff = ts.tm_gmtoff;
-#endif
-  s << std::put_time(&ts, fmt[f]);
-  if (f >= MF1) {
-    for (MTimeFract i = MF6; i > f; i = MTimeFract((int) i - 1))
-      us = us / 10;
-    s << '.' << std::setfill('0') << std::setw(f - MSecond) << us;
-  }
-  if (f >= MHour)
-    s << mobs::timeOffsetToStr(gmtoff);
-  return s.str();
+  long gmtoff = localOffset(time);
+  char buf[40];
+  return std::string(buf, formatTime(buf, int64_t(time) + gmtoff, us, f, 'T', true, gmtoff));
 }
 
 std::string to_string_ansi(MTime t, MTimeFract f) {
-#ifdef __MINGW32__
-  static const char *fmt[] = {"%Y", "%Y-%m", "%Y-%m-%d", "%Y-%m-%d %H", "%Y-%m-%d %H:%M", "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M:%S",
-                              "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M:%S"};
-#else
-  static const char *fmt[] = {"%Y", "%Y-%m", "%F", "%F %H", "%F %H:%M", "%F %T", "%F %T", "%F %T", "%F %T", "%F %T",
-                              "%F %T", "%F %T"};
-#endif
-  std::stringstream s;
-  struct tm ts{};
   time_t time;
   int us;
   TimeHelper::split(t, time, us);
-#ifdef __MINGW32__
-  localtime_s(&ts, &time);
-#else
-  localtime_r(&time, &ts);
-#endif
-  s << std::put_time(&ts, fmt[f]);
-  if (f >= MF1) {
-    for (MTimeFract i = MF6; i > f; i = MTimeFract((int) i - 1))
-      us = us / 10;
-    s << '.' << std::setfill('0') << std::setw(f - MSecond) << us;
-  }
-  return s.str();
+  long gmtoff = localOffset(time);
+  char buf[40];
+  return std::string(buf, formatTime(buf, int64_t(time) + gmtoff, us, f, ' ', false, 0));
 }
 
 std::string to_string_gmt(MTime t, MTimeFract f) {
-#ifdef __MINGW32__
-  static const char *fmt[] = {"%Y", "%Y-%m", "%Y-%m-%d", "%Y-%m-%dT%H", "%Y-%m-%dT%H:%M", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S",
-                              "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M:%S"};
-#else
-  static const char *fmt[] = {"%Y", "%Y-%m", "%F", "%FT%H", "%FT%H:%M", "%FT%T", "%FT%T", "%FT%T", "%FT%T", "%FT%T",
-                              "%FT%T", "%FT%T"};
-#endif
-  std::stringstream s;
-  struct tm ts{};
   time_t time;
   int us;
   TimeHelper::split(t, time, us);
-#ifdef __MINGW32__
-  gmtime_s(&ts, &time);
-#else
-  gmtime_r(&time, &ts);
-#endif
-  s << std::put_time(&ts, fmt[f]);
-  if (f >= MF1) {
-    for (MTimeFract i = MF6; i > f; i = MTimeFract((int) i - 1))
-      us = us / 10;
-    s << '.' << std::setfill('0') << std::setw(f - MSecond) << us;
-  }
-  if (f >= MHour)
-    s << 'Z';
-  return s.str();
+  char buf[40];
+  return std::string(buf, formatTime(buf, int64_t(time), us, f, 'T', true, 0));
 }
 
 
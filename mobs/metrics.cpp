@@ -0,0 +1,528 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "metrics.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+
+namespace {
+
+// 16 Stufen je Zweierpotenz, bis 2^48 ns
+const size_t subBuckets = 16;
+const size_t bucketCount = (48 - 3) * subBuckets;
+
+size_t bucketIndex(uint64_t v) {
+  if (v < subBuckets)
+    return size_t(v);
+  unsigned e = 63u - unsigned(__builtin_clzll(v));
+  size_t i = (e - 3) * subBuckets + ((v >> (e - 4)) & (subBuckets - 1));
+  return std::min(i, bucketCount - 1);
+}
+
+// obere Grenze des Bereichs einer Stufe
+uint64_t bucketValue(size_t i) {
+  if (i < subBuckets)
+    return i;
+  size_t e = i / subBuckets + 3;
+  uint64_t sub = i % subBuckets;
+  return ((subBuckets + sub + 1) << (e - 4)) - 1;
+}
+
+// Quantile aus einem Histogramm bestimmen, q aufsteigend
+void quantiles(const std::vector<uint64_t> &hist, uint64_t max, const double *q, uint64_t **res, size_t n) {
+  uint64_t total = 0;
+  for (auto h:hist)
+    total += h;
+  uint64_t cnt = 0;
+  size_t qi = 0;
+  for (size_t i = 0; i < hist.size() and qi < n; i++) {
+    cnt += hist[i];
+    while (qi < n and cnt and double(cnt) >= q[qi] * double(total))
+      *res[qi++] = std::min(bucketValue(i), max);
+  }
+}
+
+// Werte einer Metrik in einem Thread
+class Cells {
+public:
+  explicit Cells(bool hist) {
+    if (hist)
+      buckets = std::unique_ptr<std::atomic<uint64_t>[]>(new std::atomic<uint64_t>[bucketCount]);
+    clear();
+  }
+  void clear() {
+    count = 0;
+    sum = 0;
+    max = 0;
+    if (buckets)
+      for (size_t i = 0; i < bucketCount; i++)
+        buckets[i] = 0;
+  }
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> max{0};
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+};
+
+// Zellen eines Threads, Index ist die Nummer der Metrik
+struct ThreadCells {
+  std::vector<std::unique_ptr<Cells>> cells;
+  // Stand von reset(), auf den die Zellen zuletzt geleert wurden
+  std::atomic<uint64_t> generation{0};
+};
+
+// Zellen des aktuellen Threads; beim Ende des Threads werden sie in die Summe der beendeten Threads übernommen
+struct LocalCells {
+  ~LocalCells();
+  std::shared_ptr<ThreadCells> cells;
+};
+
+struct MetricInfo {
+  std::string name;
+  bool histogram;
+};
+
+std::atomic<bool> metricsOn{false};
+
+class Registry {
+public:
+  static Registry &instance() {
+    static Registry r;
+    return r;
+  }
+
+  size_t id(const char *name, bool hist) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = ids.find(name);
+    if (it != ids.end())
+      return it->second;
+    size_t i = metrics.size();
+    metrics.push_back(MetricInfo{name, hist});
+    ids[name] = i;
+    return i;
+  }
+
+  Cells &cells(size_t id) {
+    if (not local.cells) {
+      std::lock_guard<std::mutex> guard(mutex);
+      local.cells = std::make_shared<ThreadCells>();
+      local.cells->generation = generation.load();
+      threads.push_back(local.cells);
+    }
+    ThreadCells &t = *local.cells;
+    // reset() leert die Zellen nicht selbst, da nur dieser Thread ohne Sperre schreibt
+    uint64_t g = generation.load(std::memory_order_acquire);
+    if (t.generation.load(std::memory_order_relaxed) != g) {
+      for (auto &c:t.cells)
+        if (c)
+          c->clear();
+      t.generation.store(g, std::memory_order_release);
+    }
+    if (id >= t.cells.size() or not t.cells[id]) {
+      std::lock_guard<std::mutex> guard(mutex);
+      if (id >= t.cells.size())
+        t.cells.resize(id + 1);
+      t.cells[id] = std::unique_ptr<Cells>(new Cells(metrics[id].histogram));
+    }
+    return *t.cells[id];
+  }
+
+  std::vector<mobs::MetricsValue> collect(const std::string *only);
+  void reset();
+  void retire(const std::shared_ptr<ThreadCells> &t);
+
+private:
+  std::mutex mutex;
+  std::map<std::string, size_t> ids;
+  std::vector<MetricInfo> metrics;
+  std::vector<std::shared_ptr<ThreadCells>> threads;
+  // Summe der beendeten Threads, Index ist die Nummer der Metrik
+  std::vector<std::unique_ptr<Cells>> retired;
+  std::atomic<uint64_t> generation{0};
+  static thread_local LocalCells local;
+};
+
+thread_local LocalCells Registry::local;
+
+LocalCells::~LocalCells() {
+  if (cells)
+    Registry::instance().retire(cells);
+}
+
+void addCells(mobs::MetricsValue &v, std::vector<uint64_t> &hist, const Cells &c) {
+  v.count += c.count.load(std::memory_order_relaxed);
+  v.sum += c.sum.load(std::memory_order_relaxed);
+  v.max = std::max(v.max, c.max.load(std::memory_order_relaxed));
+  if (c.buckets)
+    for (size_t i = 0; i < bucketCount; i++)
+      hist[i] += c.buckets[i].load(std::memory_order_relaxed);
+}
+
+std::vector<mobs::MetricsValue> Registry::collect(const std::string *only) {
+  std::vector<mobs::MetricsValue> result;
+  std::vector<uint64_t> hist(bucketCount);
+  std::lock_guard<std::mutex> guard(mutex);
+  uint64_t g = generation.load();
+  for (auto &m:ids) {
+    if (only and *only != m.first)
+      continue;
+    const MetricInfo &info = metrics[m.second];
+    mobs::MetricsValue v;
+    v.name = info.name;
+    v.histogram = info.histogram;
+    std::fill(hist.begin(), hist.end(), 0);
+    for (auto &t:threads) {
+      // Zellen von vor dem letzten reset() gelten als leer
+      if (t->generation.load(std::memory_order_acquire) != g)
+        continue;
+      if (m.second >= t->cells.size() or not t->cells[m.second])
+        continue;
+      addCells(v, hist, *t->cells[m.second]);
+    }
+    if (m.second < retired.size() and retired[m.second])
+      addCells(v, hist, *retired[m.second]);
+    if (v.histogram and v.count) {
+      const double q[] = { 0.5, 0.9, 0.99 };
+      uint64_t *res[] = { &v.p50, &v.p90, &v.p99 };
+      quantiles(hist, v.max, q, res, 3);
+    }
+    result.push_back(std::move(v));
+  }
+  return result;
+}
+
+void Registry::reset() {
+  std::lock_guard<std::mutex> guard(mutex);
+  generation++;
+  retired.clear();
+}
+
+void Registry::retire(const std::shared_ptr<ThreadCells> &t) {
+  std::lock_guard<std::mutex> guard(mutex);
+  threads.erase(std::remove(threads.begin(), threads.end(), t), threads.end());
+  if (t->generation.load() != generation.load())
+    return;
+  if (retired.size() < t->cells.size())
+    retired.resize(t->cells.size());
+  for (size_t i = 0; i < t->cells.size(); i++) {
+    const Cells *c = t->cells[i].get();
+    if (not c)
+      continue;
+    if (not retired[i])
+      retired[i] = std::unique_ptr<Cells>(new Cells(bool(c->buckets)));
+    Cells &r = *retired[i];
+    r.count += c->count.load();
+    r.sum += c->sum.load();
+    if (c->max.load() > r.max.load())
+      r.max = c->max.load();
+    if (c->buckets)
+      for (size_t j = 0; j < bucketCount; j++)
+        r.buckets[j] += c->buckets[j].load();
+  }
+}
+
+// Nummer einer Metrik, je Thread über die Adresse des Namens zwischengespeichert
+size_t metricId(const char *name, bool hist) {
+  static thread_local std::unordered_map<const char *, size_t> cache;
+  auto it = cache.find(name);
+  if (it != cache.end())
+    return it->second;
+  size_t i = Registry::instance().id(name, hist);
+  cache[name] = i;
+  return i;
+}
+
+void writeMicros(std::ostream &s, uint64_t ns) {
+  s << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000;
+}
+
+}
+
+namespace mobs {
+
+void Metrics::enable(bool on) {
+  metricsOn = on;
+}
+
+bool Metrics::enabled() noexcept {
+  return metricsOn.load(std::memory_order_relaxed);
+}
+
+void Metrics::count(const char *name, uint64_t n) {
+  if (not enabled())
+    return;
+  Cells &c = Registry::instance().cells(metricId(name, false));
+  c.count.fetch_add(n, std::memory_order_relaxed);
+}
+
+void Metrics::record(const char *name, std::chrono::nanoseconds latency) {
+  if (not enabled())
+    return;
+  auto ns = uint64_t(std::max(latency.count(), decltype(latency.count())(0)));
+  Cells &c = Registry::instance().cells(metricId(name, true));
+  if (not c.buckets)
+    return; // bereits als Zähler angelegt
+  // nur dieser Thread schreibt, daher genügt load/store
+  c.count.store(c.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  c.sum.store(c.sum.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+  if (ns > c.max.load(std::memory_order_relaxed))
+    c.max.store(ns, std::memory_order_relaxed);
+  auto &b = c.buckets[bucketIndex(ns)];
+  b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+std::vector<MetricsValue> Metrics::values() {
+  return Registry::instance().collect(nullptr);
+}
+
+bool Metrics::value(const std::string &name, MetricsValue &result) {
+  auto v = Registry::instance().collect(&name);
+  if (v.empty())
+    return false;
+  result = v.front();
+  return true;
+}
+
+std::string Metrics::toText() {
+  std::stringstream s;
+  for (auto &v:values()) {
+    s << v.name << " count=" << v.count;
+    if (v.histogram) {
+      s << " mean=";
+      writeMicros(s, v.count ? v.sum / v.count : 0);
+      s << " p50=";
+      writeMicros(s, v.p50);
+      s << " p90=";
+      writeMicros(s, v.p90);
+      s << " p99=";
+      writeMicros(s, v.p99);
+      s << " max=";
+      writeMicros(s, v.max);
+    }
+    s << '\n';
+  }
+  return s.str();
+}
+
+std::string Metrics::toJson() {
+  std::stringstream s;
+  s << '{';
+  bool first = true;
+  for (auto &v:values()) {
+    if (not first)
+      s << ',';
+    first = false;
+    s << '"' << v.name << "\":{\"count\":" << v.count;
+    if (v.histogram) {
+      s << ",\"sum_us\":";
+      writeMicros(s, v.sum);
+      s << ",\"p50_us\":";
+      writeMicros(s, v.p50);
+      s << ",\"p90_us\":";
+      writeMicros(s, v.p90);
+      s << ",\"p99_us\":";
+      writeMicros(s, v.p99);
+      s << ",\"max_us\":";
+      writeMicros(s, v.max);
+    }
+    s << '}';
+  }
+  s << '}';
+  return s.str();
+}
+
+void Metrics::reset() {
+  Registry::instance().reset();
+}
+
+
+class QueryProfilerData {
+public:
+  struct Entry {
+    Entry() : buckets(bucketCount) {}
+    uint64_t count = 0;
+    uint64_t rows = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;
+  };
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+  std::atomic<int64_t> slowNs{0};
+};
+
+QueryProfiler::QueryProfiler(std::chrono::microseconds slowThreshold) {
+  data = std::unique_ptr<QueryProfilerData>(new QueryProfilerData);
+  QueryProfiler::slowThreshold(slowThreshold);
+}
+
+QueryProfiler::~QueryProfiler() = default;
+
+void QueryProfiler::slowThreshold(std::chrono::microseconds threshold) {
+  data->slowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(threshold).count();
+}
+
+void QueryProfiler::record(const std::string &statement, std::chrono::nanoseconds duration, uint64_t rows) {
+  auto ns = uint64_t(std::max(duration.count(), decltype(duration.count())(0)));
+  int64_t slow = data->slowNs;
+  if (slow > 0 and ns >= uint64_t(slow))
+    LOG(LM_WARNING, "SLOW QUERY " << ns / 1000000 << "ms rows=" << rows << ": " << statement);
+  std::string key = normalize(statement);
+  std::lock_guard<std::mutex> guard(data->mutex);
+  auto &e = data->entries[key];
+  e.count++;
+  e.rows += rows;
+  e.sum += ns;
+  e.max = std::max(e.max, ns);
+  e.buckets[bucketIndex(ns)]++;
+}
+
+std::vector<QueryStatistic> QueryProfiler::statistics() const {
+  std::vector<QueryStatistic> result;
+  {
+    std::lock_guard<std::mutex> guard(data->mutex);
+    for (auto &e:data->entries) {
+      QueryStatistic v;
+      v.statement = e.first;
+      v.count = e.second.count;
+      v.rows = e.second.rows;
+      v.sum = e.second.sum;
+      v.max = e.second.max;
+      const double q[] = { 0.5, 0.99 };
+      uint64_t *res[] = { &v.p50, &v.p99 };
+      quantiles(e.second.buckets, v.max, q, res, 2);
+      result.push_back(std::move(v));
+    }
+  }
+  std::sort(result.begin(), result.end(), [](const QueryStatistic &a, const QueryStatistic &b) {
+    return a.sum != b.sum ? a.sum > b.sum : a.statement < b.statement;
+  });
+  return result;
+}
+
+std::string QueryProfiler::toText() const {
+  std::stringstream s;
+  for (auto &v:statistics()) {
+    s << "count=" << v.count << " rows=" << v.rows << " sum=";
+    writeMicros(s, v.sum);
+    s << " p50=";
+    writeMicros(s, v.p50);
+    s << " p99=";
+    writeMicros(s, v.p99);
+    s << " max=";
+    writeMicros(s, v.max);
+    s << ' ' << v.statement << '\n';
+  }
+  return s.str();
+}
+
+void QueryProfiler::reset() {
+  std::lock_guard<std::mutex> guard(data->mutex);
+  data->entries.clear();
+}
+
+std::string QueryProfiler::normalize(const std::string &statement) {
+  std::string res;
+  res.reserve(statement.length());
+  // letztes Zeichen der Ausgabe ohne Leerzeichen
+  auto last = [&res](size_t end) -> size_t {
+    while (end > 0 and std::isspace(static_cast<unsigned char>(res[end - 1])))
+      end--;
+    return end;
+  };
+  // Platzhalter anhängen, Listen "?, ?" zu "?" zusammenfassen
+  auto placeholder = [&res, &last]() {
+    size_t e = last(res.length());
+    if (e > 0 and res[e - 1] == ',') {
+      size_t p = last(e - 1);
+      if (p > 0 and res[p - 1] == '?') {
+        res.resize(p);
+        return;
+      }
+    }
+    res += '?';
+  };
+  auto identChar = [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) or c == '_' or c == '$' or c == '.' or (c & 0x80);
+  };
+  const char *c = statement.c_str();
+  const char *end = c + statement.length();
+  while (c < end) {
+    if (*c == '\'') {
+      for (c++; c < end; c++) {
+        if (*c == '\\' and c + 1 < end)
+          c++;
+        else if (*c == '\'') {
+          if (c + 1 < end and c[1] == '\'')
+            c++;
+          else
+            break;
+        }
+      }
+      if (c < end)
+        c++;
+      placeholder();
+    } else if (*c == '"') {
+      const char *start = c;
+      for (c++; c < end and *c != '"'; c++)
+        if (*c == '\\' and c + 1 < end)
+          c++;
+      if (c < end)
+        c++;
+      const char *n = c;
+      while (n < end and std::isspace(static_cast<unsigned char>(*n)))
+        n++;
+      size_t e = last(res.length());
+      char prev = e > 0 ? res[e - 1] : ' ';
+      if (n < end and *n == ':')
+        res.append(start, c);
+      else if (prev == ':' or prev == '[' or (prev == ',' and last(e - 1) > 0 and res[last(e - 1) - 1] == '?'))
+        placeholder();
+      else
+        res.append(start, c);
+    } else if (*c == '?') {
+      for (c++; c < end and std::isdigit(static_cast<unsigned char>(*c)); c++) {}
+      placeholder();
+    } else if (std::isdigit(static_cast<unsigned char>(*c)) and (res.empty() or not identChar(res.back()))) {
+      for (c++; c < end; c++) {
+        if ((*c == '-' or *c == '+') and (c[-1] == 'e' or c[-1] == 'E'))
+          continue;
+        if (not std::isdigit(static_cast<unsigned char>(*c)) and *c != '.' and *c != 'e' and *c != 'E')
+          break;
+      }
+      placeholder();
+    } else
+      res += *c++;
+  }
+  return res;
+}
+
+}
@@ -0,0 +1,237 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file metrics.h
+ \brief  Zähler und Latenz-Histogramme für Datenbank-, MRPC- und Krypto-Operationen, Query-Profiler */
+
+
+#ifndef MOBS_METRICS_H
+#define MOBS_METRICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace mobs {
+
+/// Auswertung einer Metrik
+struct MetricsValue {
+  std::string name; ///< Name der Metrik
+  uint64_t count = 0; ///< Anzahl der Aufrufe bzw. Summe der Zähler
+  uint64_t sum = 0; ///< Summe der Latenzen in ns
+  uint64_t max = 0; ///< maximale Latenz in ns
+  uint64_t p50 = 0; ///< Median der Latenz in ns
+  uint64_t p90 = 0; ///< 90%-Quantil der Latenz in ns
+  uint64_t p99 = 0; ///< 99%-Quantil der Latenz in ns
+  bool histogram = false; ///< Metrik ist ein Histogramm, ansonsten ein Zähler
+};
+
+/** \brief Registry für Zähler und Latenz-Histogramme
+ *
+ * Die Metriken sind standardmäßig ausgeschaltet; dann kostet jede Messstelle nur die Abfrage von enabled().
+ * Eingeschaltet schreibt jeder Thread ohne Sperre in eigene Zellen, die erst bei der Auswertung zusammengefasst werden.
+ * Beim Ende eines Threads werden seine Zellen in eine gemeinsame Summe übernommen und freigegeben.
+ *
+ * Die Histogramme sind logarithmisch in Stufen von 1/16 einer Zweierpotenz eingeteilt (Genauigkeit ca. 6%).
+ *
+ * Die Bibliothek liefert folgende Metriken:
+ * - db.load, db.save, db.destroy, db.query, db.retrieve, db.commit, db.rollback aus DatabaseInterface und DbTransaction
+ * - sqlite.*, maria.*, mongo.* aus den Datenbank-Verbindungen
+ * - mrpc.parseServer, mrpc.sendSingle aus MrpcEc
+ * - crypt.aes.encrypt, crypt.aes.decrypt, crypt.rsa.encrypt, crypt.rsa.decrypt als Byte-Zähler
+ *
+ * Die Namen der Metriken müssen String-Literale sein bzw. für die Laufzeit des Programmes gültig bleiben.
+ * \code
+ * mobs::Metrics::enable(true);
+ * ...
+ * std::cout << mobs::Metrics::toText();
+ * \endcode
+ */
+class Metrics {
+public:
+  /// Metriken ein- oder ausschalten
+  static void enable(bool on);
+  /// sind Metriken eingeschaltet
+  static bool enabled() noexcept;
+
+  /// Zähler erhöhen
+  static void count(const char *name, uint64_t n = 1);
+  /// Latenz in ein Histogramm eintragen
+  static void record(const char *name, std::chrono::nanoseconds latency);
+
+  /// alle Metriken auswerten, sortiert nach Namen
+  static std::vector<MetricsValue> values();
+  /// eine Metrik auswerten; liefert false, wenn sie nicht existiert
+  static bool value(const std::string &name, MetricsValue &result);
+  /// Ausgabe aller Metriken als Text, eine Zeile je Metrik, Latenzen in µs
+  static std::string toText();
+  /// Ausgabe aller Metriken als JSON, Latenzen in µs
+  static std::string toJson();
+  /// alle Werte auf 0 setzen; die Zellen eines Threads werden bei seinem nächsten Eintrag geleert
+  static void reset();
+};
+
+/** \brief Misst die Laufzeit eines Blocks und trägt sie beim Verlassen in ein Histogramm ein
+ *
+ * \code
+ * MetricsTimer timer("my.operation");
+ * \endcode
+ */
+class MetricsTimer {
+public:
+  /// Konstruktor, startet die Messung, wenn Metriken eingeschaltet sind
+  explicit MetricsTimer(const char *name) : metric(Metrics::enabled() ? name : nullptr) {
+    if (metric)
+      start = std::chrono::steady_clock::now();
+  }
+  ~MetricsTimer() {
+    if (metric)
+      Metrics::record(metric, std::chrono::steady_clock::now() - start);
+  }
+  MetricsTimer(const MetricsTimer &) = delete;
+  MetricsTimer &operator=(const MetricsTimer &) = delete;
+
+private:
+  const char *metric;
+  std::chrono::steady_clock::time_point start;
+};
+
+/// Statistik einer normalisierten Anweisung im QueryProfiler
+struct QueryStatistic {
+  std::string statement; ///< normalisierte Anweisung
+  uint64_t count = 0; ///< Anzahl der Ausführungen
+  uint64_t rows = 0; ///< Summe der gelesenen bzw. geänderten Zeilen
+  uint64_t sum = 0; ///< Summe der Laufzeiten in ns
+  uint64_t max = 0; ///< maximale Laufzeit in ns
+  uint64_t p50 = 0; ///< Median der Laufzeit in ns
+  uint64_t p99 = 0; ///< 99%-Quantil der Laufzeit in ns
+};
+
+class QueryProfilerData;
+
+/** \brief Profiler für die Anweisungen einer oder mehrerer Datenbank-Verbindungen
+ *
+ * Wird der Profiler einer Verbindung mit DatabaseConnection::setQueryProfiler zugewiesen, so wird jede Anweisung
+ * dieser Verbindung mit Laufzeit und Anzahl der Zeilen erfasst. Die Auswertung erfolgt je normalisierter Anweisung,
+ * in der alle Literale durch \c ? ersetzt sind; so werden z.B. die Detail-Abfragen eines N+1-Zugriffs zusammengefasst.
+ *
+ * Bei Cursorn zählt die Laufzeit bis zur ersten Zeile und die der weiteren Fetches, nicht jedoch die Verarbeitung
+ * in der Anwendung; eingetragen wird, sobald der Cursor das Ende erreicht oder zerstört wird.
+ *
+ * Anweisungen, die länger als die Schwelle laufen, werden mit LM_WARNING und Originaltext protokolliert.
+ * Ein Profiler kann von mehreren Verbindungen bzw. Threads gleichzeitig benutzt werden.
+ * \code
+ * auto profiler = std::make_shared<mobs::QueryProfiler>(std::chrono::milliseconds(50));
+ * dbi.getConnection()->setQueryProfiler(profiler);
+ * ...
+ * std::cout << profiler->toText();
+ * \endcode
+ */
+class QueryProfiler {
+public:
+  /// Konstruktor mit Schwelle für das Slow-Query-Log; 0 schaltet das Log ab
+  explicit QueryProfiler(std::chrono::microseconds slowThreshold = std::chrono::milliseconds(100));
+  ~QueryProfiler();
+  QueryProfiler(const QueryProfiler &) = delete;
+  QueryProfiler &operator=(const QueryProfiler &) = delete;
+
+  /// Schwelle für das Slow-Query-Log setzen; 0 schaltet das Log ab
+  void slowThreshold(std::chrono::microseconds threshold);
+  /// Anweisung eintragen
+  void record(const std::string &statement, std::chrono::nanoseconds duration, uint64_t rows);
+  /// Auswertung, sortiert nach Summe der Laufzeiten absteigend
+  std::vector<QueryStatistic> statistics() const;
+  /// Auswertung als Text, eine Zeile je Anweisung, Laufzeiten in µs
+  std::string toText() const;
+  /// alle Einträge löschen
+  void reset();
+
+  /** \brief Anweisung normalisieren
+   *
+   * Zeichenketten in einfachen Hochkommas, Zahlen und Bind-Variablen (\c ?, \c ?001) werden durch \c ? ersetzt,
+   * Listen davon zu einem \c ? zusammengefasst. Zeichenketten in doppelten Hochkommas gelten als Bezeichner, außer
+   * als JSON-Wert nach einem Doppelpunkt oder in einem Array; JSON-Schlüssel bleiben erhalten.
+   */
+  static std::string normalize(const std::string &statement);
+
+private:
+  std::unique_ptr<QueryProfilerData> data;
+};
+
+/** \brief Misst die Laufzeit einer Anweisung für den QueryProfiler
+ *
+ * Ohne Profiler entstehen keine Kosten. Die Messung kann mit stop() und start() unterbrochen werden; eingetragen
+ * wird mit finish() bzw. im Destruktor.
+ */
+class QueryTimer {
+public:
+  /// Konstruktor, startet die Messung, wenn ein Profiler angegeben ist
+  QueryTimer(std::shared_ptr<QueryProfiler> profiler, const std::string &statement) : profiler(std::move(profiler)) {
+    if (this->profiler) {
+      stmt = statement;
+      begin = std::chrono::steady_clock::now();
+    }
+  }
+  ~QueryTimer() { finish(); }
+  QueryTimer(const QueryTimer &) = delete;
+  QueryTimer &operator=(const QueryTimer &) = delete;
+
+  /// ist die Messung aktiv
+  bool active() const { return bool(profiler); }
+  /// Anzahl der Zeilen setzen
+  void rows(uint64_t n) { rowCnt = n; }
+  /// Messung fortsetzen
+  void start() {
+    if (profiler and not running) {
+      begin = std::chrono::steady_clock::now();
+      running = true;
+    }
+  }
+  /// Messung unterbrechen
+  void stop() {
+    if (profiler and running) {
+      elapsed += std::chrono::steady_clock::now() - begin;
+      running = false;
+    }
+  }
+  /// Messung beenden und eintragen
+  void finish() {
+    if (not profiler)
+      return;
+    stop();
+    profiler->record(stmt, elapsed, rowCnt);
+    profiler = nullptr;
+  }
+
+private:
+  std::shared_ptr<QueryProfiler> profiler;
+  std::string stmt;
+  std::chrono::steady_clock::time_point begin;
+  std::chrono::nanoseconds elapsed{0};
+  uint64_t rowCnt = 0;
+  bool running = true;
+};
+
+}
+
+#endif //MOBS_METRICS_H
@@ -30,15 +30,24 @@
 #include "objgen.h"
 #include "unixtime.h"
 #include "helper.h"
+#include "metrics.h"
 #include "querygenerator.h"
+#include "queryprojection.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
 #include <utility>
 #include <vector>
 #include <bsoncxx/json.hpp>
 #include <bsoncxx/builder/stream/document.hpp>
 #include <mongocxx/client.hpp>
+#include <mongocxx/exception/bulk_write_exception.hpp>
+#include <mongocxx/model/write.hpp>
+#include <mongocxx/options/bulk_write.hpp>
 #include <mongocxx/uri.hpp>
 #include <mongocxx/instance.hpp>
 
@@ -159,6 +168,58 @@ private:
   bsoncxx::builder::basic::document doc;
 };
 
+// erzeugt ein Projektions-Dokument aus einer QueryProjection; Unterobjekte und Vektoren werden als Ganzes übernommen
+class BsonProjection : virtual public ObjTravConst {
+public:
+  explicit BsonProjection(const QueryProjection *p) : cth(ConvObjToString().exportAltNames()), scope(p) { names.push(""); }
+
+  bool doObjBeg(const ObjectBase &obj) override
+  {
+    if (obj.hasFeature(mobs::DbDetail))
+      return false;
+    if (names.size() > 1 and scope.selected(obj)) {
+      doc.append(kvp(names.top() + obj.getName(cth), 1));
+      return false;
+    }
+    std::string name = obj.getName(cth);
+    if (not name.empty())
+      name += ".";
+    names.push(names.top() + name);
+    scope.enter(obj);
+    return true;
+  };
+  void doObjEnd(const ObjectBase &obj) override
+  {
+    scope.leave();
+    names.pop();
+  };
+  bool doArrayBeg(const MemBaseVector &vec) override
+  {
+    if (not vec.hasFeature(mobs::DbDetail) and scope.selected(vec))
+      doc.append(kvp(names.top() + vec.getName(cth), 1));
+    return false;
+  };
+  void doArrayEnd(const MemBaseVector &vec) override { };
+  void doMem(const MemberBase &mem) override
+  {
+    if (scope.selected(mem))
+      doc.append(kvp(names.top() + mem.getName(cth), 1));
+  };
+
+  std::string result() {
+    return bsoncxx::to_json(doc.view());
+  }
+  bsoncxx::document::value value() {
+    return doc.extract();
+  }
+
+private:
+  ConvObjToString cth;
+  ProjectionScope scope;
+  std::stack<std::string> names;
+  bsoncxx::builder::basic::document doc;
+};
+
 class BsonOut : virtual public ObjTravConst {
 public:
   class Level {
@@ -956,21 +1017,57 @@ public:
 class Cursor : public virtual mobs::DbCursor {
   friend class mobs::MongoDatabaseConnection;
 public:
-  explicit Cursor(mongocxx::cursor &&c, std::shared_ptr<DatabaseConnection> dbi, std::string dbName, bool keysOnly) :
-          cursor(std::move(c)), it(cursor.begin()), dbCon(std::move(dbi)), databaseName(std::move(dbName)), isKeysOnly(keysOnly) { }
-  ~Cursor() override = default;;
+  explicit Cursor(mongocxx::cursor &&c, std::shared_ptr<DatabaseConnection> dbi, std::string dbName, bool keysOnly,
+                  std::unique_ptr<QueryTimer> qt = nullptr) :
+          cursor(std::move(c)), it(cursor.begin()), dbCon(std::move(dbi)), databaseName(std::move(dbName)),
+          isKeysOnly(keysOnly), timer(std::move(qt)) {
+    if (timer) {
+      timer->stop();
+      if (eof())
+        finishTimer();
+    }
+  }
+  ~Cursor() override {
+    if (timer and not eof())
+      timer->rows(cnt + 1);
+  }
   bool eof() override  { return it == cursor.end(); }
   bool valid() override { return not eof(); }
   bool keysOnly() const override { return isKeysOnly; }
-  void operator++() override { if (eof()) return; it.operator++(); cnt++; }
+  void operator++() override {
+    if (eof()) return;
+    if (timer)
+      timer->start();
+    it.operator++();
+    cnt++;
+    if (timer) {
+      timer->stop();
+      if (eof())
+        finishTimer();
+    }
+  }
 private:
+  void finishTimer() {
+    timer->rows(cnt);
+    timer->finish();
+    timer = nullptr;
+  }
   mongocxx::cursor cursor;
   mongocxx::cursor::iterator it;
   std::shared_ptr<DatabaseConnection> dbCon;  // verhindert das Zerstören der Connection
   std::string databaseName;  // unused
   bool isKeysOnly;
+  std::unique_ptr<QueryTimer> timer; // Messung für den QueryProfiler bis zum Ende des Cursors
 };
 
+// Anweisung für den QueryProfiler, wird nur mit Profiler aufgebaut
+std::string profileStmt(const std::shared_ptr<QueryProfiler> &profiler, const char *op, const std::string &db,
+                        const std::string &collection, const std::string &arg) {
+  if (not profiler)
+    return {};
+  return STRSTR(op << ' ' << db << '.' << collection << ' ' << arg);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 class CountCursor : public virtual mobs::DbCursor {
   friend class mobs::MongoDatabaseConnection;
@@ -998,6 +1095,45 @@ public:
 
 namespace mobs {
 
+/// \private
+class MongoBulkData {
+public:
+  /// Prüfung eines Objektes mit Versionsfeld nach dem Schreiben
+  class Check {
+  public:
+    Check(size_t i, bsoncxx::document::value f, bool e) : index(i), filter(std::move(f)), exists(e) {}
+    size_t index; // Position im Block
+    bsoncxx::document::value filter;
+    bool exists; // Objekt muss nach dem Schreiben existieren bzw. darf nicht mehr existieren
+  };
+  /// Block je Collection
+  class Batch {
+  public:
+    std::vector<mongocxx::model::write_model> models;
+    std::vector<std::string> keys; // Schlüssel je Model für Fehlermeldungen
+    std::set<std::string> uniq;
+    bool ordered = false; // bei mehrfachem Zugriff auf dasselbe Objekt Reihenfolge beibehalten
+    std::map<std::string, Check> checks; // je Schlüssel nur der Endzustand nach dem letzten Zugriff
+    size_t replaces = 0;
+    size_t deletes = 0;
+  };
+
+  Batch &batch(const std::string &db, const std::string &col, const std::string &key) {
+    Batch &b = batches[std::make_pair(db, col)];
+    if (not b.uniq.insert(key).second) {
+      b.ordered = true;
+      // ein späterer Zugriff ersetzt die Prüfung des vorigen
+      b.checks.erase(key);
+    }
+    b.keys.push_back(key);
+    pending++;
+    return b;
+  }
+
+  std::map<std::pair<std::string, std::string>, Batch> batches; // Datenbank, Collection
+  size_t pending = 0;
+};
+
 std::string MongoDatabaseConnection::collectionName(const ObjectBase &obj) {
   MemVarCfg c = obj.hasFeature(ColNameBase);
   if (c)
@@ -1007,10 +1143,113 @@ std::string MongoDatabaseConnection::collectionName(const ObjectBase &obj) {
 
 std::map<std::string, mongocxx::pool> MongoDatabaseConnection::pools;
 
+MongoDatabaseConnection::~MongoDatabaseConnection() {
+  if (bulk and bulk->pending)
+    LOG(LM_ERROR, "MongoDB: " << bulk->pending << " pending writes discarded");
+}
+
 void MongoDatabaseConnection::close() {
   entry = nullptr;
 }
 
+bool MongoDatabaseConnection::bulkActive(const DatabaseInterface &dbi) const {
+  return bulkSize > 0 and currentTransaction and currentTransaction == dbi.getTransaction();
+}
+
+void MongoDatabaseConnection::bulkFlush(TransactionDbInfo *tdb) {
+  if (not bulk or bulk->pending == 0)
+    return;
+  auto mtdb = static_cast<MongoTransactionDbInfo *>(tdb);
+  std::map<std::pair<std::string, std::string>, MongoBulkData::Batch> batches;
+  std::swap(batches, bulk->batches);
+  bulk->pending = 0;
+  open();
+  std::vector<std::string> lockErrors;
+  std::string error;
+  for (auto &b:batches) {
+    auto &batch = b.second;
+    mongocxx::collection col = entry->client()[b.first.first][b.first.second];
+    LOG(LM_DEBUG, "BULK WRITE " << b.first.first << "." << b.first.second << " " << batch.models.size()
+                                << (batch.ordered ? " ordered" : " unordered"));
+    mongocxx::options::bulk_write opt;
+    opt.ordered(batch.ordered);
+    std::set<size_t> failed;
+    bool verify = true;
+    try {
+      MetricsTimer timer("mongo.bulkWrite");
+      QueryTimer qt(queryProfiler(), profileStmt(queryProfiler(), "bulkWrite", b.first.first, b.first.second,
+                                                 std::to_string(batch.models.size())));
+      auto result = mtdb ? col.bulk_write(mtdb->session, batch.models, opt) : col.bulk_write(batch.models, opt);
+      if (not result)
+        THROW(u8"bulk write failed");
+      qt.rows(batch.models.size());
+      LOG(LM_DEBUG, "BULK INSERTED " << result->inserted_count() << " MATCHED " << result->matched_count()
+                                     << " UPSERTED " << result->upserted_count() << " DELETED "
+                                     << result->deleted_count());
+      // nur wenn die Summen nicht passen, müssen die Objekte einzeln geprüft werden
+      // (replaces und deletes zählen alle Models, auch die ohne Versionsfeld)
+      verify = size_t(result->matched_count() + result->upserted_count()) < batch.replaces or
+               size_t(result->deleted_count()) < batch.deletes;
+    } catch (mongocxx::bulk_write_exception &e) {
+      size_t firstError = batch.models.size();
+      auto &raw = e.raw_server_error();
+      if (raw) {
+        auto we = raw->view()["writeErrors"];
+        if (we and we.type() == bsoncxx::type::k_array) {
+          for (auto &i:we.get_array().value) {
+            auto d = i.get_document().view();
+            auto idx = size_t(d["index"].get_int32().value);
+            if (idx >= batch.models.size())
+              continue;
+            failed.insert(idx);
+            firstError = std::min(firstError, idx);
+            if (d["code"] and d["code"].get_int32().value == 11000) // duplicate key
+              lockErrors.push_back(batch.keys[idx]);
+            else {
+              std::string msg;
+              if (d["errmsg"])
+                msg = std::string(d["errmsg"].get_string().value.data(), d["errmsg"].get_string().value.length());
+              error += STRSTR(' ' << batch.keys[idx] << ": " << msg);
+            }
+          }
+        }
+      }
+      if (failed.empty())
+        error += STRSTR(' ' << e.what());
+      // ordered bricht beim ersten Fehler ab
+      if (batch.ordered) {
+        for (size_t i = firstError + 1; i < batch.models.size(); i++) {
+          failed.insert(i);
+          error += STRSTR(' ' << batch.keys[i] << ": not written");
+        }
+      }
+    } catch (std::exception &e) {
+      error += STRSTR(' ' << e.what());
+      continue;
+    }
+    if (not verify)
+      continue;
+    for (auto &i:batch.checks) {
+      auto &c = i.second;
+      if (failed.find(c.index) != failed.end())
+        continue;
+      bool found = bool(mtdb ? col.find_one(mtdb->session, c.filter.view()) : col.find_one(c.filter.view()));
+      if (found != c.exists)
+        lockErrors.push_back(i.first);
+    }
+  }
+  for (auto &k:lockErrors)
+    LOG(LM_ERROR, "MongoDB bulk write optLock " << k);
+  if (not lockErrors.empty()) {
+    std::stringstream str;
+    for (auto &k:lockErrors)
+      str << ' ' << k;
+    throw mobs::optLock_error(LOGSTR(u8"MongoDB bulk write optLock:" << str.str() << error));
+  }
+  if (not error.empty())
+    THROW(u8"MongoDB bulk write failed:" << error);
+}
+
 void MongoDatabaseConnection::open() {
   if (not entry) {
     if (not Entry::inst)
@@ -1031,13 +1270,19 @@ void MongoDatabaseConnection::open() {
 }
 
 bool MongoDatabaseConnection::load(DatabaseInterface &dbi, ObjectBase &obj) {
+  MetricsTimer timer("mongo.load");
+  bulkFlush(dbi.transactionDbInfo());
   open();
   BsonOut bo(mobs::ConvObjToString().exportExtended());
   obj.traverseKey(bo);
   LOG(LM_DEBUG, "LOAD " << dbi.database() << "." << collectionName(obj) << " " << bo.result());
 
   mongocxx::database db = entry->client()[dbi.database()];
+  QueryTimer qt(queryProfiler(), profileStmt(queryProfiler(), "findOne", dbi.database(), collectionName(obj),
+                                             bo.result()));
   auto val = db[collectionName(obj)].find_one(bo.value());
+  qt.rows(val ? 1 : 0);
+  qt.finish();
   if (not val)
     return false;
 
@@ -1067,6 +1312,7 @@ void MongoDatabaseConnection::create(DatabaseInterface &dbi, const ObjectBase &o
 }
 
 void MongoDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj) {
+  MetricsTimer timer("mongo.save");
   open();
   auto mtdb = static_cast<MongoTransactionDbInfo *>(dbi.transactionDbInfo());
 
@@ -1081,22 +1327,55 @@ void MongoDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj
   obj.traverse(bo);
   LOG(LM_DEBUG, "UPDATE " << dbi.database() << "." << collectionName(obj) << " " << bk.result() <<  " TO "
                          << bo.result());
+  if (bulkActive(dbi)) {
+    if (not bulk)
+      bulk = std::unique_ptr<MongoBulkData>(new MongoBulkData);
+    // Eindeutigkeit im Block nur über den Schlüssel ohne Versionsfeld
+    BsonOut bu(mobs::ConvObjToString().exportExtended());
+    obj.traverseKey(bu);
+    auto &b = bulk->batch(dbi.database(), collectionName(obj), bu.result());
+    size_t idx = b.models.size();
+    if (bk.version == 0)
+      b.models.emplace_back(mongocxx::model::insert_one(bo.value()));
+    else {
+      if (bk.version > 0) {
+        // nach dem Schreiben muss das Objekt mit erhöhter Version existieren
+        BsonOut bc(mobs::ConvObjToString().exportExtended());
+        bc.withVersionField = true;
+        bc.increment = true;
+        obj.traverseKey(bc);
+        b.checks.emplace(bu.result(), MongoBulkData::Check(idx, bc.value(), true));
+      }
+      mongocxx::model::replace_one r(bk.value(), bo.value());
+      r.upsert(bk.version < 0);
+      b.models.emplace_back(std::move(r));
+      b.replaces++;
+    }
+    if (bulk->pending >= bulkSize)
+      bulkFlush(mtdb);
+    return;
+  }
   mongocxx::database db = entry->client()[dbi.database()];
 
 //    auto result = db[colName(obj)].update_one(bk.value(), bo.setValue());
 //    mongocxx::options::update u;
 //    u.upsert(create);
   if (bk.version == 0) { // initiale version
+    QueryTimer qt(queryProfiler(), profileStmt(queryProfiler(), "insertOne", dbi.database(), collectionName(obj), ""));
     auto result = db[collectionName(obj)].insert_one(bo.value());
     if (not result)
       THROW(u8"save failed");
+    qt.rows(1);
     auto oid = result->inserted_id();
     LOG(LM_DEBUG, "INSERTED " << oid.get_oid().value.to_string());
   } else { // ohne Versionsfeld (-1) auch upsert erlauben
     auto r_opt = mongocxx::options::replace().upsert(bk.version < 0);
+    QueryTimer qt(queryProfiler(), profileStmt(queryProfiler(), "replaceOne", dbi.database(), collectionName(obj),
+                                               bk.result()));
     auto result = db[collectionName(obj)].replace_one(bk.value(), bo.value(), r_opt);
     if (not result)
       THROW(u8"save failed");
+    qt.rows(uint64_t(result->matched_count()) + (result->upserted_id() ? 1 : 0));
     LOG(LM_DEBUG, "MATCHED " << result->matched_count());
     auto oid = result->upserted_id();
     if (oid)
@@ -1105,6 +1384,7 @@ void MongoDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj
 }
 
 bool MongoDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &obj) {
+  MetricsTimer timer("mongo.destroy");
   open();
 //  DbTransaction *tdb = dbi.getTransaction();
 //  if (tdb) {
@@ -1119,8 +1399,26 @@ bool MongoDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
     THROW(u8"destroy Object version = 0 cannot destroy");
   LOG(LM_DEBUG, "DESTROY " << dbi.database() << "." << collectionName(obj) << " " <<  bo.result());
 
+  if (bulkActive(dbi)) {
+    if (not bulk)
+      bulk = std::unique_ptr<MongoBulkData>(new MongoBulkData);
+    // Eindeutigkeit im Block nur über den Schlüssel ohne Versionsfeld
+    BsonOut bc(mobs::ConvObjToString().exportExtended());
+    obj.traverseKey(bc);
+    auto &b = bulk->batch(dbi.database(), collectionName(obj), bc.result());
+    // nach dem Schreiben darf das Objekt nicht mehr existieren
+    if (bo.version > 0)
+      b.checks.emplace(bc.result(), MongoBulkData::Check(b.models.size(), bc.value(), false));
+    b.models.emplace_back(mongocxx::model::delete_one(bo.value()));
+    b.deletes++;
+    if (bulk->pending >= bulkSize)
+      bulkFlush(mtdb);
+    return true;
+  }
   bool found;
   mongocxx::database db = entry->client()[dbi.database()];
+  QueryTimer qt(queryProfiler(), profileStmt(queryProfiler(), "deleteOne", dbi.database(), collectionName(obj),
+                                             bo.result()));
   if (mtdb) {
     LOG(LM_DEBUG, "drop with session");
     auto result = db[collectionName(obj)].delete_one(mtdb->session, bo.value());
@@ -1133,6 +1431,8 @@ bool MongoDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
       THROW(u8"destroy returns with error");
     found = result->deleted_count() != 0;
   }
+  qt.rows(found ? 1 : 0);
+  qt.finish();
   if (bo.version > 0 and not found)
     THROW(u8"destroy: Object with appropriate version not found");
 
@@ -1140,6 +1440,7 @@ bool MongoDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &
 }
 
 void MongoDatabaseConnection::dropAll(DatabaseInterface &dbi, const ObjectBase &obj) {
+  bulkFlush(dbi.transactionDbInfo());
   open();
   LOG(LM_DEBUG, "DROP COLLECTION " << dbi.database() << "." << collectionName(obj));
 
@@ -1148,6 +1449,7 @@ void MongoDatabaseConnection::dropAll(DatabaseInterface &dbi, const ObjectBase &
 }
 
 void MongoDatabaseConnection::structure(DatabaseInterface &dbi, const ObjectBase &obj) {
+  bulkFlush(dbi.transactionDbInfo());
   open();
   mongocxx::database db = entry->client()[dbi.database()];
   // db.test.createIndex({ id: 1 }, { unique: true })
@@ -1163,6 +1465,8 @@ void MongoDatabaseConnection::structure(DatabaseInterface &dbi, const ObjectBase
 std::shared_ptr<DbCursor>
 MongoDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qbe, const QueryGenerator *query,
                                const QueryOrder *sort) {
+  MetricsTimer timer("mongo.query");
+  bulkFlush(dbi.transactionDbInfo());
   open();
   mongocxx::database db = entry->client()[dbi.database()];
   mongocxx::collection col = db[collectionName(obj)];
@@ -1187,6 +1491,11 @@ MongoDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qbe
     delete o2;
     LOG(LM_DEBUG, "Projection " << collectionName(obj) << " " << bo.result());
     f_opt = f_opt.projection(bo.value());
+  } else if (not dbi.getCountCursor() and dbi.getProjection()) {
+    BsonProjection bp(dbi.getProjection());
+    obj.traverse(bp);
+    LOG(LM_DEBUG, "Projection " << collectionName(obj) << " " << bp.result());
+    f_opt = f_opt.projection(bp.value());
   }
   // Sortierung
   std::string sortLog;
@@ -1211,9 +1520,18 @@ MongoDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qbe
     obj.traverse(bq);
     LOG(LM_DEBUG, "QUERY " << dbi.database() << "." << collectionName(obj) << " " << bq.result() << sortLog);
 
-    if (dbi.getCountCursor())
+    if (dbi.getCountCursor()) {
+      QueryTimer qt(queryProfiler(), profileStmt(queryProfiler(), "count", dbi.database(), collectionName(obj),
+                                                 bq.result()));
+      qt.rows(1);
       return std::make_shared<CountCursor>(col.count_documents(bq.value(), c_opt));
-    return std::make_shared<Cursor>(col.find(bq.value(), f_opt), dbi.getConnection(), dbi.database(), dbi.getKeysOnly());
+    }
+    std::unique_ptr<QueryTimer> qt;
+    if (queryProfiler())
+      qt = std::unique_ptr<QueryTimer>(new QueryTimer(queryProfiler(), profileStmt(queryProfiler(), "find",
+                                                      dbi.database(), collectionName(obj), bq.result() + sortLog)));
+    return std::make_shared<Cursor>(col.find(bq.value(), f_opt), dbi.getConnection(), dbi.database(), dbi.getKeysOnly(),
+                                    std::move(qt));
   }
   MongoQuery qgen(query);
   if (not qgen.lookUp.empty()) {
@@ -1225,9 +1543,18 @@ MongoDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qbe
 
   LOG(LM_DEBUG, "QUERY " << dbi.database() << "." << collectionName(obj) << " " << qgen.result() << "  " << sortLog);
 //    auto doc = bsoncxx::from_json(q); doc.view()
-  if (dbi.getCountCursor())
+  if (dbi.getCountCursor()) {
+    QueryTimer qt(queryProfiler(), profileStmt(queryProfiler(), "count", dbi.database(), collectionName(obj),
+                                               qgen.result()));
+    qt.rows(1);
     return std::make_shared<CountCursor>(col.count_documents(qgen.value(), c_opt));
-  return std::make_shared<Cursor>(col.find(qgen.value(), f_opt), dbi.getConnection(), dbi.database(), dbi.getKeysOnly());
+  }
+  std::unique_ptr<QueryTimer> qt;
+  if (queryProfiler())
+    qt = std::unique_ptr<QueryTimer>(new QueryTimer(queryProfiler(), profileStmt(queryProfiler(), "find",
+                                                    dbi.database(), collectionName(obj), qgen.result() + sortLog)));
+  return std::make_shared<Cursor>(col.find(qgen.value(), f_opt), dbi.getConnection(), dbi.database(), dbi.getKeysOnly(),
+                                  std::move(qt));
 }
 
 void
@@ -1276,6 +1603,10 @@ bool MongoDatabaseConnection::changedReadConcern(mongocxx::read_concern &rc, con
 
 void MongoDatabaseConnection::startTransaction(DatabaseInterface &dbi, DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) {
   open();
+  if (currentTransaction == nullptr)
+    currentTransaction = transaction;
+  else if (currentTransaction != transaction)
+    THROW(u8"MongoDB startTransaction: transaction mismatch");
 //  if (not tdb) {
 //    LOG(LM_DEBUG, "MongoDB startTransaction");
 //    auto mtdb = make_shared<MongoTransactionDbInfo>(entry->client().start_session());
@@ -1284,7 +1615,20 @@ void MongoDatabaseConnection::startTransaction(DatabaseInterface &dbi, DbTransac
 //  }
 }
 
+void MongoDatabaseConnection::prepareTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) {
+  // Fehler beim Schreiben des Blocks führen so über DatabaseManager::execute zum Rollback
+  if (currentTransaction == transaction)
+    bulkFlush(tdb.get());
+}
+
 void MongoDatabaseConnection::endTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) {
+  if (currentTransaction == transaction) {
+    currentTransaction = nullptr;
+    if (bulk and bulk->pending) {
+      LOG(LM_ERROR, "MongoDB: " << bulk->pending << " writes queued after prepare");
+      bulkFlush(tdb.get());
+    }
+  }
   if ((tdb)) {
     LOG(LM_DEBUG, "MongoDB endTransaction");
     auto mtdb = static_pointer_cast<MongoTransactionDbInfo>(tdb);
@@ -1297,6 +1641,14 @@ void MongoDatabaseConnection::endTransaction(DbTransaction *transaction, std::sh
 }
 
 void MongoDatabaseConnection::rollbackTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) {
+  if (currentTransaction == transaction) {
+    currentTransaction = nullptr;
+    if (bulk and bulk->pending) {
+      LOG(LM_DEBUG, "MongoDB rollback " << bulk->pending << " pending writes");
+      bulk->batches.clear();
+      bulk->pending = 0;
+    }
+  }
   if ((tdb)) {
     LOG(LM_DEBUG, "MongoDB rollbackTransaction");
     auto mtdb = static_pointer_cast<MongoTransactionDbInfo>(tdb);
@@ -37,8 +37,17 @@
 
 namespace mobs {
 
+class MongoBulkData;
 
   /** \brief Datenbank-Verbindung zu einer MongoDB.
+   *
+   * Innerhalb einer DbTransaction werden save() und destroy() je Collection gesammelt und als \c bulk_write
+   * geschrieben, sobald die mit setBulkSize() eingestellte Anzahl erreicht ist, spätestens aber vor dem Commit
+   * (prepareTransaction). Vor lesenden Zugriffen über dieselbe Verbindung werden anstehende Schreibzugriffe ebenfalls
+   * geschrieben. Die Fehlerprüfung erfolgt damit erst beim Schreiben des Blocks; Optimistic-Lock-Fehler werden dabei
+   * je Objekt mit dessen Schlüssel gemeldet (mobs::optLock_error) und führen zum Rollback der Transaktion.
+   * Bereits geschriebene Blöcke werden dabei nur zurückgenommen, wenn die Transaktion in einer MongoDB-Session läuft.
+   * Ein destroy() liefert innerhalb der Transaktion immer true.
    *
    * Mongo and MongoDB are registered trademarks of MongoDB, Inc.
    * \see www.mongodb.com
@@ -51,7 +60,7 @@ namespace mobs {
     explicit MongoDatabaseConnection(const ConnectionInformation &connectionInformation);
     /// \private
     MongoDatabaseConnection(const MongoDatabaseConnection &) = delete;
-    ~MongoDatabaseConnection() override = default;
+    ~MongoDatabaseConnection() override;
 
     /// Typ der Datenbank
     std::string connectionType() const override { return u8"Mongo"; }
@@ -78,6 +87,8 @@ namespace mobs {
     /// \private
     void startTransaction(DatabaseInterface &dbi, DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) override;
     /// \private
+    void prepareTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) override;
+    /// \private
     void endTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) override;
     /// \private
     void rollbackTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) override;
@@ -107,7 +118,19 @@ namespace mobs {
     /// Direkt-Zugriff auf die MongoDb
     mongocxx::database getDb(DatabaseInterface &dbi);
 
+    /** \brief Anzahl der innerhalb einer Transaktion gesammelten Schreibzugriffe, ab der ein \c bulk_write erfolgt
+     *
+     * @param size maximale Anzahl; 0 schaltet das Sammeln ab
+     */
+    void setBulkSize(size_t size) { bulkSize = size; }
+
   private:
+    void bulkFlush(TransactionDbInfo *tdb = nullptr);
+    bool bulkActive(const DatabaseInterface &dbi) const;
+    size_t bulkSize = 1000;
+    DbTransaction *currentTransaction = nullptr;
+    std::unique_ptr<MongoBulkData> bulk;
+
     class Entry {
     public:
       explicit Entry(mongocxx::pool &pool);
@@ -27,6 +27,11 @@
 #include "crypt.h"
 #include "mrpcsession.h"
 #include "encdata.h"
+#include "tcpstream.h"
+#include "metrics.h"
+#ifdef USE_ZLIB
+#include "compress.h"
+#endif
 
 
 namespace mobs {
@@ -39,6 +44,7 @@ public:
   MemVar(u_int, sessId);
   MemVar(int, sessionReuseTime, USENULL);
   MemVar(int, sessionKeyValidTime, USENULL);
+  MemVar(std::string, compression, USENULL);
 };
 
 class MrpcSessionAuth : virtual public mobs::ObjectBase {
@@ -50,6 +56,7 @@ public:
   MemVar(std::string, software);
   MemVar(std::string, hostname);
   MemVar(std::vector<u_char>, auth, USENULL);
+  MemVar(std::string, compression, USENULL);
 };
 
 
@@ -73,6 +80,17 @@ public:
 };
 
 
+const char *compressionMethod = "deflate";
+
+// Entschlüsselung passend zum Algorithmus, bei Bedarf mit Dekompression
+CryptBufBase *decryptBuf(const std::string &algorithm, CryptBufBase *cbb) {
+#ifdef USE_ZLIB
+  if (algorithm.compare(0, CryptBufDeflate::prefix().length(), CryptBufDeflate::prefix()) == 0)
+    return new CryptBufDeflate(cbb);
+#endif
+  return cbb;
+}
+
 }
 
 #if 0
@@ -137,10 +155,24 @@ void MrpcEc::encrypt()
     std::vector<u_char> iv;
     iv.resize(mobs::CryptBufAes::iv_size());
     mobs::CryptBufAes::getRand(iv);
-    writer.startEncrypt(new mobs::CryptBufAes(session->sessionKey, iv, "", true));
+    CryptBufBase *cbb = new mobs::CryptBufAes(session->sessionKey, iv, "", true);
+#ifdef USE_ZLIB
+    if (compress)
+      cbb = new CryptBufDeflate(cbb);
+#endif
+    writer.startEncrypt(cbb);
   }
 }
 
+void MrpcEc::setCompression(bool on) {
+#ifdef USE_ZLIB
+  compressionOffered = on;
+#else
+  if (on)
+    LOG(LM_WARNING, "MrpcEc: compression not available");
+#endif
+}
+
 void MrpcEc::stopEncrypt()
 {
   writer.stopEncrypt();
@@ -182,7 +214,7 @@ void MrpcEc::Encrypt(const std::string &algorithm, const ObjectBase *keyInfo,
   }
   if (keyInfo and keyInfo->isNull() and not session->sessionKey.empty()) {
     // TODO state, da nur für Server ??
-    cryptBufp = new mobs::CryptBufAes(session->sessionKey);
+    cryptBufp = decryptBuf(algorithm, new mobs::CryptBufAes(session->sessionKey));
     encrypted = true;
     session->last = time(nullptr);
     return;
@@ -272,7 +304,8 @@ void MrpcEc::Attribute(const std::string &ns, const std::string &element, const
     }
     attachmentLength = s;
     LOG(LM_INFO, "Attachment follows " << s);
-  }
+  } else if (element == "MrpcAttachment" and attribut == "encryption")
+    attachmentPlain = value == L"none";
 }
 
 std::streamsize MrpcEc::getAttachmentLength() const {
@@ -344,6 +377,10 @@ std::istream &MrpcEc::inByteStream(size_t sz)
   // schon jetzt alles wieder zurück
   state = connected;
   attachmentLength = 0;
+  if (attachmentPlain) {
+    attachmentPlain = false;
+    return byteStream(sz);
+  }
   return byteStream(mobs::CryptBufAes::aes_size(sz), new mobs::CryptBufAes(session->sessionKey));
 }
 
@@ -354,6 +391,8 @@ std::ostream &MrpcEc::outByteStream()
   mobs::CryptBufAes::getRand(iv);
   if (not session)
     throw std::runtime_error("session missing");
+  if (plainAttachments)
+    return writer.byteStream("\200");
   return writer.byteStream("\200", new mobs::CryptBufAes(session->sessionKey, iv, "", true));
 }
 
@@ -366,6 +405,48 @@ std::streamsize MrpcEc::closeOutByteStream()
   return s;
 }
 
+std::streamsize MrpcEc::sendAttachment(int fd, int64_t offset, std::streamsize length)
+{
+  std::ostream &out = outByteStream();
+  auto tcp = dynamic_cast<TcpStBuf *>(out.rdbuf());
+  if (plainAttachments and tcp) {
+    // direkt aus der Datei in den Socket
+    if (tcp->sendFile(fd, offset, length) != length)
+      THROW("sendfile failed");
+  } else {
+    std::vector<char> buf(64 * 1024);
+    for (std::streamsize done = 0; done < length;) {
+      auto sz = std::min(std::streamsize(buf.size()), length - done);
+      auto res = ::pread(fd, &buf[0], size_t(sz), off_t(offset + done));
+      if (res <= 0)
+        THROW("read error in attachment " << errno);
+      out.write(&buf[0], res);
+      done += res;
+    }
+  }
+  return closeOutByteStream();
+}
+
+std::streamsize MrpcEc::receiveAttachment(int fd)
+{
+  std::istream &in = inByteStream();
+  std::vector<char> buf(64 * 1024);
+  std::streamsize total = 0;
+  while (in.read(&buf[0], std::streamsize(buf.size())), in.gcount() > 0) {
+    auto sz = in.gcount();
+    for (std::streamsize done = 0; done < sz;) {
+      auto res = ::write(fd, &buf[done], size_t(sz - done));
+      if (res <= 0)
+        THROW("write error in attachment " << errno);
+      done += res;
+    }
+    total += sz;
+  }
+  if (in.bad())
+    THROW("read error in attachment");
+  return total;
+}
+
 
 MrpcEc::MrpcEc(std::istream &inStr, std::ostream &outStr, MrpcSession *mrpcSession, bool nonBlocking) :
     XmlReader(iStr), streambufI(inStr), streambufO(outStr),
@@ -391,11 +472,14 @@ void MrpcEc::xmlOut(const ObjectBase &obj)
 
 void MrpcEc::sendSingle(const ObjectBase &obj, std::streamsize attachmentSize)
 {
+  MetricsTimer timer("mrpc.sendSingle");
   checkAttachmentSize = attachmentSize;
   encrypt();
   if (attachmentSize > 0) {
     writer.writeTagBegin(L"MrpcAttachment");
     writer.writeAttribute(L"size", std::to_wstring(attachmentSize));
+    if (plainAttachments)
+      writer.writeAttribute(L"encryption", L"none");
     writer.writeTagEnd();
   }
   xmlOut(obj);
@@ -413,12 +497,18 @@ void MrpcEc::closeServer()
 
 void MrpcEc::flush()
 {
+  // bei TCP_NODELAY die Ausgabe zurückhalten, bis alles geschrieben ist, damit keine unnötig kleinen Pakete entstehen
+  auto tcp = dynamic_cast<TcpStBuf *>(streambufO.getOstream().rdbuf());
+  bool cork = tcp and tcp->noDelay() and tcp->setCork(true);
   writer.sync();
+  if (cork)
+    tcp->setCork(false);
 }
 
 // Server
 bool MrpcEc::parseServer()
 {
+  MetricsTimer timer("mrpc.parseServer");
   LOG(LM_DEBUG, "parseServer " << static_cast<int>(state));
   if (level() <= 0 and state != fresh and state != closing) {
     writer.writeTagEnd();
@@ -455,8 +545,12 @@ bool MrpcEc::parseServer()
           throw std::runtime_error("login failed");
         }
         LOG(LM_DEBUG, "Send MrpcSessionLoginResult");
-        encrypt();
         MrpcSessionLoginResult answer;
+        if (compressionOffered and sess->compression() == compressionMethod) {
+          compress = true;
+          answer.compression(compressionMethod);
+        }
+        encrypt();
         answer.sessId(session->sessionId);
         answer.sessionKeyValidTime(session->keyValidTime);
         answer.sessionReuseTime(session->sessionReuseTime);
@@ -540,6 +634,7 @@ bool MrpcEc::parseClient()
       session->sessionId = sess->sessId();
       session->sessionReuseTime = sess->sessionReuseTime();
       session->keyValidTime = sess->sessionKeyValidTime();
+      compress = compressionOffered and sess->compression() == compressionMethod;
       state = clientConfirmed;
       resultObj = nullptr;
     }
@@ -645,6 +740,8 @@ void MrpcEc::startSession(const std::string &keyId, const std::string &software,
   loginData.hostname(getNodeName());
   loginData.login(getLoginName());
   loginData.keyId(keyId);
+  if (compressionOffered)
+    loginData.compression(compressionMethod);
   // Zu Bestätigung der Authentizität den Session-Key signieren
   std::vector<u_char> auth;
   digestSign(session->sessionKey, auth, privateKey, passphrase);
@@ -691,6 +788,23 @@ void MrpcEc::setEcdhSessionKey(const std::vector<u_char> &cipher, const std::str
     session->generated = session->last;
 }
 
+bool MrpcEc::resumeSession(MrpcSessionStore &store, const std::vector<u_char> &ephemeralKey, const std::string &keyId) const {
+  if (not session)
+    throw std::runtime_error("session missing");
+  if (not store.get(to_string_base64(ephemeralKey), *session, keyId))
+    return false;
+  session->last = time(nullptr);
+  LOG(LM_INFO, "resume session " << session->sessionId);
+  return true;
+}
+
+void MrpcEc::storeSession(MrpcSessionStore &store, const std::vector<u_char> &ephemeralKey) const {
+  if (not session)
+    throw std::runtime_error("session missing");
+  if (session->sessionReuseTime > 0)
+    store.put(to_string_base64(ephemeralKey), *session);
+}
+
 
 bool MrpcEc::isConnected() const
 {
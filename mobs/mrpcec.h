@@ -109,6 +109,39 @@ public:
   */
   std::streamsize closeOutByteStream();
 
+  /** \brief Attachments unverschlüsselt übertragen
+   *
+   * Ist die Option gesetzt, so wird das Attachment im Klartext gesendet und im Tag MrpcAttachment entsprechend gekennzeichnet;
+   * der Empfänger erkennt dies automatisch. Damit kann, wenn der Ausgabestrom ein mobs::tcpstream ist, die Datei mittels
+   * sendfile direkt vom Kernel versendet werden.
+   *
+   * Achtung: nur verwenden, wenn die Daten nicht vertraulich sind oder die Verbindung anderweitig geschützt ist.
+   * @param on true für unverschlüsselte Attachments
+   */
+  void setPlainAttachments(bool on) { plainAttachments = on; }
+
+  /** \brief Senden eines Attachments direkt aus einer Datei.
+   *
+   * Wird im Anschluss nach sendSingle() anstelle von outByteStream() und closeOutByteStream() verwendet.
+   * Bei unverschlüsselten Attachments über einen mobs::tcpstream wird die Datei ohne Umkopieren mittels sendfile
+   * versendet, ansonsten blockweise über outByteStream().
+   * @param fd File-Deskriptor der Datei
+   * @param offset Startposition in der Datei
+   * @param length Anzahl der zu sendenden Bytes
+   * @return Anzahl der übertragenen Bytes
+   * \throws std::runtime_error wenn die angegebene Größe nicht der tatsächlichen entspricht oder ein Lesefehler auftritt
+   */
+  std::streamsize sendAttachment(int fd, int64_t offset, std::streamsize length);
+
+  /** \brief Empfangen eines Attachments direkt in eine Datei.
+   *
+   * Anstelle von inByteStream() zu verwenden; es werden getAttachmentLength() Bytes gelesen.
+   * @param fd File-Deskriptor der Ausgabedatei
+   * @return Anzahl der geschriebenen Bytes
+   * \throws std::runtime_error bei Schreib- oder Lesefehler
+   */
+  std::streamsize receiveAttachment(int fd);
+
 
   /** \brief Arbeitsroutine des Clients
   *
@@ -193,11 +226,46 @@ public:
    */
   void setEcdhSessionKey(const std::vector<u_char> &ephemeralKey, const std::string &privateKey, const std::string &passwd) const;
 
+  /** \brief Session aus einem Session-Store wiederaufnehmen (für Server).
+   *
+   * Kann im Callback loginReceived verwendet werden, um den Schlüsselaustausch bei einem Reconnect zu überspringen.
+   * @param store Session-Store des Servers
+   * @param ephemeralKey ephemerer Schlüssel der Client-Message
+   * @param keyId id zum public key des Senders oder leer
+   * @return true, wenn eine gültige Session gefunden und übernommen wurde
+   */
+  bool resumeSession(MrpcSessionStore &store, const std::vector<u_char> &ephemeralKey, const std::string &keyId) const;
+
+  /** \brief aktuelle Session im Session-Store ablegen (für Server).
+   *
+   * @param store Session-Store des Servers
+   * @param ephemeralKey ephemerer Schlüssel der Client-Message
+   */
+  void storeSession(MrpcSessionStore &store, const std::vector<u_char> &ephemeralKey) const;
+
 
   /// senden eines Objektes ohne flush()
   void xmlOut(const mobs::ObjectBase &obj);
-  /// senden der write-Buffers
+  /** \brief senden der write-Buffers
+   *
+   * Ist der Ausgabestrom ein mobs::tcpstream mit gesetztem TCP_NODELAY, so wird die Ausgabe während des Schreibens
+   * zurückgehalten (TCP_CORK), damit sie in möglichst wenigen Paketen versendet wird.
+   */
   void flush();
+  /** \brief Kompression der verschlüsselten Daten anbieten (Client) bzw. zulassen (Server)
+   *
+   * Muss vor startSession() bzw. vor dem Login gesetzt werden. Unterstützen beide Seiten die Kompression, so werden
+   * die Daten vor der Verschlüsselung mit deflate komprimiert. Attachments werden nicht komprimiert.
+   * Ohne zlib bleibt der Aufruf wirkungslos.
+   *
+   * \warning Die Länge der komprimierten und verschlüsselten Blöcke lässt Rückschlüsse auf den Inhalt zu
+   * (vgl. CRIME/BREACH). Nur einschalten, wenn ein Angreifer keine eigenen Daten in dieselben Blöcke wie
+   * vertrauliche Daten einschleusen kann. Die Vorgabe ist daher ausgeschaltet.
+   * @param on Kompression erlauben
+   */
+  void setCompression(bool on);
+  /// Rückgabe, ob die Kompression ausgehandelt wurde
+  bool isCompressed() const { return compress; }
   /// Rückgabe, ob das zuletzt ausgewertete Objekt verschlüsselt war
   bool isEncrypted() const { return  encrypted; }
 
@@ -271,6 +339,10 @@ private:
   State state = fresh;
   std::streamsize attachmentLength = 0; // Größe des Attachments das empfangen werden soll
   std::streamsize checkAttachmentSize = 0; // Größe des Attachments während des Sendens
+  bool plainAttachments = false; // Attachments unverschlüsselt senden
+  bool compressionOffered = false; // Kompression anbieten bzw. zulassen
+  bool compress = false; // ausgehende Daten komprimieren
+  bool attachmentPlain = false; // das zu empfangende Attachment ist unverschlüsselt
 
 };
 
@@ -0,0 +1,240 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mrpcsession.h"
+#include "objgen.h"
+#include "logging.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace mobs {
+
+namespace {
+class MrpcStoredSession : virtual public mobs::ObjectBase {
+public:
+  ObjInit(MrpcStoredSession);
+
+  MemVar(std::string, key);
+  MemVar(std::vector<u_char>, sessionKey);
+  MemVar(std::string, keyName);
+  MemVar(u_int, sessionId);
+  MemVar(long int, last);
+  MemVar(long int, generated);
+  MemVar(std::string, info);
+  MemVar(int, sessionReuseTime);
+  MemVar(int, keyValidTime);
+};
+
+bool usable(const MrpcSession &session) {
+  return not session.expired() and not session.keyNeedsRefresh();
+}
+
+}
+
+class MrpcSessionStoreData {
+public:
+  class Stripe {
+  public:
+    std::mutex mutex;
+    std::map<std::string, MrpcSession> sessions;
+  };
+
+  MrpcSessionStoreData(std::string file, size_t n) : persistFile(std::move(file)), stripes(n ? n : 1) {}
+
+  Stripe &stripe(const std::string &key) { return stripes[std::hash<std::string>{}(key) % stripes.size()]; }
+
+  std::string persistFile;
+  std::vector<Stripe> stripes;
+  std::mutex saveMutex;
+};
+
+
+MrpcSessionStore::MrpcSessionStore(const std::string &persistFile, size_t stripes) :
+    data(new MrpcSessionStoreData(persistFile, stripes)) {
+  if (not data->persistFile.empty())
+    load();
+}
+
+MrpcSessionStore::~MrpcSessionStore() {
+  if (data->persistFile.empty())
+    return;
+  try {
+    save();
+  } catch (std::exception &e) {
+    LOG(LM_ERROR, "MrpcSessionStore: " << e.what());
+  }
+}
+
+void MrpcSessionStore::put(const std::string &key, const MrpcSession &session) {
+  auto &s = data->stripe(key);
+  std::lock_guard<std::mutex> guard(s.mutex);
+  s.sessions[key] = session;
+}
+
+bool MrpcSessionStore::get(const std::string &key, MrpcSession &session, const std::string &keyName) {
+  auto &s = data->stripe(key);
+  std::lock_guard<std::mutex> guard(s.mutex);
+  auto it = s.sessions.find(key);
+  if (it == s.sessions.end())
+    return false;
+  if (not usable(it->second)) {
+    LOG(LM_DEBUG, "MrpcSessionStore: drop expired session " << it->second.sessionId);
+    s.sessions.erase(it);
+    return false;
+  }
+  if (not keyName.empty() and keyName != it->second.keyName)
+    return false;
+  session = it->second;
+  return true;
+}
+
+void MrpcSessionStore::erase(const std::string &key) {
+  auto &s = data->stripe(key);
+  std::lock_guard<std::mutex> guard(s.mutex);
+  s.sessions.erase(key);
+}
+
+size_t MrpcSessionStore::cleanup() {
+  size_t cnt = 0;
+  for (auto &s:data->stripes) {
+    std::lock_guard<std::mutex> guard(s.mutex);
+    for (auto it = s.sessions.begin(); it != s.sessions.end();) {
+      if (usable(it->second))
+        it++;
+      else {
+        LOG(LM_DEBUG, "MrpcSessionStore: erase old session " << it->second.sessionId);
+        it = s.sessions.erase(it);
+      }
+    }
+    cnt += s.sessions.size();
+  }
+  return cnt;
+}
+
+size_t MrpcSessionStore::size() const {
+  size_t cnt = 0;
+  for (auto &s:data->stripes) {
+    std::lock_guard<std::mutex> guard(s.mutex);
+    cnt += s.sessions.size();
+  }
+  return cnt;
+}
+
+void MrpcSessionStore::save() const {
+  if (data->persistFile.empty())
+    return;
+  std::lock_guard<std::mutex> saveGuard(data->saveMutex);
+  std::string out;
+  size_t cnt = 0;
+  for (auto &s:data->stripes) {
+    std::lock_guard<std::mutex> guard(s.mutex);
+    for (auto &i:s.sessions) {
+      const MrpcSession &session = i.second;
+      if (not usable(session))
+        continue;
+      MrpcStoredSession st;
+      st.key(i.first);
+      st.sessionKey(session.sessionKey);
+      st.keyName(session.keyName);
+      st.sessionId(session.sessionId);
+      st.last(session.last);
+      st.generated(session.generated);
+      st.info(session.info);
+      st.sessionReuseTime(session.sessionReuseTime);
+      st.keyValidTime(session.keyValidTime);
+      out += st.to_string();
+      out += '\n';
+      cnt++;
+    }
+  }
+  std::string tmp = data->persistFile + ".tmp";
+  // Reste eines abgebrochenen Laufs entfernen; die Datei wird exklusiv neu angelegt, damit keine fremde Datei
+  // oder ein symbolischer Link beschrieben wird. Sie enthält die Session-Keys, daher nur für den Besitzer lesbar.
+  ::unlink(tmp.c_str());
+  int fd = ::open(tmp.c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (fd < 0)
+    THROW("can't write session file " << tmp << ": " << strerror(errno));
+  const char *p = out.c_str();
+  size_t left = out.length();
+  while (left) {
+    ssize_t n = ::write(fd, p, left);
+    if (n < 0 and errno == EINTR)
+      continue;
+    if (n <= 0) {
+      int err = errno;
+      ::close(fd);
+      ::unlink(tmp.c_str());
+      THROW("error writing session file " << tmp << ": " << strerror(err));
+    }
+    p += n;
+    left -= size_t(n);
+  }
+  if (::fsync(fd) or ::close(fd)) {
+    ::unlink(tmp.c_str());
+    THROW("error writing session file " << tmp << ": " << strerror(errno));
+  }
+  if (::rename(tmp.c_str(), data->persistFile.c_str()))
+    THROW("can't rename session file " << tmp);
+  LOG(LM_INFO, "MrpcSessionStore: " << cnt << " sessions saved");
+}
+
+void MrpcSessionStore::load() {
+  std::ifstream in(data->persistFile);
+  if (not in.is_open())
+    return;
+  size_t cnt = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty())
+      continue;
+    MrpcStoredSession st;
+    try {
+      string2Obj(line, st);
+    } catch (std::exception &e) {
+      LOG(LM_ERROR, "MrpcSessionStore: invalid entry in " << data->persistFile << ": " << e.what());
+      continue;
+    }
+    MrpcSession session;
+    session.sessionKey = st.sessionKey();
+    session.keyName = st.keyName();
+    session.sessionId = st.sessionId();
+    session.last = st.last();
+    session.generated = st.generated();
+    session.info = st.info();
+    session.sessionReuseTime = st.sessionReuseTime();
+    session.keyValidTime = st.keyValidTime();
+    if (not usable(session))
+      continue;
+    put(st.key(), session);
+    cnt++;
+  }
+  LOG(LM_INFO, "MrpcSessionStore: " << cnt << " sessions loaded");
+}
+
+} // mobs
@@ -26,7 +26,9 @@
 #define MOBS_MRPCSESSION_H
 
 
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace mobs {
 
@@ -66,5 +68,66 @@ public:
   int keyValidTime = 0; ///< Zeit in Sekunden, die der sessionKey seit Erzeugung gültig ist wenn > 0; muss im Server gesetzt werden, im Client wird sie automatisch verwaltet
 };
 
+class MrpcSessionStoreData;
+
+/** \brief Thread-sicherer Speicher für wiederverwendbare Sessions eines Servers
+ *
+ * Ermöglicht Clients nach einem Verbindungsabbruch die Wiederaufnahme einer Session ohne erneuten Schlüsselaustausch.
+ * Als Schlüssel dient üblicherweise der ephemere Schlüssel (Cipher) des Clients, siehe MrpcEc::resumeSession.
+ * Der Speicher ist in mehrere, einzeln gesperrte Bereiche aufgeteilt, um Kollisionen paralleler Server-Threads zu vermeiden.
+ *
+ * Abgelaufene Sessions (MrpcSession::expired) oder solche, deren Schlüssel erneuert werden muss
+ * (MrpcSession::keyNeedsRefresh), werden nicht mehr geliefert.
+ *
+ * Optional wird der Inhalt in einer lokalen Datei gesichert, so dass Sessions einen Neustart des Servers überdauern.
+ * Die Datei enthält die Session-Keys und wird daher nur für den Besitzer lesbar angelegt.
+ */
+class MrpcSessionStore {
+public:
+  /** \brief Konstruktor
+   *
+   * @param persistFile Dateiname für die Sicherung; ist er gesetzt, wird die Datei beim Erzeugen gelesen und im Destruktor geschrieben
+   * @param stripes Anzahl der einzeln gesperrten Bereiche
+   */
+  explicit MrpcSessionStore(const std::string &persistFile = "", size_t stripes = 16);
+  ~MrpcSessionStore();
+  MrpcSessionStore(const MrpcSessionStore &) = delete;
+  MrpcSessionStore &operator=(const MrpcSessionStore &) = delete;
+
+  /** \brief Session ablegen oder ersetzen
+   *
+   * @param key Schlüssel der Session
+   * @param session Session-Info
+   */
+  void put(const std::string &key, const MrpcSession &session);
+  /** \brief Session suchen
+   *
+   * Abgelaufene Sessions werden dabei entfernt
+   * @param key Schlüssel der Session
+   * @param session wird bei Erfolg mit der gespeicherten Session-Info belegt
+   * @param keyName ist er nicht leer, muss er mit dem keyName der Session übereinstimmen
+   * @return true, wenn eine gültige Session gefunden wurde
+   */
+  bool get(const std::string &key, MrpcSession &session, const std::string &keyName = "");
+  /// Session entfernen
+  void erase(const std::string &key);
+  /** \brief abgelaufene Sessions entfernen
+   *
+   * @return Anzahl der verbliebenen Sessions
+   */
+  size_t cleanup();
+  /// Anzahl der gespeicherten Sessions
+  size_t size() const;
+  /** \brief gültige Sessions in die beim Konstruktor angegebene Datei sichern
+   *
+   * \throw std::runtime_error wenn die Datei nicht geschrieben werden kann
+   */
+  void save() const;
+
+private:
+  void load();
+  std::unique_ptr<MrpcSessionStoreData> data;
+};
+
 }
 #endif //MOBS_MRPCSESSION_H
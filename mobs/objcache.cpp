@@ -22,6 +22,7 @@
 
 #include "objcache.h"
 #include "lrucache.h"
+#include "querygenerator.h"
 
 
 namespace mobs {
@@ -65,6 +66,16 @@ size_t ObjCache::reduce(size_t n) {
   return data->cache.reduceCount(n);
 }
 
+std::vector<std::shared_ptr<const ObjectBase>> ObjCache::select(const QueryPredicate &pred) const {
+  std::vector<std::shared_ptr<const ObjectBase>> result;
+  std::string name = pred.objectName();
+  data->cache.forEach([&result, &pred, &name](const std::shared_ptr<const ObjectBase> &p) {
+    if (p and p->getObjectName() == name and pred(*p))
+      result.push_back(p);
+  });
+  return result;
+}
+
 ObjCache::ObjCache() {
   data = new ObjCacheData;
 }
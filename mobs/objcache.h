@@ -27,10 +27,12 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace mobs {
 
 class ObjCacheData;
+class QueryPredicate;
 /** \brief Klasse zum cachen von Objekten die von mobs::ObjectBase abgeleitet sind
  *
  * In den Objekten muss mindestens ein KEYELEMENT definiert sein.
@@ -121,6 +123,13 @@ public:
     * @return tatsächliche Größe des Caches
     */
   size_t reduce(size_t n);
+  /** \brief sucht alle Objekte im Cache, die einem Filter entsprechen
+   *
+   * Es werden nur Objekte vom Typ QueryPredicate::objectName() geprüft; die Reihenfolge entspricht den Schlüsseln
+   * @param pred übersetzter Filter, \see QueryGenerator::compile
+   * @return Liste der gefundenen Objekte
+   */
+  std::vector<std::shared_ptr<const ObjectBase>> select(const QueryPredicate &pred) const;
   /** \brief escape-Function, die ':' und '\\' für die Suche escaped
    *
    * @param key Key-Value
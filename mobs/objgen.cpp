@@ -24,6 +24,7 @@
 #include "converter.h"
 #include "csb.h"
 #include "objcache.h"
+#include <algorithm>
 #include <map>
 #include <mutex>
 
@@ -406,6 +407,50 @@ MemBaseVector * ObjectBase::getMemVec(const std::string &name, const ConvObjFrom
   return nullptr;
 }
 
+std::vector<size_t> ObjectBase::memberPosition(const MemberBase &mem) const {
+  std::vector<size_t> pos;
+  if (mem.getParentVector())
+    return {};
+  const void *elem = &mem;
+  const ObjectBase *o = mem.getParentObject();
+  for (;;) {
+    if (not o)
+      return {};
+    size_t i = 0;
+    for (; i < o->mlist.size(); i++)
+      if (o->mlist[i].mem == elem or o->mlist[i].obj == elem)
+        break;
+    if (i >= o->mlist.size())
+      return {};
+    pos.push_back(i);
+    if (o == this)
+      break;
+    if (o->m_parVec)
+      return {};
+    elem = o;
+    o = o->m_parent;
+  }
+  std::reverse(pos.begin(), pos.end());
+  return pos;
+}
+
+const MemberBase *ObjectBase::memberAt(const std::vector<size_t> &pos, bool &inNull) const {
+  const ObjectBase *o = this;
+  inNull = false;
+  for (size_t i = 0; i < pos.size(); i++) {
+    if (pos[i] >= o->mlist.size())
+      return nullptr;
+    inNull = inNull or o->isNull();
+    const MlistInfo &m = o->mlist[pos[i]];
+    if (i + 1 == pos.size())
+      return m.mem;
+    o = m.obj;
+    if (not o)
+      return nullptr;
+  }
+  return nullptr;
+}
+
 void ObjectBase::regObject(const char *n, ObjectBase *fun(ObjectBase *)) noexcept
 {
   if (ObjectBase_Reg_createMap == nullptr)
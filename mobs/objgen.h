@@ -742,6 +742,21 @@ public:
   void regArray(MemBaseVector *vec);
   /// \private
   void rebuildFindMap();
+  /** \brief Position einer Membervariablen ab diesem Objekt
+   *
+   * Liefert je Ebene den Index in der Element-Liste; damit kann dieselbe Variable in anderen Objekten gleichen Typs
+   * ohne Traversierung über memberAt() gefunden werden.
+   * @param mem Membervariable dieses Objektes oder eines Unterobjektes
+   * @return Position oder leer, wenn \c mem nicht zu diesem Objekt gehört oder in einem Vektor liegt
+   */
+  std::vector<size_t> memberPosition(const MemberBase &mem) const;
+  /** \brief Membervariable an einer Position aus memberPosition()
+   *
+   * @param pos Position
+   * @param inNull wird gesetzt, wenn dieses Objekt oder ein Unterobjekt auf dem Weg null ist
+   * @return Membervariable oder nullptr bei ungültiger Position
+   */
+  const MemberBase *memberAt(const std::vector<size_t> &pos, bool &inNull) const;
 
 
 protected:
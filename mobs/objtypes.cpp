@@ -21,6 +21,7 @@
 #include "objgen.h"
 #include "objtypes.h"
 #include "mchrono.h"
+#include "converter.h"
 
 #include <codecvt>
 #include <locale>
@@ -36,13 +37,23 @@ using namespace std;
 namespace mobs {
 
 std::wstring to_wstring(const std::string &val) {
-  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> c;
-  return c.from_bytes(val);
+  std::wstring result;
+  size_t pos = utf8_decode(val.c_str(), val.length(), result);
+  if (pos < val.length()) { // Fehlerbehandlung wie bisher
+    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> c;
+    result += c.from_bytes(val.c_str() + pos, val.c_str() + val.length());
+  }
+  return result;
 }
 
 std::u32string to_u32string(std::string val) {
-  std::wstring_convert<std::codecvt_utf8<char32_t>,char32_t> c;
-  return c.from_bytes(val);
+  std::u32string result;
+  size_t pos = utf8_decode(val.c_str(), val.length(), result);
+  if (pos < val.length()) {
+    std::wstring_convert<std::codecvt_utf8<char32_t>,char32_t> c;
+    result += c.from_bytes(val.c_str() + pos, val.c_str() + val.length());
+  }
+  return result;
 }
 
 // alle möglichen Escapes in JSON (nach RFC 8259)
@@ -207,8 +218,7 @@ bool string2x(const std::string &str, bool &t) {
 
 template<>
 bool string2x(const std::string &str, u32string &t) {
-  std::wstring_convert<std::codecvt_utf8<char32_t>,char32_t> c;
-  t = c.from_bytes(str);
+  t = to_u32string(str);
   return true;
 }
 
@@ -221,8 +231,7 @@ bool string2x(const std::string &str, u16string &t) {
 
 template<>
 bool string2x(const std::string &str, wstring &t) {
-  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> c;
-  t = c.from_bytes(str);
+  t = to_wstring(str);
   return true;
 }
 
@@ -243,8 +252,13 @@ bool wstring2x(const std::wstring &wstr, std::u16string &t) {
 
 
 std::string to_string(std::u32string t) {
-  std::wstring_convert<std::codecvt_utf8<char32_t>,char32_t> c;
-  return c.to_bytes(t);
+  std::string result;
+  size_t pos = utf8_encode(t.c_str(), t.length(), result);
+  if (pos < t.length()) { // Fehlerbehandlung wie bisher
+    std::wstring_convert<std::codecvt_utf8<char32_t>,char32_t> c;
+    result += c.to_bytes(t.c_str() + pos, t.c_str() + t.length());
+  }
+  return result;
 }
 
 std::string to_string(std::u16string t) {
@@ -253,8 +267,13 @@ std::string to_string(std::u16string t) {
 }
 
 std::string to_string(std::wstring t) {
-  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> c;
-  return c.to_bytes(t);
+  std::string result;
+  size_t pos = utf8_encode(t.c_str(), t.length(), result);
+  if (pos < t.length()) {
+    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> c;
+    result += c.to_bytes(t.c_str() + pos, t.c_str() + t.length());
+  }
+  return result;
 }
 
 std::string to_string(float t) {
@@ -21,6 +21,7 @@
 
 
 #include "querygenerator.h"
+#include "queryorder.h"
 #include "logging.h"
 #include "converter.h"
 #include "helper.h"
@@ -29,6 +30,8 @@
 #include <stack>
 #include <sstream>
 #include <cstring>
+#include <map>
+#include <regex>
 
 namespace mobs {
 
@@ -118,6 +121,67 @@ void QueryGenerator::add(const MobsMemberInfoDb &mi) {
   query.emplace_back(mi);
 }
 
+void QueryGenerator::addValue(const MemberBase &mem) {
+  if (mem.isNull())
+    THROW("query value " << mem.getElementName() << " is null");
+  // analog Member::Qi
+  MobsMemberInfo mi;
+  mem.memInfo(mi);
+  if (mi.isNumber())
+    query.emplace_back(MobsMemberInfoDb(mi));
+  else
+    query.emplace_back(MobsMemberInfoDb(mem.toStr(ConvToStrHint(mem.hasFeature(mobs::DbCompact)))));
+}
+
+void QueryGenerator::addKeysetAfter(const QueryOrder &sort) {
+  auto members = sort.members();
+  if (members.empty())
+    THROW("keyset pagination needs a sort order");
+  bool wrap = not query.empty();
+  if (wrap)
+    query.emplace_front(AndBegin);
+  if (members.size() > 1)
+    add(OrBegin);
+  for (size_t i = 0; i < members.size(); i++) {
+    if (i > 0)
+      add(AndBegin);
+    for (size_t j = 0; j < i; j++) {
+      add(*members[j].first);
+      add(Equal);
+      addValue(*members[j].first);
+    }
+    add(*members[i].first);
+    add(members[i].second < 0 ? Less : Grater);
+    addValue(*members[i].first);
+    if (i > 0)
+      add(AndEnd);
+  }
+  if (members.size() > 1)
+    add(OrEnd);
+  if (wrap)
+    add(AndEnd);
+}
+
+void QueryGenerator::addRange(const MemberBase &mem, const MemberBase *lower, const MemberBase *upper) {
+  if (not lower and not upper)
+    return;
+  bool wrap = not query.empty();
+  if (wrap)
+    query.emplace_front(AndBegin);
+  if (lower) {
+    add(mem);
+    add(GraterEqual);
+    addValue(*lower);
+  }
+  if (upper) {
+    add(mem);
+    add(Less);
+    addValue(*upper);
+  }
+  if (wrap)
+    add(AndEnd);
+}
+
 
 std::string QueryGenerator::show(const std::map<const MemberBase *, std::string> &lookUp, SQLDBdescription *sqd) const {
   std::stringstream res;
@@ -373,6 +437,302 @@ void QueryGenerator::addOp(const char *op) {
 }
 
 
+}
+
+namespace {
+using namespace mobs;
+
+// die im Filter benutzten Membervariablen eines Objektes
+struct MemberValues {
+  std::vector<const MemberBase *> members;
+  std::vector<bool> nulls;
+};
+
+// dreiwertige Logik wie in SQL
+enum Tristate { TFalse, TTrue, TUnknown };
+
+double toDouble(const MobsMemberInfo &mi) {
+  if (mi.isFloat)
+    return mi.d;
+  if (mi.isTime)
+    return double(mi.t64);
+  if (mi.isSigned)
+    return double(mi.i64);
+  return double(mi.u64);
+}
+
+// -1, 0, 1
+int compareInfo(const MobsMemberInfo &a, const MobsMemberInfo &b) {
+  if (a.isFloat or b.isFloat) {
+    double x = toDouble(a);
+    double y = toDouble(b);
+    return x < y ? -1 : x > y ? 1 : 0;
+  }
+  if (a.isTime or b.isTime) {
+    int64_t x = a.isTime ? a.t64 : a.i64;
+    int64_t y = b.isTime ? b.t64 : b.i64;
+    return x < y ? -1 : x > y ? 1 : 0;
+  }
+  if (a.isSigned and b.isSigned)
+    return a.i64 < b.i64 ? -1 : a.i64 > b.i64 ? 1 : 0;
+  if (a.isSigned and a.i64 < 0)
+    return -1;
+  if (b.isSigned and b.i64 < 0)
+    return 1;
+  uint64_t x = a.isSigned ? uint64_t(a.i64) : a.u64;
+  uint64_t y = b.isSigned ? uint64_t(b.i64) : b.u64;
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+}
+
+namespace mobs {
+
+class QueryPredicateData {
+public:
+  class Node {
+  public:
+    QueryGenerator::Operator op = QueryGenerator::AndBegin;
+    bool negate = false;
+    size_t member = 0; // Index in positions
+    std::vector<MobsMemberInfoDb> values;
+    std::shared_ptr<std::regex> regex;
+    std::vector<Node> children;
+  };
+
+  void compile(std::list<QueryGenerator::QueryItem>::const_iterator &it,
+               std::list<QueryGenerator::QueryItem>::const_iterator end, Node &node, QueryGenerator::Operator endOp);
+  size_t resolve(const MemberBase *mem);
+  Tristate eval(const Node &node, const MemberValues &mc) const;
+  Tristate compare(const Node &node, const MemberBase &mem) const;
+
+  std::string objName;
+  const ObjectBase *compileObj = nullptr; // nur während compile gültig
+  std::map<const MemberBase *, size_t> lookUp;
+  std::vector<std::vector<size_t>> positions; // Position je benutzter Membervariable, siehe ObjectBase::memberPosition
+  Node root;
+};
+
+size_t QueryPredicateData::resolve(const MemberBase *mem) {
+  auto i = lookUp.find(mem);
+  if (i != lookUp.end())
+    return i->second;
+  std::vector<size_t> pos;
+  if (mem)
+    pos = compileObj->memberPosition(*mem);
+  if (pos.empty())
+    THROW("query member " << (mem ? mem->getElementName() : std::string("?")) << " not found or inside a vector");
+  size_t n = positions.size();
+  positions.push_back(std::move(pos));
+  lookUp[mem] = n;
+  return n;
+}
+
+void QueryPredicateData::compile(std::list<QueryGenerator::QueryItem>::const_iterator &it,
+                                 std::list<QueryGenerator::QueryItem>::const_iterator end, Node &node,
+                                 QueryGenerator::Operator endOp) {
+  bool negate = false;
+  while (it != end) {
+    const QueryGenerator::QueryItem &i = *it++;
+    switch (i.op) {
+      case QueryGenerator::AndEnd:
+      case QueryGenerator::OrEnd:
+        if (i.op != endOp)
+          THROW("query syntax: unexpected end of list");
+        return;
+      case QueryGenerator::Not:
+        negate = not negate;
+        continue;
+      case QueryGenerator::AndBegin:
+      case QueryGenerator::OrBegin: {
+        Node n;
+        n.op = i.op;
+        n.negate = negate;
+        compile(it, end, n, i.op == QueryGenerator::AndBegin ? QueryGenerator::AndEnd : QueryGenerator::OrEnd);
+        node.children.push_back(std::move(n));
+        break;
+      }
+      case QueryGenerator::Variable: {
+        Node n;
+        n.member = resolve(i.mem);
+        n.negate = negate;
+        if (it == end)
+          THROW("query syntax: operator missing");
+        n.op = it->op;
+        ++it;
+        size_t need = 0;
+        switch (n.op) {
+          case QueryGenerator::Equal ... QueryGenerator::Like: need = 1; break;
+          case QueryGenerator::Between: need = 2; break;
+          case QueryGenerator::InBegin: need = SIZE_MAX; break;
+          case QueryGenerator::IsNull:
+          case QueryGenerator::IsNotNull: break;
+          default:
+            THROW("query syntax: invalid operator " << int(n.op));
+        }
+        while (need) {
+          if (it == end)
+            THROW("query syntax: value missing");
+          if (it->op == QueryGenerator::InEnd and n.op == QueryGenerator::InBegin) {
+            ++it;
+            break;
+          }
+          if (it->op != QueryGenerator::Const)
+            THROW("query syntax: only constant values are supported");
+          n.values.push_back(*it++);
+          if (need != SIZE_MAX)
+            need--;
+        }
+        if (n.op == QueryGenerator::Like)
+          n.regex = std::make_shared<std::regex>(convLikeToRegexp(n.values.front().toString()));
+        node.children.push_back(std::move(n));
+        break;
+      }
+      case QueryGenerator::literalBegin:
+      case QueryGenerator::literalEnd:
+        THROW("literal queries can't be evaluated");
+      default:
+        THROW("query syntax: unexpected operator " << int(i.op));
+    }
+    negate = false;
+  }
+  if (endOp != QueryGenerator::AndBegin)
+    THROW("query syntax: missing end of list");
+}
+
+Tristate QueryPredicateData::compare(const Node &node, const MemberBase &mem) const {
+  MobsMemberInfo mi;
+  mem.memInfo(mi);
+  std::string str;
+  bool haveStr = false;
+  // Vergleich mit einem Wert: <0, 0, >0
+  auto cmp = [&](const MobsMemberInfoDb &v) -> int {
+    if (v.isNumber() and mi.isNumber())
+      return compareInfo(mi, v);
+    if (not haveStr) {
+      str = mem.toStr(ConvToStrHint(mem.hasFeature(mobs::DbCompact)));
+      haveStr = true;
+    }
+    return str.compare(v.toString());
+  };
+  switch (node.op) {
+    case QueryGenerator::Equal: return cmp(node.values[0]) == 0 ? TTrue : TFalse;
+    case QueryGenerator::Less: return cmp(node.values[0]) < 0 ? TTrue : TFalse;
+    case QueryGenerator::LessEqual: return cmp(node.values[0]) <= 0 ? TTrue : TFalse;
+    case QueryGenerator::Grater: return cmp(node.values[0]) > 0 ? TTrue : TFalse;
+    case QueryGenerator::GraterEqual: return cmp(node.values[0]) >= 0 ? TTrue : TFalse;
+    case QueryGenerator::NotEqual: return cmp(node.values[0]) != 0 ? TTrue : TFalse;
+    case QueryGenerator::Between:
+      return cmp(node.values[0]) >= 0 and cmp(node.values[1]) <= 0 ? TTrue : TFalse;
+    case QueryGenerator::InBegin:
+      for (auto &v:node.values)
+        if (cmp(v) == 0)
+          return TTrue;
+      return TFalse;
+    case QueryGenerator::Like:
+      str = mem.toStr(ConvToStrHint(mem.hasFeature(mobs::DbCompact)));
+      return std::regex_search(str, *node.regex) ? TTrue : TFalse;
+    default:
+      THROW("invalid operator " << int(node.op));
+  }
+}
+
+Tristate QueryPredicateData::eval(const Node &node, const MemberValues &mc) const {
+  Tristate res;
+  switch (node.op) {
+    case QueryGenerator::AndBegin:
+      res = TTrue;
+      for (auto &c:node.children) {
+        Tristate t = eval(c, mc);
+        if (t == TFalse) {
+          res = TFalse;
+          break;
+        }
+        if (t == TUnknown)
+          res = TUnknown;
+      }
+      break;
+    case QueryGenerator::OrBegin:
+      res = TFalse;
+      for (auto &c:node.children) {
+        Tristate t = eval(c, mc);
+        if (t == TTrue) {
+          res = TTrue;
+          break;
+        }
+        if (t == TUnknown)
+          res = TUnknown;
+      }
+      break;
+    case QueryGenerator::IsNull:
+      res = mc.nulls[node.member] ? TTrue : TFalse;
+      break;
+    case QueryGenerator::IsNotNull:
+      res = mc.nulls[node.member] ? TFalse : TTrue;
+      break;
+    default:
+      if (mc.nulls[node.member])
+        return TUnknown;
+      res = compare(node, *mc.members[node.member]);
+  }
+  if (node.negate and res != TUnknown)
+    res = res == TTrue ? TFalse : TTrue;
+  return res;
+}
+
+
+QueryPredicate::QueryPredicate(const ObjectBase &obj, const QueryGenerator &query) {
+  auto d = std::make_shared<QueryPredicateData>();
+  d->objName = obj.getObjectName();
+  d->compileObj = &obj;
+  auto it = query.query.cbegin();
+  d->compile(it, query.query.cend(), d->root, QueryGenerator::AndBegin);
+  d->compileObj = nullptr;
+  d->lookUp.clear();
+  data = d;
+}
 
+QueryPredicate::QueryPredicate(const QueryPredicate &other) = default;
 
-}
\ No newline at end of file
+QueryPredicate::~QueryPredicate() = default;
+
+std::string QueryPredicate::objectName() const {
+  return data->objName;
+}
+
+bool QueryPredicate::operator()(const ObjectBase &obj) const {
+  if (obj.getObjectName() != data->objName)
+    THROW("query predicate for " << data->objName << " used on " << obj.getObjectName());
+  // nur die im Filter benutzten Membervariablen über ihre Position aufsuchen
+  MemberValues mc;
+  mc.members.reserve(data->positions.size());
+  mc.nulls.reserve(data->positions.size());
+  for (auto &pos:data->positions) {
+    bool inNull;
+    const MemberBase *mem = obj.memberAt(pos, inNull);
+    if (not mem)
+      THROW("query predicate: structure of " << obj.getObjectName() << " differs");
+    mc.members.push_back(mem);
+    mc.nulls.push_back(inNull or mem->isNull());
+  }
+  return data->eval(data->root, mc) == TTrue;
+}
+
+size_t QueryPredicate::evaluate(const std::vector<const ObjectBase *> &objs, std::vector<bool> &result) const {
+  size_t cnt = 0;
+  result.clear();
+  result.reserve(objs.size());
+  for (auto o:objs) {
+    bool r = o and (*this)(*o);
+    result.push_back(r);
+    if (r)
+      cnt++;
+  }
+  return cnt;
+}
+
+QueryPredicate QueryGenerator::compile(const ObjectBase &obj) const {
+  return QueryPredicate(obj, *this);
+}
+
+}
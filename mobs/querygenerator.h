@@ -28,13 +28,17 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "objgen.h"
 
 namespace mobs {
 
 class SQLDBdescription;
+class QueryOrder;
 class QueryGeneratorData;
+class QueryPredicate;
+class QueryPredicateData;
 
 /** \brief Klasse zum Erzeugen eines Filters für Datenbankabfragen
 
@@ -118,8 +122,33 @@ public:
   /// \private
   std::string show(const std::map<const MemberBase *, std::string> &lookUp, SQLDBdescription *sqd = nullptr) const;
 
+  /** \brief Ergänzt den Filter für die Folgeseite einer Keyset-Pagination
+   *
+   * Es werden nur noch Elemente geliefert, die in der Sortierung \c sort hinter den aktuellen Werten der
+   * Sortier-Elemente liegen. Bei den Sortier-Elementen (a, b) entspricht das "(a > A) OR (a = A AND b > B)", bei
+   * absteigender Sortierung mit "<". Damit die Reihenfolge eindeutig ist, sollte die Sortierung alle Key-Elemente enthalten.
+   * @param sort Sortierung der Abfrage; die Sortier-Elemente müssen Werte != null enthalten
+   * \throw runtime_error wenn die Sortierung leer ist oder ein Sortier-Element null ist
+   */
+  void addKeysetAfter(const QueryOrder &sort);
 
+  /** \brief Beschränkt den Filter auf einen Wertebereich eines Elementes
+   *
+   * Ergänzt "mem >= lower AND mem < upper"; die Werte werden aus \c lower und \c upper entnommen, die zu einem anderen
+   * Objekt gleichen Typs gehören dürfen.
+   * @param mem Element des Abfrage-Objektes
+   * @param lower Element mit der unteren Grenze (inklusive) oder nullptr für keine
+   * @param upper Element mit der oberen Grenze (exklusive) oder nullptr für keine
+   * \throw runtime_error wenn eine Grenze null ist
+   */
+  void addRange(const mobs::MemberBase &mem, const mobs::MemberBase *lower, const mobs::MemberBase *upper);
 
+  /** \brief Übersetzt den Filter zur Auswertung im Speicher
+   *
+   * @param obj Objekt, mit dessen Membervariablen der Filter erzeugt wurde
+   * \see QueryPredicate
+   */
+  QueryPredicate compile(const ObjectBase &obj) const;
 
 
 
@@ -131,6 +160,7 @@ private:
   void add(bool i);
   void add(uint64_t i);
   void add(const mobs::MemberBase &mem);
+  void addValue(const mobs::MemberBase &mem);
   void add(const mobs::MobsMemberInfoDb &mi);
   void add(Operator op);
   void add(const std::string &s);
@@ -140,6 +170,67 @@ private:
 
 
 
+/** \brief Übersetzter Filter zur Auswertung eines QueryGenerator ohne Datenbank
+ *
+ * Die Membervariablen des Filters werden beim Übersetzen auf ihre Position im Objekt abgebildet, so dass der Filter auf
+ * beliebige Objekte desselben Typs angewendet werden kann, z.B. auf den Inhalt eines ObjCache oder eines MemberVector.
+ * Unterstützt werden alle Vergleichs-Operatoren, Between, In, Like (über convLikeToRegexp) sowie die Null-Tests mit
+ * And/Or/Not-Verknüpfungen. Null-Werte werden wie in SQL behandelt, ein Vergleich mit null ist nie erfüllt.
+ *
+ * Membervariablen innerhalb von Vektoren sowie literale Bedingungen werden nicht unterstützt.
+ * \code
+ * using Q = mobs::QueryGenerator;
+ * Kunde kunde;
+ * Q filter;
+ * filter << kunde.Ort.Qi("LIKE", "Nord%") << kunde.status.QiIn({7,8,3});
+ * mobs::QueryPredicate pred = filter.compile(kunde);
+ * for (auto &k:kundenListe)
+ *   if (pred(k))
+ *     ...
+ * \endcode
+ */
+class QueryPredicate {
+public:
+  /** \brief Konstruktor, übersetzt den Filter
+   *
+   * @param obj Objekt, mit dessen Membervariablen der Filter erzeugt wurde
+   * @param query Filter
+   * \throw runtime_error bei ungültigem Filter, literalen Bedingungen oder Membervariablen aus Vektoren
+   */
+  QueryPredicate(const ObjectBase &obj, const QueryGenerator &query);
+  ~QueryPredicate();
+  /// Copy-Konstruktor, der übersetzte Filter wird gemeinsam benutzt
+  QueryPredicate(const QueryPredicate &other);
+
+  /// Typ der Objekte, auf die der Filter angewendet werden kann
+  std::string objectName() const;
+  /** \brief Prüft ein Objekt gegen den Filter
+   *
+   * \throw runtime_error wenn das Objekt einen anderen Typ hat
+   */
+  bool operator()(const ObjectBase &obj) const;
+  /** \brief Prüft mehrere Objekte gegen den Filter
+   *
+   * @param objs zu prüfende Objekte
+   * @param result je Objekt das Ergebnis
+   * @return Anzahl der Treffer
+   */
+  size_t evaluate(const std::vector<const ObjectBase *> &objs, std::vector<bool> &result) const;
+  /// liefert die Positionen aller Elemente eines Vektors, die dem Filter entsprechen
+  template<class T>
+  std::vector<size_t> select(const MemberVector<T> &vec) const {
+    std::vector<size_t> res;
+    for (size_t i = 0; i < vec.size(); i++)
+      if ((*this)(vec[i]))
+        res.push_back(i);
+    return res;
+  }
+
+private:
+  std::shared_ptr<const QueryPredicateData> data;
+};
+
+
 template<typename T, class C>
 /// Füge eine Membervariable zu einem Abfragefilter hinzu
 QueryGenerator &operator<<(QueryGenerator &g, Member<T, C> &m) { g.add(m); return g; }
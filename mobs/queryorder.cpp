@@ -68,6 +68,18 @@ void QueryOrder::directionAsc(bool asc) {
   data->asc = asc;
 }
 
+std::vector<std::pair<const mobs::MemberBase *, int>> QueryOrder::members() const {
+  // bei mehrfach angegebenen Elementen gilt die letzte Position, daher können Lücken entstehen
+  std::map<u_int, std::pair<const mobs::MemberBase *, int>> sorted;
+  for (auto &i:data->info)
+    sorted[i.second.pos] = std::make_pair(i.first, i.second.sort);
+  std::vector<std::pair<const mobs::MemberBase *, int>> res;
+  res.reserve(sorted.size());
+  for (auto &i:sorted)
+    res.push_back(i.second);
+  return res;
+}
+
 
 QueryOrder &operator<<(QueryOrder &k, QueryOrder::SortSwitch &s) {
   if (&s == &QueryOrder::ascending)
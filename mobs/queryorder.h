@@ -27,6 +27,7 @@
 
 #include "objgen.h"
 #include <memory>
+#include <vector>
 
 namespace mobs {
 
@@ -77,6 +78,9 @@ public:
   /// \private
   void directionAsc(bool);
 
+  /// \private
+  std::vector<std::pair<const mobs::MemberBase *, int>> members() const;
+
   /// Sortierfolge aufsteigend
   static SortSwitch ascending;
   /// Sortierfolge absteigend
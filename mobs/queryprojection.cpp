@@ -0,0 +1,111 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "queryprojection.h"
+
+namespace mobs {
+
+namespace {
+// Pfad eines Elementes ab dem Master-Objekt, Elemente von Vektoren haben einen leeren Namen
+std::string objPath(const ObjectBase *obj) {
+  if (not obj)
+    return {};
+  if (not obj->getParentObject())
+    return obj->getObjectName();
+  return objPath(obj->getParentObject()) + '.' + obj->getElementName();
+}
+
+std::string memPath(const ObjectBase *parent, const std::string &name) {
+  return objPath(parent) + '.' + name;
+}
+}
+
+class QueryProjectionData {
+public:
+  std::set<std::string> paths;
+};
+
+
+QueryProjection::QueryProjection() : data(new QueryProjectionData) {}
+
+QueryProjection::QueryProjection(const QueryProjection &other) : data(new QueryProjectionData(*other.data)) {}
+
+QueryProjection::~QueryProjection() = default;
+
+void QueryProjection::add(const MemberBase &mem) {
+  data->paths.insert(memPath(mem.getParentObject(), mem.getElementName()));
+}
+
+void QueryProjection::add(const ObjectBase &obj) {
+  data->paths.insert(objPath(&obj));
+}
+
+void QueryProjection::add(const MemBaseVector &vec) {
+  data->paths.insert(memPath(vec.getParentObject(), vec.getElementName()));
+}
+
+bool QueryProjection::contains(const MemberBase &mem) const {
+  return data->paths.find(memPath(mem.getParentObject(), mem.getElementName())) != data->paths.end();
+}
+
+bool QueryProjection::contains(const ObjectBase &obj) const {
+  return data->paths.find(objPath(&obj)) != data->paths.end();
+}
+
+bool QueryProjection::contains(const MemBaseVector &vec) const {
+  return data->paths.find(memPath(vec.getParentObject(), vec.getElementName())) != data->paths.end();
+}
+
+bool QueryProjection::empty() const {
+  return data->paths.empty();
+}
+
+
+bool ProjectionScope::enter(const ObjectBase &obj) {
+  if (selectAll.size() == 1 and not selectAll.top() and keys.empty()) {
+    // Master-Objekt: Key-Elemente werden immer gelesen
+    class KeyTrav : virtual public ObjTravConst {
+    public:
+      explicit KeyTrav(std::set<const MemberBase *> &k) : keys(k) {}
+      bool doObjBeg(const ObjectBase &) override { return true; }
+      void doObjEnd(const ObjectBase &) override { }
+      bool doArrayBeg(const MemBaseVector &) override { return false; }
+      void doArrayEnd(const MemBaseVector &) override { }
+      void doMem(const MemberBase &mem) override { keys.insert(&mem); }
+      std::set<const MemberBase *> &keys;
+    };
+    KeyTrav kt(keys);
+    obj.traverseKey(kt);
+  }
+  selectAll.push(selected(obj));
+  return selectAll.top();
+}
+
+bool ProjectionScope::selected(const MemberBase &mem) const {
+  if (selectAll.top() or projection->contains(mem) or keys.find(&mem) != keys.end())
+    return true;
+  // eingebettete Objekte durchlaufen kein doObjBeg
+  const ObjectBase *p = mem.getParentObject();
+  return p and projection->contains(*p);
+}
+
+
+}
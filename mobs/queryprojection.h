@@ -0,0 +1,144 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file queryprojection.h
+ \brief Datenbank-Interface: Auswahl der zu lesenden Elemente einer Abfrage
+ */
+
+#ifndef MOBS_QUERYPROJECTION_H
+#define MOBS_QUERYPROJECTION_H
+
+#include "objgen.h"
+#include <memory>
+#include <set>
+#include <stack>
+
+namespace mobs {
+
+
+class QueryProjectionData;
+
+/** \brief Klasse zur Auswahl der Elemente, die bei einer Datenbankabfrage gelesen werden (Projektion)
+
+ Ohne Projektion werden bei einer Abfrage alle Spalten und alle Detail-Tabellen der Vektoren gelesen. Mit einer Projektion
+ werden nur die angegebenen Elemente sowie die Key-Elemente geladen; alle anderen Elemente bleiben nach dem retrieve() leer.
+
+ Angegeben werden können Membervariablen, Unterobjekte (mit allen Elementen) und Vektoren. Detail-Tabellen werden nur
+ gelesen, wenn der Vektor selbst oder ein übergeordnetes Objekt ausgewählt wurde. Einzelne Elemente innerhalb von Vektoren
+ können nicht ausgewählt werden.
+
+ Die Elemente werden über ihren Pfad ab dem Master-Objekt zugeordnet; die Projektion gilt damit für alle Objekte desselben
+ Typs, z.B. auch für die mit createNew() erzeugten Objekte von DatabaseInterface::parallelScan. Ein so gelesenes Objekt
+ ist unvollständig und sollte nicht gespeichert werden.
+
+ Beispiel:
+\code
+ class Fahrzeug : public ObjectBase
+ {
+   public:
+     ObjInit(Fahrzeug);
+
+     MemVar(int,         id, KEYELEMENT1);
+     MemVar(std::string, fahrzeugTyp);
+     MemVar(int,         anzahlRaeder);
+     MemVector(Rad,      raeder);
+ };
+ ...
+ Fahrzeug f;
+ QueryProjection proj;
+ proj << f.fahrzeugTyp << f.anzahlRaeder;
+ auto cursor = dbi.withProjection(proj).query(f, filter);
+\endcode
+
+ */
+class QueryProjection {
+public:
+  QueryProjection();
+  /// Copy-Konstruktor
+  QueryProjection(const QueryProjection &other);
+  ~QueryProjection();
+  QueryProjection &operator=(const QueryProjection &) = delete;
+
+  /// füge eine Membervariable hinzu
+  void add(const mobs::MemberBase &mem);
+  /// füge ein Unterobjekt mit allen Elementen hinzu
+  void add(const mobs::ObjectBase &obj);
+  /// füge einen Vektor inklusive Detail-Tabelle hinzu
+  void add(const mobs::MemBaseVector &vec);
+
+  /// \private
+  bool contains(const mobs::MemberBase &mem) const;
+  /// \private
+  bool contains(const mobs::ObjectBase &obj) const;
+  /// \private
+  bool contains(const mobs::MemBaseVector &vec) const;
+
+  /// ist die Projektion leer
+  bool empty() const;
+
+private:
+  std::unique_ptr<QueryProjectionData> data;
+};
+
+template<typename T, class C>
+/// füge eine Membervariable zur Projektion hinzu
+QueryProjection &operator<<(QueryProjection &p, mobs::Member<T, C> &m) { p.add(m); return p; }
+
+template<class T>
+/// füge einen Vektor zur Projektion hinzu
+QueryProjection &operator<<(QueryProjection &p, mobs::MemberVector<T> &v) { p.add(v); return p; }
+
+/// füge ein Unterobjekt zur Projektion hinzu
+inline QueryProjection &operator<<(QueryProjection &p, mobs::ObjectBase &o) { p.add(o); return p; }
+
+
+/** \brief Hilfsklasse für Traversierer zur Auswertung einer Projektion
+ *
+ * Wird in doObjBeg/doArrayBeg mit enter() und in doObjEnd/doArrayEnd mit leave() aufgerufen.
+ * Ohne Projektion sind alle Elemente ausgewählt.
+ * \private
+ */
+class ProjectionScope {
+public:
+  /// \private
+  explicit ProjectionScope(const QueryProjection *p) : projection(p) { selectAll.push(p == nullptr or p->empty()); }
+  /// \private
+  bool enter(const mobs::ObjectBase &obj);
+  /// \private
+  bool enter(const mobs::MemBaseVector &vec) { selectAll.push(selected(vec)); return selectAll.top(); }
+  /// \private
+  void leave() { if (selectAll.size() > 1) selectAll.pop(); }
+  /// \private
+  bool selected(const mobs::MemberBase &mem) const;
+  /// \private
+  bool selected(const mobs::ObjectBase &obj) const { return selectAll.top() or projection->contains(obj); }
+  /// \private
+  bool selected(const mobs::MemBaseVector &vec) const { return selectAll.top() or projection->contains(vec); }
+  /// \private
+  bool all() const { return selectAll.top(); }
+
+private:
+  const QueryProjection *projection;
+  std::stack<bool> selectAll;
+  std::set<const mobs::MemberBase *> keys; // Key-Elemente des Master-Objektes
+};
+
+}
+#endif //MOBS_QUERYPROJECTION_H
@@ -23,6 +23,7 @@
 
 #include "rsa.h"
 #include "logging.h"
+#include "metrics.h"
 #include "converter.h"
 #include "digest.h"
 #include "crypt.h"
@@ -251,6 +252,7 @@ mobs::CryptBufRsa::int_type mobs::CryptBufRsa::underflow() {
 //      if (1 != EVP_DecryptUpdate(data->ctx, (u_char *) &data->buffer[0], &len, start, sz))
     if (1 != EVP_OpenUpdate(data->ctx, (u_char *) &data->buffer[0], &len, start, sz))
       throw openssl_exception(LOGSTR("mobs::CryptBufRsa"));
+    Metrics::count("crypt.rsa.decrypt", uint64_t(sz));
 //    LOG(LM_DEBUG, "GC2 = " << sz << " " << len << " " << std::string(&data->buffer[0], len));
 
     if (data->finished) {
@@ -301,6 +303,7 @@ mobs::CryptBufRsa::int_type mobs::CryptBufRsa::overflow(mobs::CryptBufRsa::int_t
     if (1 != EVP_SealUpdate(data->ctx, start, &len, (u_char *)(Base::pbase()),
                             std::distance(Base::pbase(), Base::pptr())))
       throw openssl_exception(LOGSTR("mobs::CryptBufRsa"));
+    Metrics::count("crypt.rsa.encrypt", uint64_t(std::distance(Base::pbase(), Base::pptr())));
     len +=  int(start - &buf[0]);
 //      LOG(LM_INFO, "Writing " << len << "  was " << std::distance(Base::pbase(), Base::pptr()) << std::string(Base::pbase(), std::distance(Base::pbase(), Base::pptr())));
     doWrite((char *)(&buf[0]), len);
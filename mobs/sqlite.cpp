@@ -28,7 +28,10 @@
 #include "objgen.h"
 #include "unixtime.h"
 #include "helper.h"
+#include "metrics.h"
 #include "mchrono.h"
+#include "blobstore.h"
+#include "converter.h"
 
 #include <cstdint>
 #include <cstring>
@@ -312,16 +315,31 @@ class SQLiteCursor : public virtual mobs::DbCursor {
 public:
   explicit SQLiteCursor(sqlite3_stmt *stmt, std::shared_ptr<DatabaseConnection> dbi, std::string dbName, bool keysOnly) :
           stmt(stmt), dbCon(std::move(dbi)), databaseName(std::move(dbName)), isKeysOnly(keysOnly) { }
-  ~SQLiteCursor() override { if (stmt) sqlite3_finalize(stmt); stmt = nullptr; }
+  ~SQLiteCursor() override {
+    if (stmt) {
+      if (timer)
+        timer->rows(cnt + 1);
+      sqlite3_finalize(stmt);
+    }
+    stmt = nullptr;
+  }
   bool eof() override  { return not stmt; }
   bool valid() override { return not eof(); }
   bool keysOnly() const override { return isKeysOnly; }
   void operator++() override {
     if (eof()) return;
+    if (timer)
+      timer->start();
     int rc = sqlite3_step(stmt);
+    if (timer)
+      timer->stop();
     if (rc != SQLITE_ROW) {
       sqlite3_finalize(stmt);
       stmt = nullptr;
+      if (timer) {
+        timer->rows(cnt + 1);
+        timer->finish();
+      }
       if (rc != SQLITE_DONE) {
         auto mdb = dynamic_pointer_cast<SQLiteDatabaseConnection>(dbCon);
         if (mdb)
@@ -335,6 +353,7 @@ private:
   std::shared_ptr<DatabaseConnection> dbCon;  // verhindert das Zerstören der Connection
   std::string databaseName;  // unused
   bool isKeysOnly;
+  std::unique_ptr<QueryTimer> timer; // Messung für den QueryProfiler bis zum Ende des Cursors
 };
 
 }
@@ -361,27 +380,136 @@ void SQLiteDatabaseConnection::open() {
   int rc = sqlite3_open_v2(file.c_str(), &connection, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
   if (rc)
     throw sqlite_exception(u8"connection failed", connection);
+  applyTuning();
 }
 
 SQLiteDatabaseConnection::~SQLiteDatabaseConnection() {
   LOG(LM_DEBUG, "SQLite close");
+  try {
+    flushGroup();
+  } catch (std::exception &e) {
+    LOG(LM_ERROR, u8"SQLite close: " << e.what());
+  }
   if (connection)
     sqlite3_close(connection);
   connection = nullptr;
 }
 
+void SQLiteDatabaseConnection::tune(bool wal, const std::string &synchronous, int64_t mmapSize) {
+  if (not synchronous.empty() and synchronous != "OFF" and synchronous != "NORMAL" and synchronous != "FULL" and
+      synchronous != "EXTRA")
+    THROW(u8"SQLite: invalid synchronous mode " << synchronous);
+  tuneWal = wal;
+  tuneSynchronous = synchronous;
+  tuneMmapSize = mmapSize;
+  if (connection)
+    applyTuning();
+}
+
+void SQLiteDatabaseConnection::applyTuning() {
+  string s;
+  if (tuneWal)
+    s += "PRAGMA journal_mode=WAL;";
+  if (not tuneSynchronous.empty())
+    s += STRSTR("PRAGMA synchronous=" << tuneSynchronous << ';');
+  if (tuneMmapSize >= 0)
+    s += STRSTR("PRAGMA mmap_size=" << tuneMmapSize << ';');
+  if (s.empty())
+    return;
+  LOG(LM_DEBUG, "SQL " << s);
+  // Pragmas liefern teilweise eine Ergebniszeile, daher nicht über doSql
+  if (sqlite3_exec(connection, s.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    throw sqlite_exception(u8"tune failed", connection);
+}
+
+void SQLiteDatabaseConnection::groupWrites(size_t count, std::chrono::milliseconds interval) {
+  if (count <= 1)
+    flushGroup();
+  groupCount = count;
+  groupInterval = interval;
+}
+
+void SQLiteDatabaseConnection::flushGroup() {
+  if (not groupOpen)
+    return;
+  string s = "COMMIT TRANSACTION;";
+  LOG(LM_DEBUG, "SQL " << s);
+  try {
+    doSql(s);
+  } catch (...) {
+    // hat SQLite die Transaktion bereits zurückgerollt, ist die Gruppe verloren
+    if (sqlite3_get_autocommit(connection)) {
+      groupOpen = false;
+      groupPending = 0;
+    }
+    throw;
+  }
+  groupOpen = false;
+  groupPending = 0;
+}
+
+void SQLiteDatabaseConnection::beginAtomic(DatabaseInterface &dbi) {
+  string s;
+  if (currentTransaction) {
+    // Wenn DBI mit Transaktion, dann in Transaktion bleiben
+    if (currentTransaction != dbi.getTransaction())
+      throw std::runtime_error("transaction mismatch");
+    s = "SAVEPOINT MOBS;";
+  } else if (groupCount > 1) {
+    if (not groupOpen) {
+      string b = "BEGIN TRANSACTION;";
+      LOG(LM_DEBUG, "SQL " << b);
+      doSql(b);
+      groupOpen = true;
+      groupPending = 0;
+      groupStart = std::chrono::steady_clock::now();
+    }
+    s = "SAVEPOINT MOBS;";
+  } else
+    s = "BEGIN TRANSACTION;";
+  LOG(LM_DEBUG, "SQL " << s);
+  doSql(s);
+}
+
+void SQLiteDatabaseConnection::commitAtomic() {
+  string s;
+  if (currentTransaction or groupOpen)
+    s = "RELEASE SAVEPOINT MOBS;";
+  else
+    s = "COMMIT TRANSACTION;";
+  LOG(LM_DEBUG, "SQL " << s);
+  doSql(s);
+  if (groupOpen) {
+    groupPending++;
+    if (groupPending >= groupCount or std::chrono::steady_clock::now() - groupStart >= groupInterval) {
+      // ist die Transaktion noch offen, wird ein gescheiterter Commit beim nächsten Mal wiederholt
+      try {
+        flushGroup();
+      } catch (std::exception &e) {
+        if (not groupOpen)
+          throw;
+        LOG(LM_WARNING, u8"SQLite group commit deferred: " << e.what());
+      }
+    }
+  }
+}
+
 bool SQLiteDatabaseConnection::load(DatabaseInterface &dbi, ObjectBase &obj) {
+  MetricsTimer timer("sqlite.load");
   open();
   setConf(dbi);
   SQLSQLiteDescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
   string s = gsql.selectStatementFirst();
   LOG(LM_DEBUG, "SQL: " << s);
+  QueryTimer qt(queryProfiler(), s);
   sqlite3_stmt *ppStmt = nullptr;
   int rc = sqlite3_prepare_v2(connection, s.c_str(), s.length(), &ppStmt, nullptr);
   if (rc != SQLITE_OK)
     throw sqlite_exception(u8"prepare load failed", connection);  // TODO except
   rc = sqlite3_step(ppStmt);
+  qt.rows(rc == SQLITE_ROW ? 1 : 0);
+  qt.finish();
   if (rc != SQLITE_ROW)
   {
     sqlite3_finalize(ppStmt);
@@ -396,18 +524,25 @@ bool SQLiteDatabaseConnection::load(DatabaseInterface &dbi, ObjectBase &obj) {
 
 void SQLiteDatabaseConnection::failed() {
   string s = "ROLLBACK TRANSACTION";
-  if (currentTransaction)
+  if (currentTransaction or groupOpen)
     s += " TO SAVEPOINT MOBS";
   s += ";";
   LOG(LM_DEBUG, "SQL " << s);
   try {
     doSql(s);
+    // gemeinsame Transaktion ohne das fehlerhafte Objekt fortsetzen
+    if (groupOpen and not currentTransaction) {
+      s = "RELEASE SAVEPOINT MOBS;";
+      LOG(LM_DEBUG, "SQL " << s);
+      doSql(s);
+    }
   } catch (std::exception &e) {
     LOG(LM_ERROR, u8"SQLite rollback error: " << e.what());
   }
 }
 
 void SQLiteDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &obj) {
+  MetricsTimer timer("sqlite.save");
   SQLSQLiteDescription sd(dbi.database());
   sd.useBind = true;
   mobs::SqlGenerator gsql(obj, sd);
@@ -415,18 +550,7 @@ void SQLiteDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &ob
     open();
     setConf(dbi);
     // Transaktion benutzen zwecks Atomizität
-    if (currentTransaction == nullptr) {
-      string s = "BEGIN TRANSACTION;";
-      LOG(LM_DEBUG, "SQL " << s);
-      doSql(s);
-      // Wenn DBI mit Transaktion, dann in Transaktion bleiben
-    } else if (currentTransaction != dbi.getTransaction())
-      throw std::runtime_error("transaction mismatch");
-    else {
-      string s = "SAVEPOINT MOBS;";
-      LOG(LM_DEBUG, "SQL " << s);
-      doSql(s);
-    }
+    beginAtomic(dbi);
   } catch (mobs::locked_error &e) {
     throw mobs::locked_error(LOGSTR(u8"SQLite save transaction failed: " << e.what()));
   } catch (std::exception &e) {
@@ -446,6 +570,7 @@ void SQLiteDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &ob
     else
       s = gsql.insertStatement(true);
     LOG(LM_DEBUG, "SQL " << s);
+    QueryTimer qt(queryProfiler(), s);
     sqlite3_stmt *ppStmt = nullptr;
     int rc = sqlite3_prepare_v2(connection, s.c_str(), s.length(), &ppStmt, nullptr);
     if (rc != SQLITE_OK)
@@ -458,6 +583,8 @@ void SQLiteDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &ob
       throw sqlite_exception(u8"save failed", connection);
 
     int sz = sqlite3_changes(connection);
+    qt.rows(uint64_t(sz));
+    qt.finish();
     LOG(LM_DEBUG, "ROWS " << sz);
     if (version > 0 and sz != 1)
       throw mobs::optLock_error(LOGSTR(u8"number of processed rows is " << sz << " should be 1"));
@@ -466,6 +593,7 @@ void SQLiteDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &ob
     while (not gsql.eof()) {
       s = gsql.replaceStatement(false);
       LOG(LM_DEBUG, "SQL " << s);
+      QueryTimer qtd(queryProfiler(), s);
       rc = sqlite3_prepare_v2(connection, s.c_str(), s.length(), &ppStmt, nullptr);
       if (rc != SQLITE_OK)
         throw sqlite_exception(u8"prepare save failed", connection);
@@ -475,6 +603,7 @@ void SQLiteDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &ob
       rc = sqlite3_finalize(ppStmt);
       if (rc != SQLITE_OK)
         throw sqlite_exception(u8"save failed", connection);
+      qtd.rows(uint64_t(sqlite3_changes(connection)));
     }
   } catch (sqlite_exception &e) {
     switch (sqlite3_errcode(connection)) {
@@ -514,13 +643,7 @@ void SQLiteDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &ob
   }
 
   try {
-    string s;
-    if (currentTransaction)
-      s = "RELEASE SAVEPOINT MOBS;";
-    else
-      s = "COMMIT TRANSACTION;";
-    LOG(LM_DEBUG, "SQL " << s);
-    doSql(s);
+    commitAtomic();
   } catch (mobs::locked_error &e) {
     throw mobs::locked_error(LOGSTR(u8"SQLite save transaction failed: " << e.what()));
   } catch (std::exception &e) {
@@ -531,6 +654,7 @@ void SQLiteDatabaseConnection::save(DatabaseInterface &dbi, const ObjectBase &ob
 
 
 bool SQLiteDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase &obj) {
+  MetricsTimer timer("sqlite.destroy");
   open();
   setConf(dbi);
   SQLSQLiteDescription sd(dbi.database());
@@ -539,18 +663,7 @@ bool SQLiteDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase
   try {
     open();
     // Transaktion benutzen zwecks Atomizität
-    if (currentTransaction == nullptr) {
-      string s = "BEGIN TRANSACTION;";
-      LOG(LM_DEBUG, "SQL " << s);
-      doSql(s);
-      // Wenn DBI mit Transaktion, dann in Transaktion bleiben
-    } else if (currentTransaction != dbi.getTransaction())
-      throw std::runtime_error("transaction mismatch");
-    else {
-      string s = "SAVEPOINT MOBS;";
-      LOG(LM_DEBUG, "SQL " << s);
-      doSql(s);
-    }
+    beginAtomic(dbi);
   } catch (mobs::locked_error &e) {
     throw mobs::locked_error(LOGSTR(u8"SQLite destroy transaction failed: " << e.what()));
   } catch (std::exception &e) {
@@ -567,6 +680,7 @@ bool SQLiteDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase
     for (bool first = true; first or not gsql.eof(); first = false) {
       string s = gsql.deleteStatement(first);
       LOG(LM_DEBUG, "SQL " << s);
+      QueryTimer qt(queryProfiler(), s);
       sqlite3_stmt *ppStmt = nullptr;
       int rc = sqlite3_prepare_v2(connection, s.c_str(), s.length(), &ppStmt, nullptr);
       if (rc != SQLITE_OK)
@@ -577,6 +691,8 @@ bool SQLiteDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase
       rc = sqlite3_finalize(ppStmt);
       if (rc != SQLITE_OK)
         throw sqlite_exception(u8"save failed", connection);
+      qt.rows(uint64_t(sqlite3_changes(connection)));
+      qt.finish();
       if (first) {
         found = sqlite3_changes(connection) > 0;
         if (version > 0 and not found)
@@ -595,13 +711,7 @@ bool SQLiteDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase
   }
 
   try {
-    string s;
-    if (currentTransaction)
-      s = "RELEASE SAVEPOINT MOBS;";
-    else
-      s = "COMMIT TRANSACTION;";
-    LOG(LM_DEBUG, "SQL " << s);
-    doSql(s);
+    commitAtomic();
   } catch (mobs::locked_error &e) {
     throw mobs::locked_error(LOGSTR(u8"SQLite destroy transaction failed: " << e.what()));
   } catch (std::exception &e) {
@@ -613,8 +723,10 @@ bool SQLiteDatabaseConnection::destroy(DatabaseInterface &dbi, const ObjectBase
 std::shared_ptr<DbCursor>
 SQLiteDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qbe, const QueryGenerator *query,
                                 const QueryOrder *sort) {
+  MetricsTimer timer("sqlite.query");
   SQLSQLiteDescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
+  gsql.setProjection(dbi.getProjection());
   string sqlLimit;
   if (not dbi.getCountCursor() and dbi.getQueryLimit() > 0)
     sqlLimit += STRSTR(" LIMIT " << dbi.getQueryLimit());
@@ -635,11 +747,16 @@ SQLiteDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qb
     // TODO  s += " LOCK IN SHARE MODE WAIT 10 "; / NOWAIT
 
     LOG(LM_INFO, "SQL: " << s);
+    std::unique_ptr<QueryTimer> qt;
+    if (queryProfiler())
+      qt = std::unique_ptr<QueryTimer>(new QueryTimer(queryProfiler(), s));
     sqlite3_stmt *ppStmt = nullptr;
     int rc = sqlite3_prepare_v2(connection, s.c_str(), s.length(), &ppStmt, nullptr);
     if (rc != SQLITE_OK)
       throw sqlite_exception(u8"prepare query failed", connection);
     rc = sqlite3_step(ppStmt);
+    if (qt)
+      qt->stop();
     if (rc != SQLITE_ROW) {
       sqlite3_finalize(ppStmt);
       ppStmt = nullptr;
@@ -656,9 +773,13 @@ SQLiteDatabaseConnection::query(DatabaseInterface &dbi, ObjectBase &obj, bool qb
         throw runtime_error(u8"count error");
       }
       sqlite3_finalize(ppStmt);
+      if (qt)
+        qt->rows(1);
       return std::make_shared<CountCursor>(size_t(cnt));
     }
     auto cursor = std::make_shared<SQLiteCursor>(ppStmt, dbi.getConnection(), dbi.database(), dbi.getKeysOnly());
+    if (ppStmt)
+      cursor->timer = std::move(qt);
     return cursor;
   } catch (mobs::locked_error &e) {
     throw mobs::locked_error(LOGSTR(u8"SQLite query: " << e.what()));
@@ -682,6 +803,7 @@ SQLiteDatabaseConnection::retrieve(DatabaseInterface &dbi, ObjectBase &obj, std:
   setConf(dbi);
   SQLSQLiteDescription sd(dbi.database());
   mobs::SqlGenerator gsql(obj, sd);
+  gsql.setProjection(cursor->projection());
 
   obj.clear();
   sd.stmt = curs->stmt;
@@ -694,6 +816,8 @@ SQLiteDatabaseConnection::retrieve(DatabaseInterface &dbi, ObjectBase &obj, std:
     SqlGenerator::DetailInfo di;
     string s = gsql.selectStatementArray(di);
     LOG(LM_DEBUG, "SQL " << s);
+    QueryTimer qt(queryProfiler(), s);
+    uint64_t rows = 0;
     sqlite3_stmt *ppStmt = nullptr;
     int rc = sqlite3_prepare_v2(connection, s.c_str(), s.length(), &ppStmt, nullptr);
     if (rc != SQLITE_OK)
@@ -711,7 +835,9 @@ SQLiteDatabaseConnection::retrieve(DatabaseInterface &dbi, ObjectBase &obj, std:
           break;
         }
         gsql.readObject(di);
+        rows++;
       }
+      qt.rows(rows);
     } catch (mobs::locked_error &e) {
       throw mobs::locked_error(LOGSTR(u8"SQLite retrieve: " << e.what()));
     } catch (exception &e) {
@@ -769,6 +895,8 @@ sqlite3 *SQLiteDatabaseConnection::getConnection() {
 size_t SQLiteDatabaseConnection::doSql(const string &sql)
 {
   open();
+  QueryTimer qt(queryProfiler(), sql);
+  int total = qt.active() ? sqlite3_total_changes(connection) : 0;
   sqlite3_stmt *ppStmt = nullptr;
   int rc = sqlite3_prepare_v2(connection, sql.c_str(), sql.length(), &ppStmt, nullptr);
   if (rc != SQLITE_OK)
@@ -794,12 +922,15 @@ size_t SQLiteDatabaseConnection::doSql(const string &sql)
         throw sqlite_exception(u8"step failed", connection);
     }
   }
+  if (qt.active())
+    qt.rows(uint64_t(sqlite3_total_changes(connection) - total));
   return sqlite3_changes(connection);
 }
 
 void SQLiteDatabaseConnection::startTransaction(DatabaseInterface &dbi, DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) {
   try {
     if (currentTransaction == nullptr) {
+      flushGroup();
       // SET SESSION idle_transaction_timeout=2;
       // SET SESSION idle_transaction_timeout=2, SESSION idle_readonly_transaction_timeout=10;
       string s = "BEGIN TRANSACTION;";
@@ -855,6 +986,25 @@ size_t SQLiteDatabaseConnection::maxAuditChangesValueSize(const DatabaseInterfac
   return 200;
 }
 
+void SQLiteDatabaseConnection::uploadFile(DatabaseInterface &dbi, const std::string &id, std::istream &source) {
+  BlobStore::write(dbi, id, source);
+}
+
+std::string SQLiteDatabaseConnection::uploadFile(DatabaseInterface &dbi, std::istream &source) {
+  std::string id = gen_uuid_v4_p();
+  BlobStore::write(dbi, id, source);
+  return id;
+}
+
+void SQLiteDatabaseConnection::downloadFile(DatabaseInterface &dbi, const std::string &id, std::ostream &dest) {
+  BlobStore::read(dbi, id, dest);
+}
+
+void SQLiteDatabaseConnection::deleteFile(DatabaseInterface &dbi, const std::string &id) {
+  if (not BlobStore::erase(dbi, id))
+    THROW("blob " << id << " not found");
+}
+
 void SQLiteDatabaseConnection::setConf(DatabaseInterface &dbi) {
   sqlite3_busy_timeout(connection, dbi.getTimeout().count());
 }
@@ -31,12 +31,25 @@
 #include "dbifc.h"
 
 #include <sqlite3.h>
+#include <chrono>
 
 
 namespace mobs {
 
   /** \brief Datenbank-Verbindung zu einer SQLite DB.
    *
+   * Die Ergebnismenge einer Query wird immer zeilenweise aus der lokalen Datenbank gelesen;
+   * DatabaseInterface::withFetchPolicy hat hier keine Wirkung.
+   *
+   * Für hohen Schreibdurchsatz können mit tune() WAL-Journal, synchronous und mmap_size eingestellt und mit
+   * groupWrites() einzelne Schreibzugriffe zu Transaktionen zusammengefasst werden:
+   * \code
+   * auto con = std::dynamic_pointer_cast<mobs::SQLiteDatabaseConnection>(dbi.getConnection());
+   * con->tune(true, "NORMAL", 256 * 1024 * 1024);
+   * con->groupWrites(500, std::chrono::milliseconds(200));
+   * ...
+   * con->flushGroup();
+   * \endcode
    * \see www.sqlite.org
    */
   class SQLiteDatabaseConnection : virtual public DatabaseConnection, public ConnectionInformation {
@@ -77,6 +90,15 @@ namespace mobs {
     void rollbackTransaction(DbTransaction *transaction, std::shared_ptr<TransactionDbInfo> &tdb) override;
     /// \private
     size_t maxAuditChangesValueSize(const DatabaseInterface &dbi) const override;
+
+    /// \private
+    void uploadFile(DatabaseInterface &dbi, const std::string &id, std::istream &source) override;
+    /// \private
+    std::string uploadFile(DatabaseInterface &dbi, std::istream &source) override;
+    /// \private
+    void downloadFile(DatabaseInterface &dbi, const std::string &id, std::ostream &dest) override;
+    /// \private
+    void deleteFile(DatabaseInterface &dbi, const std::string &id) override;
     // ------------------------------
 
 
@@ -91,11 +113,46 @@ namespace mobs {
     /// Direkt-Zugriff auf die MariaDB
     sqlite3 *getConnection();
 
+    /** \brief Einstellungen für hohen Schreibdurchsatz
+     *
+     * Die Einstellungen werden beim Öffnen der Datenbank bzw. sofort, falls diese bereits geöffnet ist, gesetzt.
+     * @param wal Journal im WAL-Modus (PRAGMA journal_mode=WAL)
+     * @param synchronous Wert für PRAGMA synchronous: OFF, NORMAL, FULL oder EXTRA; leer für unverändert
+     * @param mmapSize Wert für PRAGMA mmap_size in Bytes; negativ für unverändert
+     * \throw runtime_error bei ungültigen Werten oder wenn die Einstellung fehlschlägt
+     */
+    void tune(bool wal, const std::string &synchronous = "NORMAL", int64_t mmapSize = -1);
+
+    /** \brief Fasse save() und destroy() außerhalb von Transaktionen zu gemeinsamen Transaktionen zusammen
+     *
+     * Jedes Objekt wird weiterhin atomar über einen Savepoint geschrieben. Die gemeinsame Transaktion wird nach \c count
+     * Objekten, beim ersten Schreibzugriff nach Ablauf von \c interval, beim Start einer Transaktion, mit flushGroup()
+     * oder im Destruktor abgeschlossen. Bis dahin sind die Änderungen für andere Verbindungen nicht sichtbar.
+     * Schlägt der Commit fehl, so bleibt die Transaktion offen und wird beim nächsten Mal erneut abgeschlossen.
+     * @param count maximale Anzahl Objekte je Transaktion; 0 oder 1 schaltet die Zusammenfassung ab
+     * @param interval maximale Dauer einer gemeinsamen Transaktion
+     */
+    void groupWrites(size_t count, std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+    /// schließt eine offene gemeinsame Transaktion von groupWrites() ab
+    void flushGroup();
+
   private:
     void failed();
     void setConf(DatabaseInterface &dbi);
+    void applyTuning();
+    void beginAtomic(DatabaseInterface &dbi);
+    void commitAtomic();
     sqlite3 *connection = nullptr;
     DbTransaction * currentTransaction = nullptr;
+    bool tuneWal = false;
+    std::string tuneSynchronous;
+    int64_t tuneMmapSize = -1;
+    size_t groupCount = 0;
+    std::chrono::milliseconds groupInterval{0};
+    bool groupOpen = false;
+    size_t groupPending = 0;
+    std::chrono::steady_clock::time_point groupStart;
   };
 };
 
@@ -22,8 +22,8 @@
 #include "tcpstream.h"
 #include "logging.h"
 
-#include <array>
 #include <mutex>
+#include <vector>
 #include <sys/types.h>
 #ifdef __MINGW32__
 #define MSG_DONTWAIT 0
@@ -35,7 +35,12 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/ip.h>
+#include <netinet/tcp.h>
 #include <sys/poll.h>
+#include <sys/uio.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
 #endif
 #include <unistd.h>
 #include <cstring>
@@ -208,6 +213,8 @@ public:
     int i = 1;
     char *parp = (char *)&i;
     setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, parp, sizeof(i));
+    if (noDelay)
+      setNoDelay(true);
   }
 
   std::streamsize readBuf(bool nowait) {
@@ -229,14 +236,32 @@ public:
     return res;
   }
 
-  void writeBuf(std::streamsize sz) {
+  // sendet sz Zeichen aus dem Schreibpuffer sowie optional einen weiteren Block in einem Aufruf (scatter/gather)
+  void writeBuf(std::streamsize sz, const TcpStBuf::char_type *extra = nullptr, std::streamsize extraSz = 0) {
     if (fd == invalidSocket)
       bad = true;
     if (bad)
       return;
-    TcpStBuf::char_type *cp = &wrBuf[0];
-    while (sz > 0) {
-      auto res = send(fd, cp, int(sz), MSG_NOSIGNAL); // buffersize immer < INT_MAX
+#ifdef __MINGW32__
+    sendAll(&wrBuf[0], sz);
+    sendAll(extra, extraSz);
+#else
+    struct iovec iov[2];
+    struct iovec *iop = iov;
+    int cnt = 0;
+    if (sz > 0) {
+      iov[cnt].iov_base = &wrBuf[0];
+      iov[cnt++].iov_len = size_t(sz);
+    }
+    if (extra and extraSz > 0) {
+      iov[cnt].iov_base = const_cast<TcpStBuf::char_type *>(extra);
+      iov[cnt++].iov_len = size_t(extraSz);
+    }
+    while (cnt > 0) {
+      struct msghdr msg{};
+      msg.msg_iov = iop;
+      msg.msg_iovlen = cnt;
+      auto res = sendmsg(fd, &msg, MSG_NOSIGNAL);
       //LOG(LM_DEBUG, "WRITE TCP " << res );
       if (res <= 0) {
         LOG(LM_ERROR, "write error " << errno);
@@ -246,10 +271,63 @@ public:
         break;
       }
       wrPos += res;
+      auto r = size_t(res);
+      while (cnt > 0 and r >= iop->iov_len) {
+        r -= iop->iov_len;
+        iop++;
+        cnt--;
+      }
+      if (cnt > 0) {
+        iop->iov_base = static_cast<char *>(iop->iov_base) + r;
+        iop->iov_len -= r;
+      }
+    }
+#endif
+  }
+
+  std::streamsize sendFile(int file, int64_t offset, std::streamsize len) {
+    if (fd == invalidSocket)
+      bad = true;
+    std::streamsize done = 0;
+    while (done < len and not bad) {
+#ifdef __linux__
+      off_t off = off_t(offset + done);
+      auto res = ::sendfile(fd, file, &off, size_t(len - done));
+      if (res <= 0) {
+        LOG(LM_ERROR, "sendfile error " << errno);
+        bad = true;
+        break;
+      }
+      wrPos += res;
+#else
+      auto res = ::pread(file, &wrBuf[0], size_t(std::min(std::streamsize(wrBuf.size()), len - done)), off_t(offset + done));
+      if (res <= 0) {
+        LOG(LM_ERROR, "read error " << errno);
+        bad = true;
+        break;
+      }
+      writeBuf(res);
+#endif
+      done += res;
+    }
+    return done;
+  }
+
+#ifdef __MINGW32__
+  void sendAll(const TcpStBuf::char_type *cp, std::streamsize sz) {
+    while (sz > 0 and not bad) {
+      auto res = send(fd, cp, int(sz), MSG_NOSIGNAL); // buffersize immer < INT_MAX
+      if (res <= 0) {
+        LOG(LM_ERROR, "write error " << errno);
+        bad = true;
+        break;
+      }
+      wrPos += res;
       sz -= res;
       cp += res;
     }
   }
+#endif
 
   std::string getRemoteHost() const {
     return hostName((sockaddr &)remoteAddr, socklen_t(addrLen));
@@ -291,11 +369,44 @@ public:
     return true;
   }
 
+  bool setNoDelay(bool on) {
+    noDelay = on; // wenn noch nicht offen, dann nur merken
+    if (fd == invalidSocket)
+      return true;
+    int i = on ? 1 : 0;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, SOCK_CAST &i, sizeof(i)) < 0) {
+      LOG(LM_ERROR, "setNoDelay TCP_NODELAY " << strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  bool setCork(bool on) const {
+#if defined(TCP_CORK)
+    const int opt = TCP_CORK;
+#elif defined(TCP_NOPUSH)
+    const int opt = TCP_NOPUSH;
+#else
+    return false;
+#endif
+#if defined(TCP_CORK) || defined(TCP_NOPUSH)
+    if (fd == invalidSocket)
+      return false;
+    int i = on ? 1 : 0;
+    if (setsockopt(fd, IPPROTO_TCP, opt, SOCK_CAST &i, sizeof(i)) < 0) {
+      LOG(LM_ERROR, "setCork " << strerror(errno));
+      return false;
+    }
+    return true;
+#endif
+  }
+
 
   socketHandle fd = invalidSocket;
   bool bad = false;
-  std::array<TcpStBuf::char_type, 8192> rdBuf;
-  std::array<TcpStBuf::char_type, 8192> wrBuf;
+  bool noDelay = false;
+  std::vector<TcpStBuf::char_type> rdBuf = std::vector<TcpStBuf::char_type>(8192);
+  std::vector<TcpStBuf::char_type> wrBuf = std::vector<TcpStBuf::char_type>(8192);
   std::streamsize rdPos = 0;
   std::streamsize wrPos = 0;
   sockaddr_storage remoteAddr{};
@@ -312,13 +423,13 @@ TcpStBuf::TcpStBuf(TcpAccept &accept) {
   data->fd = accept.acceptConnection((sockaddr &)data->remoteAddr, data->addrLen);
   if (data->fd == invalidSocket)
     data->bad = true;
-  Base::setp(data->wrBuf.begin(), data->wrBuf.end());
+  Base::setp(&data->wrBuf[0], &data->wrBuf[0] + data->wrBuf.size());
 }
 
 TcpStBuf::TcpStBuf(const std::string &host, const std::string &service) : Base() {
   data = std::unique_ptr<TcpStBufData>(new TcpStBufData);
   data->connect(host, service);
-  Base::setp(data->wrBuf.begin(), data->wrBuf.end());
+  Base::setp(&data->wrBuf[0], &data->wrBuf[0] + data->wrBuf.size());
 }
 
 TcpStBuf::~TcpStBuf() {
@@ -366,11 +477,20 @@ bool TcpStBuf::bad() const {
   return data->bad;
 }
 
+std::streamsize TcpStBuf::xsputn(const char_type *s, std::streamsize n) {
+  // große Blöcke direkt zusammen mit dem Pufferinhalt senden, ohne sie vorher umzukopieren
+  if (n < std::streamsize(data->wrBuf.size()))
+    return Base::xsputn(s, n);
+  data->writeBuf(std::distance(Base::pbase(), Base::pptr()), s, n);
+  Base::setp(&data->wrBuf[0], &data->wrBuf[0] + data->wrBuf.size());
+  return bad() ? 0 : n;
+}
+
 TcpStBuf::int_type TcpStBuf::overflow(TcpStBuf::int_type ch) {
   TRACE(PARAM(ch));
   //LOG(LM_DEBUG, "write " << std::string(Base::pbase(), std::distance(Base::pbase(), Base::pptr())));
   data->writeBuf(std::distance(Base::pbase(), Base::pptr()));
-  Base::setp(data->wrBuf.begin(), data->wrBuf.end()); // buffer zurücksetzen
+  Base::setp(&data->wrBuf[0], &data->wrBuf[0] + data->wrBuf.size()); // buffer zurücksetzen
   if (bad())
     return Traits::eof();
   if (not Traits::eq_int_type(ch, Traits::eof()))
@@ -482,6 +602,40 @@ bool TcpStBuf::setTimeout(int milliseconds)
   return data->setTimeout(milliseconds);
 }
 
+bool TcpStBuf::setNoDelay(bool on) {
+  return data->setNoDelay(on);
+}
+
+bool TcpStBuf::noDelay() const {
+  return data->noDelay;
+}
+
+bool TcpStBuf::setCork(bool on) const {
+  return data->setCork(on);
+}
+
+std::streamsize TcpStBuf::sendFile(int file, int64_t offset, std::streamsize len) {
+  if (sync() != 0)
+    return -1;
+  return data->sendFile(file, offset, len);
+}
+
+bool TcpStBuf::setBufferSize(size_t readSize, size_t writeSize) {
+  if (readSize == 0 or writeSize == 0)
+    return false;
+  if (Base::gptr() != Base::egptr()) // es sind noch ungelesene Daten im Puffer
+    return false;
+  if (sync() != 0)
+    return false;
+  data->rdBuf.resize(readSize);
+  data->rdBuf.shrink_to_fit();
+  data->wrBuf.resize(writeSize);
+  data->wrBuf.shrink_to_fit();
+  Base::setg(&data->rdBuf[0], &data->rdBuf[0], &data->rdBuf[0]);
+  Base::setp(&data->wrBuf[0], &data->wrBuf[0] + data->wrBuf.size());
+  return true;
+}
+
 
 tcpstream::tcpstream() : std::iostream ( new TcpStBuf()) {}
 
@@ -567,6 +721,27 @@ bool tcpstream::setTimeout(int milliseconds)
   return tp->setTimeout(milliseconds);
 }
 
+bool tcpstream::setNoDelay(bool on)
+{
+  auto *tp = dynamic_cast<TcpStBuf *>(rdbuf());
+  if (not tp) THROW("bad cast");
+  return tp->setNoDelay(on);
+}
+
+bool tcpstream::setCork(bool on) const
+{
+  auto *tp = dynamic_cast<TcpStBuf *>(rdbuf());
+  if (not tp) THROW("bad cast");
+  return tp->setCork(on);
+}
+
+bool tcpstream::setBufferSize(size_t readSize, size_t writeSize)
+{
+  auto *tp = dynamic_cast<TcpStBuf *>(rdbuf());
+  if (not tp) THROW("bad cast");
+  return tp->setBufferSize(readSize, writeSize);
+}
+
 #ifdef __MINGW32__
 
 WinSock::WinSock() {
@@ -152,12 +152,53 @@ public:
    */
   bool setTimeout(int milliseconds);
 
+  /** \brief Nagle-Algorithmus abschalten (TCP_NODELAY)
+   *
+   * Kleine Pakete werden dann sofort gesendet. Ist die Verbindung noch nicht offen, wird die Einstellung beim open() gesetzt.
+   * @param on true, um TCP_NODELAY zu setzen
+   * @return Erfolg
+   */
+  bool setNoDelay(bool on);
+
+  /// Rückgabe, ob TCP_NODELAY gesetzt wurde
+  bool noDelay() const;
+
+  /** \brief Zurückhalten unvollständiger Pakete (TCP_CORK bzw. TCP_NOPUSH)
+   *
+   * Solange aktiv, werden nur volle Pakete gesendet; beim Zurücksetzen wird der Rest sofort gesendet.
+   * @param on true zum Aktivieren, false zum Senden der zurückgehaltenen Daten
+   * @return Erfolg; false, wenn vom Betriebssystem nicht unterstützt
+   */
+  bool setCork(bool on) const;
+
+  /** \brief Größe der Lese- und Schreibpuffer festlegen (default je 8 KiB)
+   *
+   * Der Schreibpuffer wird zuvor gesendet; im Lesepuffer dürfen keine ungelesenen Daten mehr sein.
+   * @param readSize Größe des Lesepuffers
+   * @param writeSize Größe des Schreibpuffers
+   * @return Erfolg
+   */
+  bool setBufferSize(size_t readSize, size_t writeSize);
+
+  /** \brief Daten aus einer Datei direkt senden
+   *
+   * Der Schreibpuffer wird zuvor gesendet. Unter Linux wird sendfile verwendet, sodass die Daten nicht in den
+   * User-Space kopiert werden.
+   * @param file File-Deskriptor der Datei
+   * @param offset Startposition in der Datei
+   * @param len Anzahl Bytes
+   * @return Anzahl der gesendeten Bytes oder -1 bei Fehler
+   */
+  std::streamsize sendFile(int file, int64_t offset, std::streamsize len);
+
   /// Rückgabe ob Fehlerstatus
   bool bad() const;
 
   /// \private
   int_type overflow(int_type ch) override;
   /// \private
+  std::streamsize xsputn(const char_type *s, std::streamsize n) override;
+  /// \private
   int_type underflow() override;
 
 protected:
@@ -250,6 +291,28 @@ public:
   */
   bool setTimeout(int milliseconds);
 
+  /** \brief Nagle-Algorithmus abschalten (TCP_NODELAY)
+   *
+   * @param on true, um TCP_NODELAY zu setzen
+   * @return Erfolg
+   */
+  bool setNoDelay(bool on);
+
+  /** \brief Zurückhalten unvollständiger Pakete (TCP_CORK bzw. TCP_NOPUSH)
+   *
+   * @param on true zum Aktivieren, false zum Senden der zurückgehaltenen Daten
+   * @return Erfolg; false, wenn vom Betriebssystem nicht unterstützt
+   */
+  bool setCork(bool on) const;
+
+  /** \brief Größe der Lese- und Schreibpuffer festlegen (default je 8 KiB)
+   *
+   * @param readSize Größe des Lesepuffers
+   * @param writeSize Größe des Schreibpuffers
+   * @return Erfolg
+   */
+  bool setBufferSize(size_t readSize, size_t writeSize);
+
 };
 
 
@@ -613,7 +613,7 @@ public:
       } else if (curr == 0xef) {
         std::locale lo;
         if ((curr = istr.get()) == 0xbb and (curr = istr.get()) == 0xbf)
-          lo = std::locale(istr.getloc(), new std::codecvt_utf8<wchar_t, 0x10ffff, std::little_endian>);
+          lo = std::locale(istr.getloc(), new codec_utf8);
         else
           throw std::runtime_error(u8"Error in BOM");
         encoding = u8"UTF-8";
@@ -846,7 +846,7 @@ public:
               encoding = mobs::to_string(v);
               if (encoding == u8"UTF-8")
               {
-                std::locale lo = std::locale(istr.getloc(), new std::codecvt_utf8<wchar_t, 0x10ffff, std::little_endian>);
+                std::locale lo = std::locale(istr.getloc(), new codec_utf8);
                 istr.imbue(lo);
               }
               else if (encoding == u8"ISO-8859-15")
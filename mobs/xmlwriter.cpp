@@ -59,6 +59,7 @@ public:
   wstringstream wstrBuff; // buffer für u8-Ausgabe in std::string
   std::unique_ptr<std::ostream> binaryStream;
   std::ostream::pos_type binaryStart = 0;
+  std::ostream *binaryRaw = nullptr; // ungefilterter binärer Stream
 
   void setConFun() const {
     std::locale lo;
@@ -74,7 +75,7 @@ public:
         break;
       case XmlWriter::CS_utf8_bom:
       case XmlWriter::CS_utf8:
-        lo = std::locale(buffer.getloc(), new std::codecvt_utf8<wchar_t, 0x10ffff, std::little_endian>);
+        lo = std::locale(buffer.getloc(), new codec_utf8);
         break;
       case XmlWriter::CS_utf16_be:
         lo = std::locale(buffer.getloc(), new std::codecvt_utf16<wchar_t, 0x10ffff, codecvt_mode(0)>);
@@ -142,6 +143,7 @@ public:
     if (delimiter)
       wbufp->getOstream() << delimiter;
     binaryStart = wbufp->getOstream().tellp();
+    binaryRaw = &wbufp->getOstream();
     return wbufp->getOstream();
   }
 
@@ -159,6 +161,15 @@ public:
       binaryStream = nullptr;
       return size;
     }
+    if (binaryRaw) {
+      std::streamsize size = binaryRaw->tellp();
+      if (size >= 0 and binaryStart >= 0)
+        size -= binaryStart;
+      else
+        size = -1;
+      binaryRaw = nullptr;
+      return size;
+    }
     return 0;
   }
 
@@ -314,7 +325,9 @@ void XmlWriter::writeBase64(const u_char *value, uint64_t size) {
     lBreak = "\n";
     lBreak.resize((data->level * 2) +1, ' ');
   }
-  copy_base64(&value[0], &value[size], std::ostreambuf_iterator<wchar_t>(*data->wostr), lBreak);
+  string b64;
+  append_base64(b64, value, size_t(size), lBreak);
+  std::copy(b64.cbegin(), b64.cend(), std::ostreambuf_iterator<wchar_t>(*data->wostr));
   *data->wostr << L"]]>";
   data->hasValue = true;
 }
@@ -327,7 +340,9 @@ void XmlWriter::writeBase64(const std::vector<u_char> &value) {
     lBreak = "\n";
     lBreak.resize((data->level * 2) +1, ' ');
   }
-  copy_base64(value.cbegin(), value.cend(), std::ostreambuf_iterator<wchar_t>(*data->wostr), lBreak);
+  string b64;
+  append_base64(b64, value.data(), value.size(), lBreak);
+  std::copy(b64.cbegin(), b64.cend(), std::ostreambuf_iterator<wchar_t>(*data->wostr));
   *data->wostr << L"]]>";
   data->hasValue = true;
 }
@@ -475,7 +490,7 @@ void XmlWriter::startEncrypt(CryptBufBase *cbbp) {
     {
       case CS_utf8_bom:
       case CS_utf8:
-        lo = std::locale(lo, new std::codecvt_utf8<wchar_t, 0x10ffff, std::little_endian>);
+        lo = std::locale(lo, new codec_utf8);
         break;
       case CS_iso8859_1:
         lo = std::locale(lo, new codec_iso8859_1);
@@ -543,7 +558,7 @@ void XmlWriter::startEncrypt(CryptBufBase *cbbp, mobs::ObjectBase *keyInfo) {
     {
       case CS_utf8_bom:
       case CS_utf8:
-        lo = std::locale(lo, new std::codecvt_utf8<wchar_t, 0x10ffff, std::little_endian>);
+        lo = std::locale(lo, new codec_utf8);
         break;
       case CS_iso8859_1:
         lo = std::locale(lo, new codec_iso8859_1);
@@ -62,6 +62,7 @@ ObjRegister(MrpcPing);
 
 int errors = 0;
 int queries = 0;
+bool compression = false;
 
 // ist wait4connected gesetzt, so wird jede Verbindung geprüft, bevor Kommandos gesendet werden, ansonsten nur bei Key refresh
 void clientWorker(mobs::MrpcSession &clientSession, bool wait4connected) {
@@ -70,8 +71,10 @@ void clientWorker(mobs::MrpcSession &clientSession, bool wait4connected) {
     if (not xstream.is_open())
       throw runtime_error("cann't connect");
     xstream.exceptions(std::iostream::failbit | std::iostream::badbit);
+    xstream.setNoDelay(true);
     LOG(LM_INFO, "CONNECTED");
     mobs::MrpcEc client(xstream, xstream, &clientSession, false);
+    client.setCompression(compression);
     string id = clientSession.keyName;
     LOG(LM_INFO, "KVALID " << clientSession.keyValid());
     client.startSession(id, "test", id + ".priv", "12345", clientSession.publicServerKey);
@@ -133,6 +136,7 @@ void usage() {
   cerr << "usage: mrpcsrv \n"
        << " -P Port default = '4444'\n"
        << " -w warte auf connected\n"
+       << " -z Kompression anbieten\n"
        << " -v Debug-Level\n";
 
   exit(1);
@@ -164,7 +168,7 @@ int main(int argc, char* argv[]) {
 
   try {
     int ch;
-    while ((ch = getopt(argc, argv, "P:vw")) != -1) {
+    while ((ch = getopt(argc, argv, "P:vwz")) != -1) {
       switch (ch) {
         case 'P':
           port = optarg;
@@ -175,6 +179,9 @@ int main(int argc, char* argv[]) {
         case 'w':
           wait = true;
           break;
+        case 'z':
+          compression = true;
+          break;
         case '?':
         default:
           usage();
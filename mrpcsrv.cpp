@@ -35,8 +35,10 @@
 #include <getopt.h>
 #include <sstream>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <thread>
-#include <mutex>
+#include <atomic>
+#include <unistd.h>
 
 using namespace std;
 
@@ -113,61 +115,33 @@ public:
 
   void keyChanged(const std::vector<u_char> &cipher, const std::string &keyId) override {
     LOG(LM_INFO, "SRV KEYCHANGE RECEIVED " << keyId);
-    string cipherStr = mobs::to_string_base64(cipher);
-    {
-      std::lock_guard<std::mutex> guard(mutex);
-      lastSessions.erase(cipherStr);
-    }
     if (not session)
       throw std::runtime_error("session missing");
     setEcdhSessionKey(cipher, privKey, "");
-    lastSessions.emplace(cipherStr, *session);
-    clientCipher = cipherStr;
+    storeSession(*sessionStore, cipher);
   }
 
   void loginReceived(const std::vector<u_char> &cipher, const std::string &keyId) override {
     LOG(LM_INFO, "SRV LOGIN RECEIVED " << keyId);
-    std::vector<u_char> key;
-
-    string cipherStr = mobs::to_string_base64(cipher);
-    auto it = lastSessions.find(cipherStr);
-    if (it == lastSessions.end() or (not keyId.empty() and keyId != it->second.keyName)) {
-      if (not session)
-        throw std::runtime_error("session missing");
-      setEcdhSessionKey(cipher, privKey, "");
-
-      {
-        static int snr = 0;
-        session->sessionId = ++snr;
-        session->sessionReuseTime = 120;
-        session->keyValidTime = 10;
-        LOG(LM_INFO, "NEW    " << session->sessionId);
-      }
-      //session->generated = time(nullptr);
-      {
-        std::lock_guard<std::mutex> guard(mutex);
-        if (it == lastSessions.end())
-          it = lastSessions.emplace(cipherStr, *session).first;
-        else
-          it->second = *session;
-        // abgelaufenen Sessions aufräumen
-        for (auto i = lastSessions.begin(); i != lastSessions.end(); ) {
-          LOG(LM_INFO, "VSEC " << i->second.keyValid() << " sec: "  << i->second.sessionId);
-          if (i->second.expired()) {
-            LOG(LM_INFO, "ERASE old session " << i->second.sessionId);
-            i = lastSessions.erase(i);
-          }
-          else
-            i++;
-        }
-      }
-      LOG(LM_INFO, "CURRENT SESSIONS " << lastSessions.size());
-      clientCipher = cipherStr;
-    }
-    else {
-      *session = it->second;
+    if (not session)
+      throw std::runtime_error("session missing");
+    if (resumeSession(*sessionStore, cipher, keyId)) {
       LOG(LM_INFO, "REUSE OLD SESSION KEY " << session->sessionId);
+      // Zeitpunkt der letzten Verwendung aktualisieren
+      storeSession(*sessionStore, cipher);
+      return;
     }
+    setEcdhSessionKey(cipher, privKey, "");
+    {
+      static std::atomic_int snr{0};
+      session->sessionId = ++snr;
+      session->sessionReuseTime = 120;
+      session->keyValidTime = 10;
+      LOG(LM_INFO, "NEW    " << session->sessionId);
+    }
+    storeSession(*sessionStore, cipher);
+    // abgelaufene Sessions aufräumen
+    LOG(LM_INFO, "CURRENT SESSIONS " << sessionStore->cleanup());
   }
 
   void authenticated(const std::string &login, const std::string &host, const std::string &software) override {
@@ -180,14 +154,12 @@ public:
 
   mobs::tcpstream &tcpstream;
   mobs::MrpcSession mrpcSession{};
-  std::string clientCipher;
   std::string privKey;
-  static std::mutex mutex;
-  static map<string, mobs::MrpcSession> lastSessions;
+  static std::unique_ptr<mobs::MrpcSessionStore> sessionStore;
 };
 
-map<string, mobs::MrpcSession> MrpcServer::lastSessions;
-std::mutex MrpcServer::mutex;
+std::unique_ptr<mobs::MrpcSessionStore> MrpcServer::sessionStore;
+bool compression = false;
 
 
 
@@ -209,8 +181,10 @@ void server(mobs::TcpAccept &tcpAccept, int t) {
       mobs::tcpstream xstream(tcpAccept);
       xstream.exceptions(std::iostream::failbit | std::iostream::badbit);
       TLOG(LM_INFO, "Remote: " << xstream.getRemoteHost() << " " << xstream.getRemoteIp());
+      xstream.setNoDelay(true);
 
       MrpcServer server(xstream, mobs::readPrivateKey("srv.priv", "00000"));
+      server.setCompression(compression);
       while (not server.eot()) {
         server.parseServer();
         TLOG(LM_INFO, "Parser");
@@ -245,18 +219,24 @@ void server(mobs::TcpAccept &tcpAccept, int t) {
         else if (auto res = server.getResult<LoadFile>()) {
           LoadFile p;
           p.name("log");
+          int fd = ::open(p.name().c_str(), O_RDONLY);
+          if (fd < 0)
+            THROW("open failed");
           struct stat sbuf;
-          if (::stat("log", &sbuf) != 0)
+          if (::fstat(fd, &sbuf) != 0) {
+            ::close(fd);
             THROW("stat failed");
+          }
           p.length(sbuf.st_size);
           server.sendSingle(p, sbuf.st_size);
-          auto &str = server.outByteStream();
-          ifstream istr(p.name());
-          if (not istr.is_open())
-            THROW("open failed");
-          str << istr.rdbuf();
-          istr.close();
-          auto sz = server.closeOutByteStream();
+          std::streamsize sz;
+          try {
+            sz = server.sendAttachment(fd, 0, sbuf.st_size);
+          } catch (...) {
+            ::close(fd);
+            throw;
+          }
+          ::close(fd);
           LOG(LM_INFO, "Bytes written " << sz);
           server.writer.putc('\n');
           server.writer.sync();
@@ -294,6 +274,8 @@ void server(mobs::TcpAccept &tcpAccept, int t) {
 void usage() {
   cerr << "usage: mrpcsrv \n"
        << " -P Port default = '4444'\n"
+       << " -S Datei zur Sicherung der Sessions, default keine\n"
+       << " -z Kompression zulassen\n"
        << " -v Debug-Level\n";
 
   exit(1);
@@ -303,22 +285,30 @@ void usage() {
 int main(int argc, char* argv[]) {
   logging::currentLevel = logging::lm_info;
   string port = "4444";
+  string sessionFile;
 
   try {
     int ch;
-    while ((ch = getopt(argc, argv, "P:v")) != -1) {
+    while ((ch = getopt(argc, argv, "P:S:vz")) != -1) {
       switch (ch) {
         case 'P':
           port = optarg;
           break;
+        case 'S':
+          sessionFile = optarg;
+          break;
         case 'v':
           logging::currentLevel = logging::lm_debug;
           break;
+        case 'z':
+          compression = true;
+          break;
         case '?':
         default:
           usage();
       }
     }
+    MrpcServer::sessionStore.reset(new mobs::MrpcSessionStore(sessionFile));
     mobs::generateCryptoKey(mobs::CryptECprime256v1, "srv.priv", "srv.pub", "00000");
 
     mobs::TcpAccept tcpAccept;
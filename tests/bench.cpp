@@ -0,0 +1,453 @@
+// Bibliothek zur einfachen Verwendung serialisierbarer C++-Objekte
+// für Datenspeicherung und Transport
+//
+// Copyright 2026 Matthias Lautner
+//
+// This is part of MObs https://github.com/AlMarentu/MObs.git
+//
+// MObs is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/* Benchmarks für Serialisierung, Parser, Datenbank, Krypto-Streams und Cache
+ *
+ * Aufruf mit Ausgabe als JSON zum Vergleich über mehrere Versionen:
+ *   mobs_bench --benchmark_out=bench.json --benchmark_out_format=json
+ *
+ * Alle Testdaten werden mit fester Saat erzeugt und sind damit reproduzierbar.
+ */
+
+#include "objgen.h"
+#include "mchrono.h"
+#include "xmlout.h"
+#include "xmlwriter.h"
+#include "xmlread.h"
+#include "dbifc.h"
+#include "querygenerator.h"
+#include "lrucache.h"
+#include "csb.h"
+#include "aes.h"
+#include "compress.h"
+#include "logging.h"
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <random>
+#include <sstream>
+
+
+namespace {
+
+// flaches Objekt mit gemischten Typen
+class BFlat : virtual public mobs::ObjectBase {
+public:
+  ObjInit(BFlat);
+  MemVar(int, id, KEYELEMENT1);
+  MemVar(int, version, VERSIONFIELD);
+  MemVar(std::string, name);
+  MemVar(std::string, city);
+  MemVar(double, amount);
+  MemVar(bool, active);
+  MemVar(mobs::MTime, changed);
+  MemVar(int64_t, counter);
+};
+
+#define BENCH_FIELDS(n) MemVar(std::string, s##n); MemVar(int, i##n)
+
+// breites Objekt mit 32 Elementen
+class BWide : virtual public mobs::ObjectBase {
+public:
+  ObjInit(BWide);
+  BENCH_FIELDS(0); BENCH_FIELDS(1); BENCH_FIELDS(2); BENCH_FIELDS(3);
+  BENCH_FIELDS(4); BENCH_FIELDS(5); BENCH_FIELDS(6); BENCH_FIELDS(7);
+  BENCH_FIELDS(8); BENCH_FIELDS(9); BENCH_FIELDS(10); BENCH_FIELDS(11);
+  BENCH_FIELDS(12); BENCH_FIELDS(13); BENCH_FIELDS(14); BENCH_FIELDS(15);
+};
+
+// tief geschachteltes Objekt
+class BLeaf : virtual public mobs::ObjectBase {
+public:
+  ObjInit(BLeaf);
+  MemVar(int, a);
+  MemVar(std::string, b);
+};
+
+class BLevel3 : virtual public mobs::ObjectBase {
+public:
+  ObjInit(BLevel3);
+  MemObj(BLeaf, leaf);
+  MemVector(BLeaf, leaves);
+};
+
+class BLevel2 : virtual public mobs::ObjectBase {
+public:
+  ObjInit(BLevel2);
+  MemVar(std::string, tag);
+  MemObj(BLevel3, l3);
+};
+
+class BLevel1 : virtual public mobs::ObjectBase {
+public:
+  ObjInit(BLevel1);
+  MemObj(BLevel2, l2);
+  MemVector(BLevel2, items);
+};
+
+class BNested : virtual public mobs::ObjectBase {
+public:
+  ObjInit(BNested);
+  MemVar(int, id, KEYELEMENT1);
+  MemObj(BLevel1, l1);
+  MemVector(BLevel1, branches);
+};
+
+// Objekt mit großen Vektoren
+class BVector : virtual public mobs::ObjectBase {
+public:
+  ObjInit(BVector);
+  MemVarVector(int, values);
+  MemVector(BFlat, rows);
+};
+
+
+std::string randomText(std::mt19937 &rnd, size_t len, bool ascii = false) {
+  static const std::string chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789";
+  static const char *umlaut[] = { u8"ä", u8"ö", u8"ü", u8"ß" };
+  std::string s;
+  while (s.length() < len) {
+    auto i = size_t(rnd() % (chars.length() + (ascii ? 0 : 4)));
+    if (i < chars.length())
+      s += chars[i];
+    else
+      s += umlaut[i - chars.length()];
+  }
+  return s;
+}
+
+void generate(BFlat &o, std::mt19937 &rnd, int i) {
+  o.id(i);
+  o.name(randomText(rnd, 20));
+  o.city(randomText(rnd, 12));
+  o.amount(double(rnd() % 1000000) / 100);
+  o.active(rnd() % 2 == 0);
+  o.changed(mobs::MTime(std::chrono::microseconds(1600000000000000LL + int64_t(rnd() % 100000000) * 1000)));
+  o.counter(int64_t(rnd()));
+}
+
+void generate(BWide &o, std::mt19937 &rnd, int) {
+  std::stringstream s;
+  s << '{';
+  for (int i = 0; i < 16; i++)
+    s << (i ? "," : "") << "s" << i << ":\"" << randomText(rnd, 16) << "\",i" << i << ':' << int(rnd() % 100000);
+  s << '}';
+  mobs::string2Obj(s.str(), o, mobs::ConvObjFromStr());
+}
+
+void generate(BLevel2 &o, std::mt19937 &rnd) {
+  o.tag(randomText(rnd, 8));
+  o.l3.leaf.a(int(rnd() % 1000));
+  o.l3.leaf.b(randomText(rnd, 8));
+  for (int i = 0; i < 4; i++) {
+    o.l3.leaves[size_t(i)].a(int(rnd() % 1000));
+    o.l3.leaves[size_t(i)].b(randomText(rnd, 8));
+  }
+}
+
+void generate(BNested &o, std::mt19937 &rnd, int i) {
+  o.id(i);
+  generate(o.l1.l2, rnd);
+  for (size_t b = 0; b < 4; b++) {
+    generate(o.branches[b].l2, rnd);
+    for (size_t j = 0; j < 3; j++)
+      generate(o.branches[b].items[j], rnd);
+  }
+}
+
+void generate(BVector &o, std::mt19937 &rnd, int n) {
+  for (size_t i = 0; i < size_t(n); i++)
+    o.values[i](int(rnd()));
+  for (size_t i = 0; i < size_t(n) / 10; i++)
+    generate(o.rows[i], rnd, int(i));
+}
+
+template<class T>
+void generate(T &o, int n = 1) {
+  std::mt19937 rnd(4711);
+  generate(o, rnd, n);
+}
+
+
+template<class T>
+class BenchXmlReader : public mobs::XmlReader {
+public:
+  BenchXmlReader(const std::string &s, T &o) : XmlReader(s), obj(o) {}
+  void StartTag(const std::string &ns, const std::string &element) override {
+    if (element == "root")
+      fill(&obj);
+  }
+  void filled(mobs::ObjectBase *, const std::string &error) override {
+    if (not error.empty())
+      throw std::runtime_error(error);
+  }
+private:
+  T &obj;
+};
+
+template<class T>
+std::string toXml(const T &o) {
+  mobs::XmlWriter w;
+  mobs::XmlOut xo(&w, mobs::ConvObjToString());
+  w.writeHead();
+  o.traverse(xo);
+  return w.getString();
+}
+
+
+template<class T>
+void BM_JsonWrite(benchmark::State &state) {
+  T o;
+  generate(o, int(state.range(0)));
+  size_t bytes = 0;
+  for (auto _ : state) {
+    std::string s = o.to_string(mobs::ConvObjToString().exportJson());
+    bytes += s.length();
+    benchmark::DoNotOptimize(s);
+  }
+  state.SetBytesProcessed(int64_t(bytes));
+}
+
+template<class T>
+void BM_JsonRead(benchmark::State &state) {
+  T o;
+  generate(o, int(state.range(0)));
+  std::string s = o.to_string(mobs::ConvObjToString().exportJson());
+  for (auto _ : state) {
+    T r;
+    mobs::string2Obj(s, r, mobs::ConvObjFromStr());
+    benchmark::DoNotOptimize(r);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations() * s.length()));
+}
+
+template<class T>
+void BM_XmlWrite(benchmark::State &state) {
+  T o;
+  generate(o, int(state.range(0)));
+  size_t bytes = 0;
+  for (auto _ : state) {
+    std::string s = toXml(o);
+    bytes += s.length();
+    benchmark::DoNotOptimize(s);
+  }
+  state.SetBytesProcessed(int64_t(bytes));
+}
+
+template<class T>
+void BM_XmlRead(benchmark::State &state) {
+  T o;
+  generate(o, int(state.range(0)));
+  std::string s = toXml(o);
+  for (auto _ : state) {
+    T r;
+    BenchXmlReader<T> reader(s, r);
+    reader.parse();
+    benchmark::DoNotOptimize(r);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations() * s.length()));
+}
+
+#define BENCH_SHAPES(bm) \
+  BENCHMARK_TEMPLATE(bm, BFlat)->Arg(1); \
+  BENCHMARK_TEMPLATE(bm, BWide)->Arg(1); \
+  BENCHMARK_TEMPLATE(bm, BNested)->Arg(1); \
+  BENCHMARK_TEMPLATE(bm, BVector)->Arg(100)->Arg(10000)
+
+BENCH_SHAPES(BM_JsonWrite);
+BENCH_SHAPES(BM_JsonRead);
+BENCH_SHAPES(BM_XmlWrite);
+BENCH_SHAPES(BM_XmlRead);
+
+
+#ifdef USE_SQLITE
+// SQLite-Datenbank mit n Datensätzen
+class SqliteFixture : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State &state) override {
+    std::remove(dbFile.c_str());
+    dbMgr = std::unique_ptr<mobs::DatabaseManager>(new mobs::DatabaseManager);
+    dbMgr->addConnection("bench", mobs::ConnectionInformation("sqlite://" + dbFile, ""));
+    dbi = std::unique_ptr<mobs::DatabaseInterface>(new mobs::DatabaseInterface(dbMgr->getDbIfc("bench")));
+    BFlat o;
+    dbi->structure(o);
+    std::mt19937 rnd(4711);
+    mobs::DatabaseManager::transaction_callback cb = [&](mobs::DbTransaction *trans) {
+      mobs::DatabaseInterface t = trans->getDbIfc("bench");
+      for (int i = 1; i <= rows; i++) {
+        generate(o, rnd, i);
+        o.version(0);
+        t.save(o);
+      }
+    };
+    mobs::DatabaseManager::execute(cb);
+  }
+
+  void TearDown(const benchmark::State &state) override {
+    dbi.reset();
+    dbMgr.reset();
+    std::remove(dbFile.c_str());
+  }
+
+  const std::string dbFile = "/tmp/mobs_bench.db";
+  const int rows = 1000;
+  std::unique_ptr<mobs::DatabaseManager> dbMgr;
+  std::unique_ptr<mobs::DatabaseInterface> dbi;
+};
+
+BENCHMARK_F(SqliteFixture, Save)(benchmark::State &state) {
+  std::mt19937 rnd(815);
+  BFlat o;
+  int i = 0;
+  for (auto _ : state) {
+    o.id(1 + i++ % rows);
+    dbi->load(o);
+    o.name(randomText(rnd, 20));
+    dbi->save(o);
+  }
+}
+
+BENCHMARK_F(SqliteFixture, Load)(benchmark::State &state) {
+  BFlat o;
+  int i = 0;
+  for (auto _ : state) {
+    o.id(1 + i++ % rows);
+    if (not dbi->load(o))
+      state.SkipWithError("not found");
+  }
+}
+
+BENCHMARK_F(SqliteFixture, Query)(benchmark::State &state) {
+  BFlat o;
+  size_t cnt = 0;
+  for (auto _ : state) {
+    auto cursor = dbi->query(o, mobs::QueryGenerator());
+    for (; not cursor->eof(); cursor->next(), cnt++)
+      dbi->retrieve(o, cursor);
+  }
+  state.SetItemsProcessed(int64_t(cnt));
+}
+#endif
+
+
+std::string randomData(size_t n) {
+  std::mt19937 rnd(4711);
+  std::string s;
+  s.reserve(n);
+  // teilweise wiederholende Daten, damit die Kompression etwas zu tun hat
+  while (s.length() < n)
+    s += randomText(rnd, 64 + rnd() % 64, true) + "\n";
+  s.resize(n);
+  return s;
+}
+
+void BM_AesEncrypt(benchmark::State &state) {
+  std::string data = randomData(size_t(state.range(0)));
+  std::vector<u_char> key(mobs::CryptBufAes::key_size(), '1');
+  std::vector<u_char> iv(mobs::CryptBufAes::iv_size(), '0');
+  for (auto _ : state) {
+    std::stringstream ss;
+    mobs::CryptOstrBuf streambuf(ss, new mobs::CryptBufAes(key, iv));
+    std::wostream out(&streambuf);
+    out << mobs::to_wstring(data);
+    streambuf.finalize();
+    benchmark::DoNotOptimize(ss);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations() * data.length()));
+}
+BENCHMARK(BM_AesEncrypt)->Arg(1 << 16)->Arg(1 << 20);
+
+void BM_AesDecrypt(benchmark::State &state) {
+  std::string data = randomData(size_t(state.range(0)));
+  std::vector<u_char> key(mobs::CryptBufAes::key_size(), '1');
+  std::vector<u_char> iv(mobs::CryptBufAes::iv_size(), '0');
+  std::stringstream enc;
+  {
+    mobs::CryptOstrBuf streambuf(enc, new mobs::CryptBufAes(key, iv));
+    std::wostream out(&streambuf);
+    out << mobs::to_wstring(data);
+    streambuf.finalize();
+  }
+  std::string cipher = enc.str();
+  for (auto _ : state) {
+    std::stringstream ss(cipher);
+    mobs::CryptIstrBuf streambuf(ss, new mobs::CryptBufAes(key, iv));
+    std::wistream in(&streambuf);
+    std::wstring res;
+    std::getline(in, res, L'\0');
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations() * data.length()));
+}
+BENCHMARK(BM_AesDecrypt)->Arg(1 << 16)->Arg(1 << 20);
+
+void BM_Deflate(benchmark::State &state) {
+  std::string data = randomData(size_t(state.range(0)));
+  size_t out = 0;
+  for (auto _ : state) {
+    std::stringstream ss;
+    auto deflate = new mobs::CryptBufDeflate;
+    mobs::CryptOstrBuf streambuf(ss, deflate);
+    std::wostream os(&streambuf);
+    os << mobs::to_wstring(data);
+    streambuf.finalize();
+    out = ss.str().length();
+  }
+  state.SetBytesProcessed(int64_t(state.iterations() * data.length()));
+  state.counters["ratio"] = double(out) / double(data.length());
+}
+BENCHMARK(BM_Deflate)->Arg(1 << 16)->Arg(1 << 20);
+
+
+void BM_LruCache(benchmark::State &state) {
+  auto n = size_t(state.range(0));
+  std::vector<std::string> keys;
+  std::mt19937 rnd(4711);
+  for (size_t i = 0; i < n; i++)
+    keys.push_back(randomText(rnd, 16));
+  std::uniform_int_distribution<size_t> dist(0, n - 1);
+  mobs::LRUCache<BFlat> cache;
+  for (auto &k:keys)
+    cache.insert(k, std::make_shared<BFlat>(), 100);
+  for (auto _ : state) {
+    const std::string &k = keys[dist(rnd)];
+    auto p = cache.lookup(k);
+    if (not p)
+      cache.insert(k, std::make_shared<BFlat>(), 100);
+    if (dist(rnd) % 16 == 0) {
+      cache.erase(k);
+      cache.reduceCount(n - 1);
+    }
+    benchmark::DoNotOptimize(p);
+  }
+}
+BENCHMARK(BM_LruCache)->Arg(1000)->Arg(100000);
+
+}
+
+int main(int argc, char **argv) {
+  logging::currentLevel = logging::lm_warn;
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
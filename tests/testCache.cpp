@@ -21,6 +21,7 @@
 
 #include "objcache.h"
 #include "objcache.h"
+#include "querygenerator.h"
 #include "objgen.h"
 
 #include <stdio.h>
@@ -114,5 +115,26 @@ TEST(cacheTest, simple) {
   EXPECT_EQ(0, cache.reduce(0));
 }
 
+TEST(cacheTest, select) {
+  mobs::ObjCache cache;
+  for (int i = 1; i <= 5; i++) {
+    Person p;
+    p.kundennr(i);
+    p.name(i % 2 ? "Müller" : "Huber");
+    cache.save(p);
+  }
+  KFZ k;
+  k.kennzeichen("X-1");
+  k.hersteller("Müller");
+  cache.save(k);
+
+  Person q;
+  mobs::QueryGenerator filter;
+  filter << q.name.Qi("=", "Müller");
+  auto res = cache.select(filter.compile(q));
+  ASSERT_EQ(3, res.size());
+  EXPECT_EQ(1, std::dynamic_pointer_cast<const Person>(res[0])->kundennr());
+  EXPECT_EQ(5, std::dynamic_pointer_cast<const Person>(res[2])->kundennr());
 }
 
+}
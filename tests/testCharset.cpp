@@ -332,12 +332,89 @@ TEST(charsetTest, charsetStrUtf8) {
   EXPECT_EQ("€Mähr", person.name());
 }
 
+TEST(charsetTest, utf8Block) {
+  std::string ascii(100, 'x');
+  std::string s = ascii + u8"€Mähr" + ascii + u8"\U0001F600" + ascii;
+  std::wstring w = to_wstring(s);
+  ASSERT_EQ(307, w.length());
+  EXPECT_EQ(L'€', w[100]);
+  EXPECT_EQ(0xd83d, w[205]);
+  EXPECT_EQ(0xde00, w[206]);
+  EXPECT_EQ(s, to_string(w));
+  EXPECT_EQ(306, to_u32string(s).length());
+  EXPECT_EQ(s, to_string(to_u32string(s)));
+  EXPECT_TRUE(utf8_valid(s.c_str(), s.length()));
+  EXPECT_EQ(100, ascii_prefix(s.c_str(), s.length()));
+
+  // Fehlerfälle wie std::codecvt_utf8
+  EXPECT_FALSE(utf8_valid((s + "\xc0\x80").c_str(), s.length() + 2));
+  EXPECT_FALSE(utf8_valid((s + "\xed\xa0\x80").c_str(), s.length() + 3));
+  EXPECT_FALSE(utf8_valid((s + "\xe2\x82").c_str(), s.length() + 2));
+  EXPECT_ANY_THROW(to_wstring(ascii + "\xff" + ascii));
+  std::wstring u;
+  EXPECT_EQ(100, utf8_decode((ascii + "\xc0\x80").c_str(), 102, u));
+  EXPECT_EQ(std::wstring(100, L'x'), u);
+
+  std::string l(200, 'a');
+  l[150] = char(0xe4);
+  std::wstring wl(l.length(), L' ');
+  widen_latin1(l.c_str(), l.length(), &wl[0]);
+  EXPECT_EQ(L'ä', wl[150]);
+  std::string l2(wl.length(), ' ');
+  EXPECT_EQ(150, narrow_ascii(wl.c_str(), wl.length(), &l2[0]));
+  EXPECT_EQ(200, narrow_latin1(wl.c_str(), wl.length(), &l2[0]));
+  EXPECT_EQ(l, l2);
+  wl[180] = L'€';
+  EXPECT_EQ(180, narrow_latin1(wl.c_str(), wl.length(), &l2[0]));
+
+  Person p;
+  p.name(ascii + u8"€Mähr" + ascii);
+  XmlWriter xf(mobs::XmlWriter::CS_utf8, false);
+  XmlOut xo(&xf, ConvObjToString().exportXml());
+  p.traverse(xo);
+  XmlInput xr(xf.getString());
+  EXPECT_NO_THROW(xr.parse());
+  EXPECT_EQ(p.name(), person.name());
+}
+
 TEST(charsetTest, upperLower) {
   EXPECT_EQ(wstring(L"möèt"), mobs::toLower(L"MÖÈT"));
   EXPECT_EQ(wstring(L"MÖÈT"), mobs::toUpper(L"möèt"));
   EXPECT_EQ(string(u8"möètßa"), mobs::toLower(u8"MÖÈTßa"));
   EXPECT_EQ(string(u8"MÖÈTAß"), mobs::toUpper(u8"möètAß"));
+  EXPECT_EQ(string(u8"łódź ÿ i"), mobs::toLower(u8"ŁÓDŹ Ÿ İ"));
+  EXPECT_EQ(string(u8"ŁÓDŹ Ÿ I"), mobs::toUpper(u8"łódź ÿ ı"));
+  EXPECT_EQ(wstring(L"I"), mobs::toUpper(L"i"));
+  EXPECT_EQ(string("ISTANBUL"), mobs::toUpper(u8"istanbul"));
+  EXPECT_EQ(wstring(L"i"), mobs::toLower(L"\u0130"));
+
+  string s = u8"schon klein: äöü ß 123";
+  EXPECT_FALSE(mobs::toLowerInplace(s));
+  EXPECT_EQ(string(u8"schon klein: äöü ß 123"), s);
+  EXPECT_TRUE(mobs::toUpperInplace(s));
+  EXPECT_EQ(string(u8"SCHON KLEIN: ÄÖÜ ß 123"), s);
+  s = "ab\xff\xc3" "Cd";
+  EXPECT_TRUE(mobs::toLowerInplace(s));
+  EXPECT_EQ(string("ab\xff\xc3" "cd"), s);
+
+}
 
+TEST(charsetTest, to7Up) {
+  string u8 = u8"Goethe Müller 1223 Çelik";
+  wstring w = mobs::to_wstring(u8);
+  vector<string> t1, t2;
+  for (auto it = u8.cbegin(); it != u8.cend();) {
+    string r;
+    it = mobs::to7Up(it, u8.cend(), r);
+    t1.push_back(r);
+  }
+  for (auto it = w.cbegin(); it != w.cend();) {
+    string r;
+    it = mobs::to7Up(it, w.cend(), r);
+    t2.push_back(r);
+  }
+  EXPECT_EQ(vector<string>({"GOTHE", "MULER", "123", "CELIK"}), t1);
+  EXPECT_EQ(t2, t1);
 }
 
 TEST(charsetTest, uuid) {
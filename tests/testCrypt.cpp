@@ -27,6 +27,9 @@
 #include "rsa.h"
 #include "digest.h"
 #include "digest.h"
+#ifdef USE_ZLIB
+#include "compress.h"
+#endif
 #include "objtypes.h"
 #include "objgen.h"
 
@@ -424,6 +427,43 @@ TEST(cryptTest, sharedSecret) {
 
 }
 
+TEST(cryptTest, keyHandle) {
+  string privU, pubU;
+  string privS, pubS;
+  ASSERT_NO_THROW(mobs::generateCryptoKeyMem(mobs::CryptECprime256v1, privU, pubU, "12345"));
+  ASSERT_NO_THROW(mobs::generateCryptoKeyMem(mobs::CryptECprime256v1, privS, pubS, "54321"));
+
+  mobs::CryptKey keyPrivU, keyPubS;
+  EXPECT_TRUE(keyPrivU.empty());
+  ASSERT_NO_THROW(keyPrivU = mobs::CryptKey::privateKey(privU, "12345"));
+  ASSERT_NO_THROW(keyPubS = mobs::CryptKey::publicKey(pubS));
+  EXPECT_FALSE(keyPrivU.empty());
+  EXPECT_ANY_THROW(mobs::CryptKey::privateKey(privU, "54321"));
+  EXPECT_ANY_THROW(mobs::CryptKey::publicKey("/nonexistent/key.pem"));
+
+  std::vector<u_char> cipherU;
+  std::vector<u_char> cipherS;
+  ASSERT_NO_THROW(mobs::deriveSharedSecret(cipherU, keyPubS, keyPrivU));
+  ASSERT_NO_THROW(mobs::deriveSharedSecret(cipherS, pubU, privS, "54321"));
+  EXPECT_EQ(cipherU, cipherS);
+
+  std::vector<u_char> data = {'H', 'a', 'L', 'L', 'o', '\0'};
+  std::vector<u_char> sig;
+  ASSERT_NO_THROW(mobs::digestSign(data, sig, keyPrivU));
+  EXPECT_TRUE(mobs::digestVerify(data, sig, pubU));
+  EXPECT_TRUE(mobs::digestVerify(data, sig, mobs::CryptKey::publicKey(pubU)));
+
+  // falsche Passphrase darf auch bei gecachtem Schlüssel nicht funktionieren
+  EXPECT_TRUE(mobs::checkPassword(privU, "12345"));
+  EXPECT_FALSE(mobs::checkPassword(privU, "54321"));
+  ASSERT_NO_THROW(mobs::keyCacheClear());
+  EXPECT_TRUE(mobs::checkPassword(privU, "12345"));
+  ASSERT_NO_THROW(mobs::keyCacheSize(0));
+  EXPECT_TRUE(mobs::checkPassword(privU, "12345"));
+  EXPECT_FALSE(mobs::checkPassword(privU, "54321"));
+  ASSERT_NO_THROW(mobs::keyCacheSize(32));
+}
+
 
 TEST(cryptTest, ecdh) {
   string privS, pubS;
@@ -529,6 +569,89 @@ TEST(cryptTest, rsaChange) {
 
 
 
+#ifdef USE_ZLIB
+TEST(cryptTest, deflate1) {
+  std::string text;
+  for (int i = 0; i < 2000; i++)
+    text += "<Person><name>Fischers Fritz</name><nr>" + std::to_string(i) + "</nr></Person>";
+  std::stringstream ss;
+  auto cmp = new mobs::CryptBufDeflate;
+  mobs::CryptOstrBuf streambuf(ss, cmp);
+  std::wostream xStrOut(&streambuf);
+  xStrOut << mobs::to_wstring(text);
+  streambuf.finalize();
+  EXPECT_EQ(text.length(), cmp->totalIn());
+  EXPECT_EQ(ss.str().length(), cmp->totalOut());
+  EXPECT_GT(text.length() / 10, ss.str().length());
+
+  mobs::CryptIstrBuf streambufI(ss, new mobs::CryptBufDeflate);
+  std::wistream xStrIn(&streambufI);
+  std::string res;
+  wchar_t c;
+  while (not xStrIn.get(c).eof())
+    res += u_char(c);
+  EXPECT_FALSE(streambufI.bad());
+  EXPECT_EQ(text, res);
+}
+
+TEST(cryptTest, deflateAes) {
+  std::vector<u_char> key;
+  std::vector<u_char> iv;
+  key.resize(mobs::CryptBufAes::key_size(), '1');
+  iv.resize(mobs::CryptBufAes::iv_size(), '0');
+  std::string text;
+  for (int i = 0; i < 500; i++)
+    text += "Fischers Fritz fischt frische Fische " + std::to_string(i) + "\n";
+
+  std::stringstream ss;
+  auto cmp = new mobs::CryptBufDeflate(new mobs::CryptBufAes(key, iv));
+  EXPECT_EQ("deflate+aes-256-cbc", cmp->name());
+  mobs::CryptOstrBuf streambuf(ss, cmp);
+  std::wostream xStrOut(&streambuf);
+  xStrOut << mobs::CryptBufAes::base64(true);
+  xStrOut << mobs::to_wstring(text.substr(0, 100));
+  xStrOut.flush();
+  xStrOut << mobs::to_wstring(text.substr(100));
+  streambuf.finalize();
+  EXPECT_EQ(std::string::npos, ss.str().find("Fritz"));
+  EXPECT_GT(text.length() / 4, ss.str().length());
+
+  mobs::CryptIstrBuf streambufI(ss, new mobs::CryptBufDeflate(new mobs::CryptBufAes(key, iv)));
+  std::wistream xStrIn(&streambufI);
+  streambufI.getCbb()->setBase64(true);
+  std::string res;
+  wchar_t c;
+  while (not xStrIn.get(c).eof())
+    res += u_char(c);
+  EXPECT_FALSE(streambufI.bad());
+  EXPECT_EQ(text, res);
+}
+
+TEST(cryptTest, deflateLimit) {
+  std::string text(1000000, 'x');
+  std::stringstream ss;
+  mobs::CryptOstrBuf streambuf(ss, new mobs::CryptBufDeflate);
+  std::wostream xStrOut(&streambuf);
+  xStrOut << mobs::to_wstring(text);
+  streambuf.finalize();
+  EXPECT_GT(size_t(2000), ss.str().length());
+
+  for (size_t limit : { text.length(), text.length() - 1 }) {
+    std::stringstream ssI(ss.str());
+    auto cmp = new mobs::CryptBufDeflate;
+    cmp->setMaxInflated(limit);
+    mobs::CryptIstrBuf streambufI(ssI, cmp);
+    std::wistream xStrIn(&streambufI);
+    size_t cnt = 0;
+    wchar_t c;
+    while (not xStrIn.get(c).eof() and not xStrIn.bad())
+      cnt++;
+    EXPECT_EQ(limit != text.length(), streambufI.bad()) << limit;
+    EXPECT_GE(limit, cnt);
+  }
+}
+#endif
+
 TEST(cryptTest, digest1) {
 
   std::stringstream ss;
@@ -646,6 +769,84 @@ TEST(cryptTest, digest4) {
   EXPECT_ANY_THROW(mobs::hash_value(s, "gibsnich"));
 }
 
+TEST(cryptTest, treeDigest) {
+  std::string data;
+  for (int i = 0; i < 100000; i++)
+    data += char(i * 7 + i / 251);
+  mobs::TreeDigest td1("sha256", 4096, 1);
+  td1.update(data.c_str(), data.length());
+  std::string h1 = td1.hashStr();
+  EXPECT_EQ(25, td1.chunks());
+  EXPECT_EQ("tree:sha256:4096", td1.descriptor());
+
+  // unabhängig von Threads und Aufteilung der Eingabe
+  mobs::TreeDigest td4("sha256", 4096, 4);
+  for (size_t i = 0; i < data.length(); i += 1000)
+    td4.update(&data[i], std::min(size_t(1000), data.length() - i));
+  EXPECT_EQ(h1, td4.hashStr());
+  std::istringstream in(data);
+  EXPECT_EQ(h1, mobs::tree_hash_value(in, "sha256", 4096));
+  std::istringstream in2(data);
+  EXPECT_NE(h1, mobs::tree_hash_value(in2, "sha256", 8192));
+
+  // Wurzel aus Kennung und Block-Hashes
+  std::string leaves;
+  for (size_t i = 0; i < data.length(); i += 4096) {
+    std::vector<u_char> chunk(1, 0);
+    chunk.insert(chunk.end(), data.begin() + i, data.begin() + std::min(i + 4096, data.length()));
+    std::vector<u_char> h;
+    mobs::hash_value(chunk, h, "sha256");
+    leaves += std::string(h.begin(), h.end());
+  }
+  EXPECT_EQ(h1, mobs::hash_value(std::string(1, '\1') + "tree:sha256:4096" + leaves, "sha256"));
+
+  mobs::digestStream ds("sha256", 4096, 2);
+  ds << data;
+  EXPECT_EQ(h1, ds.hashStr());
+  EXPECT_ANY_THROW(ds.uuid());
+  // auch mit einem für UUIDs zulässigen Verfahren nach Abschluss des Hashes
+  mobs::digestStream ds1("sha1", 4096);
+  ds1 << data;
+  EXPECT_FALSE(ds1.hashStr().empty());
+  EXPECT_ANY_THROW(ds1.uuid());
+
+  std::wstring text;
+  for (int i = 0; i < 20000; i++)
+    text += wchar_t(L'a' + i % 26);
+  mobs::TreeDigest td("sha256", 4096);
+  std::string t = mobs::to_string(text);
+  td.update(t.c_str(), t.length());
+  std::stringstream ss;
+  auto md = new mobs::CryptBufDigest("sha256");
+  md->treeHash(4096);
+  mobs::CryptOstrBuf streambuf(ss, md);
+  std::wostream xStrOut(&streambuf);
+  xStrOut << text;
+  streambuf.finalize();
+  EXPECT_EQ(t, ss.str());
+  EXPECT_EQ(td.hashStr(), md->hashStr());
+
+  EXPECT_ANY_THROW(mobs::TreeDigest("gibsnich"));
+}
+
+TEST(cryptTest, hashValues) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < 10000; i++)
+    keys.push_back("Fahrzeug." + std::to_string(i));
+  auto res = mobs::hash_values(keys, "sha1", 3);
+  ASSERT_EQ(keys.size(), res.size());
+  EXPECT_EQ(mobs::hash_value(keys[0]), res[0]);
+  EXPECT_EQ(mobs::hash_value(keys[7777]), res[7777]);
+  EXPECT_EQ(mobs::hash_value(keys[9999]), res[9999]);
+
+  std::vector<std::vector<u_char>> bufs{{}, {'a', 'b', 'c'}};
+  auto res2 = mobs::hash_values(bufs, "md5");
+  ASSERT_EQ(2, res2.size());
+  EXPECT_EQ("d41d8cd98f00b204e9800998ecf8427e", res2[0]);
+  EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", res2[1]);
+  EXPECT_ANY_THROW(mobs::hash_values(keys, "gibsnich"));
+}
+
 TEST(cryptTest, uuid) {
   mobs::digestStream ds("md5");
   std::vector<u_char> domain({0x6b, 0xa7, 0xb8, 0x10, 0x9d, 0xad, 0x11, 0xd1, 0x80, 0xb4, 0x00, 0xc0, 0x4f, 0xd4, 0x30, 0xc8});
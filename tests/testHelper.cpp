@@ -22,12 +22,25 @@
 #include "objgen.h"
 #include "queryorder.h"
 #include "querygenerator.h"
+#include "queryprojection.h"
 #include "helper.h"
 #include "audittrail.h"
+#include "auditwriter.h"
+#include "blobstore.h"
+#include "dbifc.h"
 #include "logging.h"
+#include "metrics.h"
+#ifdef USE_SQLITE
+#include "sqlite.h"
+#endif
 
 #include <sstream>
+#include <fstream>
+#include <atomic>
 #include <chrono>
+#include <thread>
+#include <functional>
+#include <unistd.h>
 #include <gtest/gtest.h>
 
 
@@ -440,6 +453,622 @@ TEST(helperTest, sql) {
 
 
 
+TEST(helperTest, statementCache) {
+  ObjA3 a3;
+  a3.k3kk(7);
+  a3.oa3.o2oo[0].a1bc("XX");
+  a3.oa3.o2oo[1].c1de(4);
+  SQLDBTestDesc sd;
+
+  auto generate = [&]() {
+    mobs::SqlGenerator gsql(a3, sd);
+    std::vector<std::string> res;
+    for (bool first = true; first or not gsql.eof(); first = false)
+      res.push_back(gsql.createStatement(first));
+    for (bool first = true; first or not gsql.eof(); first = false)
+      res.push_back(gsql.dropStatement(first));
+    for (bool first = true; first or not gsql.eof(); first = false)
+      res.push_back(gsql.insertStatement(first));
+    for (bool first = true; first or not gsql.eof(); first = false)
+      res.push_back(gsql.replaceStatement(first));
+    res.push_back(gsql.selectStatementFirst());
+    res.push_back(gsql.selectStatementFirst(true));
+    return res;
+  };
+
+  mobs::SqlGenerator::statementCache(false);
+  auto plain = generate();
+  ASSERT_EQ(13, plain.size());
+  mobs::SqlGenerator::statementCache(true);
+  mobs::SqlGenerator::clearStatementCache();
+  EXPECT_EQ(0, mobs::SqlGenerator::statementCacheSize());
+  EXPECT_EQ(plain, generate());
+  size_t sz = mobs::SqlGenerator::statementCacheSize();
+  EXPECT_LT(0, sz);
+  EXPECT_EQ(plain, generate());
+  EXPECT_EQ(sz, mobs::SqlGenerator::statementCacheSize());
+  EXPECT_EQ("insert into D.ObjA3_o2oo(k3kk,o_oo_ix,a1bc,c1de,f1gh) VALUES (7, 1,'',4,0);", plain[6]);
+
+  // Werte werden nicht gecacht
+  a3.k3kk(8);
+  mobs::SqlGenerator gsql(a3, sd);
+  EXPECT_EQ("select k3kk from D.ObjA3 where k3kk=8;", gsql.selectStatementFirst(true));
+
+  // andere Einstellungen ergeben eigene Einträge
+  sd.createWith_IfNotExists = true;
+  EXPECT_EQ(u8"create table if not exists D.ObjA3(k3kk INT NOT NULL,version INT NOT NULL,p3p VARCHAR(30) NOT NULL,o_k2kk INT NOT NULL,o_s2s VARCHAR(30) NOT NULL, primary key (k3kk));",
+            gsql.createStatement(true));
+  EXPECT_FALSE(gsql.eof());
+}
+
+
+#ifdef USE_SQLITE
+class ObjAud : virtual public mobs::ObjectBase {
+public:
+  ObjInit(ObjAud, AUDITTRAIL);
+  MemVar(int, id, KEYELEMENT1);
+  MemVar(int, version, VERSIONFIELD);
+  MemVar(std::string, name);
+};
+
+/// Test mit eigenem DatabaseManager und einer SQLite-Datenbank in einer eindeutigen temporären Datei
+class helperDbTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    dbFile = tempFile();
+    dbMgr = std::unique_ptr<mobs::DatabaseManager>(new mobs::DatabaseManager);
+  }
+
+  void TearDown() override {
+    dbMgr = nullptr;
+    for (auto &f:files) {
+      for (auto ext:{"", "-journal", "-wal", "-shm"})
+        std::remove((f + ext).c_str());
+    }
+  }
+
+  /// neue, leere temporäre Datei; wird in TearDown gelöscht
+  std::string tempFile() {
+    std::string name = "/tmp/mobs_test_XXXXXX";
+    int fd = ::mkstemp(&name[0]);
+    if (fd < 0)
+      throw std::runtime_error("can't create temporary file");
+    ::close(fd);
+    files.push_back(name);
+    return name;
+  }
+
+  /// Verbindung auf die Datenbank des Tests anmelden
+  mobs::DatabaseInterface connect(const std::string &connectionName) {
+    dbMgr->addConnection(connectionName, mobs::ConnectionInformation("sqlite://" + dbFile, ""));
+    return dbMgr->getDbIfc(connectionName);
+  }
+
+  std::string dbFile;
+  std::unique_ptr<mobs::DatabaseManager> dbMgr;
+
+private:
+  std::vector<std::string> files;
+};
+
+TEST_F(helperDbTest, auditWriter) {
+  std::string spool = tempFile();
+  mobs::DatabaseInterface dbi = connect("aw_app");
+  connect("aw_audit");
+  ASSERT_NO_THROW(dbi.structure(ObjAud()));
+
+  // Eintrag aus einem vorherigen Lauf
+  mobs::AuditQueued q;
+  q.connection("aw_audit");
+  q.activity.time(mobs::MTime(std::chrono::microseconds(1000000)));
+  q.activity.userId(1);
+  q.activity.jobId("crashed");
+  // Eintrag einer zurückgerollten Transaktion mit Storno-Satz
+  mobs::AuditQueued r(q);
+  r.txId("rolled-back");
+  mobs::AuditQueued c;
+  c.txId("rolled-back");
+  c.cancelled(true);
+  {
+    std::ofstream out(spool);
+    out << q.to_string() << '\n' << r.to_string() << '\n' << c.to_string() << '\n';
+  }
+  {
+    mobs::AuditWriter writer(mobs::AuditWriter::Synchronous, spool, 5, 3);
+    EXPECT_ANY_THROW(mobs::AuditWriter(mobs::AuditWriter::Synchronous));
+    writer.useConnection("aw_app", "aw_audit");
+    EXPECT_EQ("aw_audit", writer.auditConnection("aw_app"));
+    EXPECT_EQ("", writer.auditConnection("aw_audit"));
+    writer.flush();
+    EXPECT_EQ(1, writer.written());
+    for (int i = 1; i <= 7; i++) {
+      ObjAud o;
+      o.id(i);
+      o.name("x");
+      ASSERT_NO_THROW(dbi.save(o));
+    }
+    writer.flush();
+    EXPECT_EQ(0, writer.queued());
+    EXPECT_EQ(8, writer.written());
+    EXPECT_EQ(0, writer.failed());
+
+    // nicht schreibbarer Audit-Trail wird im Modus Synchronous an den Aufrufer gemeldet
+    mobs::DatabaseInterface dbiBad = connect("aw_bad");
+    writer.useConnection("aw_bad", "aw_missing");
+    ObjAud o;
+    o.id(20);
+    o.name("y");
+    EXPECT_ANY_THROW(dbiBad.save(o));
+    EXPECT_EQ(1, writer.failed());
+    EXPECT_EQ(8, writer.written());
+  }
+  EXPECT_EQ(nullptr, mobs::AuditWriter::instance());
+  mobs::AuditActivity aa;
+  auto cursor = dbi.withCountCursor().qbe(aa);
+  EXPECT_EQ(8, cursor->pos());
+  // nur der nicht geschriebene Eintrag verbleibt in der Spool-Datei
+  std::ifstream in(spool);
+  std::string line;
+  ASSERT_TRUE(std::getline(in, line).good());
+  EXPECT_NE(std::string::npos, line.find("aw_missing"));
+  EXPECT_FALSE(std::getline(in, line).good());
+}
+
+TEST_F(helperDbTest, keysetSqlite) {
+  mobs::DatabaseInterface dbi = connect("ks");
+  ObjAud o;
+  ASSERT_NO_THROW(dbi.structure(o));
+  for (int i = 1; i <= 25; i++) {
+    ObjAud a;
+    a.id(i);
+    a.name(i % 2 ? "odd" : "even");
+    ASSERT_NO_THROW(dbi.save(a));
+  }
+  mobs::QueryGenerator filter;
+  mobs::QueryOrder sort;
+  sort << o.name << o.id;
+  mobs::QueryOrder badSort;
+  badSort << o.name;
+  EXPECT_ANY_THROW(dbi.queryAfter(o, filter, badSort));
+  // mehrfach angegebenes Element zählt an der letzten Position
+  mobs::QueryOrder dupSort;
+  dupSort << o.id << o.name << o.id;
+  auto members = dupSort.members();
+  ASSERT_EQ(2, members.size());
+  EXPECT_EQ(static_cast<const mobs::MemberBase *>(&o.name), members[0].first);
+  EXPECT_EQ(static_cast<const mobs::MemberBase *>(&o.id), members[1].first);
+  EXPECT_NO_THROW(dbi.queryAfter(o, filter, dupSort));
+
+  std::vector<int> ids;
+  auto cursor = dbi.withQueryLimit(10).query(o, filter, sort);
+  for (int page = 0; page < 5; page++) {
+    int cnt = 0;
+    for (; not cursor->eof(); cursor->next(), cnt++) {
+      dbi.retrieve(o, cursor);
+      ids.push_back(o.id());
+    }
+    if (cnt < 10)
+      break;
+    cursor = dbi.withQueryLimit(10).queryAfter(o, filter, sort);
+  }
+  ASSERT_EQ(25, ids.size());
+  EXPECT_EQ(2, ids[0]);
+  EXPECT_EQ(24, ids[11]);
+  EXPECT_EQ(1, ids[12]);
+  EXPECT_EQ(25, ids[24]);
+}
+
+TEST(helperTest, projectionSqlite) {
+  mobs::DatabaseManager dbMgr;
+  dbMgr.addConnection("prj", mobs::ConnectionInformation("sqlite://:memory:", ""));
+  mobs::DatabaseInterface dbi = dbMgr.getDbIfc("prj");
+  ObjA3 o;
+  ASSERT_NO_THROW(dbi.structure(o));
+  for (int i = 1; i <= 3; i++) {
+    ObjA3 a;
+    a.k3kk(i);
+    a.p3p(std::string("p") + std::to_string(i));
+    a.oa3.k2kk(10 + i);
+    a.oa3.s2s("sub");
+    a.oa3.o2oo[1].a1bc("x");
+    a.oa3.o2oo[1].c1de(i);
+    ASSERT_NO_THROW(dbi.save(a));
+  }
+  mobs::QueryGenerator filter;
+  filter << o.k3kk.Qi(">", 1);
+  mobs::QueryOrder sort;
+  sort << o.k3kk;
+
+  mobs::QueryProjection proj;
+  proj << o.p3p;
+  auto cursor = dbi.withProjection(proj).query(o, filter, sort);
+  ASSERT_FALSE(cursor->eof());
+  EXPECT_TRUE(cursor->projection());
+  ASSERT_NO_THROW(dbi.retrieve(o, cursor));
+  EXPECT_EQ(2, o.k3kk());
+  EXPECT_EQ("p2", o.p3p());
+  EXPECT_EQ("", o.oa3.s2s());
+  EXPECT_EQ(0, o.oa3.o2oo.size());
+
+  mobs::QueryProjection proj2;
+  proj2 << o.oa3.o2oo;
+  cursor = dbi.withProjection(proj2).query(o, filter, sort);
+  ASSERT_FALSE(cursor->eof());
+  ASSERT_NO_THROW(dbi.retrieve(o, cursor));
+  EXPECT_EQ(2, o.k3kk());
+  EXPECT_EQ("", o.p3p());
+  ASSERT_EQ(2, o.oa3.o2oo.size());
+  EXPECT_EQ(2, o.oa3.o2oo[1].c1de());
+
+  cursor = dbi.query(o, filter, sort);
+  EXPECT_FALSE(cursor->projection());
+  ASSERT_NO_THROW(dbi.retrieve(o, cursor));
+  EXPECT_EQ("p2", o.p3p());
+  EXPECT_EQ("sub", o.oa3.s2s());
+  EXPECT_EQ(2, o.oa3.o2oo.size());
+}
+
+TEST_F(helperDbTest, parallelScanSqlite) {
+  for (auto n:{"scan0", "scan1", "scan2", "scan3"})
+    connect(n);
+  mobs::DatabaseInterface dbi = dbMgr->getDbIfc("scan0");
+  ObjAud o;
+  ASSERT_NO_THROW(dbi.structure(o));
+  mobs::DatabaseManager::transaction_callback cb = [](mobs::DbTransaction *trans) {
+    mobs::DatabaseInterface tdbi = trans->getDbIfc("scan0");
+    for (int i = 1; i <= 60; i++) {
+      ObjAud a;
+      a.id(i);
+      a.name(i % 3 ? "x" : "y");
+      tdbi.save(a);
+    }
+  };
+  ASSERT_NO_THROW(mobs::DatabaseManager::execute(cb));
+
+  std::atomic<int> sum(0);
+  std::atomic<size_t> calls(0);
+  mobs::QueryGenerator filter;
+  size_t n = 0;
+  ASSERT_NO_THROW(n = dbi.parallelScan(o, filter, {"scan0", "scan1", "scan2", "scan3"}, 3,
+                                       [&sum, &calls](mobs::ObjectBase &obj) {
+                                         sum += dynamic_cast<ObjAud &>(obj).id();
+                                         calls++;
+                                       }, 5));
+  EXPECT_EQ(60, n);
+  EXPECT_EQ(60, calls);
+  EXPECT_EQ(60 * 61 / 2, sum);
+
+  filter << o.name.Qi("=", "y");
+  sum = 0;
+  EXPECT_EQ(20, dbi.parallelScan(o, filter, {"scan1", "scan2"}, 2, [&sum](mobs::ObjectBase &obj) {
+    sum += dynamic_cast<ObjAud &>(obj).id();
+  }));
+  EXPECT_EQ(3 * 20 * 21 / 2, sum);
+
+  // die Projektion gilt auch für die in den Threads erzeugten Objekte
+  mobs::QueryProjection proj;
+  proj << o.name;
+  sum = 0;
+  calls = 0;
+  EXPECT_EQ(20, dbi.withProjection(proj).parallelScan(o, filter, {"scan1", "scan2", "scan3"}, 2,
+                                                       [&sum, &calls](mobs::ObjectBase &obj) {
+    auto &a = dynamic_cast<ObjAud &>(obj);
+    sum += a.id();
+    if (a.name() == "y" and a.version() == 0)
+      calls++;
+  }));
+  EXPECT_EQ(3 * 20 * 21 / 2, sum);
+  EXPECT_EQ(20, calls);
+
+  EXPECT_ANY_THROW(dbi.parallelScan(o, filter, {"scan1", "scan2"}, 2, [](mobs::ObjectBase &obj) {
+    throw std::runtime_error("stop");
+  }));
+}
+
+TEST_F(helperDbTest, fetchPolicySqlite) {
+  mobs::DatabaseInterface dbi = connect("fp");
+  EXPECT_EQ(mobs::DatabaseInterface::FetchDefault, dbi.getFetchPolicy());
+  mobs::DatabaseInterface dbc = dbi.withFetchPolicy(mobs::DatabaseInterface::FetchServerCursor, 5);
+  EXPECT_EQ(mobs::DatabaseInterface::FetchServerCursor, dbc.getFetchPolicy());
+  EXPECT_EQ(5, dbc.getFetchSize());
+  EXPECT_EQ(1, dbi.withFetchPolicy(mobs::DatabaseInterface::FetchServerCursor, 0).getFetchSize());
+  ObjAud o;
+  ASSERT_NO_THROW(dbi.structure(o));
+  // nicht in Sortier-Reihenfolge speichern
+  for (int i = 0; i < 23; i++) {
+    ObjAud a;
+    a.id(i * 7 % 23 + 1);
+    a.name("n" + std::to_string(a.id()));
+    ASSERT_NO_THROW(dbi.save(a));
+  }
+  mobs::QueryOrder sort;
+  sort << o.id;
+  // alle Datensätze in Reihenfolge über mehrere Fetch-Blöcke
+  int cnt = 0;
+  for (auto cursor = dbc.query(o, mobs::QueryGenerator(), sort); not cursor->eof(); cursor->next()) {
+    ASSERT_NO_THROW(dbc.retrieve(o, cursor));
+    cnt++;
+    EXPECT_EQ(cnt, o.id());
+    EXPECT_EQ("n" + std::to_string(cnt), o.name());
+  }
+  EXPECT_EQ(23, cnt);
+  // mit Filter, Ergebnis kleiner als ein Fetch-Block
+  mobs::QueryGenerator filter;
+  filter << o.id.Qi(">", 20);
+  cnt = 0;
+  for (auto cursor = dbc.query(o, filter, sort); not cursor->eof(); cursor->next()) {
+    ASSERT_NO_THROW(dbc.retrieve(o, cursor));
+    EXPECT_EQ(21 + cnt++, o.id());
+  }
+  EXPECT_EQ(3, cnt);
+}
+
+class ObjGrp : virtual public mobs::ObjectBase {
+public:
+  ObjInit(ObjGrp);
+  MemVar(int, id, KEYELEMENT1);
+  MemVar(int, version, VERSIONFIELD);
+};
+
+TEST_F(helperDbTest, groupWritesSqlite) {
+  mobs::DatabaseInterface dbi = connect("gw");
+  mobs::DatabaseInterface dbr = connect("gw_read").withCountCursor();
+  ObjGrp o;
+  ASSERT_NO_THROW(dbi.structure(o));
+  auto con = std::dynamic_pointer_cast<mobs::SQLiteDatabaseConnection>(dbi.getConnection());
+  ASSERT_TRUE(con);
+  EXPECT_ANY_THROW(con->tune(true, "FAST"));
+  ASSERT_NO_THROW(con->tune(true, "NORMAL", 1 << 20));
+  con->groupWrites(10, std::chrono::hours(1));
+  for (int i = 1; i <= 25; i++) {
+    ObjGrp a;
+    a.id(i);
+    ASSERT_NO_THROW(dbi.save(a));
+  }
+  EXPECT_EQ(20, dbr.query(o, mobs::QueryGenerator())->pos());
+  // fehlerhaftes Objekt verwirft nicht die gemeinsame Transaktion
+  ObjGrp a;
+  a.id(1);
+  a.version(7);
+  EXPECT_THROW(dbi.save(a), mobs::optLock_error);
+  a.id(26);
+  a.version(0);
+  ASSERT_NO_THROW(dbi.save(a));
+  EXPECT_EQ(20, dbr.query(o, mobs::QueryGenerator())->pos());
+  ASSERT_NO_THROW(con->flushGroup());
+  EXPECT_EQ(26, dbr.query(o, mobs::QueryGenerator())->pos());
+  // Transaktion schließt die gemeinsame Transaktion vorher ab
+  a.id(27);
+  a.version(0);
+  ASSERT_NO_THROW(dbi.save(a));
+  mobs::DatabaseManager::transaction_callback cb = [](mobs::DbTransaction *trans) {
+    mobs::DatabaseInterface tdbi = trans->getDbIfc("gw");
+    ObjGrp t;
+    t.id(28);
+    tdbi.save(t);
+  };
+  ASSERT_NO_THROW(mobs::DatabaseManager::execute(cb));
+  EXPECT_EQ(28, dbr.query(o, mobs::QueryGenerator())->pos());
+  con->groupWrites(0);
+}
+
+TEST_F(helperDbTest, metricsSqlite) {
+  mobs::Metrics::enable(true);
+  mobs::Metrics::reset();
+  std::thread t([]() {
+    for (int i = 1; i <= 100; i++)
+      mobs::Metrics::record("test.latency", std::chrono::microseconds(i));
+  });
+  t.join();
+  mobs::Metrics::record("test.latency", std::chrono::milliseconds(1));
+  mobs::Metrics::count("test.bytes", 10);
+  mobs::Metrics::count("test.bytes", 5);
+  mobs::MetricsValue v;
+  ASSERT_TRUE(mobs::Metrics::value("test.latency", v));
+  EXPECT_TRUE(v.histogram);
+  EXPECT_EQ(101, v.count);
+  EXPECT_EQ(1000000, v.max);
+  EXPECT_NEAR(50000, double(v.p50), 4000);
+  EXPECT_NEAR(90000, double(v.p90), 6000);
+  ASSERT_TRUE(mobs::Metrics::value("test.bytes", v));
+  EXPECT_FALSE(v.histogram);
+  EXPECT_EQ(15, v.count);
+  EXPECT_FALSE(mobs::Metrics::value("test.unknown", v));
+
+  mobs::DatabaseInterface dbi = connect("metrics");
+  ObjGrp o;
+  ASSERT_NO_THROW(dbi.structure(o));
+  for (int i = 1; i <= 3; i++) {
+    o.id(i);
+    o.version(0);
+    ASSERT_NO_THROW(dbi.save(o));
+  }
+  EXPECT_TRUE(dbi.load(o));
+  ASSERT_TRUE(mobs::Metrics::value("db.save", v));
+  EXPECT_EQ(3, v.count);
+  ASSERT_TRUE(mobs::Metrics::value("sqlite.save", v));
+  EXPECT_EQ(3, v.count);
+  ASSERT_TRUE(mobs::Metrics::value("db.load", v));
+  EXPECT_EQ(1, v.count);
+  std::string text = mobs::Metrics::toText();
+  EXPECT_NE(std::string::npos, text.find("test.bytes count=15\n"));
+  std::string json = mobs::Metrics::toJson();
+  EXPECT_NE(std::string::npos, json.find("\"test.bytes\":{\"count\":15}"));
+  EXPECT_NE(std::string::npos, json.find("\"test.latency\":{\"count\":101,\"sum_us\":6050.000,"));
+  mobs::Metrics::enable(false);
+  o.id(4);
+  o.version(0);
+  ASSERT_NO_THROW(dbi.save(o));
+  ASSERT_TRUE(mobs::Metrics::value("db.save", v));
+  EXPECT_EQ(3, v.count);
+
+  // reset leert auch die Summe der beendeten Threads
+  mobs::Metrics::enable(true);
+  mobs::Metrics::reset();
+  ASSERT_TRUE(mobs::Metrics::value("test.latency", v));
+  EXPECT_EQ(0, v.count);
+  std::thread t2([]() { mobs::Metrics::record("test.latency", std::chrono::microseconds(7)); });
+  t2.join();
+  mobs::Metrics::record("test.latency", std::chrono::microseconds(3));
+  ASSERT_TRUE(mobs::Metrics::value("test.latency", v));
+  EXPECT_EQ(2, v.count);
+  EXPECT_EQ(10000, v.sum);
+  mobs::Metrics::enable(false);
+}
+
+TEST_F(helperDbTest, queryProfilerSqlite) {
+  EXPECT_EQ("select a,b from T where a=? and b=? and c in (?) limit ?;",
+            mobs::QueryProfiler::normalize("select a,b from T where a=12 and b='x''y' and c in (1, 2,3) limit 5;"));
+  EXPECT_EQ("insert into T1(id,v) VALUES (?);", mobs::QueryProfiler::normalize("insert into T1(id,v) VALUES (?001,?002);"));
+  EXPECT_EQ("find db.c {\"a\":?,\"b\":{\"$in\":[?]}}",
+            mobs::QueryProfiler::normalize("find db.c {\"a\":\"x\",\"b\":{\"$in\":[1,\"y\",3]}}"));
+
+  mobs::DatabaseInterface dbi = connect("prof");
+  auto profiler = std::make_shared<mobs::QueryProfiler>(std::chrono::microseconds(0));
+  dbi.getConnection()->setQueryProfiler(profiler);
+  ObjGrp o;
+  ASSERT_NO_THROW(dbi.structure(o));
+  for (int i = 1; i <= 5; i++) {
+    o.id(i);
+    o.version(0);
+    ASSERT_NO_THROW(dbi.save(o));
+  }
+  o.id(3);
+  EXPECT_TRUE(dbi.load(o));
+  o.id(9);
+  EXPECT_FALSE(dbi.load(o));
+  size_t n = 0;
+  for (auto cursor = dbi.query(o, mobs::QueryGenerator()); not cursor->eof(); cursor->next())
+    n++;
+  EXPECT_EQ(5, n);
+
+  std::map<std::string, mobs::QueryStatistic> stat;
+  for (auto &v:profiler->statistics())
+    stat[v.statement] = v;
+  auto insert = stat.find("insert into ObjGrp(id,version) VALUES (?);");
+  ASSERT_NE(stat.end(), insert);
+  EXPECT_EQ(5, insert->second.count);
+  EXPECT_EQ(5, insert->second.rows);
+  EXPECT_LE(insert->second.p50, insert->second.p99);
+  EXPECT_LE(insert->second.p99, insert->second.max);
+  auto load = stat.find("select id,version from ObjGrp where id=?;");
+  ASSERT_NE(stat.end(), load);
+  EXPECT_EQ(2, load->second.count);
+  EXPECT_EQ(1, load->second.rows);
+  auto query = stat.find("select mt.id,mt.version from ObjGrp mt ;");
+  ASSERT_NE(stat.end(), query);
+  EXPECT_EQ(1, query->second.count);
+  EXPECT_EQ(5, query->second.rows);
+  EXPECT_NE(std::string::npos, profiler->toText().find(" rows=5 "));
+
+  dbi.getConnection()->setQueryProfiler(nullptr);
+  profiler->reset();
+  dbi.load(o);
+  EXPECT_TRUE(profiler->statistics().empty());
+}
+
+TEST_F(helperDbTest, blobStoreSqlite) {
+  for (auto n:{"blob0", "blob1", "blob2"})
+    connect(n);
+  std::string data;
+  for (int i = 0; i < 10000; i++)
+    data += char(i * 7 + i / 251);
+  mobs::BlobStore store({"blob0", "blob1", "blob2"}, 1000);
+  ASSERT_NO_THROW(store.structure());
+  std::string id;
+  {
+    std::istringstream in(data);
+    ASSERT_NO_THROW(id = store.upload(in));
+  }
+  EXPECT_EQ(10000, store.size(id));
+  std::ostringstream out;
+  ASSERT_NO_THROW(store.download(id, out));
+  EXPECT_TRUE(out.str() == data);
+  out.str("");
+  ASSERT_NO_THROW(store.download(id, out, 1500, 2700));
+  EXPECT_TRUE(out.str() == data.substr(1500, 2700));
+  out.str("");
+  ASSERT_NO_THROW(store.download(id, out, 9990));
+  EXPECT_TRUE(out.str() == data.substr(9990));
+  EXPECT_ANY_THROW(store.download(id, out, 10001));
+
+  // ersetzen durch kürzeren BLOB
+  {
+    std::istringstream in(data.substr(0, 1200));
+    ASSERT_NO_THROW(store.upload(id, in));
+  }
+  out.str("");
+  ASSERT_NO_THROW(store.download(id, out));
+  EXPECT_TRUE(out.str() == data.substr(0, 1200));
+  // abgebrochenes Ersetzen lässt den alten BLOB unverändert
+  {
+    class FailingBuf : public std::streambuf {
+    public:
+      explicit FailingBuf(std::string &s) { setg(&s[0], &s[0], &s[0] + s.length()); }
+    protected:
+      int_type underflow() override { throw std::runtime_error("read error"); }
+    };
+    std::string part = data.substr(0, 2500);
+    FailingBuf buf(part);
+    std::istream in(&buf);
+    EXPECT_ANY_THROW(store.upload(id, in));
+  }
+  out.str("");
+  ASSERT_NO_THROW(store.download(id, out));
+  EXPECT_TRUE(out.str() == data.substr(0, 1200));
+  EXPECT_TRUE(store.remove(id));
+  EXPECT_FALSE(store.remove(id));
+  EXPECT_ANY_THROW(store.size(id));
+
+  // gleichzeitiges Ersetzen: der zuerst gespeicherte BLOB gewinnt, der andere scheitert am Versionsfeld
+  {
+    class ReplacingBuf : public std::streambuf {
+    public:
+      ReplacingBuf(std::string &s, std::function<void()> f) : str(s), race(std::move(f)) { }
+    protected:
+      int_type underflow() override {
+        if (not race)
+          return traits_type::eof();
+        auto f = std::move(race);
+        race = nullptr;
+        f();
+        setg(&str[0], &str[0], &str[0] + str.length());
+        return traits_type::to_int_type(*gptr());
+      }
+    private:
+      std::string &str;
+      std::function<void()> race;
+    };
+    mobs::DatabaseInterface dbi0 = dbMgr->getDbIfc("blob0");
+    mobs::DatabaseInterface dbi1 = dbMgr->getDbIfc("blob1");
+    std::istringstream first(data.substr(0, 3000));
+    ASSERT_NO_THROW(mobs::BlobStore::write(dbi0, "race", first, 1000));
+    std::string outer = data.substr(0, 500);
+    ReplacingBuf buf(outer, [&dbi1, &data]() {
+      std::istringstream in(data.substr(0, 2000));
+      mobs::BlobStore::write(dbi1, "race", in, 1000);
+    });
+    std::istream in(&buf);
+    EXPECT_THROW(mobs::BlobStore::write(dbi0, "race", in, 1000), mobs::optLock_error);
+    out.str("");
+    ASSERT_NO_THROW(mobs::BlobStore::read(dbi0, "race", out));
+    EXPECT_TRUE(out.str() == data.substr(0, 2000));
+    EXPECT_TRUE(mobs::BlobStore::erase(dbi0, "race"));
+  }
+
+  // sequenziell über die Schnittstelle der Datenbank-Verbindung
+  mobs::DatabaseInterface dbi = dbMgr->getDbIfc("blob0");
+  std::istringstream in(data);
+  ASSERT_NO_THROW(id = dbi.getConnection()->uploadFile(dbi, in));
+  out.str("");
+  ASSERT_NO_THROW(dbi.getConnection()->downloadFile(dbi, id, out));
+  EXPECT_TRUE(out.str() == data);
+  ASSERT_NO_THROW(dbi.getConnection()->deleteFile(dbi, id));
+  EXPECT_ANY_THROW(dbi.getConnection()->deleteFile(dbi, id));
+}
+#endif
+
+
 TEST(helperTest, dbjson) {
   ObjJ1 j1,j2;
 
@@ -573,6 +1202,188 @@ TEST(helperTest, query) {
 }
 
 
+TEST(helperTest, predicate) {
+  using Q = mobs::QueryGenerator;
+  ObjA3 e;
+  Q where;
+  where << e.k3kk.Qi("<>", 5) << e.p3p.QiBetween("Anton", "Berti")
+        << Q::OrBegin << e.oa3.k2kk.QiIn({1, 2, 3}) << e.oa3.s2s.Qi("LIKE", "N%heim") << Q::OrEnd;
+  mobs::QueryPredicate pred = where.compile(e);
+  EXPECT_EQ("ObjA3", pred.objectName());
+
+  ObjA3 a;
+  a.k3kk(4);
+  a.p3p("Bernd");
+  a.oa3.k2kk(2);
+  EXPECT_TRUE(pred(a));
+  a.k3kk(5);
+  EXPECT_FALSE(pred(a));
+  a.k3kk(6);
+  a.p3p("Caesar");
+  EXPECT_FALSE(pred(a));
+  a.p3p("Anton");
+  a.oa3.k2kk(9);
+  EXPECT_FALSE(pred(a));
+  a.oa3.s2s("Nordheim");
+  EXPECT_TRUE(pred(a));
+  a.oa3.s2s("Nordheimer");
+  EXPECT_FALSE(pred(a));
+
+  // Null-Werte und Not
+  ObjE1 n;
+  Q wn;
+  wn << n.cc.QiNull();
+  mobs::QueryPredicate pn = wn.compile(n);
+  Q wc;
+  wc << Q::Not << n.cc.Qi(">", 3);
+  mobs::QueryPredicate pc = wc.compile(n);
+  ObjE1 b;
+  b.cc.forceNull();
+  EXPECT_TRUE(pn(b));
+  EXPECT_FALSE(pc(b));
+  b.cc(2);
+  EXPECT_FALSE(pn(b));
+  EXPECT_TRUE(pc(b));
+  EXPECT_ANY_THROW(pc(a));
+
+  // mehrere Objekte und Vektoren
+  ObjA2 v;
+  v.o2oo[0].c1de(1);
+  v.o2oo[1].c1de(7);
+  v.o2oo[2].c1de(9);
+  Q wv;
+  wv << v.o2oo[0].c1de.Qi(">=", 7);
+  EXPECT_ANY_THROW(wv.compile(v));
+  ObjA1 t;
+  Q wt;
+  wt << t.c1de.Qi(">=", 7);
+  EXPECT_EQ(std::vector<size_t>({1, 2}), wt.compile(t).select(v.o2oo));
+  std::vector<bool> res;
+  EXPECT_EQ(1, wt.compile(t).evaluate({&v.o2oo[0], &v.o2oo[1]}, res));
+  EXPECT_EQ(std::vector<bool>({false, true}), res);
+
+  Q wl;
+  wl << Q::literalBegin << "1=1" << Q::literalEnd;
+  EXPECT_ANY_THROW(wl.compile(t));
+}
+
+
+TEST(helperTest, asyncLog) {
+  // eigenes temporäres Verzeichnis, wird auch bei fehlgeschlagenen Prüfungen entfernt
+  struct TempDir {
+    TempDir() {
+      if (not ::mkdtemp(&dir[0]))
+        throw std::runtime_error("can't create temporary directory");
+    }
+    ~TempDir() {
+      std::remove((dir + "/asynclog.log.0").c_str());
+      ::rmdir(dir.c_str());
+    }
+    std::string dir = "/tmp/mobs_asynclog_XXXXXX";
+  } tmp;
+  std::string logFile = tmp.dir + "/asynclog.log";
+  {
+    logging::AsyncLog asyncLog(logFile, 16, logging::AsyncLog::Block);
+    EXPECT_ANY_THROW(logging::AsyncLog());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+      threads.emplace_back([t]() {
+        for (int i = 0; i < 100; i++)
+          LOG(LM_ERROR, "async " << t << " " << i << (i == 0 ? "\nnext" : ""));
+      });
+    for (auto &t:threads)
+      t.join();
+    asyncLog.flush();
+    EXPECT_EQ(400, asyncLog.written());
+    EXPECT_EQ(0, asyncLog.dropped());
+  }
+  std::ifstream in(logFile + ".0");
+  std::string line;
+  int cnt = 0;
+  while (std::getline(in, line)) {
+    cnt++;
+    EXPECT_EQ("E ", line.substr(0, 2));
+    EXPECT_NE(std::string::npos, line.find(" ["));
+    EXPECT_NE(std::string::npos, line.find(" async "));
+  }
+  EXPECT_EQ(400, cnt);
+}
+
+TEST(helperTest, logLevel) {
+  auto level = logging::currentLevel;
+  int cnt = 0;
+  auto count = [&cnt]() { return ++cnt; };
+  logging::currentLevel = logging::lm_error;
+  LOG(LM_DEBUG, "not evaluated " << count());
+  EXPECT_EQ(0, cnt);
+  logging::setModuleLevel("testHelper.cpp", logging::lm_debug);
+  LOG(LM_DEBUG, "evaluated " << count());
+  EXPECT_EQ(1, cnt);
+  logging::setModuleLevel("/some/path/testHelper.cpp", logging::lm_warn);
+  LOG(LM_INFO, "not evaluated " << count());
+  EXPECT_EQ(1, cnt);
+  logging::resetModuleLevel("testHelper.cpp");
+  LOG(LM_WARNING, "not evaluated " << count());
+  EXPECT_EQ(1, cnt);
+  logging::currentLevel = level;
+  LOG(LM_WARNING, "evaluated " << count());
+  EXPECT_EQ(2, cnt);
+}
+
+TEST(helperTest, keyset) {
+  ObjA3 e;
+  mobs::QueryOrder sortList;
+  sortList << e.p3p << mobs::QueryOrder::descending << e.k3kk;
+  SQLDBTestDesc sd;
+  using Q = mobs::QueryGenerator;
+  Q w1;
+  w1 << e.oa3.k2kk.Qi("!=", 7);
+  e.p3p("Otto");
+  e.k3kk(12);
+  w1.addKeysetAfter(sortList);
+  mobs::SqlGenerator gsql(e, sd);
+  EXPECT_EQ("select mt.k3kk,mt.version,mt.p3p,mt.o_k2kk,mt.o_s2s from D.ObjA3 mt  where "
+            "(mt.o_k2kk<>7 AND (mt.p3p>\"Otto\" OR (mt.p3p=\"Otto\" AND mt.k3kk<12))) order by mt.p3p,mt.k3kk descending;",
+            gsql.query(mobs::SqlGenerator::Normal, &sortList, &w1));
+
+  Q w2;
+  mobs::QueryOrder sortList2;
+  sortList2 << e.k3kk;
+  w2.addKeysetAfter(sortList2);
+  EXPECT_EQ("select mt.k3kk,mt.version,mt.p3p,mt.o_k2kk,mt.o_s2s from D.ObjA3 mt  where mt.k3kk>12 order by mt.k3kk;",
+            gsql.query(mobs::SqlGenerator::Normal, &sortList2, &w2));
+
+  Q w3;
+  e.p3p.forceNull();
+  EXPECT_ANY_THROW(w3.addKeysetAfter(sortList));
+  EXPECT_ANY_THROW(w3.addKeysetAfter(mobs::QueryOrder()));
+}
+
+
+TEST(helperTest, projection) {
+  ObjA3 e;
+  SQLDBTestDesc sd;
+  mobs::QueryProjection proj;
+  proj << e.p3p;
+  mobs::SqlGenerator gsql(e, sd);
+  gsql.setProjection(&proj);
+  EXPECT_EQ("select mt.k3kk,mt.p3p from D.ObjA3 mt ;", gsql.query(mobs::SqlGenerator::Normal, nullptr, nullptr));
+  gsql.readObject(e);
+  EXPECT_TRUE(gsql.eof());
+
+  mobs::QueryProjection proj2;
+  proj2 << e.oa3;
+  gsql.setProjection(&proj2);
+  EXPECT_EQ("select mt.k3kk,mt.o_k2kk,mt.o_s2s from D.ObjA3 mt ;", gsql.query(mobs::SqlGenerator::Normal, nullptr, nullptr));
+  gsql.readObject(e);
+  EXPECT_FALSE(gsql.eof());
+
+  mobs::SqlGenerator gsql2(e, sd);
+  EXPECT_EQ("select mt.k3kk,mt.version,mt.p3p,mt.o_k2kk,mt.o_s2s from D.ObjA3 mt ;",
+            gsql2.query(mobs::SqlGenerator::Normal, nullptr, nullptr));
+}
+
+
 TEST(helperTest, sqlBig) {
 
   DMGR_TemplatePool a3;
@@ -146,5 +146,41 @@ TEST(mchronoTest, delta) {
   EXPECT_LT(2, (MTimeNow() - vorher).count()); // Sollte immer mindestens 2 microsekunden dauern
 }
 
+TEST(mchronoTest, dst) {
+  // Sommerzeit-Umstellung, Tests laufen mit TZ=Europe/Berlin
+  MTime t;
+  ASSERT_TRUE(string2x("2020-03-29T00:59:59Z", t));
+  EXPECT_EQ("2020-03-29T01:59:59+01:00", to_string_iso8601(t, MSecond));
+  t += std::chrono::seconds(1);
+  EXPECT_EQ("2020-03-29T03:00:00+02:00", to_string_iso8601(t, MSecond));
+  EXPECT_EQ("2020-03-29 03:00:00", to_string_ansi(t, MSecond));
+  ASSERT_TRUE(string2x("2020-10-25T00:59:59Z", t));
+  EXPECT_EQ("2020-10-25T02:59:59+02:00", to_string_iso8601(t, MSecond));
+  t += std::chrono::seconds(1);
+  EXPECT_EQ("2020-10-25T02:00:00+01:00", to_string_iso8601(t, MSecond));
+  EXPECT_EQ("2020-10-25T01:00:00Z", to_string_gmt(t, MSecond));
+
+  ASSERT_TRUE(string2x("2020-07-01T12:00:00", t));
+  EXPECT_EQ("2020-07-01T10:00:00Z", to_string_gmt(t, MSecond));
+  ASSERT_TRUE(string2x("2020-03-29 03:30:00", t));
+  EXPECT_EQ("2020-03-29T01:30:00Z", to_string_gmt(t, MSecond));
+  ASSERT_TRUE(string2x("2009-12-31T23:00:00", t));
+  EXPECT_EQ("2009-12-31T22:00:00Z", to_string_gmt(t, MSecond));
+
+  // Round-Trip über mehrere Jahre
+  ASSERT_TRUE(string2x("1971-01-01T00:00:00.5Z", t));
+  for (int i = 0; i < 2000; i++) {
+    t += std::chrono::hours(24 * 13 + 7) + std::chrono::microseconds(1);
+    MTime t2;
+    ASSERT_TRUE(string2x(to_string(t), t2)) << to_string(t);
+    EXPECT_EQ(t.time_since_epoch().count(), t2.time_since_epoch().count()) << to_string(t);
+  }
+
+  MDate d;
+  ASSERT_TRUE(string2x("2024-02-29", d));
+  EXPECT_EQ("2024-02-29", to_string(d));
+  EXPECT_FALSE(string2x("2024-13-01", d));
+}
+
 }
 
@@ -41,6 +41,11 @@
 #include <sstream>
 #include <gtest/gtest.h>
 #include <codecvt>
+#include <thread>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "digest.h"
 
@@ -152,6 +157,18 @@ public:
   std::string privKey;
 };
 
+// eindeutige temporäre Datei mit Inhalt anlegen
+string tempFile(const string &content) {
+  string name = "/tmp/mobs_mrpc_XXXXXX";
+  int fd = ::mkstemp(&name[0]);
+  if (fd < 0)
+    THROW("can't create temporary file");
+  ::close(fd);
+  ofstream o(name, ios::trunc | ios::binary);
+  o << content;
+  return name;
+}
+
 void exampleClient() {
 
   string passphrase = "12345";
@@ -1696,4 +1713,286 @@ TEST(mrpcTest, MrpcAttachmentEcc) {
 }
 
 
+TEST(mrpcTest, MrpcPlainAttachment) {
+  string cpriv, cpub, spriv, spub;
+  mobs::generateCryptoKeyMem(mobs::CryptECprime256v1, spriv, spub);
+  mobs::generateCryptoKeyMem(mobs::CryptECprime256v1, cpriv, cpub);
+  string inFile = "mrpc_attach_in.tmp";
+  string outFile = "mrpc_attach_out.tmp";
+  string content;
+  for (int i = 0; i < 10000; i++)
+    content += std::to_string(i) + " Hallo\n";
+  {
+    ofstream o(inFile, ios::trunc);
+    o << content;
+  }
+
+  stringstream strStoC;
+  stringstream strCtoS;
+  MrpcServer2 server(strCtoS, strStoC, cpub, spriv);
+  mobs::MrpcSession clientSession{};
+  mobs::MrpcEc client(strStoC, strCtoS, &clientSession, false);
+  ASSERT_NO_THROW(client.startSession("testkey", "googletest", cpriv, "", spub));
+  MrpcPerson p1;
+  client.sendSingle(p1);
+  for (int i = 0; i < 5 and not server.resultObj; i++)
+    ASSERT_NO_THROW(server.parseServer());
+  ASSERT_TRUE(server.isConnected());
+
+  server.setPlainAttachments(true);
+  MrpcPerson p2;
+  p2.name("Heinrich");
+  std::streamsize sz = content.length() - 10;
+  server.sendSingle(p2, sz);
+  int fd = ::open(inFile.c_str(), O_RDONLY);
+  ASSERT_LE(0, fd);
+  EXPECT_EQ(sz, server.sendAttachment(fd, 10, sz));
+  ::close(fd);
+  server.flush();
+  EXPECT_NE(string::npos, strStoC.str().find("9999 Hallo"));
+
+  bool res = false;
+  for (int i = 0; i < 5 and not res; i++)
+    ASSERT_NO_THROW(res = client.parseClient());
+  ASSERT_TRUE(res);
+  for (int i = 0; i < 5 and not client.inByteStreamAvail(); i++)
+    ASSERT_NO_THROW(client.parseClient());
+  EXPECT_EQ(sz, client.getAttachmentLength());
+  fd = ::open(outFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  ASSERT_LE(0, fd);
+  EXPECT_EQ(sz, client.receiveAttachment(fd));
+  ::close(fd);
+  ifstream i(outFile);
+  string result((std::istreambuf_iterator<char>(i)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(content.substr(10), result);
+  ::remove(inFile.c_str());
+  ::remove(outFile.c_str());
+}
+
+
+TEST(mrpcTest, MrpcCompression) {
+  string cpriv, cpub, spriv, spub;
+  mobs::generateCryptoKeyMem(mobs::CryptECprime256v1, spriv, spub);
+  mobs::generateCryptoKeyMem(mobs::CryptECprime256v1, cpriv, cpub);
+  stringstream strStoC;
+  stringstream strCtoS;
+  MrpcServer2 server(strCtoS, strStoC, cpub, spriv);
+  mobs::MrpcSession clientSession{};
+  mobs::MrpcEc client(strStoC, strCtoS, &clientSession, false);
+  server.setCompression(true);
+  client.setCompression(true);
+  ASSERT_NO_THROW(client.startSession("testkey", "googletest", cpriv, "", spub));
+  MrpcPerson p1;
+  client.sendSingle(p1);
+  for (int i = 0; i < 5 and not server.resultObj; i++)
+    ASSERT_NO_THROW(server.parseServer());
+  ASSERT_TRUE(server.isConnected());
+  server.resultObj = nullptr;
+#ifdef USE_ZLIB
+  EXPECT_TRUE(server.isCompressed());
+#endif
+
+  MrpcPerson p2;
+  p2.name(string(20000, 'X'));
+  auto pos = strStoC.str().length();
+  server.sendSingle(p2);
+  auto sz = strStoC.str().length() - pos;
+#ifdef USE_ZLIB
+  EXPECT_GT(1000, sz);
+  EXPECT_NE(string::npos, strStoC.str().find("deflate+aes-256-cbc"));
+#else
+  EXPECT_LT(20000, sz);
+#endif
+
+  bool res = false;
+  for (int i = 0; i < 5 and not res; i++)
+    ASSERT_NO_THROW(res = client.parseClient());
+  ASSERT_TRUE(res);
+#ifdef USE_ZLIB
+  EXPECT_TRUE(client.isCompressed());
+#endif
+  auto r = client.getResult<MrpcPerson>();
+  ASSERT_TRUE(r);
+  EXPECT_EQ(p2.name(), r->name());
+
+  // in Gegenrichtung
+  client.sendSingle(p2);
+  for (int i = 0; i < 5 and not server.resultObj; i++)
+    ASSERT_NO_THROW(server.parseServer());
+  r = server.getResult<MrpcPerson>();
+  ASSERT_TRUE(r);
+  EXPECT_EQ(p2.name(), r->name());
+}
+
+
+TEST(mrpcTest, MrpcSessionStore) {
+  string file = "mrpc_session_store.tmp";
+  ::remove(file.c_str());
+  mobs::MrpcSession sess;
+  sess.sessionKey = {1, 2, 3, 4};
+  sess.keyName = "testkey";
+  sess.sessionId = 7;
+  sess.sessionReuseTime = 120;
+  sess.last = time(nullptr);
+  sess.generated = sess.last;
+  {
+    mobs::MrpcSessionStore store(file, 4);
+    store.put("abc", sess);
+    mobs::MrpcSession expired = sess;
+    expired.sessionId = 8;
+    expired.last = time(nullptr) - 200;
+    store.put("old", expired);
+    EXPECT_EQ(2, store.size());
+
+    mobs::MrpcSession res;
+    EXPECT_FALSE(store.get("xyz", res));
+    EXPECT_FALSE(store.get("abc", res, "otherkey"));
+    ASSERT_TRUE(store.get("abc", res, "testkey"));
+    EXPECT_EQ(7, res.sessionId);
+    EXPECT_EQ(sess.sessionKey, res.sessionKey);
+    EXPECT_FALSE(store.get("old", res));
+    EXPECT_EQ(1, store.cleanup());
+  }
+  struct stat st{};
+  ASSERT_EQ(0, ::stat(file.c_str(), &st));
+  EXPECT_EQ(S_IRUSR | S_IWUSR, st.st_mode & 0777);
+  {
+    // wurde beim Beenden gesichert
+    mobs::MrpcSessionStore store(file);
+    mobs::MrpcSession res;
+    ASSERT_TRUE(store.get("abc", res));
+    EXPECT_EQ(7, res.sessionId);
+    EXPECT_EQ(sess.sessionKey, res.sessionKey);
+    EXPECT_EQ(120, res.sessionReuseTime);
+    store.erase("abc");
+    EXPECT_EQ(0, store.size());
+  }
+  ::remove(file.c_str());
+}
+
+TEST(mrpcTest, tcpBufferNoDelay) {
+  mobs::TcpAccept tcpAccept;
+  if (tcpAccept.initService("25431") == mobs::invalidSocket)
+    GTEST_SKIP() << "can't open port";
+  string payload;
+  for (int i = 0; payload.size() < 100000; i++)
+    payload += std::to_string(i) + ' ';
+  string file = tempFile("xxFILEyy");
+  // Verbindungsaufbau vor dem Start des Server-Threads, danach kein ASSERT bis zum join
+  mobs::tcpstream con("localhost", "25431");
+  ASSERT_TRUE(con.is_open());
+  string received;
+  std::thread srv([&tcpAccept, &received]() {
+    mobs::tcpstream con(tcpAccept);
+    con.setBufferSize(1000, 1000);
+    std::getline(con, received, '\0');
+  });
+  EXPECT_TRUE(con.setNoDelay(true));
+  EXPECT_TRUE(con.setBufferSize(4096, 512));
+  con.setCork(true);
+  con << "HEAD:";
+  con.write(payload.c_str(), std::streamsize(payload.length())); // größer als Puffer: direkt per scatter/gather
+  con << ":";
+  int fd = ::open(file.c_str(), O_RDONLY);
+  EXPECT_LE(0, fd);
+  auto tcp = dynamic_cast<mobs::TcpStBuf *>(con.rdbuf());
+  EXPECT_NE(nullptr, tcp);
+  if (fd >= 0 and tcp)
+    EXPECT_EQ(4, tcp->sendFile(fd, 2, 4));
+  if (fd >= 0)
+    ::close(fd);
+  ::remove(file.c_str());
+  con << ":TAIL" << '\0';
+  con.flush();
+  con.setCork(false);
+  EXPECT_EQ(std::streamoff(payload.length() + 16), std::streamoff(con.tellp()));
+  srv.join();
+  EXPECT_EQ("HEAD:" + payload + ":FILE:TAIL", received);
+}
+
+TEST(mrpcTest, MrpcPlainAttachmentTcp) {
+  mobs::TcpAccept tcpAccept;
+  if (tcpAccept.initService("25432") == mobs::invalidSocket)
+    GTEST_SKIP() << "can't open port";
+  string cpriv, cpub, spriv, spub;
+  mobs::generateCryptoKeyMem(mobs::CryptECprime256v1, spriv, spub);
+  mobs::generateCryptoKeyMem(mobs::CryptECprime256v1, cpriv, cpub);
+  string content;
+  for (int i = 0; content.size() < 500000; i++)
+    content += std::to_string(i) + " Hallo\n";
+  string inFile = tempFile(content);
+  string outFile = tempFile("");
+  std::streamsize sz = std::streamsize(content.length()) - 10;
+
+  // Verbindungsaufbau vor dem Start des Server-Threads, danach kein ASSERT bis zum join
+  mobs::tcpstream con("localhost", "25432");
+  ASSERT_TRUE(con.is_open());
+  std::streamsize sent = 0;
+  string srvError;
+  std::thread srv([&]() {
+    try {
+      mobs::tcpstream xstream(tcpAccept);
+      xstream.exceptions(std::iostream::failbit | std::iostream::badbit);
+      MrpcServer2 server(xstream, xstream, cpub, spriv);
+      // unverschlüsselt über einen tcpstream: das Attachment wird per sendfile versendet
+      server.setPlainAttachments(true);
+      while (not server.getResult<MrpcPerson>())
+        server.parseServer();
+      MrpcPerson p;
+      p.name("Heinrich");
+      server.sendSingle(p, sz);
+      int fd = ::open(inFile.c_str(), O_RDONLY);
+      if (fd < 0)
+        THROW("open failed");
+      try {
+        sent = server.sendAttachment(fd, 10, sz);
+      } catch (...) {
+        ::close(fd);
+        throw;
+      }
+      ::close(fd);
+      server.flush();
+    } catch (std::exception &e) {
+      srvError = e.what();
+    }
+  });
+
+  std::streamsize received = 0;
+  try {
+    con.exceptions(std::iostream::failbit | std::iostream::badbit);
+    mobs::MrpcSession clientSession{};
+    mobs::MrpcEc client(con, con, &clientSession, false);
+    client.startSession("testkey", "googletest", cpriv, "", spub);
+    MrpcPerson p1;
+    client.sendSingle(p1);
+    std::unique_ptr<MrpcPerson> res;
+    while (not (res = client.getResult<MrpcPerson>()))
+      client.parseClient();
+    EXPECT_EQ("Heinrich", res->name());
+    while (not client.inByteStreamAvail())
+      client.parseClient();
+    EXPECT_EQ(sz, client.getAttachmentLength());
+    int fd = ::open(outFile.c_str(), O_WRONLY | O_TRUNC);
+    if (fd < 0)
+      THROW("open failed");
+    received = client.receiveAttachment(fd);
+    ::close(fd);
+  } catch (std::exception &e) {
+    ADD_FAILURE() << "client: " << e.what();
+  }
+  // ein blockierter Server erhält damit EOF
+  con.exceptions(std::iostream::goodbit);
+  con.shutdown();
+  srv.join();
+
+  EXPECT_EQ("", srvError);
+  EXPECT_EQ(sz, sent);
+  EXPECT_EQ(sz, received);
+  ifstream i(outFile);
+  string result((std::istreambuf_iterator<char>(i)), std::istreambuf_iterator<char>());
+  EXPECT_TRUE(content.substr(10) == result);
+  ::remove(inFile.c_str());
+  ::remove(outFile.c_str());
+}
+
 }
\ No newline at end of file
@@ -268,6 +268,45 @@ TEST(objtypeTest, tobase64) {
 
 }
 
+void checkBase64Block() {
+  std::vector<u_char> v;
+  for (size_t i = 0; i < 300; i++)
+    v.push_back(u_char(i * 7 + i / 13));
+  for (size_t n = 0; n < v.size(); n += (n < 70 ? 1 : 13)) {
+    std::string r;
+    ::mobs::copy_base64(v.cbegin(), v.cbegin() + n, std::back_inserter(r), "\n ");
+    std::string b;
+    ::mobs::append_base64(b, v.data(), n, "\n ");
+    ASSERT_EQ(r, b) << "len " << n;
+    std::vector<u_char> d;
+    ::mobs::from_string_base64(b, d);
+    EXPECT_TRUE(std::equal(d.cbegin(), d.cend(), v.cbegin()) and d.size() == n) << "len " << n;
+  }
+  v.pop_back();
+  std::string s = ::mobs::to_string_base64(v);
+  std::vector<u_char> d(s.length());
+  size_t done = ::mobs::decode_base64(s.c_str(), s.length(), d.data());
+  // letzte Gruppe endet auf Padding
+  EXPECT_EQ(s.length() - 4, done);
+  EXPECT_TRUE(std::equal(v.cbegin(), v.cbegin() + done / 4 * 3, d.cbegin()));
+  s[130] = '*';
+  EXPECT_EQ(128, ::mobs::decode_base64(s.c_str(), s.length(), d.data()));
+  EXPECT_ANY_THROW(::mobs::from_string_base64(s, d));
+}
+
+TEST(objtypeTest, base64Block) {
+  EXPECT_FALSE(::mobs::base64_implementation("neon"));
+  for (auto impl : {"scalar", "ssse3", "avx2"}) {
+    if (not ::mobs::base64_implementation(impl))
+      continue;
+    SCOPED_TRACE(impl);
+    EXPECT_STREQ(impl, ::mobs::base64_implementation());
+    checkBase64Block();
+  }
+  ASSERT_TRUE(::mobs::base64_implementation(""));
+}
+
+
 
 TEST(objtypeTest, times) {
   mobs::MobsMemberInfo mi;